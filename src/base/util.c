@@ -6,6 +6,7 @@
 
 #include "base/util.h"
 
+#include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
@@ -162,32 +163,80 @@ out:
  * sysfs-related utilities
  */
 
-int sid_util_sysfs_get(const char *path, char *buf, size_t buf_size, size_t *char_count)
+int sid_util_sysfs_open(const char *path)
 {
-	FILE  *fp;
-	size_t len;
-	int    r = -1;
+	int fd;
 
-	if (!(fp = fopen(path, "r"))) {
-		r = -errno;
-		goto out;
-	}
+	if ((fd = open(path, O_PATH | O_DIRECTORY | O_CLOEXEC)) < 0)
+		return -errno;
 
-	if (!(fgets(buf, buf_size, fp))) {
-		r = -EIO;
-		goto out;
-	}
+	return fd;
+}
 
-	if ((len = strlen(buf)) && buf[len - 1] == '\n')
-		buf[--len] = '\0';
+int sid_util_sysfs_get_at(int dir_fd, const char *path, char *buf, size_t buf_size, size_t *char_count)
+{
+	ssize_t n;
+	char   *p;
+	size_t  len;
+	int     fd;
+
+	if (!buf_size)
+		return -EINVAL;
+
+	if ((fd = openat(dir_fd, path, O_RDONLY | O_CLOEXEC)) < 0)
+		return -errno;
+
+	n = sid_util_fd_read_all(fd, buf, buf_size - 1);
+	(void) close(fd);
+
+	if (n < 0)
+		return n;
+
+	if (!n)
+		return -EIO;
+
+	buf[n] = '\0';
+
+	if ((p = memchr(buf, '\n', n)))
+		*p = '\0';
+
+	len = p ? (size_t) (p - buf) : (size_t) n;
 
 	if (char_count)
 		*char_count = len + 1;
 
-	r = 0;
-out:
-	if (fp)
-		fclose(fp);
+	return 0;
+}
+
+int sid_util_sysfs_get(const char *path, char *buf, size_t buf_size, size_t *char_count)
+{
+	return sid_util_sysfs_get_at(AT_FDCWD, path, buf, buf_size, char_count);
+}
+
+int sid_util_sysfs_dir_iter_at(int dir_fd, const char *path, void *buf, size_t buf_size, sid_util_sysfs_dir_fn_t fn, void *arg)
+{
+	struct dirent64 *dent;
+	ssize_t          n, pos;
+	int              fd, r = 0;
+
+	if ((fd = openat(dir_fd, path, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+		return -errno;
+
+	while ((n = getdents64(fd, buf, buf_size)) > 0) {
+		for (pos = 0; pos < n; pos += dent->d_reclen) {
+			dent = (struct dirent64 *) ((char *) buf + pos);
 
+			if (dent->d_name[0] == '.' && (!dent->d_name[1] || (dent->d_name[1] == '.' && !dent->d_name[2])))
+				continue;
+
+			if ((r = fn(dent->d_name, arg)) < 0)
+				goto out;
+		}
+	}
+
+	if (n < 0)
+		r = -errno;
+out:
+	(void) close(fd);
 	return r;
 }
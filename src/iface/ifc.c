@@ -10,6 +10,7 @@
 #include "iface/ifc-internal.h"
 
 #include <errno.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
@@ -34,12 +35,14 @@ static const char * const _cmd_names[] = {
 	[SID_IFC_CMD_DBSTATS]    = "dbstats",
 	[SID_IFC_CMD_RESOURCES]  = "resources",
 	[SID_IFC_CMD_DEVICES]    = "devices",
+	[SID_IFC_CMD_WATCH]      = "watch",
 };
 
 struct sid_ifc_rsl {
 	struct sid_buf *buf;
 	const char     *shm;
 	size_t          shm_len;
+	int             fd; /* kept open for SID_IFC_CMD_WATCH */
 };
 
 static inline bool _needs_mem_fd(sid_ifc_cmd_t cmd)
@@ -58,6 +61,9 @@ void sid_ifc_rsl_free(struct sid_ifc_rsl *rsl)
 	if (rsl->shm != MAP_FAILED)
 		(void) munmap((void *) rsl->shm, rsl->shm_len);
 
+	if (rsl->fd >= 0)
+		(void) close(rsl->fd);
+
 	free(rsl);
 }
 
@@ -219,6 +225,96 @@ out:
 	return r;
 }
 
+static int _add_watch_filter_to_buf(struct sid_buf *buf, struct sid_ifc_watch_data *data)
+{
+	int r = 0;
+
+	if (data->ns && (r = sid_buf_add_fmt(buf, NULL, NULL, "%s=%s", SID_IFC_WATCH_KEY_NS, data->ns)) < 0)
+		goto out;
+
+	if (data->prefix && (r = sid_buf_add_fmt(buf, NULL, NULL, "%s=%s", SID_IFC_WATCH_KEY_PREFIX, data->prefix)) < 0)
+		goto out;
+out:
+	return r;
+}
+
+/*
+ * Receive exactly one size-prefixed message from fd to buf. Unlike sid_buf_read,
+ * this never reads past the end of the message so it is safe to use on a stream
+ * where more messages may follow.
+ */
+static int _recv_msg(struct sid_buf *buf, int fd)
+{
+	SID_BUF_SIZE_PREFIX_TYPE msg_size;
+	const void              *mem;
+	ssize_t                  n;
+	int                      r;
+
+	if ((n = sid_util_fd_read_all(fd, &msg_size, SID_BUF_SIZE_PREFIX_LEN)) != SID_BUF_SIZE_PREFIX_LEN) {
+		if (n < 0)
+			return n;
+		return n ? -EBADMSG : -ENODATA;
+	}
+
+	if (msg_size < SID_BUF_SIZE_PREFIX_LEN + SID_IFC_MSG_HEADER_SIZE)
+		return -EBADMSG;
+
+	msg_size -= SID_BUF_SIZE_PREFIX_LEN;
+
+	if ((r = sid_buf_reset(buf)) < 0 || (r = sid_buf_add(buf, NULL, msg_size, &mem, NULL)) < 0)
+		return r;
+
+	n = sid_util_fd_read_all(fd, (void *) mem, msg_size);
+	(void) sid_buf_unbind_mem(buf, mem);
+
+	if (n != msg_size)
+		return n < 0 ? n : -EBADMSG;
+
+	return 0;
+}
+
+int sid_ifc_rsl_get_fd(struct sid_ifc_rsl *rsl)
+{
+	if (!rsl)
+		return -EINVAL;
+
+	return rsl->fd >= 0 ? rsl->fd : -ENOTCONN;
+}
+
+int sid_ifc_rsl_next(struct sid_ifc_rsl *rsl)
+{
+	if (!rsl)
+		return -EINVAL;
+
+	if (rsl->fd < 0)
+		return -ENOTCONN;
+
+	return _recv_msg(rsl->buf, rsl->fd);
+}
+
+static int _add_dbdump_filter_to_buf(struct sid_buf *buf, struct sid_ifc_dbdump_data *data)
+{
+	int r = 0;
+
+	if (data->ns && (r = sid_buf_add_fmt(buf, NULL, NULL, "%s=%s", SID_IFC_DBDUMP_KEY_NS, data->ns)) < 0)
+		goto out;
+
+	if (data->mod && (r = sid_buf_add_fmt(buf, NULL, NULL, "%s=%s", SID_IFC_DBDUMP_KEY_MOD, data->mod)) < 0)
+		goto out;
+
+	if (data->dev && (r = sid_buf_add_fmt(buf, NULL, NULL, "%s=%s", SID_IFC_DBDUMP_KEY_DEV, data->dev)) < 0)
+		goto out;
+
+	if (data->prefix && (r = sid_buf_add_fmt(buf, NULL, NULL, "%s=%s", SID_IFC_DBDUMP_KEY_PREFIX, data->prefix)) < 0)
+		goto out;
+
+	if (data->flags &&
+	    (r = sid_buf_add_fmt(buf, NULL, NULL, "%s=%" PRIu64, SID_IFC_DBDUMP_KEY_FLAGS, data->flags)) < 0)
+		goto out;
+out:
+	return r;
+}
+
 int sid_ifc_req(struct sid_ifc_req *req, struct sid_ifc_rsl **rsl_p)
 {
 	int                 socket_fd = -1;
@@ -241,6 +337,7 @@ int sid_ifc_req(struct sid_ifc_req *req, struct sid_ifc_rsl **rsl_p)
 
 	rsl->shm     = MAP_FAILED;
 	rsl->shm_len = 0;
+	rsl->fd      = -1;
 
 	if (!(rsl->buf = buf = sid_buf_create(&SID_BUF_SPEC(.mode = SID_BUF_MODE_SIZE_PREFIX), &SID_BUF_INIT(.alloc_step = 1), &r)))
 		goto out;
@@ -273,6 +370,14 @@ int sid_ifc_req(struct sid_ifc_req *req, struct sid_ifc_rsl **rsl_p)
 				if ((r = _add_checkpoint_env_to_buf(buf, &req->data.checkpoint)) < 0)
 					goto out;
 				break;
+			case SID_IFC_CMD_DBDUMP:
+				if ((r = _add_dbdump_filter_to_buf(buf, &req->data.dbdump)) < 0)
+					goto out;
+				break;
+			case SID_IFC_CMD_WATCH:
+				if ((r = _add_watch_filter_to_buf(buf, &req->data.watch)) < 0)
+					goto out;
+				break;
 			default:
 				/* no extra data to add for other commands */
 				break;
@@ -292,6 +397,19 @@ int sid_ifc_req(struct sid_ifc_req *req, struct sid_ifc_rsl **rsl_p)
 	if ((r = sid_buf_reset(buf) < 0))
 		goto out;
 
+	if (req->cmd == SID_IFC_CMD_WATCH) {
+		/* change records may follow the reply right away, keep them in the socket */
+		if ((r = _recv_msg(buf, socket_fd)) < 0) {
+			if (r == -ENODATA)
+				r = -EBADMSG;
+			goto out;
+		}
+
+		rsl->fd   = socket_fd;
+		socket_fd = -1;
+		goto out;
+	}
+
 	for (;;) {
 		n = sid_buf_read(buf, socket_fd);
 		if (n > 0) {
@@ -364,3 +482,103 @@ out:
 
 	return r;
 }
+
+#define CBOR_MAJOR_MASK   0xe0
+#define CBOR_INFO_MASK    0x1f
+#define CBOR_MAJOR_UINT   0x00
+#define CBOR_MAJOR_NINT   0x20
+#define CBOR_MAJOR_BSTR   0x40
+#define CBOR_MAJOR_TSTR   0x60
+#define CBOR_MAJOR_ARRAY  0x80
+#define CBOR_MAJOR_MAP    0xa0
+#define CBOR_MAJOR_OTHER  0xe0
+#define CBOR_INFO_UINT8   24
+#define CBOR_INFO_UINT64  27
+#define CBOR_INFO_INDEF   31
+#define CBOR_SIMPLE_FALSE 20
+#define CBOR_SIMPLE_TRUE  21
+
+int sid_ifc_cbor_next(const char **data, size_t *size, struct sid_ifc_cbor_item *item)
+{
+	const unsigned char *p;
+	uint8_t              major, info;
+	uint64_t             val = 0;
+	size_t               len = 1;
+
+	if (!data || !*data || !size || !item)
+		return -EINVAL;
+
+	if (!*size)
+		return -ENODATA;
+
+	p     = (const unsigned char *) *data;
+	major = p[0] & CBOR_MAJOR_MASK;
+	info  = p[0] & CBOR_INFO_MASK;
+
+	if (info < CBOR_INFO_UINT8)
+		val = info;
+	else if (info <= CBOR_INFO_UINT64) {
+		/* 1, 2, 4 or 8 bytes of argument in network byte order */
+		len += (size_t) 1 << (info - CBOR_INFO_UINT8);
+		if (*size < len)
+			return -EBADMSG;
+		for (size_t i = 1; i < len; i++)
+			val = (val << 8) | p[i];
+	} else if (info != CBOR_INFO_INDEF)
+		return -EBADMSG;
+
+	switch (major) {
+		case CBOR_MAJOR_UINT:
+		case CBOR_MAJOR_NINT:
+			if (info == CBOR_INFO_INDEF)
+				return -EBADMSG;
+			if (major == CBOR_MAJOR_UINT) {
+				item->type     = SID_IFC_CBOR_UINT;
+				item->val.uint = val;
+			} else {
+				if (val > INT64_MAX)
+					return -ERANGE;
+				item->type     = SID_IFC_CBOR_NINT;
+				item->val.nint = -1 - (int64_t) val;
+			}
+			break;
+
+		case CBOR_MAJOR_BSTR:
+		case CBOR_MAJOR_TSTR:
+			/* chunked strings are never produced by SID */
+			if (info == CBOR_INFO_INDEF)
+				return -ENOTSUP;
+			if (val > *size - len)
+				return -EBADMSG;
+			item->type        = major == CBOR_MAJOR_BSTR ? SID_IFC_CBOR_BSTR : SID_IFC_CBOR_TSTR;
+			item->val.str.mem = *data + len;
+			item->val.str.len = val;
+			len += val;
+			break;
+
+		case CBOR_MAJOR_ARRAY:
+		case CBOR_MAJOR_MAP:
+			item->type      = major == CBOR_MAJOR_ARRAY ? SID_IFC_CBOR_ARRAY : SID_IFC_CBOR_MAP;
+			item->val.count = info == CBOR_INFO_INDEF ? SID_IFC_CBOR_COUNT_INDEFINITE : val;
+			break;
+
+		case CBOR_MAJOR_OTHER:
+			if (info == CBOR_INFO_INDEF)
+				item->type = SID_IFC_CBOR_BREAK;
+			else if (info == CBOR_SIMPLE_FALSE || info == CBOR_SIMPLE_TRUE) {
+				item->type        = SID_IFC_CBOR_BOOL;
+				item->val.boolean = info == CBOR_SIMPLE_TRUE;
+			} else
+				return -ENOTSUP;
+			break;
+
+		default:
+			/* tags */
+			return -ENOTSUP;
+	}
+
+	*data += len;
+	*size -= len;
+
+	return 0;
+}
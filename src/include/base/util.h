@@ -36,7 +36,22 @@ bool sid_util_kernel_get_arg(const char *arg, char **value, int *ret_code);
  * sysfs-related utilities.
  */
 
+/*
+ * The '_at' variants resolve path relative to dir_fd, usually a device's sysfs
+ * directory opened once with sid_util_sysfs_open so that repeated lookups do not
+ * need to compose and walk the full path each time.
+ */
+typedef int (*sid_util_sysfs_dir_fn_t)(const char *name, void *arg);
+
+int sid_util_sysfs_open(const char *path);
 int sid_util_sysfs_get(const char *path, char *buf, size_t buf_size, size_t *char_count);
+int sid_util_sysfs_get_at(int dir_fd, const char *path, char *buf, size_t buf_size, size_t *char_count);
+
+/*
+ * Calls fn for each entry in a directory, except "." and "..", reading the directory with
+ * getdents64 into caller-supplied buf. Stops and returns fn's return value if it is negative.
+ */
+int sid_util_sysfs_dir_iter_at(int dir_fd, const char *path, void *buf, size_t buf_size, sid_util_sysfs_dir_fn_t fn, void *arg);
 
 #ifdef __cplusplus
 }
@@ -29,6 +29,21 @@ struct sid_ifc_msg_header {
 #define SID_IFC_SOCKET_PATH     "\0sid-ubridge.socket"
 #define SID_IFC_SOCKET_PATH_LEN (sizeof(SID_IFC_SOCKET_PATH) - 1)
 
+/*
+ * Keys used in "key=value\0" pairs carried with SID_IFC_CMD_DBDUMP request.
+ */
+#define SID_IFC_DBDUMP_KEY_NS     "NS"
+#define SID_IFC_DBDUMP_KEY_MOD    "MOD"
+#define SID_IFC_DBDUMP_KEY_DEV    "DEV"
+#define SID_IFC_DBDUMP_KEY_PREFIX "PREFIX"
+#define SID_IFC_DBDUMP_KEY_FLAGS  "FLAGS"
+
+/*
+ * Keys used in "key=value\0" pairs carried with SID_IFC_CMD_WATCH request.
+ */
+#define SID_IFC_WATCH_KEY_NS      "NS"
+#define SID_IFC_WATCH_KEY_PREFIX  "PREFIX"
+
 #ifdef __cplusplus
 }
 #endif
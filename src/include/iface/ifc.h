@@ -30,7 +30,8 @@ typedef enum {
 	SID_IFC_CMD_DBSTATS    = 8,
 	SID_IFC_CMD_RESOURCES  = 9,
 	SID_IFC_CMD_DEVICES    = 10,
-	_SID_IFC_CMD_END       = SID_IFC_CMD_DEVICES,
+	SID_IFC_CMD_WATCH      = 11,
+	_SID_IFC_CMD_END       = SID_IFC_CMD_WATCH,
 } sid_ifc_cmd_t;
 
 #define SID_IFC_CMD_STATUS_MASK_OVERALL UINT64_C(0x0000000000000001)
@@ -41,6 +42,7 @@ typedef enum {
 #define SID_IFC_CMD_FL_FMT_TABLE        UINT16_C(0x0000)
 #define SID_IFC_CMD_FL_FMT_JSON         UINT16_C(0x0001)
 #define SID_IFC_CMD_FL_FMT_ENV          UINT16_C(0x0002)
+#define SID_IFC_CMD_FL_FMT_CBOR         UINT16_C(0x0003)
 #define SID_IFC_CMD_FL_UNMODIFIED_DATA  UINT16_C(0x0004)
 
 struct sid_ifc_checkpoint_data {
@@ -54,6 +56,19 @@ struct sid_ifc_unmodified_data {
 	size_t size;
 };
 
+struct sid_ifc_dbdump_data {
+	char    *ns;     /* namespace: udev/U, dev/D, mod/M, devmod/X, glob/G */
+	char    *mod;    /* full name of the module owning the records */
+	char    *dev;    /* device ID or device alias (major:minor, name or alias key) */
+	char    *prefix; /* raw key prefix */
+	uint64_t flags;  /* flags the records must have set (SID_KV_FL_*) */
+};
+
+struct sid_ifc_watch_data {
+	char *ns;     /* namespace: udev/U, dev/D, mod/M, devmod/X, glob/G */
+	char *prefix; /* raw key prefix */
+};
+
 struct sid_ifc_req {
 	sid_ifc_cmd_t cmd;
 	uint64_t      flags;
@@ -62,11 +77,49 @@ struct sid_ifc_req {
 	union {
 		struct sid_ifc_checkpoint_data checkpoint;
 		struct sid_ifc_unmodified_data unmodified;
+		struct sid_ifc_dbdump_data     dbdump;
+		struct sid_ifc_watch_data      watch;
 	} data;
 };
 
 struct sid_ifc_rsl;
 
+/*
+ * Response data requested with SID_IFC_CMD_FL_FMT_CBOR is a sequence of CBOR (RFC 8949)
+ * data items followed by a terminating null byte which is not part of the CBOR data.
+ * Documents and elements are encoded as maps keyed by field names, arrays as arrays.
+ *
+ * Only the subset of CBOR produced by SID is decoded: integers, byte and text strings,
+ * definite and indefinite-length arrays and maps, false, true and the break stop code.
+ */
+typedef enum {
+	SID_IFC_CBOR_UINT,
+	SID_IFC_CBOR_NINT,
+	SID_IFC_CBOR_BSTR,
+	SID_IFC_CBOR_TSTR,
+	SID_IFC_CBOR_ARRAY,
+	SID_IFC_CBOR_MAP,
+	SID_IFC_CBOR_BOOL,
+	SID_IFC_CBOR_BREAK,
+} sid_ifc_cbor_type_t;
+
+#define SID_IFC_CBOR_COUNT_INDEFINITE UINT64_MAX
+
+struct sid_ifc_cbor_item {
+	sid_ifc_cbor_type_t type;
+
+	union {
+		uint64_t uint;    /* SID_IFC_CBOR_UINT */
+		int64_t  nint;    /* SID_IFC_CBOR_NINT */
+		bool     boolean; /* SID_IFC_CBOR_BOOL */
+		uint64_t count;   /* SID_IFC_CBOR_ARRAY/MAP: number of items or SID_IFC_CBOR_COUNT_INDEFINITE */
+		struct {
+			const char *mem; /* not null-terminated */
+			size_t      len;
+		} str;            /* SID_IFC_CBOR_BSTR/TSTR */
+	} val;
+};
+
 const char   *sid_ifc_cmd_type_to_name(sid_ifc_cmd_t cmd);
 sid_ifc_cmd_t sid_ifc_cmd_name_to_type(const char *cmd_name);
 int           sid_ifc_req(struct sid_ifc_req *req, struct sid_ifc_rsl **rsl);
@@ -74,6 +127,25 @@ void          sid_ifc_rsl_free(struct sid_ifc_rsl *rsl);
 int           sid_ifc_rsl_get_status(struct sid_ifc_rsl *rsl, uint64_t *status);
 int           sid_ifc_rsl_get_protocol(struct sid_ifc_rsl *rsl, uint8_t *prot);
 const char   *sid_ifc_rsl_get_data(struct sid_ifc_rsl *rsl, size_t *size_p);
+
+/*
+ * SID_IFC_CMD_WATCH keeps the connection open after the initial reply and the
+ * daemon keeps sending one message with change records for each committed
+ * update of records matching the filter. The file descriptor can be polled
+ * for readability, sid_ifc_rsl_next then receives next message to rsl
+ * and returns -ENODATA when the daemon closes the connection.
+ */
+int sid_ifc_rsl_get_fd(struct sid_ifc_rsl *rsl);
+int sid_ifc_rsl_next(struct sid_ifc_rsl *rsl);
+
+/*
+ * Decode next CBOR item from data and advance data/size past it.
+ * Container items only carry their count, contained items follow
+ * in subsequent calls. Returns -ENODATA if there is no more data,
+ * -EBADMSG on truncated data and -ENOTSUP on unsupported item.
+ */
+int sid_ifc_cbor_next(const char **data, size_t *size, struct sid_ifc_cbor_item *item);
+
 #ifdef __cplusplus
 }
 #endif
@@ -14,6 +14,8 @@
 extern "C" {
 #endif
 
+struct mem_slab_stats;
+
 typedef struct bptree      bptree_t;
 typedef struct bptree_iter bptree_iter_t;
 
@@ -54,9 +56,18 @@ void     *bptree_lookup(bptree_t *bptree, const char *key, size_t *data_size, un
 int       bptree_get_height(bptree_t *bptree);
 size_t    bptree_get_size(bptree_t *bptree, size_t *meta_size, size_t *data_size);
 size_t    bptree_get_entry_count(bptree_t *bptree);
+unsigned  bptree_get_slab_stats(bptree_t *bptree, struct mem_slab_stats *stats, unsigned count);
 int       bptree_destroy(bptree_t *bptree);
 int       bptree_destroy_with_fn(bptree_t *bptree, bptree_iterate_fn_t fn, void *fn_arg);
 
+/*
+ * While the cursor is active, the tree remembers where the last key was
+ * looked up. Lookups and updates of keys which fall into the same leaf do
+ * not descend from the root then. This pays off for keys coming in order.
+ */
+void bptree_cursor_begin(bptree_t *bptree);
+void bptree_cursor_end(bptree_t *bptree);
+
 void bptree_iter(bptree_t *bptree, const char *key_start, const char *key_end, bptree_iterate_fn_t fn, void *fn_arg);
 
 bptree_iter_t *bptree_iter_create(bptree_t *bptree, const char *key_start, const char *key_end);
@@ -23,6 +23,7 @@ typedef enum {
 	FMT_TABLE,
 	FMT_JSON,
 	FMT_ENV,
+	FMT_CBOR,
 } fmt_output_t;
 
 int fmt_doc_start(fmt_output_t format, struct sid_buf *buf, int level);
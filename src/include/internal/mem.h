@@ -24,6 +24,68 @@ extern "C" {
 void *mem_zalloc(size_t size) __malloc;
 void *mem_freen(void *mem);
 
+/*
+ * Arena for short-lived scratch memory.
+ *
+ * Allocations are carved out of larger chunks and they are never freed one by one.
+ * Instead, mem_arena_release frees everything allocated since the mark was taken,
+ * so nested users can share one arena as long as they release in reverse order.
+ * Released chunks are kept for reuse until the arena is destroyed.
+ */
+struct mem_arena;
+
+struct mem_arena_mark {
+	void  *chunk;
+	size_t used;
+};
+
+struct mem_arena     *mem_arena_create(size_t chunk_size);
+void                  mem_arena_destroy(struct mem_arena *arena);
+void                 *mem_arena_alloc(struct mem_arena *arena, size_t size);
+struct mem_arena_mark mem_arena_get_mark(struct mem_arena *arena);
+void                  mem_arena_release(struct mem_arena *arena, struct mem_arena_mark mark);
+
+/*
+ * Slab allocator for many small objects of the same size.
+ *
+ * Objects are carved out of aligned pages, each page keeps its own list of freed
+ * objects. Allocations are served from the first page with free objects so objects
+ * allocated one after another end up close together. Pages which become empty are
+ * returned to the system, except for one spare page kept to avoid page thrashing.
+ */
+struct mem_slab;
+
+/*
+ * Slab cache with size classes for objects of variable size. Objects bigger
+ * than the largest size class are allocated directly from the system, but they
+ * are still tracked by the cache so they are freed on cache destruction.
+ */
+struct mem_slab_cache;
+
+#define MEM_SLAB_CACHE_CLASS_COUNT 16
+#define MEM_SLAB_CACHE_STATS_COUNT (MEM_SLAB_CACHE_CLASS_COUNT + 1)
+
+struct mem_slab_stats {
+	const char *name;
+	size_t      obj_size;  /* 0 for objects bigger than the largest size class */
+	size_t      obj_count; /* number of allocated objects */
+	size_t      obj_limit; /* number of objects which fit the pages without allocating new ones */
+	size_t      page_count;
+	size_t      mem_size; /* total memory taken from the system */
+};
+
+struct mem_slab *mem_slab_create(const char *name, size_t obj_size);
+void             mem_slab_destroy(struct mem_slab *slab);
+void            *mem_slab_alloc(struct mem_slab *slab);
+void             mem_slab_free(struct mem_slab *slab, void *obj);
+void             mem_slab_get_stats(struct mem_slab *slab, struct mem_slab_stats *stats);
+
+struct mem_slab_cache *mem_slab_cache_create(const char *name);
+void                   mem_slab_cache_destroy(struct mem_slab_cache *cache);
+void                  *mem_slab_cache_alloc(struct mem_slab_cache *cache, size_t size);
+void                   mem_slab_cache_free(struct mem_slab_cache *cache, void *obj, size_t size);
+unsigned               mem_slab_cache_get_stats(struct mem_slab_cache *cache, struct mem_slab_stats *stats, unsigned count);
+
 #ifdef __cplusplus
 }
 #endif
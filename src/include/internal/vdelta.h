@@ -0,0 +1,69 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2017-2025 Red Hat, Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef _SID_VDELTA_H
+#define _SID_VDELTA_H
+
+#include <stddef.h>
+#include <sys/uio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Delta calculation for vectors of strings.
+ *
+ * All input vectors are arrays of iovecs pointing to NUL-terminated strings sorted
+ * by strcmp. Output items are appended at v[cnt] of each output vector and cnt is
+ * incremented so the caller can have a header prepared in front. Output items are
+ * sorted as well and they point to the same strings as input items. The caller is
+ * responsible for providing enough space in output vectors, see capacity notes below.
+ * No memory is allocated.
+ */
+
+typedef enum {
+	VDELTA_OP_SET,   /* new vector replaces old vector */
+	VDELTA_OP_PLUS,  /* new vector items are added to old vector */
+	VDELTA_OP_MINUS, /* new vector items are removed from old vector */
+} vdelta_op_t;
+
+struct vdelta_vec {
+	struct iovec *v;
+	size_t        cnt;
+};
+
+/*
+ * Calculates the result of applying 'new' to 'old' with given operation in one pass.
+ *   plus:  items added to old vector (capacity: new.cnt)
+ *   minus: items removed from old vector (capacity: old.cnt)
+ *   final: resulting vector (capacity: old.cnt + new.cnt)
+ */
+void vdelta_step(vdelta_op_t              op,
+                 const struct vdelta_vec *old,
+                 const struct vdelta_vec *new,
+                 struct vdelta_vec       *plus,
+                 struct vdelta_vec       *minus,
+                 struct vdelta_vec       *final);
+
+/*
+ * Accumulates step delta (new_plus, new_minus) into absolute delta (old_plus, old_minus),
+ * dropping items which cancel each other out.
+ *   abs_plus:  (old_plus - new_minus) + (new_plus - old_minus) (capacity: old_plus.cnt + new_plus.cnt)
+ *   abs_minus: (old_minus - new_plus) + (new_minus - old_plus) (capacity: old_minus.cnt + new_minus.cnt)
+ */
+void vdelta_abs(const struct vdelta_vec *old_plus,
+                const struct vdelta_vec *old_minus,
+                const struct vdelta_vec *new_plus,
+                const struct vdelta_vec *new_minus,
+                struct vdelta_vec       *abs_plus,
+                struct vdelta_vec       *abs_minus);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -7,6 +7,7 @@
 #ifndef _SID_KVS_H
 #define _SID_KVS_H
 
+#include "internal/mem.h"
 #include "resource/res.h"
 
 #include <sys/uio.h>
@@ -128,6 +129,24 @@ struct sid_kvs_set_args {
 int sid_kvs_set(sid_res_t *kv_store_res, struct sid_kvs_set_args *args);
 #define sid_kvs_va_set(kv_store_res, ...) sid_kvs_set((kv_store_res), &((struct sid_kvs_set_args) {__VA_ARGS__}))
 
+/*
+ * Sets 'count' items in one go, each one as if set with sid_kvs_set.
+ *   - Items are processed in key order, not in array order. Items with the same key
+ *     keep their relative order so the last one in the array is the one that stays.
+ *   - All items are set under one transaction. If there's no transaction active, the
+ *     function starts one itself and commits it at the end, otherwise it becomes part
+ *     of the active transaction.
+ *   - An item that fails to be set is rolled back without affecting the other items.
+ *   - If results is not NULL, it must have 'count' items to store sid_kvs_set return
+ *     code for each item in args.
+ *
+ * Returns:
+ *    0 if all items set
+ *   -EINVAL or -ENOMEM if the batch could not be processed at all
+ *   return code of the first item in args that failed to be set otherwise
+ */
+int sid_kvs_set_batch(sid_res_t *kv_store_res, struct sid_kvs_set_args *args, size_t count, int *results);
+
 struct sid_kvs_get_args {
 	const char       *key;
 	size_t           *size;
@@ -161,6 +180,42 @@ struct sid_kvs_unset_args {
 int sid_kvs_unset(sid_res_t *kv_store_res, struct sid_kvs_unset_args *args);
 #define sid_kvs_va_unset(kv_store_res, ...) sid_kvs_unset((kv_store_res), &((struct sid_kvs_unset_args) {__VA_ARGS__}))
 
+struct sid_kvs_unset_range_args {
+	const char            *key_start;
+	const char            *key_end;
+	const char            *archive_prefix;
+	sid_kvs_update_cb_fn_t fn;
+	void                  *fn_arg;
+};
+
+struct sid_kvs_unset_prefix_args {
+	const char            *prefix;
+	const char            *archive_prefix;
+	sid_kvs_update_cb_fn_t fn;
+	void                  *fn_arg;
+};
+
+/*
+ * Unset all keys in range <key_start, key_end> or all keys with given prefix.
+ * NULL key_start or key_end means the range is not limited at that end.
+ *   - Each key is unset the same way as with sid_kvs_unset, including calling fn with fn_arg
+ *     to confirm the action for each key.
+ *   - If archive_prefix is set, each key is archived under archive_prefix + key.
+ *   - Only supported with SID_KVS_BACKEND_BPTREE.
+ *
+ * Returns:
+ *   number of keys unset
+ *   -ENOTSUP if the backend does not support ordered key ranges
+ *   -EINVAL or -ENOMEM on error
+ */
+int sid_kvs_unset_range(sid_res_t *kv_store_res, struct sid_kvs_unset_range_args *args);
+#define sid_kvs_va_unset_range(kv_store_res, ...)                                                                                  \
+	sid_kvs_unset_range((kv_store_res), &((struct sid_kvs_unset_range_args) {__VA_ARGS__}))
+
+int sid_kvs_unset_prefix(sid_res_t *kv_store_res, struct sid_kvs_unset_prefix_args *args);
+#define sid_kvs_va_unset_prefix(kv_store_res, ...)                                                                                 \
+	sid_kvs_unset_prefix((kv_store_res), &((struct sid_kvs_unset_prefix_args) {__VA_ARGS__}))
+
 /*
  * Add alias for given key.
  *   - if the alias is already used and is pointing to a different record
@@ -173,12 +228,83 @@ int sid_kvs_unset(sid_res_t *kv_store_res, struct sid_kvs_unset_args *args);
  */
 int sid_kvs_add_alias(sid_res_t *kv_store_res, const char *key, const char *alias, bool force);
 
+#define SID_KVS_IDX_FL_NONE     UINT32_C(0x00000000)
+#define SID_KVS_IDX_FL_NO_BUILD UINT32_C(0x00000001)
+
+typedef uint32_t sid_kvs_idx_fl_t;
+
+/*
+ * Secondary index specification.
+ *   - prefix:   prefix of alias keys the index consists of, it must not be used by any other key
+ *   - match_fn: returns true if the record with given key, data and flags belongs to the index
+ *   - part_fn:  optional, writes a key part into part buffer which is then placed between the prefix
+ *               and the key in the alias key so the index can be searched by that part, the part
+ *               must depend on the key only; returns false if there's no part (record not indexed)
+ *   - fn_arg:   argument passed to match_fn and part_fn
+ *   - flags:    SID_KVS_IDX_FL_NO_BUILD to not index records which already exist in the store
+ */
+struct sid_kvs_index_spec {
+	const char *prefix;
+	bool (*match_fn)(const char *key, void *data, size_t data_size, sid_kvs_val_fl_t flags, void *arg);
+	bool (*part_fn)(const char *key, char *part, size_t part_size, void *arg);
+	void            *fn_arg;
+	sid_kvs_idx_fl_t flags;
+};
+
+/*
+ * Registers secondary index.
+ *   - The store maintains the index itself on each set and unset, including archive keys,
+ *     so that each record matching the index has an alias '<prefix><part><key>'.
+ *   - Alias changes are part of the transaction, if there's one active.
+ *   - The index is then iterated with sid_kvs_iter_create_prefix using the prefix (and the part).
+ *   - Only the bptree backend supports indexes.
+ *
+ * Returns:
+ *    0 if index registered
+ *   -ENOTSUP if the backend does not support indexes
+ *   -EBUSY if there's a transaction active
+ *   -ENOMEM if failed to register the index or build it from existing records
+ */
+int sid_kvs_index_register(sid_res_t *kv_store_res, const struct sid_kvs_index_spec *spec);
+
 size_t sid_kvs_get_size(sid_res_t *kv_store_res, size_t *meta_size, size_t *data_size);
 
+/*
+ * Get statistics for slabs the store allocates its values and backend's internal
+ * structures from. Fills at most 'count' items in 'stats' and returns the number
+ * of items filled. SID_KVS_SLAB_STATS_COUNT items is always enough.
+ */
+#define SID_KVS_SLAB_STATS_COUNT (2 * MEM_SLAB_CACHE_STATS_COUNT + 2)
+
+unsigned sid_kvs_get_slab_stats(sid_res_t *kv_store_res, struct mem_slab_stats *stats, unsigned count);
+
 int  sid_kvs_transaction_begin(sid_res_t *kv_store_res);
 void sid_kvs_transaction_end(sid_res_t *kv_store_res, bool rollback);
 bool sid_kvs_transaction_active(sid_res_t *kv_store_res);
 
+/*
+ * Savepoint within a transaction. It just marks how far the transaction has
+ * got so far, there's nothing to release. Rolling back to a savepoint undoes
+ * all changes made after the savepoint was taken while keeping the ones made
+ * before and the transaction stays active. Savepoints taken after the one
+ * rolled back to become invalid, the savepoint itself can be reused.
+ * Savepoints taken in another transaction are invalid too.
+ *
+ * Returns:
+ *    0 on success
+ *   -ENOENT if there's no transaction active
+ *   -ERANGE if the savepoint is found invalid (sid_kvs_rollback_to only)
+ */
+struct sid_kvs_savepoint {
+	unsigned trans_gen;    /* transaction the savepoint was taken in */
+	unsigned rollback_cnt; /* number of rollbacks to savepoints done in the transaction before */
+	size_t   rollback_pos;
+	size_t   unset_pos;
+};
+
+int sid_kvs_savepoint(sid_res_t *kv_store_res, struct sid_kvs_savepoint *savepoint);
+int sid_kvs_rollback_to(sid_res_t *kv_store_res, const struct sid_kvs_savepoint *savepoint);
+
 typedef struct sid_kvs_iter sid_kvs_iter_t;
 
 sid_kvs_iter_t *sid_kvs_iter_create(sid_res_t *kv_store_res, const char *key_start, const char *key_end);
@@ -173,6 +173,8 @@ int sid_res_ev_create_io(sid_res_t            *res,
                          const char           *name,
                          void                 *data);
 
+int sid_res_ev_set_io_events(sid_res_ev_src_t *es, uint32_t events);
+
 int sid_res_ev_create_signal(sid_res_t                *res,
                              sid_res_ev_src_t        **es,
                              sigset_t                  mask,
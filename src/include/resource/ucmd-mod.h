@@ -14,6 +14,7 @@
 #include "resource/mod.h"
 
 #include <inttypes.h>
+#include <stdbool.h>
 #include <stddef.h>
 
 #ifdef __cplusplus
@@ -39,6 +40,8 @@ extern "C" {
 #define SID_UCMD_MOD_FN_NAME_SCAN_B_EXIT         "sid_ucmd_scan_b_exit"
 #define SID_UCMD_MOD_FN_NAME_SCAN_ERROR          "sid_ucmd_scan_error"
 
+#define SID_UCMD_MOD_SYM_NAME_SCAN_CACHEABLE     "sid_ucmd_scan_cacheable"
+
 struct sid_ucmd_common_ctx;
 struct sid_ucmd_ctx;
 
@@ -111,6 +114,15 @@ typedef int sid_ucmd_fn_t(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx);
 #define SID_UCMD_SCAN_B_EXIT(fn)         SID_UCMD_FN(scan_b_exit, _SID_UCMD_FN_CHECK_TYPE(fn))
 #define SID_UCMD_SCAN_ERROR(fn)          SID_UCMD_FN(scan_error, _SID_UCMD_FN_CHECK_TYPE(fn))
 
+/*
+ * Declare that the results the module stores in SID_KV_NS_UDEV during stage A
+ * depend only on the device content. For a device which has not changed since
+ * the last scan (same diskseq, size and content fingerprint), the results are
+ * replayed from the scan cache on a CHANGE event and the module's stage A phase
+ * functions are not called.
+ */
+#define SID_UCMD_SCAN_CACHEABLE(val)     bool sid_ucmd_scan_cacheable = val;
+
 /*
  * Functions to retrieve device properties associated with given command ctx.
  */
@@ -125,6 +137,13 @@ uint64_t       sid_ucmd_ev_get_dev_seqnum(struct sid_ucmd_ctx *ucmd_ctx);
 uint64_t       sid_ucmd_ev_get_dev_diskseq(struct sid_ucmd_ctx *ucmd_ctx);
 const char    *sid_ucmd_ev_get_dev_synth_uuid(struct sid_ucmd_ctx *ucmd_ctx);
 
+/*
+ * Returns O_PATH file descriptor for device's sysfs directory, opened on first call and closed
+ * automatically when the command finishes, or negative errno value on error. Use with the
+ * sid_util_sysfs_*_at functions to read sysfs attributes relative to this directory.
+ */
+int sid_ucmd_ev_get_dev_sysfs_fd(struct sid_ucmd_ctx *ucmd_ctx);
+
 typedef enum {
 	SID_KV_NS_UNDEFINED, /* namespace not defined */
 	SID_KV_NS_UDEV,      /* per-device ns with records in the scope of current device
@@ -254,6 +273,15 @@ const char **sid_ucmd_dev_alias_get(sid_res_t *mod_res, struct sid_ucmd_ctx *ucm
 #define sid_ucmd_dev_alias_va_get(mod_res, ucmd_ctx, ...)                                                                          \
 	sid_ucmd_dev_alias_get(mod_res, ucmd_ctx, &((struct sid_ucmd_dev_alias_get_args) {__VA_ARGS__}))
 
+/*
+ * Same as sid_ucmd_dev_alias_get, but the result is allocated from memory owned by
+ * the command. It stays valid until the command finishes and it must not be freed.
+ */
+const char **
+	sid_ucmd_dev_alias_get_scoped(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx, struct sid_ucmd_dev_alias_get_args *args);
+#define sid_ucmd_dev_alias_va_get_scoped(mod_res, ucmd_ctx, ...)                                                                   \
+	sid_ucmd_dev_alias_get_scoped(mod_res, ucmd_ctx, &((struct sid_ucmd_dev_alias_get_args) {__VA_ARGS__}))
+
 int sid_ucmd_group_create(sid_res_t           *mod_res,
                           struct sid_ucmd_ctx *ucmd_ctx,
                           sid_kv_ns_t          group_ns,
@@ -300,6 +328,15 @@ const char **sid_ucmd_dev_stack_get(sid_res_t *mod_res, struct sid_ucmd_ctx *ucm
 #define sid_ucmd_dev_stack_va_get(mod_res, ucmd_ctx, ...)                                                                          \
 	sid_ucmd_dev_stack_get(mod_res, ucmd_ctx, &((struct sid_ucmd_dev_stack_get_args) {__VA_ARGS__}))
 
+/*
+ * Same as sid_ucmd_dev_stack_get, but the result is allocated from memory owned by
+ * the command. It stays valid until the command finishes and it must not be freed.
+ */
+const char **
+	sid_ucmd_dev_stack_get_scoped(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx, struct sid_ucmd_dev_stack_get_args *args);
+#define sid_ucmd_dev_stack_va_get_scoped(mod_res, ucmd_ctx, ...)                                                                   \
+	sid_ucmd_dev_stack_get_scoped(mod_res, ucmd_ctx, &((struct sid_ucmd_dev_stack_get_args) {__VA_ARGS__}))
+
 #ifdef __cplusplus
 }
 #endif
@@ -40,6 +40,16 @@ struct sid_wrk_init_cb_spec {
 
 #define SID_WRK_INIT_CB_SPEC(...) ((struct sid_wrk_init_cb_spec) {__VA_ARGS__})
 
+/* Worker exit specification */
+typedef int sid_wrk_exit_cb_fn_t(sid_res_t *res, const siginfo_t *si, void *arg);
+
+struct sid_wrk_exit_cb_spec {
+	sid_wrk_exit_cb_fn_t *fn;
+	void                 *arg;
+};
+
+#define SID_WRK_EXIT_CB_SPEC(...) ((struct sid_wrk_exit_cb_spec) {__VA_ARGS__})
+
 /* Wire specification */
 typedef enum {
 	SID_WRK_WIRE_NONE,
@@ -130,6 +140,7 @@ struct sid_wrk_timeout_spec {
 struct sid_wrk_ctl_res_params {
 	sid_wrk_type_t                    worker_type;   /* type of workers this controller creates */
 	struct sid_wrk_init_cb_spec       init_cb_spec;  /* worker initialization callback specification */
+	struct sid_wrk_exit_cb_spec       exit_cb_spec;  /* worker exit callback specification (called in proxy) */
 	const struct sid_wrk_chan_spec   *channel_specs; /* NULL-terminated list of proxy <-> worker channel specs */
 	const struct sid_wrk_timeout_spec timeout_spec;  /* timeout specification */
 };
@@ -170,6 +181,7 @@ bool            sid_wrk_ctl_detect_worker(sid_res_t *res);
 sid_wrk_state_t sid_wrk_ctl_get_worker_state(sid_res_t *res);
 const char     *sid_wrk_ctl_get_worker_id(sid_res_t *res);
 void           *sid_wrk_ctl_get_worker_arg(sid_res_t *res);
+pid_t           sid_wrk_ctl_get_worker_pid(sid_res_t *res);
 
 /* Yield current worker and make it available for others to use. */
 int sid_wrk_ctl_yield_worker(sid_res_t *res);
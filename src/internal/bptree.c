@@ -29,10 +29,17 @@
  *     the same record with the original key
  *   - added 'bptree_destroy_with_fn' to call custom fn before each record
  *     is unreferenced/removed
+ *   - allocate records, keys and nodes from slabs, keep key string together
+ *     with its bptree_key_t and node's key and pointer arrays together with
+ *     the node itself
+ *   - added 'bptree_cursor_begin/end' to find the leaf for keys coming in
+ *     order without descending from the root each time
  */
 
 #include "internal/bptree.h"
 
+#include "internal/mem.h"
+
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
@@ -44,8 +51,8 @@ typedef struct bptree_record {
 } bptree_record_t;
 
 typedef struct bptree_key {
-	const char *key;
-	unsigned    ref_count;
+	unsigned ref_count;
+	char     key[];
 } bptree_key_t;
 
 /*
@@ -87,6 +94,30 @@ typedef enum {
 	LOOKUP_PREFIX,
 } bptree_lookup_method_t;
 
+/*
+ * Cursor remembering the path from the root to the leaf found by the last
+ * lookup. Keys in the range of the subtree under a node on the path are
+ * greater than the 'lower' and less than or equal to the 'upper' separator
+ * key above the node. The next lookup climbs the path only until the key
+ * falls into the range and descends from there, so keys coming in order
+ * mostly share the path instead of descending from the root each time.
+ * Any change in the tree's structure resets the cursor.
+ *
+ * Each internal node has at least two children, so the tree's height
+ * never reaches BPTREE_CURSOR_MAX_DEPTH with a size_t number of entries.
+ */
+#define BPTREE_CURSOR_MAX_DEPTH (sizeof(size_t) * 8)
+
+typedef struct bptree_cursor {
+	bool active;
+	int  depth; /* number of valid levels in path, 0 if not set */
+	struct {
+		struct bptree_node *node;
+		bptree_key_t       *lower;
+		bptree_key_t       *upper;
+	} path[BPTREE_CURSOR_MAX_DEPTH];
+} bptree_cursor_t;
+
 typedef struct bptree_iter {
 	bptree_lookup_method_t method;
 	bptree_t              *bptree;
@@ -108,11 +139,15 @@ typedef struct bptree_iter {
  */
 
 typedef struct bptree {
-	bptree_node_t *root;
-	int            order;
-	size_t         meta_size;
-	size_t         data_size;
-	size_t         num_entries;
+	bptree_node_t         *root;
+	int                    order;
+	size_t                 meta_size;
+	size_t                 data_size;
+	size_t                 num_entries;
+	struct mem_slab       *record_slab;
+	struct mem_slab       *node_slab;
+	struct mem_slab_cache *key_cache;
+	bptree_cursor_t        cursor;
 } bptree_t;
 
 static bptree_node_t *_insert_into_parent(bptree_t       *bptree,
@@ -122,6 +157,14 @@ static bptree_node_t *_insert_into_parent(bptree_t       *bptree,
                                           bptree_node_t  *right);
 static bptree_node_t *_delete_entry(bptree_t *bptree, bptree_node_t *n, bptree_key_t *bkey, void *pointer);
 
+static void _free_bptree(bptree_t *bptree)
+{
+	mem_slab_destroy(bptree->record_slab);
+	mem_slab_destroy(bptree->node_slab);
+	mem_slab_cache_destroy(bptree->key_cache);
+	free(bptree);
+}
+
 /*
  * Create new tree.
  */
@@ -132,7 +175,7 @@ bptree_t *bptree_create(int order)
 	if (order <= 3)
 		return NULL;
 
-	if (!(bptree = malloc(sizeof(bptree_t))))
+	if (!(bptree = mem_zalloc(sizeof(bptree_t))))
 		return NULL;
 
 	bptree->root        = NULL;
@@ -141,6 +184,15 @@ bptree_t *bptree_create(int order)
 	bptree->data_size   = 0;
 	bptree->num_entries = 0;
 
+	if (!(bptree->record_slab = mem_slab_create("bptree-record", sizeof(bptree_record_t))) ||
+	    !(bptree->node_slab = mem_slab_create("bptree-node",
+	                                          sizeof(bptree_node_t) + (order - 1) * sizeof(bptree_key_t *) +
+	                                                  order * sizeof(void *))) ||
+	    !(bptree->key_cache = mem_slab_cache_create("bptree-key"))) {
+		_free_bptree(bptree);
+		return NULL;
+	}
+
 	return bptree;
 }
 
@@ -175,6 +227,19 @@ size_t bptree_get_size(bptree_t *bptree, size_t *meta_size, size_t *data_size)
 	return bptree->meta_size + bptree->data_size;
 }
 
+unsigned bptree_get_slab_stats(bptree_t *bptree, struct mem_slab_stats *stats, unsigned count)
+{
+	unsigned n = 0;
+
+	if (n < count)
+		mem_slab_get_stats(bptree->record_slab, &stats[n++]);
+
+	if (n < count)
+		mem_slab_get_stats(bptree->node_slab, &stats[n++]);
+
+	return n + mem_slab_cache_get_stats(bptree->key_cache, stats + n, count - n);
+}
+
 size_t bptree_get_entry_count(bptree_t *bptree)
 {
 	return bptree->num_entries;
@@ -184,16 +249,34 @@ size_t bptree_get_entry_count(bptree_t *bptree)
  * Traces the path from the root to a leaf, searching by key.
  * Returns the leaf containing the given key.
  */
+static bool _in_cursor_level(bptree_cursor_t *cursor, int level, const char *key)
+{
+	return (!cursor->path[level].lower || strcmp(key, cursor->path[level].lower->key) > 0) &&
+	       (!cursor->path[level].upper || strcmp(key, cursor->path[level].upper->key) <= 0);
+}
+
 static bptree_node_t *_find_leaf(bptree_t *bptree, const char *key)
 {
-	int            i;
-	bptree_node_t *c;
+	bptree_cursor_t *cursor = &bptree->cursor;
+	bptree_key_t    *lower  = NULL, *upper = NULL;
+	int              i, level = 0;
+	bptree_node_t   *c;
 
 	if (!bptree->root)
 		return NULL;
 
 	c = bptree->root;
 
+	if (cursor->active && cursor->depth) {
+		/* the root level is never bounded, so the climb stops there at the latest */
+		for (level = cursor->depth - 1; level && !_in_cursor_level(cursor, level, key); level--)
+			;
+
+		c     = cursor->path[level].node;
+		lower = cursor->path[level].lower;
+		upper = cursor->path[level].upper;
+	}
+
 	while (!c->is_leaf) {
 		i = 0;
 
@@ -204,12 +287,48 @@ static bptree_node_t *_find_leaf(bptree_t *bptree, const char *key)
 				break;
 		}
 
+		if (cursor->active) {
+			cursor->path[level].node  = c;
+			cursor->path[level].lower = lower;
+			cursor->path[level].upper = upper;
+
+			if (i > 0)
+				lower = c->bkeys[i - 1];
+			if (i < c->num_keys)
+				upper = c->bkeys[i];
+			level++;
+		}
+
 		c = (bptree_node_t *) c->pointers[i];
 	}
 
+	if (cursor->active) {
+		cursor->path[level].node  = c;
+		cursor->path[level].lower = lower;
+		cursor->path[level].upper = upper;
+		cursor->depth             = level + 1;
+	}
+
 	return c;
 }
 
+static void _reset_cursor(bptree_t *bptree)
+{
+	bptree->cursor.depth = 0;
+}
+
+void bptree_cursor_begin(bptree_t *bptree)
+{
+	bptree->cursor.active = true;
+	_reset_cursor(bptree);
+}
+
+void bptree_cursor_end(bptree_t *bptree)
+{
+	bptree->cursor.active = false;
+	_reset_cursor(bptree);
+}
+
 /*
  * Looks up and returns the record to which a key refers.
  */
@@ -301,7 +420,7 @@ static bptree_record_t *_make_record(bptree_t *bptree, void *data, size_t data_s
 {
 	bptree_record_t *rec;
 
-	if (!(rec = malloc(sizeof(bptree_record_t))))
+	if (!(rec = mem_slab_alloc(bptree->record_slab)))
 		return NULL;
 
 	rec->data_size     = data_size;
@@ -321,7 +440,7 @@ static void _destroy_record(bptree_t *bptree, bptree_record_t *rec)
 	bptree->data_size -= rec->data_size;
 	bptree->num_entries--;
 
-	free(rec);
+	mem_slab_free(bptree->record_slab, rec);
 }
 
 static bptree_record_t *_ref_record(bptree_record_t *rec)
@@ -341,28 +460,26 @@ static void _unref_record(bptree_t *bptree, bptree_record_t *rec)
 static bptree_key_t *_make_bkey(bptree_t *bptree, const char *key)
 {
 	bptree_key_t *bkey;
+	size_t        size = sizeof(*bkey) + strlen(key) + 1;
 
-	if (!(bkey = malloc(sizeof(bptree_key_t))))
+	if (!(bkey = mem_slab_cache_alloc(bptree->key_cache, size)))
 		return NULL;
 
-	if (!(bkey->key = strdup(key))) {
-		free(bkey);
-		return NULL;
-	}
-
+	memcpy(bkey->key, key, size - sizeof(*bkey));
 	bkey->ref_count    = 0;
 
-	bptree->meta_size += (sizeof(*bkey) + strlen(key) + 1);
+	bptree->meta_size += size;
 
 	return bkey;
 }
 
 static void _destroy_bkey(bptree_t *bptree, bptree_key_t *bkey)
 {
-	bptree->meta_size -= (sizeof(*bkey) + strlen(bkey->key) + 1);
+	size_t size        = sizeof(*bkey) + strlen(bkey->key) + 1;
 
-	free((void *) bkey->key);
-	free(bkey);
+	bptree->meta_size -= size;
+
+	mem_slab_cache_free(bptree->key_cache, bkey, size);
 }
 
 static bptree_key_t *_ref_bkey(bptree_key_t *bkey)
@@ -391,21 +508,14 @@ static bptree_node_t *_make_node(bptree_t *bptree)
 	size_t         pointers_size;
 	size_t         bkeys_size;
 
-	if (!(new_node = malloc(sizeof(bptree_node_t))))
+	/* The node, its key array and its pointer array are allocated as one object. */
+	if (!(new_node = mem_slab_alloc(bptree->node_slab)))
 		return NULL;
 
-	bkeys_size = (bptree->order - 1) * sizeof(bptree_key_t *);
-	if (!(new_node->bkeys = malloc(bkeys_size))) {
-		free(new_node);
-		return NULL;
-	}
-
-	pointers_size = bptree->order * sizeof(void *);
-	if (!(new_node->pointers = malloc(pointers_size))) {
-		free(new_node->bkeys);
-		free(new_node);
-		return NULL;
-	}
+	bkeys_size          = (bptree->order - 1) * sizeof(bptree_key_t *);
+	pointers_size       = bptree->order * sizeof(void *);
+	new_node->bkeys     = (bptree_key_t **) (new_node + 1);
+	new_node->pointers  = (void **) ((char *) new_node->bkeys + bkeys_size);
 
 	new_node->is_leaf   = false;
 	new_node->num_keys  = 0;
@@ -420,9 +530,7 @@ static void _destroy_node(bptree_t *bptree, bptree_node_t *n)
 {
 	bptree->meta_size -= (sizeof(*n) + ((bptree->order - 1) * sizeof(bptree_key_t *)) + (bptree->order * sizeof(void *)));
 
-	free(n->bkeys);
-	free(n->pointers);
-	free(n);
+	mem_slab_free(bptree->node_slab, n);
 }
 
 static bptree_node_t *_make_node_list(bptree_t *bptree, size_t count)
@@ -742,6 +850,8 @@ static bptree_node_t *_create_root(bptree_t *bptree, bptree_key_t *bkey, bptree_
 {
 	bptree_node_t *leaf;
 
+	_reset_cursor(bptree);
+
 	if (!(leaf = _make_node(bptree)))
 		return NULL;
 	leaf->is_leaf                             = true;
@@ -775,6 +885,8 @@ static int _insert(bptree_t *bptree, bptree_key_t *bkey, bptree_record_t *rec)
 	if (!(node_list = _make_node_list(bptree, count)))
 		return -1;
 
+	_reset_cursor(bptree);
+
 	_insert_into_leaf_after_splitting(bptree, &node_list, leaf, bkey, rec);
 	assert(!node_list);
 
@@ -1247,6 +1359,8 @@ static bptree_node_t *_delete_entry(bptree_t *bptree, bptree_node_t *n, bptree_k
 	bptree_key_t  *bk_prime;
 	int            capacity;
 
+	_reset_cursor(bptree);
+
 	/* Remove key and pointer from node. */
 
 	n = _remove_entry_from_node(bptree, n, bkey, pointer);
@@ -1354,7 +1468,7 @@ int bptree_destroy(bptree_t *bptree)
 {
 	if (bptree->root)
 		_destroy_tree_nodes(bptree, bptree->root, NULL, NULL);
-	free(bptree);
+	_free_bptree(bptree);
 	return 0;
 }
 
@@ -1362,7 +1476,7 @@ int bptree_destroy_with_fn(bptree_t *bptree, bptree_iterate_fn_t fn, void *fn_ar
 {
 	if (bptree->root)
 		_destroy_tree_nodes(bptree, bptree->root, fn, fn_arg);
-	free(bptree);
+	_free_bptree(bptree);
 	return 0;
 }
 
@@ -9,8 +9,7 @@
 #include "base/conv.h"
 
 #include <errno.h>
-#include <inttypes.h>
-#include <stdio.h>
+#include <string.h>
 
 #define JSON_START_ELEM  "{"
 #define JSON_END_ELEM    "}"
@@ -18,24 +17,151 @@
 #define JSON_END_ARRAY   "]"
 #define JSON_INDENT      "    "
 
-#define JOIN_STR(format) ((format == FMT_TABLE) ? ": " : "=")
+/* CBOR (RFC 8949) initial byte: major type in upper 3 bits, additional info in lower 5 bits. */
+#define CBOR_MAJOR_UINT   0x00
+#define CBOR_MAJOR_NINT   0x20
+#define CBOR_MAJOR_BSTR   0x40
+#define CBOR_MAJOR_TSTR   0x60
+#define CBOR_MAJOR_ARRAY  0x80
+#define CBOR_MAJOR_MAP    0xa0
+#define CBOR_INFO_UINT8   24
+#define CBOR_INFO_INDEF   31
+#define CBOR_FALSE        0xf4
+#define CBOR_TRUE         0xf5
+#define CBOR_BREAK        0xff
+#define CBOR_ARRAY_INDEF  (CBOR_MAJOR_ARRAY | CBOR_INFO_INDEF)
+#define CBOR_MAP_INDEF    (CBOR_MAJOR_MAP | CBOR_INFO_INDEF)
+
+#define PRINT_LIT(buf, lit) _print_str(buf, "" lit, sizeof(lit) - 1)
 
-static int _print_fmt(struct sid_buf *buf, const char *fmt, ...)
+/*
+ * Word-at-a-time (SWAR) byte tests, see "Bit Twiddling Hacks" by Sean Eron Anderson.
+ * The result is non-zero if any byte in the word matches. It is exact for that
+ * question, but not for the position of the match, that one is found bytewise.
+ */
+#define SWAR_ONES           UINT64_C(0x0101010101010101)
+#define SWAR_HIGHS          UINT64_C(0x8080808080808080)
+#define SWAR_HAS_ZERO(w)    (((w) - SWAR_ONES) & ~(w) & SWAR_HIGHS)
+#define SWAR_HAS_LESS(w, n) (((w) - SWAR_ONES * (n)) & ~(w) & SWAR_HIGHS)
+#define SWAR_HAS_BYTE(w, b) SWAR_HAS_ZERO((w) ^ (SWAR_ONES * (b)))
+
+#define JSON_CHAR_NEEDS_ESCAPE(c) ((unsigned char) (c) < 0x20 || (c) == '"' || (c) == '\\')
+#define JSON_WORD_NEEDS_ESCAPE(w) (SWAR_HAS_LESS(w, 0x20) | SWAR_HAS_BYTE(w, '"') | SWAR_HAS_BYTE(w, '\\'))
+
+static int _print_str(struct sid_buf *buf, const char *str, size_t len)
 {
-	va_list ap;
-	int     r;
+	return sid_buf_add(buf, str, len, NULL, NULL);
+}
 
-	if (!buf || !fmt)
-		return -EINVAL;
+static int _print_cstr(struct sid_buf *buf, const char *str)
+{
+	return _print_str(buf, str, strlen(str));
+}
+
+static int _print_uint64(struct sid_buf *buf, uint64_t value)
+{
+	char  num[20]; /* UINT64_MAX has 20 digits */
+	char *p = num + sizeof(num);
 
-	va_start(ap, fmt);
+	do {
+		*--p   = '0' + value % 10;
+		value /= 10;
+	} while (value);
 
-	r = sid_buf_add_vfmt(buf, NULL, NULL, fmt, ap);
-	if (!r)
-		r = sid_buf_rewind(buf, 1, SID_BUF_POS_REL);
+	return _print_str(buf, p, num + sizeof(num) - p);
+}
 
-	va_end(ap);
-	return r;
+static int _print_int64(struct sid_buf *buf, int64_t value)
+{
+	int r;
+
+	if (value >= 0)
+		return _print_uint64(buf, value);
+
+	if ((r = PRINT_LIT(buf, "-")) < 0)
+		return r;
+
+	/* negate in unsigned arithmetic so INT64_MIN does not overflow */
+	return _print_uint64(buf, -(uint64_t) value);
+}
+
+/* Return length of the leading part of str which does not need JSON escaping. */
+static size_t _json_plain_len(const char *str, size_t len)
+{
+	uint64_t w;
+	size_t   i = 0;
+
+	for (; i + sizeof(w) <= len; i += sizeof(w)) {
+		memcpy(&w, str + i, sizeof(w));
+		if (JSON_WORD_NEEDS_ESCAPE(w))
+			break;
+	}
+
+	while (i < len && !JSON_CHAR_NEEDS_ESCAPE(str[i]))
+		i++;
+
+	return i;
+}
+
+static int _print_json_str(struct sid_buf *buf, const char *str)
+{
+	static const char hex[] = "0123456789abcdef";
+	size_t            len   = strlen(str);
+	size_t            plain;
+	char              esc[6] = "\\u00";
+	int               r;
+
+	if ((r = PRINT_LIT(buf, "\"")) < 0)
+		return r;
+
+	while (len) {
+		plain = _json_plain_len(str, len);
+
+		if (plain && (r = _print_str(buf, str, plain)) < 0)
+			return r;
+
+		str += plain;
+		len -= plain;
+
+		if (!len)
+			break;
+
+		switch (*str) {
+			case '"':
+				r = PRINT_LIT(buf, "\\\"");
+				break;
+			case '\\':
+				r = PRINT_LIT(buf, "\\\\");
+				break;
+			case '\b':
+				r = PRINT_LIT(buf, "\\b");
+				break;
+			case '\f':
+				r = PRINT_LIT(buf, "\\f");
+				break;
+			case '\n':
+				r = PRINT_LIT(buf, "\\n");
+				break;
+			case '\r':
+				r = PRINT_LIT(buf, "\\r");
+				break;
+			case '\t':
+				r = PRINT_LIT(buf, "\\t");
+				break;
+			default:
+				esc[4] = hex[(unsigned char) *str >> 4];
+				esc[5] = hex[(unsigned char) *str & 0xf];
+				r      = _print_str(buf, esc, sizeof(esc));
+		}
+
+		if (r < 0)
+			return r;
+
+		str++;
+		len--;
+	}
+
+	return PRINT_LIT(buf, "\"");
 }
 
 static int _print_binary(const unsigned char *value, size_t len, struct sid_buf *buf)
@@ -60,20 +186,116 @@ static int _print_binary(const unsigned char *value, size_t len, struct sid_buf
 	return r;
 }
 
+static int _cbor_add_byte(struct sid_buf *buf, uint8_t byte)
+{
+	return sid_buf_add(buf, &byte, 1, NULL, NULL);
+}
+
+static int _cbor_add_head(struct sid_buf *buf, uint8_t major, uint64_t value)
+{
+	uint8_t head[9];
+	size_t  len;
+
+	if (value < CBOR_INFO_UINT8)
+		return _cbor_add_byte(buf, major | (uint8_t) value);
+
+	if (value <= UINT8_MAX) {
+		head[0] = major | CBOR_INFO_UINT8;
+		len     = 2;
+	} else if (value <= UINT16_MAX) {
+		head[0] = major | (CBOR_INFO_UINT8 + 1);
+		len     = 3;
+	} else if (value <= UINT32_MAX) {
+		head[0] = major | (CBOR_INFO_UINT8 + 2);
+		len     = 5;
+	} else {
+		head[0] = major | (CBOR_INFO_UINT8 + 3);
+		len     = 9;
+	}
+
+	/* argument is stored in network byte order */
+	for (size_t i = len - 1; i > 0; i--, value >>= 8)
+		head[i] = value & 0xff;
+
+	return sid_buf_add(buf, head, len, NULL, NULL);
+}
+
+static int _cbor_add_str(struct sid_buf *buf, uint8_t major, const char *str, size_t len)
+{
+	int r;
+
+	if ((r = _cbor_add_head(buf, major, len)) < 0 || !len)
+		return r;
+
+	return sid_buf_add(buf, str, len, NULL, NULL);
+}
+
+static int _cbor_add_text(struct sid_buf *buf, const char *str)
+{
+	return _cbor_add_str(buf, CBOR_MAJOR_TSTR, str, strlen(str));
+}
+
+static int _cbor_add_int64(struct sid_buf *buf, int64_t value)
+{
+	if (value < 0)
+		return _cbor_add_head(buf, CBOR_MAJOR_NINT, (uint64_t) (-(value + 1)));
+
+	return _cbor_add_head(buf, CBOR_MAJOR_UINT, (uint64_t) value);
+}
+
 static int _print_indent(struct sid_buf *buf, int level)
 {
-	int r = 0;
+	static const char indent[] = JSON_INDENT JSON_INDENT JSON_INDENT JSON_INDENT;
+	const int         per_add  = (sizeof(indent) - 1) / (sizeof(JSON_INDENT) - 1);
+	int               n, r = 0;
 
 	if (!buf)
 		return -EINVAL;
 
-	for (int i = 0; i < level && !r; i++) {
-		r = _print_fmt(buf, JSON_INDENT);
+	for (; level > 0 && !r; level -= n) {
+		n = level < per_add ? level : per_add;
+		r = _print_str(buf, indent, n * (sizeof(JSON_INDENT) - 1));
 	}
 
 	return r;
 }
 
+/* Separate JSON item from the previous one and indent it. */
+static int _print_json_sep(struct sid_buf *buf, int level, bool with_comma)
+{
+	int r;
+
+	r = with_comma ? PRINT_LIT(buf, ",\n") : PRINT_LIT(buf, "\n");
+	if (!r)
+		r = _print_indent(buf, level);
+
+	return r;
+}
+
+static int _print_json_name(struct sid_buf *buf, int level, const char *name, bool with_comma)
+{
+	int r;
+
+	r = _print_json_sep(buf, level, with_comma);
+	if (!r)
+		r = _print_json_str(buf, name);
+	if (!r)
+		r = PRINT_LIT(buf, ": ");
+
+	return r;
+}
+
+static int _print_name_join(fmt_output_t format, struct sid_buf *buf, const char *name)
+{
+	int r;
+
+	r = _print_cstr(buf, name);
+	if (!r)
+		r = format == FMT_TABLE ? PRINT_LIT(buf, ": ") : PRINT_LIT(buf, "=");
+
+	return r;
+}
+
 int fmt_doc_start(fmt_output_t format, struct sid_buf *buf, int level)
 {
 	int r = 0;
@@ -84,8 +306,9 @@ int fmt_doc_start(fmt_output_t format, struct sid_buf *buf, int level)
 	if (format == FMT_JSON) {
 		r = _print_indent(buf, level);
 		if (!r)
-			r = _print_fmt(buf, JSON_START_ELEM);
-	}
+			r = PRINT_LIT(buf, JSON_START_ELEM);
+	} else if (format == FMT_CBOR)
+		r = _cbor_add_byte(buf, CBOR_MAP_INDEF);
 
 	return r;
 }
@@ -98,12 +321,13 @@ int fmt_doc_end(fmt_output_t format, struct sid_buf *buf, int level)
 		return -EINVAL;
 
 	if (format == FMT_JSON) {
-		r = _print_fmt(buf, "\n");
+		r = PRINT_LIT(buf, "\n");
 		if (!r)
 			r = _print_indent(buf, level);
 		if (!r)
-			r = _print_fmt(buf, JSON_END_ELEM "\n");
-	}
+			r = PRINT_LIT(buf, JSON_END_ELEM "\n");
+	} else if (format == FMT_CBOR)
+		r = _cbor_add_byte(buf, CBOR_BREAK);
 
 	return r;
 }
@@ -116,15 +340,22 @@ int fmt_arr_start(fmt_output_t format, struct sid_buf *buf, int level, const cha
 		return -EINVAL;
 
 	if (format == FMT_JSON) {
-		r = _print_fmt(buf, "%s\n", with_comma ? "," : "");
+		r = _print_json_name(buf, level, array_name, with_comma);
 		if (!r)
-			r = _print_indent(buf, level);
+			r = PRINT_LIT(buf, JSON_START_ARRAY);
+	} else if (format == FMT_CBOR) {
+		r = _cbor_add_text(buf, array_name);
 		if (!r)
-			r = _print_fmt(buf, "\"%s\": %s", array_name, JSON_START_ARRAY);
+			r = _cbor_add_byte(buf, CBOR_ARRAY_INDEF);
 	} else if (format == FMT_ENV) {
-		r = _print_fmt(buf, "%s=\"", array_name);
-	} else if (format == FMT_TABLE)
-		r = _print_fmt(buf, "%s:\n", array_name);
+		r = _print_cstr(buf, array_name);
+		if (!r)
+			r = PRINT_LIT(buf, "=\"");
+	} else if (format == FMT_TABLE) {
+		r = _print_cstr(buf, array_name);
+		if (!r)
+			r = PRINT_LIT(buf, ":\n");
+	}
 
 	return r;
 }
@@ -137,13 +368,15 @@ int fmt_arr_end(fmt_output_t format, struct sid_buf *buf, int level)
 		return -EINVAL;
 
 	if (format == FMT_JSON) {
-		r = _print_fmt(buf, "\n");
+		r = PRINT_LIT(buf, "\n");
 		if (!r)
 			r = _print_indent(buf, level);
 		if (!r)
-			r = _print_fmt(buf, JSON_END_ARRAY);
+			r = PRINT_LIT(buf, JSON_END_ARRAY);
+	} else if (format == FMT_CBOR) {
+		r = _cbor_add_byte(buf, CBOR_BREAK);
 	} else if (format == FMT_ENV) {
-		r = _print_fmt(buf, "\"\n");
+		r = PRINT_LIT(buf, "\"\n");
 	}
 
 	return r;
@@ -157,13 +390,13 @@ int fmt_elm_start(fmt_output_t format, struct sid_buf *buf, int level, bool with
 		return -EINVAL;
 
 	if (format == FMT_JSON) {
-		r = _print_fmt(buf, "%s\n", with_comma ? "," : "");
+		r = _print_json_sep(buf, level, with_comma);
 		if (!r)
-			r = _print_indent(buf, level);
-		if (!r)
-			r = _print_fmt(buf, JSON_START_ELEM);
-	} else if (format == FMT_TABLE && with_comma)
-		r = _print_fmt(buf, "\n");
+			r = PRINT_LIT(buf, JSON_START_ELEM);
+	} else if (format == FMT_CBOR)
+		r = _cbor_add_byte(buf, CBOR_MAP_INDEF);
+	else if (format == FMT_TABLE && with_comma)
+		r = PRINT_LIT(buf, "\n");
 
 	return r;
 }
@@ -176,12 +409,13 @@ int fmt_elm_end(fmt_output_t format, struct sid_buf *buf, int level)
 		return -EINVAL;
 
 	if (format == FMT_JSON) {
-		r = _print_fmt(buf, "\n");
+		r = PRINT_LIT(buf, "\n");
 		if (!r)
 			r = _print_indent(buf, level);
 		if (!r)
-			r = _print_fmt(buf, JSON_END_ELEM);
-	}
+			r = PRINT_LIT(buf, JSON_END_ELEM);
+	} else if (format == FMT_CBOR)
+		r = _cbor_add_byte(buf, CBOR_BREAK);
 
 	return r;
 }
@@ -194,13 +428,20 @@ int fmt_elm_name(fmt_output_t format, struct sid_buf *buf, int level, const char
 		return -EINVAL;
 
 	if (format == FMT_JSON) {
-		r = _print_fmt(buf, "%s\n", with_comma ? "," : "");
+		r = _print_json_sep(buf, level, with_comma);
 		if (!r)
-			r = _print_indent(buf, level);
+			r = _print_json_str(buf, elem_name);
 		if (!r)
-			r = _print_fmt(buf, "\"%s\":\n", elem_name);
-	} else if (format == FMT_TABLE)
-		r = _print_fmt(buf, "%s%s:\n", with_comma ? "\n" : "", elem_name);
+			r = PRINT_LIT(buf, ":\n");
+	} else if (format == FMT_CBOR)
+		r = _cbor_add_text(buf, elem_name);
+	else if (format == FMT_TABLE) {
+		r = with_comma ? PRINT_LIT(buf, "\n") : 0;
+		if (!r)
+			r = _print_cstr(buf, elem_name);
+		if (!r)
+			r = PRINT_LIT(buf, ":\n");
+	}
 
 	return r;
 }
@@ -213,13 +454,20 @@ int fmt_fld_str(fmt_output_t format, struct sid_buf *buf, int level, const char
 		return -EINVAL;
 
 	if (format == FMT_JSON) {
-		r = _print_fmt(buf, "%s\n", with_comma ? "," : "");
+		r = _print_json_name(buf, level, field_name, with_comma);
 		if (!r)
-			r = _print_indent(buf, level);
+			r = _print_json_str(buf, value);
+	} else if (format == FMT_CBOR) {
+		r = _cbor_add_text(buf, field_name);
 		if (!r)
-			r = _print_fmt(buf, "\"%s\": \"%s\"", field_name, value);
-	} else
-		r = _print_fmt(buf, "%s%s%s\n", field_name, JOIN_STR(format), value);
+			r = _cbor_add_text(buf, value);
+	} else {
+		r = _print_name_join(format, buf, field_name);
+		if (!r)
+			r = _print_cstr(buf, value);
+		if (!r)
+			r = PRINT_LIT(buf, "\n");
+	}
 
 	return r;
 }
@@ -238,19 +486,23 @@ int fmt_fld_bin(fmt_output_t    format,
 		return -EINVAL;
 
 	if (format == FMT_JSON) {
-		r = _print_fmt(buf, "%s\n", with_comma ? "," : "");
+		r = _print_json_name(buf, level, field_name, with_comma);
 		if (!r)
-			r = _print_indent(buf, level);
-		if (!r)
-			r = _print_fmt(buf, "\"%s\": \"", field_name);
+			r = PRINT_LIT(buf, "\"");
 		if (!r)
 			r = _print_binary((const unsigned char *) value, len, buf);
 		if (!r)
-			r = _print_fmt(buf, "\"");
+			r = PRINT_LIT(buf, "\"");
+	} else if (format == FMT_CBOR) {
+		r = _cbor_add_text(buf, field_name);
+		if (!r)
+			r = _cbor_add_str(buf, CBOR_MAJOR_BSTR, value, len);
 	} else {
-		_print_fmt(buf, "%s%s", field_name, JOIN_STR(format));
-		_print_binary((const unsigned char *) value, len, buf);
-		_print_fmt(buf, "\n");
+		r = _print_name_join(format, buf, field_name);
+		if (!r)
+			r = _print_binary((const unsigned char *) value, len, buf);
+		if (!r)
+			r = PRINT_LIT(buf, "\n");
 	}
 
 	return r;
@@ -258,21 +510,7 @@ int fmt_fld_bin(fmt_output_t    format,
 
 int fmt_fld_uint(fmt_output_t format, struct sid_buf *buf, int level, const char *field_name, uint value, bool with_comma)
 {
-	int r = 0;
-
-	if (!field_name || !buf)
-		return -EINVAL;
-
-	if (format == FMT_JSON) {
-		r = _print_fmt(buf, "%s\n", with_comma ? "," : "");
-		if (!r)
-			r = _print_indent(buf, level);
-		if (!r)
-			r = _print_fmt(buf, "\"%s\": %u", field_name, value);
-	} else
-		r = _print_fmt(buf, "%s%s%u\n", field_name, JOIN_STR(format), value);
-
-	return r;
+	return fmt_fld_uint64(format, buf, level, field_name, value, with_comma);
 }
 
 int fmt_fld_uint64(fmt_output_t format, struct sid_buf *buf, int level, const char *field_name, uint64_t value, bool with_comma)
@@ -283,13 +521,20 @@ int fmt_fld_uint64(fmt_output_t format, struct sid_buf *buf, int level, const ch
 		return -EINVAL;
 
 	if (format == FMT_JSON) {
-		r = _print_fmt(buf, "%s\n", with_comma ? "," : "");
+		r = _print_json_name(buf, level, field_name, with_comma);
 		if (!r)
-			r = _print_indent(buf, level);
+			r = _print_uint64(buf, value);
+	} else if (format == FMT_CBOR) {
+		r = _cbor_add_text(buf, field_name);
 		if (!r)
-			r = _print_fmt(buf, "\"%s\": %" PRIu64, field_name, value);
-	} else
-		r = _print_fmt(buf, "%s%s%" PRIu64 "\n", field_name, JOIN_STR(format), value);
+			r = _cbor_add_head(buf, CBOR_MAJOR_UINT, value);
+	} else {
+		r = _print_name_join(format, buf, field_name);
+		if (!r)
+			r = _print_uint64(buf, value);
+		if (!r)
+			r = PRINT_LIT(buf, "\n");
+	}
 
 	return r;
 }
@@ -302,13 +547,20 @@ int fmt_fld_int64(fmt_output_t format, struct sid_buf *buf, int level, const cha
 		return -EINVAL;
 
 	if (format == FMT_JSON) {
-		r = _print_fmt(buf, "%s\n", with_comma ? "," : "");
+		r = _print_json_name(buf, level, field_name, with_comma);
 		if (!r)
-			r = _print_indent(buf, level);
+			r = _print_int64(buf, value);
+	} else if (format == FMT_CBOR) {
+		r = _cbor_add_text(buf, field_name);
+		if (!r)
+			r = _cbor_add_int64(buf, value);
+	} else {
+		r = _print_name_join(format, buf, field_name);
+		if (!r)
+			r = _print_int64(buf, value);
 		if (!r)
-			r = _print_fmt(buf, "\"%s\": %" PRIi64, field_name, value);
-	} else
-		r = _print_fmt(buf, "%s%s%" PRIi64 "\n", field_name, JOIN_STR(format), value);
+			r = PRINT_LIT(buf, "\n");
+	}
 
 	return r;
 }
@@ -321,15 +573,26 @@ int fmt_fld_bool(fmt_output_t format, struct sid_buf *buf, int level, const char
 		return -EINVAL;
 
 	if (format == FMT_JSON) {
-		r = _print_fmt(buf, "%s\n", with_comma ? "," : "");
+		r = _print_json_sep(buf, level, with_comma);
 		if (!r)
-			r = _print_indent(buf, level);
+			r = PRINT_LIT(buf, "{");
+		if (!r)
+			r = _print_json_str(buf, field_name);
 		if (!r)
-			r = _print_fmt(buf, "{\"%s\": %s}", field_name, value ? "true" : "false");
+			r = value ? PRINT_LIT(buf, ": true}") : PRINT_LIT(buf, ": false}");
+	} else if (format == FMT_CBOR) {
+		r = _cbor_add_text(buf, field_name);
+		if (!r)
+			r = _cbor_add_byte(buf, value ? CBOR_TRUE : CBOR_FALSE);
 	} else if (format == FMT_ENV) {
-		r = _print_fmt(buf, "%s=%d\n", field_name, value);
-	} else if (value)
-		r = _print_fmt(buf, "%s\n", field_name);
+		r = _print_name_join(format, buf, field_name);
+		if (!r)
+			r = value ? PRINT_LIT(buf, "1\n") : PRINT_LIT(buf, "0\n");
+	} else if (value) {
+		r = _print_cstr(buf, field_name);
+		if (!r)
+			r = PRINT_LIT(buf, "\n");
+	}
 
 	return r;
 }
@@ -342,13 +605,16 @@ int fmt_arr_fld_uint(fmt_output_t format, struct sid_buf *buf, int level, uint v
 		return -EINVAL;
 
 	if (format == FMT_JSON) {
-		r = _print_fmt(buf, "%s\n", with_comma ? "," : "");
+		r = _print_json_sep(buf, level, with_comma);
 		if (!r)
-			r = _print_indent(buf, level);
+			r = _print_uint64(buf, value);
+	} else if (format == FMT_CBOR)
+		r = _cbor_add_head(buf, CBOR_MAJOR_UINT, value);
+	else if (format == FMT_TABLE) {
+		r = _print_uint64(buf, value);
 		if (!r)
-			r = _print_fmt(buf, "%u", value);
-	} else if (format == FMT_TABLE)
-		r = _print_fmt(buf, "%u\n", value);
+			r = PRINT_LIT(buf, "\n");
+	}
 
 	return r;
 }
@@ -361,15 +627,20 @@ int fmt_arr_fld_str(fmt_output_t format, struct sid_buf *buf, int level, const c
 		return -EINVAL;
 
 	if (format == FMT_JSON) {
-		r = _print_fmt(buf, "%s\n", with_comma ? "," : "");
+		r = _print_json_sep(buf, level, with_comma);
 		if (!r)
-			r = _print_indent(buf, level);
-		if (!r)
-			r = _print_fmt(buf, "\"%s\"", value);
+			r = _print_json_str(buf, value);
+	} else if (format == FMT_CBOR) {
+		r = _cbor_add_text(buf, value);
 	} else if (format == FMT_ENV) {
-		r = _print_fmt(buf, "%s%s", with_comma ? "," : "", value);
-	} else if (format == FMT_TABLE)
-		r = _print_fmt(buf, "%s\n", value);
+		r = with_comma ? PRINT_LIT(buf, ",") : 0;
+		if (!r)
+			r = _print_cstr(buf, value);
+	} else if (format == FMT_TABLE) {
+		r = _print_cstr(buf, value);
+		if (!r)
+			r = PRINT_LIT(buf, "\n");
+	}
 
 	return r;
 }
@@ -382,19 +653,19 @@ int fmt_arr_fld_bin(fmt_output_t format, struct sid_buf *buf, int level, const c
 		return -EINVAL;
 
 	if (format == FMT_JSON) {
-		r = _print_fmt(buf, "%s\n", with_comma ? "," : "");
-		if (!r)
-			r = _print_indent(buf, level);
+		r = _print_json_sep(buf, level, with_comma);
 		if (!r)
-			r = _print_fmt(buf, "\"");
+			r = PRINT_LIT(buf, "\"");
 		if (!r)
 			r = _print_binary((const unsigned char *) value, len, buf);
 		if (!r)
-			r = _print_fmt(buf, "\"");
+			r = PRINT_LIT(buf, "\"");
+	} else if (format == FMT_CBOR) {
+		r = _cbor_add_str(buf, CBOR_MAJOR_BSTR, value, len);
 	} else if (format == FMT_TABLE) {
 		r = _print_binary((const unsigned char *) value, len, buf);
 		if (!r)
-			r = _print_fmt(buf, "\n");
+			r = PRINT_LIT(buf, "\n");
 	}
 
 	return r;
@@ -6,6 +6,11 @@
 
 #include "internal/mem.h"
 
+#include "internal/list.h"
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 
 void *mem_zalloc(size_t size)
@@ -23,3 +28,378 @@ void *mem_freen(void *mem)
 	free(mem);
 	return NULL;
 }
+
+struct mem_arena_chunk {
+	struct mem_arena_chunk *next;
+	size_t                  size;
+	size_t                  used;
+	char                    data[] __aligned;
+};
+
+struct mem_arena {
+	size_t                  chunk_size;
+	struct mem_arena_chunk *first;
+	struct mem_arena_chunk *current;
+};
+
+struct mem_arena *mem_arena_create(size_t chunk_size)
+{
+	struct mem_arena *arena;
+
+	if (!(arena = mem_zalloc(sizeof(*arena))))
+		return NULL;
+
+	arena->chunk_size = chunk_size;
+	return arena;
+}
+
+void mem_arena_destroy(struct mem_arena *arena)
+{
+	struct mem_arena_chunk *chunk, *next;
+
+	if (!arena)
+		return;
+
+	for (chunk = arena->first; chunk; chunk = next) {
+		next = chunk->next;
+		free(chunk);
+	}
+
+	free(arena);
+}
+
+void *mem_arena_alloc(struct mem_arena *arena, size_t size)
+{
+	struct mem_arena_chunk *chunk = arena->current, *next;
+	void                   *p;
+
+	size = MEM_ALIGN_UP(size, __BIGGEST_ALIGNMENT__);
+
+	if (!chunk || chunk->size - chunk->used < size) {
+		/* Use spare chunk left after previous release if it is big enough, otherwise drop it. */
+		while ((next = chunk ? chunk->next : arena->first) && next->size < size) {
+			if (chunk)
+				chunk->next = next->next;
+			else
+				arena->first = next->next;
+			free(next);
+		}
+
+		if (!next) {
+			if (!(next = malloc(sizeof(*next) + (size > arena->chunk_size ? size : arena->chunk_size))))
+				return NULL;
+
+			next->next = NULL;
+			next->size = size > arena->chunk_size ? size : arena->chunk_size;
+
+			if (chunk)
+				chunk->next = next;
+			else
+				arena->first = next;
+		}
+
+		next->used     = 0;
+		arena->current = chunk = next;
+	}
+
+	p            = chunk->data + chunk->used;
+	chunk->used += size;
+
+	return p;
+}
+
+struct mem_arena_mark mem_arena_get_mark(struct mem_arena *arena)
+{
+	return (struct mem_arena_mark) {.chunk = arena->current, .used = arena->current ? arena->current->used : 0};
+}
+
+void mem_arena_release(struct mem_arena *arena, struct mem_arena_mark mark)
+{
+	arena->current = mark.chunk;
+
+	if (arena->current)
+		arena->current->used = mark.used;
+}
+
+#define MEM_SLAB_PAGE_SIZE     16384
+#define MEM_SLAB_PAGE_MIN_OBJS 8
+
+struct mem_slab_page {
+	struct list      list;
+	struct mem_slab *slab;
+	void            *free;   /* chain of freed objects */
+	unsigned         used;   /* number of allocated objects */
+	unsigned         bumped; /* number of objects taken from the never-used area */
+	char             data[] __aligned;
+};
+
+struct mem_slab {
+	const char           *name;
+	size_t                obj_size;
+	size_t                page_size;
+	unsigned              page_objs;
+	struct list           partial; /* pages with free objects, allocating from the first one */
+	struct list           full;
+	struct mem_slab_page *spare;
+	size_t                page_count;
+	size_t                obj_count;
+};
+
+struct mem_slab_large {
+	struct list list;
+	size_t      size;
+	char        data[] __aligned;
+};
+
+struct mem_slab_cache {
+	const char      *name;
+	struct mem_slab *slabs[MEM_SLAB_CACHE_CLASS_COUNT];
+	struct list      large;
+	size_t           large_count;
+	size_t           large_size;
+};
+
+/* 16-byte steps up to 128, then 4 classes for each power of two */
+static const size_t _slab_class_sizes[MEM_SLAB_CACHE_CLASS_COUNT] =
+	{16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512};
+
+struct mem_slab *mem_slab_create(const char *name, size_t obj_size)
+{
+	struct mem_slab *slab;
+
+	if (!(slab = mem_zalloc(sizeof(*slab))))
+		return NULL;
+
+	slab->name      = name;
+	/* each object must be able to hold the link to next free object */
+	slab->obj_size  = MEM_ALIGN_UP(obj_size < sizeof(void *) ? sizeof(void *) : obj_size, sizeof(void *));
+	slab->page_size = MEM_SLAB_PAGE_SIZE;
+
+	while ((slab->page_size - sizeof(struct mem_slab_page)) / slab->obj_size < MEM_SLAB_PAGE_MIN_OBJS)
+		slab->page_size <<= 1;
+
+	slab->page_objs = (slab->page_size - sizeof(struct mem_slab_page)) / slab->obj_size;
+
+	list_init(&slab->partial);
+	list_init(&slab->full);
+
+	return slab;
+}
+
+static void _free_list_items(struct list *head)
+{
+	struct list *v, *next;
+
+	for (v = head->n; v != head; v = next) {
+		next = v->n;
+		free(v); /* the list is always the first item in the structure */
+	}
+}
+
+void mem_slab_destroy(struct mem_slab *slab)
+{
+	if (!slab)
+		return;
+
+	_free_list_items(&slab->partial);
+	_free_list_items(&slab->full);
+
+	free(slab->spare);
+	free(slab);
+}
+
+void *mem_slab_alloc(struct mem_slab *slab)
+{
+	struct mem_slab_page *page;
+	void                 *obj;
+
+	if (list_is_empty(&slab->partial)) {
+		if ((page = slab->spare))
+			slab->spare = NULL;
+		else {
+			if (!(page = aligned_alloc(slab->page_size, slab->page_size)))
+				return NULL;
+
+			page->slab   = slab;
+			page->free   = NULL;
+			page->used   = 0;
+			page->bumped = 0;
+			slab->page_count++;
+		}
+
+		list_add(&slab->partial, &page->list);
+	} else
+		page = list_item(slab->partial.n, struct mem_slab_page);
+
+	if ((obj = page->free))
+		page->free = *(void **) obj;
+	else
+		obj = page->data + (size_t) page->bumped++ * slab->obj_size;
+
+	if (++page->used == slab->page_objs) {
+		list_del(&page->list);
+		list_add(&slab->full, &page->list);
+	}
+
+	slab->obj_count++;
+
+	return obj;
+}
+
+void mem_slab_free(struct mem_slab *slab, void *obj)
+{
+	struct mem_slab_page *page;
+
+	if (!obj)
+		return;
+
+	page = (struct mem_slab_page *) ((uintptr_t) obj & ~((uintptr_t) slab->page_size - 1));
+	assert(page->slab == slab);
+
+	slab->obj_count--;
+
+	if (--page->used == 0) {
+		list_del(&page->list);
+
+		if (slab->spare) {
+			free(page);
+			slab->page_count--;
+		} else {
+			page->free   = NULL;
+			page->bumped = 0;
+			slab->spare  = page;
+		}
+
+		return;
+	}
+
+	*(void **) obj = page->free;
+	page->free     = obj;
+
+	if (page->used == slab->page_objs - 1) {
+		/*
+		 * Add the page at the end of the list so we keep allocating
+		 * from the current page and we do not scatter new objects.
+		 */
+		list_del(&page->list);
+		list_add(&slab->partial, &page->list);
+	}
+}
+
+void mem_slab_get_stats(struct mem_slab *slab, struct mem_slab_stats *stats)
+{
+	*stats = (struct mem_slab_stats) {.name       = slab->name,
+	                                  .obj_size   = slab->obj_size,
+	                                  .obj_count  = slab->obj_count,
+	                                  .obj_limit  = slab->page_count * slab->page_objs,
+	                                  .page_count = slab->page_count,
+	                                  .mem_size   = slab->page_count * slab->page_size + sizeof(*slab)};
+}
+
+static unsigned _get_slab_class(size_t size)
+{
+	unsigned bits;
+
+	if (size <= 128)
+		return size ? (size - 1) >> 4 : 0;
+
+	/* position of the highest bit set in size - 1, which is at least 7 here */
+	bits = (sizeof(unsigned long) * 8 - 1) - __builtin_clzl(size - 1);
+
+	return 8 + (bits - 7) * 4 + ((size - 1 - (1UL << bits)) >> (bits - 2));
+}
+
+struct mem_slab_cache *mem_slab_cache_create(const char *name)
+{
+	struct mem_slab_cache *cache;
+
+	if (!(cache = mem_zalloc(sizeof(*cache))))
+		return NULL;
+
+	cache->name = name;
+	list_init(&cache->large);
+
+	return cache;
+}
+
+void mem_slab_cache_destroy(struct mem_slab_cache *cache)
+{
+	unsigned i;
+
+	if (!cache)
+		return;
+
+	for (i = 0; i < MEM_SLAB_CACHE_CLASS_COUNT; i++)
+		mem_slab_destroy(cache->slabs[i]);
+
+	_free_list_items(&cache->large);
+
+	free(cache);
+}
+
+void *mem_slab_cache_alloc(struct mem_slab_cache *cache, size_t size)
+{
+	struct mem_slab_large *large;
+	unsigned               class;
+
+	if (size > _slab_class_sizes[MEM_SLAB_CACHE_CLASS_COUNT - 1]) {
+		if (!(large = malloc(sizeof(*large) + size)))
+			return NULL;
+
+		large->size = size;
+		list_add(&cache->large, &large->list);
+		cache->large_count++;
+		cache->large_size += size;
+
+		return large->data;
+	}
+
+	class = _get_slab_class(size);
+
+	if (!cache->slabs[class] && !(cache->slabs[class] = mem_slab_create(cache->name, _slab_class_sizes[class])))
+		return NULL;
+
+	return mem_slab_alloc(cache->slabs[class]);
+}
+
+void mem_slab_cache_free(struct mem_slab_cache *cache, void *obj, size_t size)
+{
+	struct mem_slab_large *large;
+
+	if (!obj)
+		return;
+
+	if (size > _slab_class_sizes[MEM_SLAB_CACHE_CLASS_COUNT - 1]) {
+		large = (struct mem_slab_large *) ((char *) obj - offsetof(struct mem_slab_large, data));
+		assert(large->size == size);
+
+		list_del(&large->list);
+		cache->large_count--;
+		cache->large_size -= size;
+		free(large);
+
+		return;
+	}
+
+	mem_slab_free(cache->slabs[_get_slab_class(size)], obj);
+}
+
+unsigned mem_slab_cache_get_stats(struct mem_slab_cache *cache, struct mem_slab_stats *stats, unsigned count)
+{
+	unsigned i, n = 0;
+
+	for (i = 0; i < MEM_SLAB_CACHE_CLASS_COUNT && n < count; i++) {
+		if (cache->slabs[i])
+			mem_slab_get_stats(cache->slabs[i], &stats[n++]);
+	}
+
+	if (cache->large_count && n < count)
+		stats[n++] = (struct mem_slab_stats) {.name      = cache->name,
+		                                      .obj_size  = 0,
+		                                      .obj_count = cache->large_count,
+		                                      .obj_limit = cache->large_count,
+		                                      .mem_size  = cache->large_size +
+		                                                  cache->large_count * sizeof(struct mem_slab_large)};
+
+	return n;
+}
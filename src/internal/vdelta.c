@@ -0,0 +1,104 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2017-2025 Red Hat, Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "internal/vdelta.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#define VDELTA_STR(vec, i) ((const char *) (vec)->v[i].iov_base)
+
+static inline void _append(struct vdelta_vec *out, const struct iovec *item)
+{
+	out->v[out->cnt++] = *item;
+}
+
+void vdelta_step(vdelta_op_t              op,
+                 const struct vdelta_vec *old,
+                 const struct vdelta_vec *new,
+                 struct vdelta_vec       *plus,
+                 struct vdelta_vec       *minus,
+                 struct vdelta_vec       *final)
+{
+	size_t i_old = 0, i_new = 0;
+	int    cmp_result;
+
+	while (i_old < old->cnt || i_new < new->cnt) {
+		if (i_old == old->cnt)
+			cmp_result = 1;
+		else if (i_new == new->cnt)
+			cmp_result = -1;
+		else
+			cmp_result = strcmp(VDELTA_STR(old, i_old), VDELTA_STR(new, i_new));
+
+		if (cmp_result < 0) {
+			/* only old vector has the item: removed for SET, kept otherwise */
+			_append(op == VDELTA_OP_SET ? minus : final, &old->v[i_old++]);
+		} else if (cmp_result > 0) {
+			/* only new vector has the item: added for SET and PLUS, ignored for MINUS */
+			if (op != VDELTA_OP_MINUS) {
+				_append(plus, &new->v[i_new]);
+				_append(final, &new->v[i_new]);
+			}
+			i_new++;
+		} else {
+			/* both vectors have the item: removed for MINUS, kept otherwise */
+			_append(op == VDELTA_OP_MINUS ? minus : final, &new->v[i_new]);
+			i_old++;
+			i_new++;
+		}
+	}
+}
+
+/*
+ * Checks if str is in the exclusion vector. As we go through sorted items,
+ * the exclusion vector position only moves forward.
+ */
+static bool _is_excluded(const struct vdelta_vec *excl, size_t *i_excl, const char *str)
+{
+	int cmp_result = -1;
+
+	while (*i_excl < excl->cnt && (cmp_result = strcmp(VDELTA_STR(excl, *i_excl), str)) < 0)
+		(*i_excl)++;
+
+	return *i_excl < excl->cnt && !cmp_result;
+}
+
+/*
+ * Merges (a - a_excl) and (b - b_excl) into out in one pass.
+ * Items equal in a and b are both kept, a's item first.
+ */
+static void _merge_excl(const struct vdelta_vec *a,
+                        const struct vdelta_vec *a_excl,
+                        const struct vdelta_vec *b,
+                        const struct vdelta_vec *b_excl,
+                        struct vdelta_vec       *out)
+{
+	size_t i_a = 0, i_a_excl = 0, i_b = 0, i_b_excl = 0;
+
+	while (i_a < a->cnt || i_b < b->cnt) {
+		if (i_b == b->cnt || (i_a < a->cnt && strcmp(VDELTA_STR(a, i_a), VDELTA_STR(b, i_b)) <= 0)) {
+			if (!_is_excluded(a_excl, &i_a_excl, VDELTA_STR(a, i_a)))
+				_append(out, &a->v[i_a]);
+			i_a++;
+		} else {
+			if (!_is_excluded(b_excl, &i_b_excl, VDELTA_STR(b, i_b)))
+				_append(out, &b->v[i_b]);
+			i_b++;
+		}
+	}
+}
+
+void vdelta_abs(const struct vdelta_vec *old_plus,
+                const struct vdelta_vec *old_minus,
+                const struct vdelta_vec *new_plus,
+                const struct vdelta_vec *new_minus,
+                struct vdelta_vec       *abs_plus,
+                struct vdelta_vec       *abs_minus)
+{
+	_merge_excl(old_plus, new_minus, new_plus, old_minus, abs_plus);
+	_merge_excl(old_minus, new_plus, new_minus, old_plus, abs_minus);
+}
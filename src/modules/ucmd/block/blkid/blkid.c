@@ -6,6 +6,8 @@
 
 #include "blkid-key.h"
 #include "blkid-type.h"
+#include "base/util.h"
+#include "internal/mem.h"
 #include "resource/ucmd-mod.h"
 
 #include <blkid/blkid.h>
@@ -20,10 +22,29 @@
 #include <unistd.h>
 
 SID_UCMD_MOD_PRIO(0)
+SID_UCMD_SCAN_CACHEABLE(true)
+
+/*
+ * If set to 1, devices are probed with O_DIRECT so the probing does not
+ * populate the page cache. The superblock prefetch is not used then.
+ */
+#define KEY_BLKID_DIRECT_IO "SID_BLKID_DIRECT_IO"
+
+/*
+ * The probe is created and configured once in the main process. Each
+ * worker gets its own copy on fork and reuses it for all the devices
+ * it scans, resetting the probe between the devices.
+ */
+struct blkid_mod_ctx {
+	blkid_probe pr;
+	bool        direct_io;
+};
 
 static int _blkid_init(sid_res_t *mod_res, struct sid_ucmd_common_ctx *ucmd_common_ctx)
 {
+	struct blkid_mod_ctx    *blkid_mod;
 	const struct blkid_xkey *xkey;
+	unsigned long long       val;
 	unsigned                 i;
 
 	sid_res_log_debug(mod_res, "init");
@@ -43,17 +64,42 @@ static int _blkid_init(sid_res_t *mod_res, struct sid_ucmd_common_ctx *ucmd_comm
 		return -1;
 	}
 
+	if (!(blkid_mod = mem_zalloc(sizeof(*blkid_mod)))) {
+		sid_res_log_error(mod_res, "Failed to allocate module context structure.");
+		return -1;
+	}
+
+	if (!(blkid_mod->pr = blkid_new_probe())) {
+		sid_res_log_error(mod_res, "Failed to create blkid probe.");
+		free(blkid_mod);
+		return -1;
+	}
+
+	blkid_probe_set_superblocks_flags(blkid_mod->pr,
+	                                  BLKID_SUBLKS_LABEL | BLKID_SUBLKS_UUID | BLKID_SUBLKS_TYPE | BLKID_SUBLKS_SECTYPE |
+	                                          BLKID_SUBLKS_FSINFO | BLKID_SUBLKS_USAGE | BLKID_SUBLKS_VERSION);
+
+	blkid_mod->direct_io = sid_util_env_get_ull(KEY_BLKID_DIRECT_IO, 0, 1, &val) == 0 && val;
+	sid_mod_set_data(mod_res, blkid_mod);
+
 	return 0;
 }
 SID_UCMD_MOD_INIT(_blkid_init)
 
 static int _blkid_exit(sid_res_t *mod_res, struct sid_ucmd_common_ctx *ucmd_common_ctx)
 {
+	struct blkid_mod_ctx    *blkid_mod = sid_mod_get_data(mod_res);
 	const struct blkid_xkey *xkey;
 	unsigned                 i;
 
 	sid_res_log_debug(mod_res, "exit");
 
+	if (blkid_mod) {
+		blkid_free_probe(blkid_mod->pr);
+		free(blkid_mod);
+		sid_mod_set_data(mod_res, NULL);
+	}
+
 	xkey = &blkid_xkey_arr[i = 0];
 	while (xkey->num < U_ID_NUM_KEYS) {
 		if (sid_ucmd_kv_unreserve(mod_res, ucmd_common_ctx, SID_KV_NS_UDEV, xkey->name) < 0) {
@@ -170,34 +216,57 @@ static int _probe_superblocks(blkid_probe pr)
 	return blkid_do_safeprobe(pr);
 }
 
+/*
+ * Most superblocks are located within the first megabyte of the device and
+ * some (e.g. MD raid, ZFS labels) near the device end. Tell the kernel to
+ * read both areas in advance so the I/O is issued at once instead of one
+ * small synchronous read at a time as libblkid walks through the probing
+ * functions. The probing then reads the data from the page cache.
+ */
+#define BLKID_PREFETCH_HEAD_SIZE (1024 * 1024)
+#define BLKID_PREFETCH_TAIL_SIZE (1024 * 1024)
+
+static void _prefetch_superblocks(sid_res_t *mod_res, blkid_probe pr, int fd)
+{
+	blkid_loff_t size = blkid_probe_get_size(pr);
+	int          r;
+
+	if (size <= 0)
+		return;
+
+	if ((r = posix_fadvise(fd, 0, size < BLKID_PREFETCH_HEAD_SIZE ? size : BLKID_PREFETCH_HEAD_SIZE, POSIX_FADV_WILLNEED))) {
+		sid_res_log_error_errno(mod_res, r, "Failed to prefetch device start");
+		return;
+	}
+
+	if (size > BLKID_PREFETCH_HEAD_SIZE + BLKID_PREFETCH_TAIL_SIZE &&
+	    (r = posix_fadvise(fd, size - BLKID_PREFETCH_TAIL_SIZE, BLKID_PREFETCH_TAIL_SIZE, POSIX_FADV_WILLNEED)))
+		sid_res_log_error_errno(mod_res, r, "Failed to prefetch device end");
+}
+
 static int _blkid_scan_next(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx)
 {
-	char        dev_path[PATH_MAX];
-	int64_t     offset = 0;
-	int         noraid = 0;
-	int         fd     = -1;
-	blkid_probe pr     = NULL;
-	const char *data;
-	const char *name;
-	int         nvals;
-	int         i;
-	int         r = -1;
+	struct blkid_mod_ctx *blkid_mod = sid_mod_get_data(mod_res);
+	blkid_probe           pr        = blkid_mod->pr;
+	char                  dev_path[PATH_MAX];
+	int64_t               offset = 0;
+	int                   noraid = 0;
+	int                   fd     = -1;
+	const char           *data;
+	const char           *name;
+	int                   nvals;
+	int                   i;
+	int                   r = -1;
 
 	sid_res_log_debug(mod_res, "scan-next");
 
-	pr = blkid_new_probe();
-	if (!pr)
-		goto out;
-
-	blkid_probe_set_superblocks_flags(pr,
-	                                  BLKID_SUBLKS_LABEL | BLKID_SUBLKS_UUID | BLKID_SUBLKS_TYPE | BLKID_SUBLKS_SECTYPE |
-	                                          BLKID_SUBLKS_FSINFO | BLKID_SUBLKS_USAGE | BLKID_SUBLKS_VERSION);
+	blkid_reset_probe(pr);
 
 	// TODO: Also decide when to use offset (including exact value) and noraid options.
 
 	snprintf(dev_path, sizeof(dev_path), SYSTEM_DEV_PATH "/%s", sid_ucmd_ev_get_dev_name(ucmd_ctx));
 
-	if ((fd = open(dev_path, O_RDONLY | O_CLOEXEC)) < 0) {
+	if ((fd = open(dev_path, O_RDONLY | O_CLOEXEC | (blkid_mod->direct_io ? O_DIRECT : 0))) < 0) {
 		sid_res_log_error_errno(mod_res, errno, "Failed to open device %s", dev_path);
 		goto out;
 	}
@@ -205,6 +274,9 @@ static int _blkid_scan_next(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx)
 	if ((r = blkid_probe_set_device(pr, fd, offset, 0)) < 0)
 		goto out;
 
+	if (!blkid_mod->direct_io)
+		_prefetch_superblocks(mod_res, pr, fd);
+
 	sid_res_log_debug(mod_res, "Probe %s %sraid offset=%" PRIi64, dev_path, noraid ? "no" : "", offset);
 
 	if ((r = _probe_superblocks(pr)) < 0)
@@ -221,10 +293,10 @@ static int _blkid_scan_next(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx)
 
 	r = 0;
 out:
+	/* detach the device from the probe and drop its buffers before closing the fd */
+	(void) blkid_probe_set_device(pr, -1, 0, 0);
 	if (fd >= 0)
 		(void) close(fd);
-	if (pr)
-		blkid_free_probe(pr);
 
 	return r;
 }
@@ -5,12 +5,16 @@
  */
 
 #include "base/util.h"
+#include "internal/mem.h"
 #include "resource/ucmd-mod.h"
 
+#include <dirent.h>
 #include <libudev.h>
+#include <limits.h>
 #include <mpath_valid.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/stat.h>
 
 SID_UCMD_MOD_PRIO(-1)
 
@@ -18,13 +22,95 @@ SID_UCMD_MOD_PRIO(-1)
 #define X_VALID    "VALID"
 #define X_WWID     "WWID"
 
+#define MPATH_CONF_FILE  "/etc/multipath.conf"
+#define MPATH_CONF_DIR   "/etc/multipath/conf.d"
+#define MPATH_WWIDS_FILE "/etc/multipath/wwids"
+
+struct dm_mpath_mod_ctx {
+	int      cmdline_allow; /* result of _kernel_cmdline_allow, evaluated once at init */
+	uint64_t conf_stamp;    /* stamp of multipath config files when the config was last (re)loaded */
+};
+
+static int _kernel_cmdline_allow(void)
+{
+	char *value = NULL;
+
+	if (!sid_util_kernel_get_arg("nompath", NULL, NULL) && !sid_util_kernel_get_arg("nompath", &value, NULL))
+		return 1;
+	if (value && strcmp(value, "off") != 0)
+		return 1;
+	return 0;
+}
+
+static void _conf_stamp_add(uint64_t *stamp, const char *path)
+{
+	struct stat st;
+	uint64_t    fields[5] = {0};
+	int         i;
+
+	/* a missing file still changes the stamp so that adding it later is detected */
+	if (stat(path, &st) == 0) {
+		fields[0] = st.st_dev;
+		fields[1] = st.st_ino;
+		fields[2] = st.st_size;
+		fields[3] = st.st_mtim.tv_sec;
+		fields[4] = st.st_mtim.tv_nsec;
+	}
+
+	for (i = 0; i < 5; i++) {
+		*stamp ^= fields[i];
+		*stamp *= UINT64_C(0x100000001b3);
+	}
+}
+
+/*
+ * Get a stamp of all the files the multipath config is read from. If the
+ * stamp differs from the one recorded at last config (re)load, the config
+ * needs to be reloaded.
+ */
+static uint64_t _get_conf_stamp(void)
+{
+	uint64_t       stamp = UINT64_C(0xcbf29ce484222325);
+	char           path[PATH_MAX];
+	DIR           *dir;
+	struct dirent *dirent;
+
+	_conf_stamp_add(&stamp, MPATH_CONF_FILE);
+	_conf_stamp_add(&stamp, MPATH_WWIDS_FILE);
+	_conf_stamp_add(&stamp, MPATH_CONF_DIR);
+
+	if ((dir = opendir(MPATH_CONF_DIR))) {
+		while ((dirent = readdir(dir))) {
+			if (dirent->d_name[0] == '.')
+				continue;
+
+			if (snprintf(path, sizeof(path), MPATH_CONF_DIR "/%s", dirent->d_name) < sizeof(path))
+				_conf_stamp_add(&stamp, path);
+		}
+		closedir(dir);
+	}
+
+	return stamp;
+}
+
 static int _dm_mpath_init(sid_res_t *mod_res, struct sid_ucmd_common_ctx *ucmd_common_ctx)
 {
+	struct dm_mpath_mod_ctx *mpath_mod;
+
 	sid_res_log_debug(mod_res, "init");
 
+	if (!(mpath_mod = mem_zalloc(sizeof(*mpath_mod)))) {
+		sid_res_log_error(mod_res, "Failed to allocate memory module context structure.");
+		return -1;
+	}
+
+	mpath_mod->cmdline_allow = _kernel_cmdline_allow();
+	mpath_mod->conf_stamp    = _get_conf_stamp();
+
 	/* TODO - set up dm/udev logging */
 	if (mpathvalid_init(MPATH_LOG_PRIO_NOLOG, MPATH_LOG_STDERR)) {
 		sid_res_log_error(mod_res, "failed to initialize mpathvalid");
+		free(mpath_mod);
 		return -1;
 	}
 
@@ -33,9 +119,11 @@ static int _dm_mpath_init(sid_res_t *mod_res, struct sid_ucmd_common_ctx *ucmd_c
 		goto fail;
 	}
 
+	sid_mod_set_data(mod_res, mpath_mod);
 	return 0;
 fail:
 	mpathvalid_exit();
+	free(mpath_mod);
 	return -1;
 }
 SID_UCMD_MOD_INIT(_dm_mpath_init)
@@ -48,21 +136,11 @@ static int _dm_mpath_exit(sid_res_t *mod_res, struct sid_ucmd_common_ctx *ucmd_c
 		sid_res_log_error(mod_res, "Failed to unreserve multipath udev key %s.", U_DEV_PATH);
 
 	mpathvalid_exit();
+	free(sid_mod_get_data(mod_res));
 	return 0;
 }
 SID_UCMD_MOD_EXIT(_dm_mpath_exit)
 
-static int _kernel_cmdline_allow(void)
-{
-	char *value = NULL;
-
-	if (!sid_util_kernel_get_arg("nompath", NULL, NULL) && !sid_util_kernel_get_arg("nompath", &value, NULL))
-		return 1;
-	if (value && strcmp(value, "off") != 0)
-		return 1;
-	return 0;
-}
-
 static int _dm_mpath_reset(sid_res_t *mod_res, struct sid_ucmd_common_ctx *ucmd_common_ctx)
 {
 	sid_res_log_debug(mod_res, "reset");
@@ -78,12 +156,11 @@ static int _is_parent_multipathed(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_
 	char        *p;
 	int          r = 0;
 
-	parent         = sid_ucmd_dev_stack_va_get(mod_res, ucmd_ctx, .method = SID_DEV_SEARCH_IMM_ANC, .ret_code = &r);
+	parent = sid_ucmd_dev_stack_va_get_scoped(mod_res, ucmd_ctx, .method = SID_DEV_SEARCH_IMM_ANC, .ret_code = &r);
 	if (r < 0 || !parent)
 		return 0;
 
 	valid_str = sid_ucmd_kv_va_get(mod_res, ucmd_ctx, .ns = SID_KV_NS_DEV, .frg_dev_key = parent[0], .key = X_VALID);
-	free(parent);
 
 	if (!valid_str || !valid_str[0])
 		return 0;
@@ -105,13 +182,15 @@ static int _is_parent_multipathed(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_
 
 static int _dm_mpath_scan_next(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx)
 {
-	int   r;
-	char *wwid;
-	char  valid_str[2];
+	struct dm_mpath_mod_ctx *mpath_mod = sid_mod_get_data(mod_res);
+	uint64_t                 conf_stamp;
+	int                      r;
+	char                    *wwid;
+	char                     valid_str[2];
 
 	sid_res_log_debug(mod_res, "scan-next");
 
-	if (!_kernel_cmdline_allow()) // treat failure as allowed
+	if (!mpath_mod->cmdline_allow) // treat failure as allowed
 		return 0;
 
 	switch (sid_ucmd_ev_get_dev_type(ucmd_ctx)) {
@@ -123,9 +202,12 @@ static int _dm_mpath_scan_next(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx
 			return 0;
 	}
 
-	if (mpathvalid_reload_config() < 0) {
-		sid_res_log_error(mod_res, "failed to reinitialize mpathvalid");
-		return -1;
+	if ((conf_stamp = _get_conf_stamp()) != mpath_mod->conf_stamp) {
+		if (mpathvalid_reload_config() < 0) {
+			sid_res_log_error(mod_res, "failed to reinitialize mpathvalid");
+			return -1;
+		}
+		mpath_mod->conf_stamp = conf_stamp;
 	}
 	// currently treats MPATH_SMART like MPATH_STRICT
 	r = mpathvalid_is_path(sid_ucmd_ev_get_dev_name(ucmd_ctx), MPATH_DEFAULT, &wwid, NULL, 0);
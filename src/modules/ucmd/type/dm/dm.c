@@ -13,11 +13,15 @@
 #include "resource/mod-reg.h"
 #include "resource/ucmd-mod.h"
 
+#include <fcntl.h>
 #include <limits.h>
 #include <linux/dm-ioctl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/ioctl.h>
 #include <sys/sem.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
 
 #define DM_ID                "dm"
 #define DM_SUBMODULES_ID     DM_ID "_sub"
@@ -71,6 +75,16 @@ struct dm_mod_ctx {
 	sid_res_t *submod_res_current;
 	sid_res_t *submod_res_next;
 	sid_res_t *submod_res;
+	int        control_fd;
+};
+
+struct dm_props {
+	char     name[DM_NAME_LEN];
+	char     uuid[DM_UUID_LEN];
+	char     suspended[10]; /* "0" or "1" value as in sysfs */
+	bool     has_counts;
+	uint32_t open_count;
+	uint32_t event_nr;
 };
 
 typedef uint16_t dm_cookie_base_t;
@@ -115,6 +129,8 @@ static const char *_udev_cookie_flag_names[] = {"DM_UDEV_DISABLE_DM_RULES_FLAG",
 #define SYSFS_DM_NAME       "dm/name"
 #define SYSFS_DM_SUSPENDED  "dm/suspended"
 
+#define DM_CONTROL_PATH     SYSTEM_DEV_PATH "/mapper/control"
+
 static const char _failed_to_set_msg[]       = "Failed to set value for key \"%s\"";
 static const char _failed_to_get_msg[]       = "Failed to get value for key \"%s\"";
 static const char _failed_to_set_alias_msg[] = "Failed to add alias for key \"%s\"";
@@ -311,44 +327,96 @@ static int _get_cookie_props(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx,
 	return 1;
 }
 
-static int _get_sysfs_value(sid_res_t *mod_res, const char *sysfs_path, char *sysfs_entry, char *buf, size_t buf_size)
+static int _get_sysfs_value(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx, const char *sysfs_entry, char *buf, size_t buf_size)
 {
-	char path[PATH_MAX];
-	int  r;
+	int fd, r;
 
-	if (snprintf(path, sizeof(path), "%s%s/%s", SYSTEM_SYSFS_PATH, sysfs_path, sysfs_entry) < 0) {
-		sid_res_log_error(mod_res, "Failed to construct sysfs path for entry %s", sysfs_entry);
-		return -ENOMEM;
+	if ((fd = sid_ucmd_ev_get_dev_sysfs_fd(ucmd_ctx)) < 0) {
+		sid_res_log_error_errno(mod_res, fd, "Failed to open sysfs directory for " DEV_PRINT_FMT, DEV_PRINT(ucmd_ctx));
+		return fd;
 	}
 
-	if ((r = sid_util_sysfs_get(path, buf, buf_size, NULL)) < 0) {
-		sid_res_log_error_errno(mod_res, r, _failed_to_get_sysfs_msg, path);
+	if ((r = sid_util_sysfs_get_at(fd, sysfs_entry, buf, buf_size, NULL)) < 0) {
+		sid_res_log_error_errno(mod_res, r, _failed_to_get_sysfs_msg, sysfs_entry);
 		return r;
 	}
 
 	return 0;
 }
 
-static int _get_sysfs_props(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx)
+static int _get_sysfs_props(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx, struct dm_props *props)
 {
-	const char *sysfs_dev_path;
-	char        name[DM_NAME_LEN];
-	char        uuid[DM_UUID_LEN];
-	char        suspended[10]; /* "Active" or "Suspended" value */
-	int         r;
-
 	/* uuid may be blank, name and suspended property is always set  */
 
-	sysfs_dev_path = sid_ucmd_ev_get_dev_path(ucmd_ctx);
+	if (_get_sysfs_value(mod_res, ucmd_ctx, SYSFS_DM_UUID, props->uuid, sizeof(props->uuid)) < 0)
+		return -1;
 
-	if (_get_sysfs_value(mod_res, sysfs_dev_path, SYSFS_DM_UUID, uuid, sizeof(uuid)) < 0)
+	if (_get_sysfs_value(mod_res, ucmd_ctx, SYSFS_DM_NAME, props->name, sizeof(props->name)) < 0 || !props->name[0])
 		return -1;
 
-	if (_get_sysfs_value(mod_res, sysfs_dev_path, SYSFS_DM_NAME, name, sizeof(name)) < 0 || !name[0])
+	if (_get_sysfs_value(mod_res, ucmd_ctx, SYSFS_DM_SUSPENDED, props->suspended, sizeof(props->suspended)) < 0 ||
+	    !props->suspended[0])
 		return -1;
 
-	if (_get_sysfs_value(mod_res, sysfs_dev_path, SYSFS_DM_SUSPENDED, suspended, sizeof(suspended)) < 0 || !suspended[0])
+	return 0;
+}
+
+/*
+ * Get all the properties with one DM_DEV_STATUS ioctl. Unlike sysfs, this
+ * also provides the open count and event number for the device.
+ */
+static int _get_ioctl_props(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx, int control_fd, struct dm_props *props)
+{
+	struct dm_ioctl dmi = {
+		.version    = {DM_VERSION_MAJOR, 0, 0},
+		.data_size  = sizeof(dmi),
+		.data_start = sizeof(dmi),
+		.dev        = makedev(sid_ucmd_ev_get_dev_major(ucmd_ctx), sid_ucmd_ev_get_dev_minor(ucmd_ctx)),
+	};
+	int             r;
+
+	if (ioctl(control_fd, DM_DEV_STATUS, &dmi) < 0) {
+		r = -errno;
+		/* not an error yet, the caller falls back to sysfs */
+		sid_res_log_debug(mod_res,
+		                  "DM_DEV_STATUS ioctl failed for " DEV_PRINT_FMT ": %s.",
+		                  DEV_PRINT(ucmd_ctx),
+		                  strerror(-r));
+		return r;
+	}
+
+	if (!dmi.name[0])
+		return -ENODATA;
+
+	memcpy(props->name, dmi.name, sizeof(props->name));
+	memcpy(props->uuid, dmi.uuid, sizeof(props->uuid));
+	props->name[sizeof(props->name) - 1] = '\0';
+	props->uuid[sizeof(props->uuid) - 1] = '\0';
+
+	strcpy(props->suspended, dmi.flags & DM_SUSPEND_FLAG ? "1" : "0");
+
+	props->has_counts = true;
+	props->open_count = dmi.open_count;
+	props->event_nr   = dmi.event_nr;
+
+	return 0;
+}
+
+static int _get_dm_props(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx)
+{
+	struct dm_mod_ctx *dm_mod    = sid_mod_get_data(mod_res);
+	struct dm_props    props     = {0};
+	const char        *name      = props.name;
+	const char        *uuid      = props.uuid;
+	const char        *suspended = props.suspended;
+	int                r;
+
+	/* fall back to sysfs if the control node is not available or if the ioctl fails */
+	if ((dm_mod->control_fd < 0 || _get_ioctl_props(mod_res, ucmd_ctx, dm_mod->control_fd, &props) < 0) &&
+	    _get_sysfs_props(mod_res, ucmd_ctx, &props) < 0) {
+		sid_res_log_error(mod_res, "Failed to get device-mapper properties for " DEV_PRINT_FMT ".", DEV_PRINT(ucmd_ctx));
 		return -1;
+	}
 
 	if (uuid[0] && (r = sid_ucmd_dev_alias_add(mod_res, ucmd_ctx, ALS_UUID, uuid)) < 0) {
 		sid_res_log_error_errno(mod_res, r, _failed_to_set_alias_msg, ALS_UUID);
@@ -401,6 +469,31 @@ static int _get_sysfs_props(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx)
 		return -1;
 	}
 
+	if (!props.has_counts)
+		return 0;
+
+	if (sid_ucmd_kv_va_set(mod_res,
+	                       ucmd_ctx,
+	                       .ns  = SID_KV_NS_DEVMOD,
+	                       .key = DM_X_OPEN_COUNT,
+	                       .val = &props.open_count,
+	                       .sz  = sizeof(props.open_count),
+	                       .fl  = SID_KV_FL_SC | SID_KV_FL_SUB_RD) < 0) {
+		sid_res_log_error(mod_res, _failed_to_set_msg, DM_X_OPEN_COUNT);
+		return -1;
+	}
+
+	if (sid_ucmd_kv_va_set(mod_res,
+	                       ucmd_ctx,
+	                       .ns  = SID_KV_NS_DEVMOD,
+	                       .key = DM_X_EVENT_NR,
+	                       .val = &props.event_nr,
+	                       .sz  = sizeof(props.event_nr),
+	                       .fl  = SID_KV_FL_SC | SID_KV_FL_SUB_RD) < 0) {
+		sid_res_log_error(mod_res, _failed_to_set_msg, DM_X_EVENT_NR);
+		return -1;
+	}
+
 	return 0;
 }
 
@@ -417,6 +510,10 @@ static int _dm_init(sid_res_t *mod_res, struct sid_ucmd_common_ctx *ucmd_common_
 		return -1;
 	}
 
+	/* inherited by workers, used for DM_DEV_STATUS ioctl with sysfs as fallback */
+	if ((dm_mod->control_fd = open(DM_CONTROL_PATH, O_RDWR | O_CLOEXEC)) < 0)
+		sid_res_log_debug(mod_res, "Failed to open %s, using sysfs to get device properties.", DM_CONTROL_PATH);
+
 	{
 		submod_reg_res_params = &(struct sid_mod_reg_res_params) {
 			.directory     = SID_UCMD_TYPE_MOD_DIR "/" DM_ID,
@@ -483,6 +580,8 @@ static int _dm_init(sid_res_t *mod_res, struct sid_ucmd_common_ctx *ucmd_common_
 	return 0;
 fail:
 	sid_res_unref(dm_mod->submod_registry);
+	if (dm_mod->control_fd >= 0)
+		close(dm_mod->control_fd);
 	free(dm_mod);
 	return -1;
 }
@@ -504,6 +603,8 @@ static int _dm_exit(sid_res_t *mod_res, struct sid_ucmd_common_ctx *ucmd_common_
 	}
 
 	dm_mod = sid_mod_get_data(mod_res);
+	if (dm_mod->control_fd >= 0)
+		close(dm_mod->control_fd);
 	free(dm_mod);
 
 	return r;
@@ -563,7 +664,7 @@ static int _dm_scan_a_init(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx)
 {
 	sid_res_log_debug(mod_res, "scan-a-init");
 
-	if (_get_sysfs_props(mod_res, ucmd_ctx) < 0)
+	if (_get_dm_props(mod_res, ucmd_ctx) < 0)
 		return -1;
 
 	return _dm_submod_common_scan_init(mod_res, ucmd_ctx);
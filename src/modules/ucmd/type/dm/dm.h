@@ -22,6 +22,8 @@ extern "C" {
 #define DM_X_NAME                                         "name"
 #define DM_X_UUID                                         "uuid"
 #define DM_X_COOKIE_FLAGS                                 "cookie_flags"
+#define DM_X_OPEN_COUNT                                   "open_count" /* uint32_t */
+#define DM_X_EVENT_NR                                     "event_nr"   /* uint32_t */
 
 typedef uint16_t dm_cookie_fl_t;
 
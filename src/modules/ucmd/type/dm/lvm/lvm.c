@@ -5,12 +5,24 @@
  */
 
 #include "../dm.h"
+#include "base/buf.h"
+#include "internal/mem.h"
 #include "internal/util.h"
 #include "resource/ucmd-mod.h"
 #include "resource/wrk-ctl.h"
 
+#include <fcntl.h>
 #include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <sys/file.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <unistd.h>
 
 #define LVM_DM_UUID_PREFIX "LVM-"
 
@@ -19,6 +31,70 @@ SID_UCMD_MOD_PRIO(0)
 #define LVM_EXEC_BIN_PATH    SBINDIR "/lvm"
 #define LVM_VG_NAME_COMPLETE "LVM_VG_NAME_COMPLETE"
 
+#define LVM_PVSCAN_ARGS                                                                                                            \
+	"pvscan --cache --listvg --checkcomplete --vgonline --autoactivation event --udevoutput --journal=output"
+
+/*
+ * Instead of executing lvm for each command, a single lvm process running
+ * in shell mode is kept as a helper. The helper reads commands from the
+ * 'in' FIFO and writes their output, followed by the shell prompt, to the
+ * 'out' FIFO. Its stderr is passed to the main process and logged there.
+ *
+ * The main process runs the helper as an external worker and it is the
+ * only one to signal it. It restarts the helper if it exits and it
+ * periodically checks that the helper still responds. Once the helper
+ * answers its first prompt, the main process writes the helper generation
+ * to the 'ready' file.
+ *
+ * Event workers take the helper lock, check the 'ready' file, send a
+ * command and read its output up to the next prompt. If the helper fails
+ * to answer, the worker removes the 'ready' file so the helper is not used
+ * anymore and the main process restarts it on its next check. If the
+ * helper is not available, the command is executed directly instead.
+ */
+#define LVM_HELPER_DIR          "/run/sid-lvm-helper"
+#define LVM_HELPER_IN_PATH      LVM_HELPER_DIR "/in"
+#define LVM_HELPER_OUT_PATH     LVM_HELPER_DIR "/out"
+#define LVM_HELPER_LOCK_PATH    LVM_HELPER_DIR "/lock"
+#define LVM_HELPER_READY_PATH   LVM_HELPER_DIR "/ready"
+#define LVM_HELPER_PROMPT       "lvm> "
+#define LVM_HELPER_PING_CMD     "version"
+#define LVM_HELPER_CHECK_USEC   10000000
+#define LVM_HELPER_RESTART_USEC 1000000
+#define LVM_HELPER_POLL_MSEC    500
+#define LVM_HELPER_START_MSEC   5000
+#define LVM_HELPER_PING_MSEC    2000
+#define LVM_HELPER_CMD_MSEC     20000
+#define LVM_LOCK_REARM_MSEC     100
+
+typedef enum {
+	LVM_HELPER_STOPPED,
+	LVM_HELPER_STARTING,
+	LVM_HELPER_READY,
+	LVM_HELPER_PINGING,
+} lvm_helper_state_t;
+
+struct lvm_helper {
+	sid_res_t         *ctl_res;   /* worker control running the helper */
+	sid_res_t         *proxy_res; /* helper process, NULL if not running */
+	lvm_helper_state_t state;
+	unsigned           gen;     /* helper generation, increased with each start */
+	bool               killed;  /* helper killed by us */
+	int                in_fd;   /* both ends of the 'in' FIFO */
+	int                out_fd;  /* both ends of the 'out' FIFO */
+	int                lock_fd; /* helper lock if held by the main process, -1 otherwise */
+	struct sid_buf    *buf;     /* reply to the main process request */
+	sid_res_ev_src_t  *out_es;
+	sid_res_ev_src_t  *reply_es;
+	sid_res_ev_src_t  *check_es;
+};
+
+struct lvm_mod_ctx {
+	sid_res_t        *runner_res;
+	pid_t             main_pid;
+	struct lvm_helper helper;
+};
+
 /* _unquote from lvm2 source code: libdm/libdm-string */
 static char *_unquote(char *component)
 {
@@ -120,18 +196,11 @@ struct out_ctx {
 
 #define OUT_CTX(...) ((struct out_ctx) {__VA_ARGS__})
 
-static int _process_out_line(const char *line, size_t len, bool merge_back, void *data)
+static int _store_out_line(struct out_ctx *ctx, const char *line, size_t len)
 {
-	sid_res_t      *proxy_res = data;
-	struct out_ctx *ctx       = sid_wrk_ctl_get_worker_arg(proxy_res);
-	char            line_buf[LINE_MAX];
-	char           *key, *val;
-	int             r;
-
-	sid_res_log_debug(proxy_res, "OUT: %s", line);
-
-	if (!ctx->store_kv)
-		return 0;
+	char  line_buf[LINE_MAX];
+	char *key, *val;
+	int   r;
 
 	if (len > LINE_MAX - 1)
 		return -ENOBUFS;
@@ -149,6 +218,38 @@ static int _process_out_line(const char *line, size_t len, bool merge_back, void
 	return 0;
 }
 
+static int _handle_out_line(struct out_ctx *ctx, const char *line, size_t len)
+{
+	if (!ctx->store_kv)
+		return 0;
+
+	return _store_out_line(ctx, line, len);
+}
+
+static int _process_out_line(const char *line, size_t len, bool merge_back, void *data)
+{
+	sid_res_t      *proxy_res = data;
+	struct out_ctx *ctx       = sid_wrk_ctl_get_worker_arg(proxy_res);
+
+	sid_res_log_debug(proxy_res, "OUT: %s", line);
+
+	return _handle_out_line(ctx, line, len);
+}
+
+static int _process_helper_line(const char *line, size_t len, bool merge_back, void *data)
+{
+	struct out_ctx *ctx     = data;
+	size_t          key_len = strspn(line, "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_");
+
+	/* the shell echoes the command, so skip anything not in KEY=VALUE form */
+	if (!key_len || key_len >= len || line[key_len] != '=')
+		return 0;
+
+	sid_res_log_debug(ctx->mod_res, "OUT (helper): %.*s", (int) len, line);
+
+	return _handle_out_line(ctx, line, len);
+}
+
 static int _process_err_line(const char *line, size_t len, bool merge_back, void *data)
 {
 	struct out_ctx *ctx = sid_wrk_ctl_get_worker_arg(data);
@@ -167,12 +268,671 @@ static int _runner_stderr_recv_fn(sid_res_t *proxy_res, struct sid_wrk_chan *cha
 	return util_str_iterate_tokens(data_spec->data, "\n", NULL, _process_err_line, proxy_res);
 }
 
+static int _write_file(const char *path, const void *data, size_t size)
+{
+	int fd, r = 0;
+
+	if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600)) < 0)
+		return -errno;
+
+	if (size && write(fd, data, size) != size)
+		r = -EIO;
+
+	close(fd);
+
+	if (r < 0)
+		unlink(path);
+
+	return r;
+}
+
+static char *_read_file(const char *path)
+{
+	struct stat st;
+	char       *data = NULL;
+	int         fd;
+
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+		return NULL;
+
+	if (fstat(fd, &st) < 0 || !(data = malloc(st.st_size + 1)))
+		goto out;
+
+	if (read(fd, data, st.st_size) != st.st_size) {
+		free(data);
+		data = NULL;
+		goto out;
+	}
+
+	data[st.st_size] = '\0';
+out:
+	close(fd);
+	return data;
+}
+
+static volatile sig_atomic_t _lock_timed_out;
+
+static void _on_lock_timeout(int signum)
+{
+	_lock_timed_out = 1;
+}
+
+/*
+ * Lock the file at path. Wait for the lock up to timeout_msec.
+ * Returns the locked file descriptor or negative error code.
+ *
+ * The wait blocks in flock() until SIGALRM interrupts it on timeout. The
+ * timer keeps firing once expired so that an expiry right before flock()
+ * is entered can not leave us waiting for the lock indefinitely.
+ */
+static int _lock_wait(const char *path, int timeout_msec)
+{
+	struct sigaction act   = {.sa_handler = _on_lock_timeout}, old_act;
+	struct itimerval timer = {.it_interval = {.tv_usec = LVM_LOCK_REARM_MSEC * 1000},
+	                          .it_value    = {.tv_sec = timeout_msec / 1000, .tv_usec = (timeout_msec % 1000) * 1000}};
+	sigset_t         sigmask, old_sigmask;
+	int              fd, r;
+
+	if ((fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600)) < 0)
+		return -errno;
+
+	if (flock(fd, LOCK_EX | LOCK_NB) == 0)
+		return fd;
+
+	if (errno != EWOULDBLOCK) {
+		r = -errno;
+		goto out;
+	}
+
+	if (timeout_msec <= 0) {
+		r = -ETIMEDOUT;
+		goto out;
+	}
+
+	_lock_timed_out = 0;
+	sigemptyset(&act.sa_mask);
+	sigemptyset(&sigmask);
+	sigaddset(&sigmask, SIGALRM);
+
+	/* no SA_RESTART - the signal needs to interrupt flock() */
+	if (sigaction(SIGALRM, &act, &old_act) < 0) {
+		r = -errno;
+		goto out;
+	}
+
+	if (setitimer(ITIMER_REAL, &timer, NULL) < 0) {
+		r = -errno;
+		(void) sigaction(SIGALRM, &old_act, NULL);
+		goto out;
+	}
+
+	/* signals are blocked in SID processes */
+	(void) sigprocmask(SIG_UNBLOCK, &sigmask, &old_sigmask);
+
+	while ((r = flock(fd, LOCK_EX)) < 0 && errno == EINTR && !_lock_timed_out)
+		;
+
+	if (r < 0)
+		r = errno == EINTR ? -ETIMEDOUT : -errno;
+
+	/* disarm the timer before blocking the signal again so no SIGALRM is left pending */
+	(void) setitimer(ITIMER_REAL, &(struct itimerval) {0}, NULL);
+	(void) sigprocmask(SIG_SETMASK, &old_sigmask, NULL);
+	(void) sigaction(SIGALRM, &old_act, NULL);
+
+	if (r == 0)
+		return fd;
+out:
+	close(fd);
+	return r;
+}
+
+static void _unlock(int *fd)
+{
+	if (*fd < 0)
+		return;
+
+	(void) flock(*fd, LOCK_UN);
+	close(*fd);
+	*fd = -1;
+}
+
+static void _helper_drain(int fd)
+{
+	char data[LINE_MAX];
+
+	while (read(fd, data, sizeof(data)) > 0)
+		;
+}
+
+static int _helper_send(int fd, const char *cmd_line)
+{
+	struct iovec iov[] = {{.iov_base = (void *) cmd_line, .iov_len = strlen(cmd_line)}, {.iov_base = "\n", .iov_len = 1}};
+
+	if (writev(fd, iov, 2) != iov[0].iov_len + iov[1].iov_len)
+		return -EIO;
+
+	return 0;
+}
+
+/*
+ * Read available helper output into buf. Returns 1 if the output ends with
+ * the prompt, which is then replaced with the terminating '\0', 0 if more
+ * output is needed or negative error code.
+ */
+static int _helper_read(int fd, struct sid_buf *buf)
+{
+	static const size_t prompt_len = sizeof(LVM_HELPER_PROMPT) - 1;
+	char                data[LINE_MAX];
+	const void         *buf_data;
+	size_t              buf_size;
+	ssize_t             n;
+
+	while ((n = read(fd, data, sizeof(data))) != 0) {
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN)
+				break;
+			return -errno;
+		}
+
+		if (sid_buf_add(buf, data, n, NULL, NULL) < 0)
+			return -ENOMEM;
+	}
+
+	if (sid_buf_get_data(buf, &buf_data, &buf_size) < 0)
+		return -ENOMEM;
+
+	if (buf_size < prompt_len || memcmp((const char *) buf_data + buf_size - prompt_len, LVM_HELPER_PROMPT, prompt_len))
+		return 0;
+
+	if (sid_buf_rewind(buf, buf_size - prompt_len, SID_BUF_POS_ABS) < 0 || sid_buf_add(buf, "", 1, NULL, NULL) < 0)
+		return -ENOMEM;
+
+	return 1;
+}
+
+/*
+ * Get generation of the helper which is ready to run commands.
+ * Returns 0 if there is no such helper.
+ */
+static unsigned _helper_get_ready_gen(void)
+{
+	char    *gen_str;
+	unsigned gen = 0;
+
+	if ((gen_str = _read_file(LVM_HELPER_READY_PATH))) {
+		gen = strtoul(gen_str, NULL, 10);
+		free(gen_str);
+	}
+
+	return gen;
+}
+
+/*
+ * Read helper output up to the next prompt. Fail if the helper of given
+ * generation is not ready anymore or if there's no output for longer
+ * than timeout_msec.
+ */
+static int _helper_recv(int fd, unsigned gen, struct sid_buf *buf, int timeout_msec)
+{
+	int r;
+
+	while (timeout_msec > 0) {
+		if ((r = poll(&(struct pollfd) {.fd = fd, .events = POLLIN}, 1, LVM_HELPER_POLL_MSEC)) < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
+
+		if (r == 0) {
+			if (_helper_get_ready_gen() != gen)
+				return -ESRCH;
+			timeout_msec -= LVM_HELPER_POLL_MSEC;
+			continue;
+		}
+
+		if ((r = _helper_read(fd, buf)) != 0)
+			return r < 0 ? r : 0;
+	}
+
+	return -ETIMEDOUT;
+}
+
+static int _helper_init_cb(sid_res_t *res, void *arg)
+{
+	sigset_t sigmask;
+	int      fd;
+
+	/*
+	 * Open the FIFOs without O_NONBLOCK - the main process keeps both ends
+	 * of each FIFO open so these never block.
+	 */
+	if ((fd = open(LVM_HELPER_IN_PATH, O_RDONLY | O_CLOEXEC)) < 0 || dup2(fd, STDIN_FILENO) < 0 || close(fd) < 0 ||
+	    (fd = open(LVM_HELPER_OUT_PATH, O_WRONLY | O_CLOEXEC)) < 0 || dup2(fd, STDOUT_FILENO) < 0 || close(fd) < 0)
+		return -errno;
+
+	/* signals are blocked in SID processes and the mask is inherited on exec */
+	sigemptyset(&sigmask);
+	(void) sigprocmask(SIG_SETMASK, &sigmask, NULL);
+
+	return 0;
+}
+
+static int _process_helper_err_line(const char *line, size_t len, bool merge_back, void *data)
+{
+	sid_res_log_warning((sid_res_t *) data, "ERR (helper): %s", line);
+
+	return 0;
+}
+
+static int _helper_stderr_recv_fn(sid_res_t *proxy_res, struct sid_wrk_chan *chan, struct sid_wrk_data_spec *data_spec, void *arg)
+{
+	return util_str_iterate_tokens(data_spec->data, "\n", NULL, _process_helper_err_line, proxy_res);
+}
+
+static void _helper_kill(sid_res_t *mod_res, struct lvm_helper *helper, int signum)
+{
+	pid_t pid;
+
+	if (!helper->proxy_res || !(pid = sid_wrk_ctl_get_worker_pid(helper->proxy_res)))
+		return;
+
+	helper->killed = true;
+
+	if (kill(pid, signum) < 0)
+		sid_res_log_error_errno(mod_res, errno, "Failed to send signal to LVM helper with PID %d", pid);
+}
+
+static void _helper_end_request(struct lvm_helper *helper)
+{
+	if (helper->out_es)
+		(void) sid_res_ev_destroy(&helper->out_es);
+
+	if (helper->reply_es)
+		(void) sid_res_ev_destroy(&helper->reply_es);
+
+	if (helper->buf)
+		(void) sid_buf_reset(helper->buf);
+
+	_unlock(&helper->lock_fd);
+}
+
+static int _on_helper_out_event(sid_res_ev_src_t *es, int fd, uint32_t revents, void *data)
+{
+	sid_res_t          *mod_res = data;
+	struct lvm_mod_ctx *lvm_mod = sid_mod_get_data(mod_res);
+	struct lvm_helper  *helper  = &lvm_mod->helper;
+	char                gen_str[16];
+	int                 r;
+
+	if ((r = _helper_read(fd, helper->buf)) == 0)
+		return 0;
+
+	if (r < 0) {
+		sid_res_log_error_errno(mod_res, r, "Failed to read LVM helper output, restarting");
+		_helper_kill(mod_res, helper, SIGKILL);
+		return 0;
+	}
+
+	if (helper->state == LVM_HELPER_STARTING) {
+		snprintf(gen_str, sizeof(gen_str), "%u", helper->gen);
+
+		if ((r = _write_file(LVM_HELPER_READY_PATH, gen_str, strlen(gen_str))) < 0) {
+			sid_res_log_error_errno(mod_res, r, "Failed to mark LVM helper as ready");
+			_helper_kill(mod_res, helper, SIGKILL);
+			return 0;
+		}
+
+		sid_res_log_debug(mod_res, "LVM helper started with PID %d.", sid_wrk_ctl_get_worker_pid(helper->proxy_res));
+	}
+
+	helper->state = LVM_HELPER_READY;
+	_helper_end_request(helper);
+
+	return 0;
+}
+
+static int _on_helper_reply_timeout_event(sid_res_ev_src_t *es, uint64_t usec, void *data)
+{
+	sid_res_t          *mod_res = data;
+	struct lvm_mod_ctx *lvm_mod = sid_mod_get_data(mod_res);
+
+	sid_res_log_error(mod_res, "LVM helper not responding, restarting.");
+	_helper_kill(mod_res, &lvm_mod->helper, SIGKILL);
+
+	return 0;
+}
+
+/*
+ * Send cmd_line, if any, to the helper and wait for its prompt in the event
+ * loop. The helper lock must be held and it is released once the reply is
+ * received or the helper exits.
+ */
+static int _helper_request(sid_res_t *mod_res, struct lvm_helper *helper, const char *cmd_line, int timeout_msec)
+{
+	int r;
+
+	_helper_drain(helper->out_fd);
+
+	if ((cmd_line && (r = _helper_send(helper->in_fd, cmd_line)) < 0) ||
+	    (r = sid_res_ev_create_io(mod_res,
+	                              &helper->out_es,
+	                              helper->out_fd,
+	                              _on_helper_out_event,
+	                              0,
+	                              "lvm helper output",
+	                              mod_res)) < 0 ||
+	    (r = sid_res_ev_create_time(mod_res,
+	                                &helper->reply_es,
+	                                CLOCK_MONOTONIC,
+	                                SID_RES_POS_REL,
+	                                (uint64_t) timeout_msec * 1000,
+	                                0,
+	                                _on_helper_reply_timeout_event,
+	                                0,
+	                                "lvm helper reply timeout",
+	                                mod_res)) < 0)
+		return r;
+
+	return 0;
+}
+
+static int _on_helper_exit(sid_res_t *proxy_res, const siginfo_t *si, void *arg)
+{
+	sid_res_t          *mod_res = arg;
+	struct lvm_mod_ctx *lvm_mod = sid_mod_get_data(mod_res);
+	struct lvm_helper  *helper  = &lvm_mod->helper;
+
+	(void) unlink(LVM_HELPER_READY_PATH);
+
+	if (helper->killed)
+		sid_res_log_debug(mod_res, "LVM helper with PID %d stopped.", si->si_pid);
+	else if (si->si_code == CLD_EXITED)
+		sid_res_log_error(mod_res, "LVM helper with PID %d exited with exit code %d.", si->si_pid, si->si_status);
+	else
+		sid_res_log_error(mod_res,
+		                  "LVM helper with PID %d terminated by signal %d (SIG%s).",
+		                  si->si_pid,
+		                  si->si_status,
+		                  sigabbrev_np(si->si_status));
+
+	/* a helper which never got ready is retried on the next regular check only */
+	if (helper->state != LVM_HELPER_STARTING)
+		(void) sid_res_ev_rearm_time(helper->check_es, SID_RES_POS_REL, LVM_HELPER_RESTART_USEC);
+
+	_helper_end_request(helper);
+	helper->proxy_res = NULL;
+	helper->state     = LVM_HELPER_STOPPED;
+
+	return 0;
+}
+
+static int _helper_start(sid_res_t *mod_res, struct lvm_helper *helper)
+{
+	sid_res_t *proxy_res;
+	int        r;
+
+	/* a worker still using the previous helper instance, try again later */
+	if ((helper->lock_fd = _lock_wait(LVM_HELPER_LOCK_PATH, 0)) < 0)
+		return helper->lock_fd;
+
+	/* drop anything left over from previous helper instance */
+	_helper_drain(helper->in_fd);
+	_helper_drain(helper->out_fd);
+
+	helper->killed = false;
+	helper->gen++;
+
+	if ((r = sid_wrk_ctl_get_new_worker(helper->ctl_res,
+	                                    &SID_WRK_PARAMS(.id = "lvm-helper", .external.exec_file = LVM_EXEC_BIN_PATH),
+	                                    &proxy_res)) < 0) {
+		sid_res_log_error_errno(mod_res, r, "Failed to create LVM helper");
+		_unlock(&helper->lock_fd);
+		return r;
+	}
+
+	if (!proxy_res) {
+		/* helper process here */
+		(void) sid_wrk_ctl_run_worker(helper->ctl_res, SID_RES_NO_SERVICE_LINKS);
+		_exit(EXIT_FAILURE);
+	}
+
+	helper->proxy_res = proxy_res;
+	helper->state     = LVM_HELPER_STARTING;
+
+	if ((r = _helper_request(mod_res, helper, NULL, LVM_HELPER_START_MSEC)) < 0) {
+		sid_res_log_error_errno(mod_res, r, "Failed to start LVM helper");
+		/* the exit callback resets the helper */
+		_helper_kill(mod_res, helper, SIGKILL);
+		return r;
+	}
+
+	return 0;
+}
+
+static int _on_helper_check_event(sid_res_ev_src_t *es, uint64_t usec, void *data)
+{
+	sid_res_t          *mod_res = data;
+	struct lvm_mod_ctx *lvm_mod = sid_mod_get_data(mod_res);
+	struct lvm_helper  *helper  = &lvm_mod->helper;
+	int                 r;
+
+	(void) sid_res_ev_rearm_time(es, SID_RES_POS_REL, LVM_HELPER_CHECK_USEC);
+
+	switch (helper->state) {
+		case LVM_HELPER_STOPPED:
+			(void) _helper_start(mod_res, helper);
+			break;
+
+		case LVM_HELPER_READY:
+			if (!_helper_get_ready_gen()) {
+				sid_res_log_error(mod_res, "LVM helper failed to run command, restarting.");
+				_helper_kill(mod_res, helper, SIGKILL);
+				break;
+			}
+
+			/* if a worker holds the lock, the helper is in use and it is checked there */
+			if ((helper->lock_fd = _lock_wait(LVM_HELPER_LOCK_PATH, 0)) < 0)
+				break;
+
+			helper->state = LVM_HELPER_PINGING;
+
+			if ((r = _helper_request(mod_res, helper, LVM_HELPER_PING_CMD, LVM_HELPER_PING_MSEC)) < 0) {
+				sid_res_log_error_errno(mod_res, r, "Failed to check LVM helper, restarting");
+				_helper_kill(mod_res, helper, SIGKILL);
+			}
+			break;
+
+		case LVM_HELPER_STARTING:
+		case LVM_HELPER_PINGING:
+			/* request in progress, it has its own timeout */
+			break;
+	}
+
+	return 0;
+}
+
+static int _helper_init(sid_res_t *mod_res, struct lvm_helper *helper)
+{
+	int r;
+
+	if ((mkdir(LVM_HELPER_DIR, 0700) < 0 && errno != EEXIST) || (unlink(LVM_HELPER_READY_PATH) < 0 && errno != ENOENT) ||
+	    (unlink(LVM_HELPER_IN_PATH) < 0 && errno != ENOENT) || (unlink(LVM_HELPER_OUT_PATH) < 0 && errno != ENOENT) ||
+	    mkfifo(LVM_HELPER_IN_PATH, 0600) < 0 || mkfifo(LVM_HELPER_OUT_PATH, 0600) < 0) {
+		r = -errno;
+		goto fail;
+	}
+
+	/*
+	 * Keep both ends of the FIFOs open so the helper does not see EOF or
+	 * EPIPE when a worker closes its end, and so the FIFOs can be drained.
+	 */
+	if ((helper->in_fd = open(LVM_HELPER_IN_PATH, O_RDWR | O_NONBLOCK | O_CLOEXEC)) < 0 ||
+	    (helper->out_fd = open(LVM_HELPER_OUT_PATH, O_RDWR | O_NONBLOCK | O_CLOEXEC)) < 0) {
+		r = -errno;
+		goto fail;
+	}
+
+	if (!(helper->buf = sid_buf_create(&SID_BUF_SPEC(), &SID_BUF_INIT(.size = LINE_MAX, .alloc_step = LINE_MAX), &r)))
+		goto fail;
+
+	struct sid_wrk_ctl_res_params helper_params = {
+		.worker_type   = SID_WRK_TYPE_EXTERNAL,
+		.init_cb_spec  = SID_WRK_INIT_CB_SPEC(.fn = _helper_init_cb),
+		.exit_cb_spec  = SID_WRK_EXIT_CB_SPEC(.fn = _on_helper_exit, .arg = mod_res),
+
+		.channel_specs = SID_WRK_CHAN_SPEC_ARRAY(
+			SID_WRK_CHAN_SPEC(.id   = "stderr",
+
+	                                  .wire = SID_WRK_WIRE_SPEC(.type              = SID_WRK_WIRE_PIPE_TO_PRX,
+	                                                            .ext.used          = true,
+	                                                            .ext.pipe.fd_redir = STDERR_FILENO),
+
+	                                  .proxy_rx =
+	                                          SID_WRK_LANE_SPEC(.cb = SID_WRK_LANE_CB_SPEC(.fn = _helper_stderr_recv_fn),
+	                                                            .data_suffix = (struct iovec) {.iov_base = "", .iov_len = 1}))),
+	};
+
+	if (!(helper->ctl_res = sid_res_create(mod_res,
+	                                       &sid_res_type_wrk_ctl,
+	                                       SID_RES_FL_NONE,
+	                                       "lvm helper",
+	                                       &helper_params,
+	                                       SID_RES_PRIO_NORMAL,
+	                                       SID_RES_NO_SERVICE_LINKS))) {
+		r = -ENOMEM;
+		goto fail;
+	}
+
+	if ((r = sid_res_ev_create_time(mod_res,
+	                                &helper->check_es,
+	                                CLOCK_MONOTONIC,
+	                                SID_RES_POS_REL,
+	                                LVM_HELPER_CHECK_USEC,
+	                                0,
+	                                _on_helper_check_event,
+	                                0,
+	                                "lvm helper check",
+	                                mod_res)) < 0)
+		goto fail;
+
+	/* the helper is started in the background, commands are executed directly until it is ready */
+	(void) _helper_start(mod_res, helper);
+
+	return 0;
+fail:
+	sid_res_log_error_errno(mod_res, r, "Failed to set up LVM helper, executing lvm for each command");
+	return r;
+}
+
+/*
+ * The module resource destroys its children and event sources before the
+ * exit hook runs, so the helper's worker control and its exit callback are
+ * gone here and the helper can not be stopped through them anymore. It is
+ * not signalled nor reaped here: it sees EOF on its input once the FIFOs
+ * are closed and it gets SIGTERM as parent-death signal when SID exits.
+ */
+static void _helper_exit(struct lvm_helper *helper)
+{
+	(void) unlink(LVM_HELPER_READY_PATH);
+	_unlock(&helper->lock_fd);
+}
+
+/*
+ * Run the command in the helper. Returns -ENOTCONN if the helper could not
+ * run the command and the command needs to be executed directly.
+ */
+static int _run_helper(sid_res_t *mod_res, const char *cmd_line, struct out_ctx *out_ctx)
+{
+	struct sid_buf *buf = NULL;
+	const void     *data;
+	size_t          size;
+	unsigned        gen;
+	int             lock_fd, in_fd = -1, out_fd = -1;
+	int             r = -ENOTCONN;
+
+	if ((lock_fd = _lock_wait(LVM_HELPER_LOCK_PATH, LVM_HELPER_CMD_MSEC)) < 0)
+		goto out;
+
+	/* the helper may have been restarted since this worker was forked, so check it under the lock */
+	if (!(gen = _helper_get_ready_gen()))
+		goto out;
+
+	if ((in_fd = open(LVM_HELPER_IN_PATH, O_WRONLY | O_NONBLOCK | O_CLOEXEC)) < 0 ||
+	    (out_fd = open(LVM_HELPER_OUT_PATH, O_RDONLY | O_NONBLOCK | O_CLOEXEC)) < 0 ||
+	    !(buf = sid_buf_create(&SID_BUF_SPEC(), &SID_BUF_INIT(.size = LINE_MAX, .alloc_step = LINE_MAX), NULL)))
+		goto out;
+
+	_helper_drain(out_fd);
+
+	if ((r = _helper_send(in_fd, cmd_line)) < 0 || (r = _helper_recv(out_fd, gen, buf, LVM_HELPER_CMD_MSEC)) < 0) {
+		sid_res_log_error_errno(mod_res, r, "LVM helper failed to run command");
+		/*
+		 * The helper may still be running the command, do not let it answer
+		 * the next one. The main process restarts the helper.
+		 */
+		(void) unlink(LVM_HELPER_READY_PATH);
+		r = -ENOTCONN;
+		goto out;
+	}
+
+	_unlock(&lock_fd);
+
+	if ((r = sid_buf_get_data(buf, &data, &size)) < 0)
+		goto out;
+
+	r = util_str_iterate_tokens(data, "\n", NULL, _process_helper_line, out_ctx);
+out:
+	if (buf)
+		sid_buf_destroy(buf);
+	if (out_fd >= 0)
+		close(out_fd);
+	if (in_fd >= 0)
+		close(in_fd);
+	_unlock(&lock_fd);
+
+	return r;
+}
+
+static int _run_lvm(sid_res_t *mod_res, const char *id, const char *cmd_line, struct out_ctx *out_ctx)
+{
+	struct lvm_mod_ctx   *lvm_mod = sid_mod_get_data(mod_res);
+	struct sid_wrk_params wrk_lvm;
+	int                   r;
+
+	if ((r = _run_helper(mod_res, cmd_line, out_ctx)) != -ENOTCONN)
+		return r;
+
+	wrk_lvm = SID_WRK_PARAMS(.id                 = id,
+	                         .external.exec_file = LVM_EXEC_BIN_PATH,
+	                         .external.args      = cmd_line,
+	                         .worker_proxy_arg   = out_ctx,
+	                         .timeout_spec       = SID_WRK_TIMEOUT_SPEC(.usec = 20000000, .signum = SIGKILL));
+
+	if ((r = sid_wrk_ctl_run_new_worker(lvm_mod->runner_res, &wrk_lvm, SID_RES_NO_SERVICE_LINKS)) < 0)
+		sid_res_log_error_errno(mod_res, r, "Failed to run %s", id);
+
+	return r;
+}
+
 static int _lvm_init(sid_res_t *mod_res, struct sid_ucmd_common_ctx *ucmd_common_ctx)
 {
-	sid_res_t *runner_res;
+	struct lvm_mod_ctx *lvm_mod;
 
 	sid_res_log_debug(mod_res, "init");
 
+	if (!(lvm_mod = mem_zalloc(sizeof(*lvm_mod)))) {
+		sid_res_log_error(mod_res, "Failed to allocate module context.");
+		return -1;
+	}
+
+	lvm_mod->main_pid       = getpid();
+	lvm_mod->helper.in_fd   = -1;
+	lvm_mod->helper.out_fd  = -1;
+	lvm_mod->helper.lock_fd = -1;
+
 	struct sid_wrk_ctl_res_params runner_params = {
 		.worker_type   = SID_WRK_TYPE_EXTERNAL,
 
@@ -198,25 +958,45 @@ static int _lvm_init(sid_res_t *mod_res, struct sid_ucmd_common_ctx *ucmd_common
 
 		.timeout_spec = SID_WRK_TIMEOUT_SPEC(.usec = 5000000, .signum = SIGKILL)};
 
-	if (!(runner_res = sid_res_create(mod_res,
-	                                  &sid_res_type_wrk_ctl,
-	                                  SID_RES_FL_NONE,
-	                                  "lvm runner",
-	                                  &runner_params,
-	                                  SID_RES_PRIO_NORMAL,
-	                                  SID_RES_NO_SERVICE_LINKS))) {
+	if (!(lvm_mod->runner_res = sid_res_create(mod_res,
+	                                           &sid_res_type_wrk_ctl,
+	                                           SID_RES_FL_NONE,
+	                                           "lvm runner",
+	                                           &runner_params,
+	                                           SID_RES_PRIO_NORMAL,
+	                                           SID_RES_NO_SERVICE_LINKS))) {
 		sid_res_log_error(mod_res, "Failed to create command runner.");
+		free(lvm_mod);
 		return -1;
 	}
 
-	sid_mod_set_data(mod_res, runner_res);
+	sid_mod_set_data(mod_res, lvm_mod);
+
+	/* the helper is optional, lvm is executed for each command without it */
+	(void) _helper_init(mod_res, &lvm_mod->helper);
+
 	return 0;
 }
 SID_UCMD_MOD_INIT(_lvm_init)
 
 static int _lvm_exit(sid_res_t *mod_res, struct sid_ucmd_common_ctx *ucmd_common_ctx)
 {
+	struct lvm_mod_ctx *lvm_mod = sid_mod_get_data(mod_res);
+
 	sid_res_log_debug(mod_res, "exit");
+
+	/* workers inherit the module context, but only the main process owns the helper */
+	if (lvm_mod->main_pid == getpid())
+		_helper_exit(&lvm_mod->helper);
+
+	if (lvm_mod->helper.in_fd >= 0)
+		close(lvm_mod->helper.in_fd);
+	if (lvm_mod->helper.out_fd >= 0)
+		close(lvm_mod->helper.out_fd);
+	if (lvm_mod->helper.buf)
+		sid_buf_destroy(lvm_mod->helper.buf);
+
+	free(lvm_mod);
 	return 0;
 }
 SID_UCMD_MOD_EXIT(_lvm_exit)
@@ -307,64 +1087,42 @@ SID_UCMD_SCAN_PRE(_lvm_scan_pre)
 
 static int _lvm_scan_next(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx)
 {
-	sid_res_t            *runner_res = sid_mod_get_data(mod_res);
-	char                 *cmd_line;
-	int                   r;
-	struct sid_wrk_params wrk_pvscan;
+	struct out_ctx out_ctx = OUT_CTX(.mod_res = mod_res, .ucmd_ctx = ucmd_ctx, .store_kv = true);
+	char          *cmd_line;
+	int            r;
 
 	sid_res_log_debug(mod_res, "scan-next");
 
 	if (!(cmd_line = util_str_comb_to_str(NULL,
-	                                      NULL,
-	                                      "pvscan --cache --listvg --checkcomplete --vgonline --autoactivation event "
-	                                      "--udevoutput --journal=output /dev/",
-	                                      sid_ucmd_ev_get_dev_name(ucmd_ctx))))
+	                                      LVM_PVSCAN_ARGS " " SYSTEM_DEV_PATH "/",
+	                                      sid_ucmd_ev_get_dev_name(ucmd_ctx),
+	                                      NULL)))
 		return -1;
 
-	wrk_pvscan = SID_WRK_PARAMS(.id                 = "pvscan",
-	                            .external.exec_file = LVM_EXEC_BIN_PATH,
-	                            .external.args      = cmd_line,
-	                            .worker_proxy_arg   = &OUT_CTX(.mod_res = mod_res, .ucmd_ctx = ucmd_ctx, .store_kv = true),
-	                            .timeout_spec       = SID_WRK_TIMEOUT_SPEC(.usec = 20000000, .signum = SIGKILL));
-
-	if ((r = sid_wrk_ctl_run_new_worker(runner_res, &wrk_pvscan, SID_RES_NO_SERVICE_LINKS)) < 0) {
-		sid_res_log_error_errno(mod_res, r, "Failed to run %s", wrk_pvscan.id);
-		free(cmd_line);
-		return -1;
-	}
+	r = _run_lvm(mod_res, "pvscan", cmd_line, &out_ctx);
 
 	free(cmd_line);
-	return 0;
+	return r < 0 ? -1 : 0;
 }
 SID_UCMD_SCAN_NEXT(_lvm_scan_next)
 
 static int _lvm_scan_action_next(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx)
 {
-	const char           *val;
-	sid_res_t            *runner_res;
-	char                 *cmd_line = NULL;
-	struct sid_wrk_params wrk_vgchange;
-	int                   r = -1;
+	const char *val;
+	char       *cmd_line = NULL;
+	int         r        = -1;
 
 	sid_res_log_debug(mod_res, "scan-action-next");
 
 	if ((val = sid_ucmd_kv_va_get(mod_res, ucmd_ctx, .ns = SID_KV_NS_DEVMOD, .key = LVM_VG_NAME_COMPLETE))) {
-		runner_res = sid_mod_get_data(mod_res);
-
 		if (!(cmd_line = util_str_comb_to_str(NULL, NULL, "vgchange -aay --autoactivation event ", val)))
 			goto out;
 
-		wrk_vgchange =
-			SID_WRK_PARAMS(.id                 = "vgchange",
-		                       .external.exec_file = LVM_EXEC_BIN_PATH,
-		                       .external.args      = cmd_line,
-		                       .worker_proxy_arg   = &OUT_CTX(.mod_res = mod_res, .ucmd_ctx = ucmd_ctx, .store_kv = false),
-		                       .timeout_spec       = SID_WRK_TIMEOUT_SPEC(.usec = 20000000, .signum = SIGKILL));
-
-		if ((r = sid_wrk_ctl_run_new_worker(runner_res, &wrk_vgchange, SID_RES_NO_SERVICE_LINKS)) < 0) {
-			sid_res_log_error_errno(mod_res, r, "Failed to run %s", wrk_vgchange.id);
+		if (_run_lvm(mod_res,
+		             "vgchange",
+		             cmd_line,
+		             &OUT_CTX(.mod_res = mod_res, .ucmd_ctx = ucmd_ctx, .store_kv = false)) < 0)
 			goto out;
-		}
 
 		if (sid_ucmd_kv_va_set(mod_res, ucmd_ctx, .ns = SID_KV_NS_DEVMOD, .key = LVM_VG_NAME_COMPLETE) < 0) {
 			sid_res_log_error(mod_res, "Failed to store value for key \"%s\"", LVM_VG_NAME_COMPLETE);
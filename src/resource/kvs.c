@@ -18,14 +18,28 @@
 #include <stdint.h>
 #include <stdio.h>
 
-#define KV_STORE_VALUE_INT_ALLOC UINT32_C(0x00000001)
+#define KV_STORE_VALUE_INT_ALLOC   UINT32_C(0x00000001)
+#define KV_STORE_VALUE_INT_INDEXED UINT32_C(0x00000002) /* the value may have index keys */
+
+#define KV_INDEX_PART_SIZE       128
+#define KV_INDEX_KEY_BUF_SIZE    256
 
 typedef uint32_t kv_store_value_int_fl_t;
 
+struct kv_index {
+	struct sid_kvs_index_spec spec;
+	size_t                    prefix_len;
+};
+
 struct kv_store {
-	sid_kvs_backend_t backend;
-	struct sid_buf   *trans_unset_buf;
-	struct sid_buf   *trans_rollback_buf;
+	sid_kvs_backend_t      backend;
+	struct sid_buf        *trans_unset_buf;
+	struct sid_buf        *trans_rollback_buf;
+	struct sid_buf        *trans_rollback_to_buf; /* savepoints rolled back to in the transaction */
+	unsigned               trans_gen;
+	struct kv_index       *indexes;
+	unsigned               index_count;
+	struct mem_slab_cache *value_cache;
 
 	union {
 		struct hash_table *ht;
@@ -46,11 +60,13 @@ struct kv_rollback_arg {
 	size_t                 kv_store_value_size;
 	bool                   has_archive:1;
 	bool                   is_archive :1;
+	bool                   is_index   :1;
 };
 
 struct kv_unset_arg {
 	const char *key;
 	bool        has_archive:1;
+	bool        is_index   :1;
 };
 
 struct kv_archive_arg {
@@ -64,15 +80,19 @@ struct kv_trans_fn_arg {
 	sid_res_t *res;
 	bool       has_archive:1;
 	bool       is_archive :1;
+	bool       is_index   :1;
 };
 
 struct kv_update_fn_relay {
+	struct kv_store       *kv_store;
 	sid_kvs_update_cb_fn_t fn;
 	void                  *fn_arg;
 	struct sid_buf        *unset_buf;
 	struct sid_buf        *rollback_buf;
 	struct kv_archive_arg  archive_arg;
 	int                    ret_code;
+	bool                   changed;
+	bool                   old_indexed; /* old value matched an index */
 };
 
 typedef enum {
@@ -115,13 +135,36 @@ static void *_get_data(struct kv_store_value *value)
 	return value->ext_flags & SID_KVS_VAL_FL_REF ? _get_ptr(value->data) : value->data;
 }
 
-static void _destroy_kv_store_value(struct kv_store_value *value)
+/*
+ * Get the size of the kv_store_value container as allocated by _create_kv_store_value.
+ */
+static size_t _get_kv_store_value_size(struct kv_store_value *value)
 {
 	struct iovec *iov;
-	size_t        i;
+	size_t        i, size;
 
-	if (!value)
-		return;
+	if (value->ext_flags & SID_KVS_VAL_FL_REF)
+		/* C, D, G, H */
+		return sizeof(*value) + sizeof(uintptr_t);
+
+	if (value->ext_flags & SID_KVS_VAL_FL_VECTOR) {
+		/* E */
+		iov = (struct iovec *) value->data;
+
+		for (i = 0, size = sizeof(*value) + value->size * sizeof(struct iovec); i < value->size; i++)
+			size += iov[i].iov_len;
+
+		return size;
+	}
+
+	/* A, B, F */
+	return sizeof(*value) + value->size;
+}
+
+static void _release_kv_store_value_refs(struct kv_store_value *value)
+{
+	struct iovec *iov;
+	size_t        i;
 
 	/* Take extra care of situations where we store reference to a value. */
 	if (value->ext_flags & SID_KVS_VAL_FL_REF) {
@@ -150,21 +193,33 @@ static void _destroy_kv_store_value(struct kv_store_value *value)
 				free(_get_ptr(value->data));
 		}
 	}
+}
+
+static void _destroy_kv_store_value(struct kv_store *kv_store, struct kv_store_value *value)
+{
+	if (!value)
+		return;
+
+	_release_kv_store_value_refs(value);
 
 	/*
 	 * If the value stored is not a reference, it's stored as copy and
 	 * part of value->data[] field allocated together with the value itself.
-	 * Then it's freed just by calling free(value).
+	 * Then it's freed just by returning the value to the value cache.
 	 */
 
 	/* A, B, C, D, E, F */
-	free(value);
+	mem_slab_cache_free(kv_store->value_cache, value, _get_kv_store_value_size(value));
 }
 
+/*
+ * On store destruction, all values are freed at once together with the value cache,
+ * so release only the references the values hold.
+ */
 static void
 	_hash_destroy_kv_store_value(const void *key __unused, uint32_t key_len __unused, void *value, size_t value_size __unused)
 {
-	_destroy_kv_store_value(value);
+	_release_kv_store_value_refs(value);
 }
 
 static void _bptree_destroy_kv_store_value(const char *key   __unused,
@@ -174,7 +229,7 @@ static void _bptree_destroy_kv_store_value(const char *key   __unused,
                                            void *arg         __unused)
 {
 	if (ref_count == 1)
-		_destroy_kv_store_value(value);
+		_release_kv_store_value_refs(value);
 }
 
 /*
@@ -210,8 +265,22 @@ static void _bptree_destroy_kv_store_value(const char *key   __unused,
  * For vectors, this also means that both the struct iovec and values reference by iovec.iov_base have
  * been allocated by "malloc" too.
  */
-static struct kv_store_value *
-	_create_kv_store_value(struct iovec *iov, int iov_cnt, sid_kvs_val_fl_t flags, sid_kvs_val_op_fl_t op_flags, size_t *size)
+static struct kv_store_value *_alloc_kv_store_value(struct kv_store *kv_store, size_t value_size)
+{
+	struct kv_store_value *value;
+
+	if ((value = mem_slab_cache_alloc(kv_store->value_cache, value_size)))
+		memset(value, 0, value_size);
+
+	return value;
+}
+
+static struct kv_store_value *_create_kv_store_value(struct kv_store    *kv_store,
+                                                     struct iovec       *iov,
+                                                     int                 iov_cnt,
+                                                     sid_kvs_val_fl_t    flags,
+                                                     sid_kvs_val_op_fl_t op_flags,
+                                                     size_t             *size)
 {
 	struct kv_store_value *value;
 	size_t                 value_size;
@@ -224,7 +293,7 @@ static struct kv_store_value *
 		if (flags & SID_KVS_VAL_FL_REF) {
 			value_size = sizeof(*value) + sizeof(uintptr_t);
 
-			if (!(value = mem_zalloc(value_size)))
+			if (!(value = _alloc_kv_store_value(kv_store, value_size)))
 				return NULL;
 
 			if (op_flags & SID_KVS_VAL_OP_MERGE) {
@@ -232,8 +301,10 @@ static struct kv_store_value *
 				for (i = 0, data_size = 0; i < iov_cnt; i++)
 					data_size += iov[i].iov_len;
 
-				if (!(p = malloc(data_size)))
-					return mem_freen(value);
+				if (!(p = malloc(data_size))) {
+					mem_slab_cache_free(kv_store->value_cache, value, value_size);
+					return NULL;
+				}
 
 				/*
 				 * FIXME:
@@ -268,7 +339,7 @@ static struct kv_store_value *
 				/* F */
 				value_size = sizeof(*value) + data_size;
 
-				if (!(value = mem_zalloc(value_size)))
+				if (!(value = _alloc_kv_store_value(kv_store, value_size)))
 					return NULL;
 
 				for (i = 0, p = value->data; i < iov_cnt; i++) {
@@ -283,7 +354,7 @@ static struct kv_store_value *
 				/* E */
 				value_size = sizeof(*value) + iov_cnt * sizeof(struct iovec) + data_size;
 
-				if (!(value = mem_zalloc(value_size)))
+				if (!(value = _alloc_kv_store_value(kv_store, value_size)))
 					return NULL;
 
 				iov2 = (struct iovec *) value->data;
@@ -305,7 +376,7 @@ static struct kv_store_value *
 			/* C,D */
 			value_size = sizeof(*value) + sizeof(uintptr_t);
 
-			if (!(value = mem_zalloc(value_size)))
+			if (!(value = _alloc_kv_store_value(kv_store, value_size)))
 				return NULL;
 
 			_set_ptr(value->data, iov[0].iov_base);
@@ -313,7 +384,7 @@ static struct kv_store_value *
 			/* A,B */
 			value_size = sizeof(*value) + iov[0].iov_len;
 
-			if (!(value = mem_zalloc(value_size)))
+			if (!(value = _alloc_kv_store_value(kv_store, value_size)))
 				return NULL;
 
 			memcpy(value->data, iov[0].iov_base, iov[0].iov_len);
@@ -354,6 +425,8 @@ static int _update_fn(const char                *key,
 	const char                *key_dup;
 	int                        r = 1;
 
+	relay->old_indexed = old_value && (old_value->int_flags & KV_STORE_VALUE_INT_INDEXED);
+
 	if (relay->fn) {
 		if (old_value) {
 			update_spec.old_data      = _get_data(old_value);
@@ -393,7 +466,8 @@ static int _update_fn(const char                *key,
 					iov                 = tmp_iov;
 				}
 
-				if (!(edited_new_value = _create_kv_store_value(iov,
+				if (!(edited_new_value = _create_kv_store_value(relay->kv_store,
+				                                                iov,
 				                                                iov_cnt,
 				                                                update_spec.new_flags,
 				                                                update_spec.op_flags,
@@ -402,7 +476,7 @@ static int _update_fn(const char                *key,
 					return 0;
 				}
 
-				_destroy_kv_store_value(orig_new_value);
+				_destroy_kv_store_value(relay->kv_store, orig_new_value);
 
 				*new_value     = edited_new_value;
 				*new_value_len = kv_store_value_size;
@@ -437,11 +511,11 @@ static int _update_fn(const char                *key,
 				relay->archive_arg.kv_store_value_size = old_value_len;
 			}
 		} else
-			_destroy_kv_store_value(old_value);
+			_destroy_kv_store_value(relay->kv_store, old_value);
 	}
 
 	if (!r) {
-		_destroy_kv_store_value(*new_value);
+		_destroy_kv_store_value(relay->kv_store, *new_value);
 		*new_value = NULL;
 	}
 
@@ -503,7 +577,9 @@ static int _set_value(struct kv_store           *kv_store,
                       size_t                    *kv_store_value_size,
                       struct kv_update_fn_relay *relay)
 {
-	int r = 0;
+	int r           = 0;
+
+	relay->kv_store = kv_store;
 
 	switch (kv_store->backend) {
 		case SID_KVS_BACKEND_HASH:
@@ -533,6 +609,11 @@ static int _set_value(struct kv_store           *kv_store,
 }
 
 static void _kv_store_trans_rollback_value(sid_res_t *kv_store_res, struct kv_rollback_arg *rollback_arg);
+static int  _update_indexes(struct kv_store       *kv_store,
+                            const char            *key,
+                            struct kv_store_value *value,
+                            bool                   old_indexed,
+                            bool                   has_archive);
 
 int sid_kvs_set(sid_res_t *kv_store_res, struct sid_kvs_set_args *args)
 {
@@ -570,7 +651,7 @@ int sid_kvs_set(sid_res_t *kv_store_res, struct sid_kvs_set_args *args)
 		iov_cnt               = 1;
 	}
 
-	if (!(kv_store_value = _create_kv_store_value(iov, iov_cnt, args->flags, args->op_flags, &kv_store_value_size)))
+	if (!(kv_store_value = _create_kv_store_value(kv_store, iov, iov_cnt, args->flags, args->op_flags, &kv_store_value_size)))
 		return -ENOMEM;
 
 	c_key         = _canonicalize_key(args->key);
@@ -584,6 +665,9 @@ int sid_kvs_set(sid_res_t *kv_store_res, struct sid_kvs_set_args *args)
 	if ((r = _set_value(kv_store, c_key, &kv_store_value, &kv_store_value_size, &relay)) < 0)
 		return r;
 
+	if (kv_store_value && (r = _update_indexes(kv_store, c_key, kv_store_value, relay.old_indexed, false)) < 0)
+		return r;
+
 	if (relay.archive_arg.has_archive && relay.archive_arg.kv_store_value) {
 		relay.archive_arg.has_archive = false;
 		relay.archive_arg.is_archive  = true;
@@ -604,6 +688,9 @@ int sid_kvs_set(sid_res_t *kv_store_res, struct sid_kvs_set_args *args)
 			}
 			return r;
 		}
+
+		if ((r = _update_indexes(kv_store, c_archive_key, relay.archive_arg.kv_store_value, relay.old_indexed, false)) < 0)
+			return r;
 	}
 
 	if (args->stored_value)
@@ -612,6 +699,90 @@ int sid_kvs_set(sid_res_t *kv_store_res, struct sid_kvs_set_args *args)
 	return 0;
 }
 
+struct kv_batch_item {
+	const char *key;
+	size_t      idx;
+};
+
+static int _batch_item_cmp(const void *a, const void *b)
+{
+	const struct kv_batch_item *item_a = a, *item_b = b;
+	int                         r;
+
+	if ((r = strcmp(item_a->key, item_b->key)))
+		return r;
+
+	/* keep the order of items with the same key so the last one wins */
+	return (item_a->idx > item_b->idx) - (item_a->idx < item_b->idx);
+}
+
+int sid_kvs_set_batch(sid_res_t *kv_store_res, struct sid_kvs_set_args *args, size_t count, int *results)
+{
+	struct kv_store         *kv_store;
+	struct kv_batch_item    *items;
+	struct sid_kvs_savepoint savepoint;
+	const char              *c_key;
+	size_t                   i, failed_idx = count;
+	bool                     own_trans     = false;
+	int                      r             = 0, item_r;
+
+	if (!sid_res_match(kv_store_res, &sid_res_type_kvs, NULL) || (count && !args))
+		return -EINVAL;
+
+	if (!count)
+		return 0;
+
+	if (!(items = malloc(count * sizeof(*items))))
+		return -ENOMEM;
+
+	for (i = 0; i < count; i++) {
+		c_key    = _canonicalize_key(args[i].key);
+		items[i] = (struct kv_batch_item) {.key = c_key ?: "", .idx = i};
+	}
+
+	/*
+	 * Go through the keys in order so that with the bptree cursor, neighbouring
+	 * keys are found in the same leaf without descending from the root again.
+	 */
+	qsort(items, count, sizeof(*items), _batch_item_cmp);
+
+	if (!sid_kvs_transaction_active(kv_store_res)) {
+		if ((r = sid_kvs_transaction_begin(kv_store_res)) < 0)
+			goto out;
+		own_trans = true;
+	}
+
+	kv_store = sid_res_get_data(kv_store_res);
+
+	if (kv_store->backend == SID_KVS_BACKEND_BPTREE)
+		bptree_cursor_begin(kv_store->bpt);
+
+	for (i = 0; i < count; i++) {
+		(void) sid_kvs_savepoint(kv_store_res, &savepoint);
+
+		if ((item_r = sid_kvs_set(kv_store_res, &args[items[i].idx])) < 0) {
+			(void) sid_kvs_rollback_to(kv_store_res, &savepoint);
+
+			if (items[i].idx < failed_idx) {
+				failed_idx = items[i].idx;
+				r          = item_r;
+			}
+		}
+
+		if (results)
+			results[items[i].idx] = item_r;
+	}
+
+	if (kv_store->backend == SID_KVS_BACKEND_BPTREE)
+		bptree_cursor_end(kv_store->bpt);
+
+	if (own_trans)
+		sid_kvs_transaction_end(kv_store_res, false);
+out:
+	free(items);
+	return r;
+}
+
 int sid_kvs_add_alias(sid_res_t *kv_store_res, const char *key, const char *alias, bool force)
 {
 	struct kv_store *kv_store;
@@ -689,6 +860,8 @@ static int _unset_fn(const char                *key,
 	const char                *key_dup;
 	int                        r;
 
+	relay->old_indexed = old_value && (old_value->int_flags & KV_STORE_VALUE_INT_INDEXED);
+
 	if (relay->fn) {
 		update_spec.key           = key;
 
@@ -713,6 +886,8 @@ static int _unset_fn(const char                *key,
 		r = 1;
 
 	if (r == 1) {
+		relay->changed = true;
+
 		if (relay->unset_buf) {
 			if ((key_dup = strdup(key))) {
 				struct kv_unset_arg unset_arg = {.key = key_dup, .has_archive = relay->archive_arg.has_archive};
@@ -723,7 +898,7 @@ static int _unset_fn(const char                *key,
 
 			r = 0;
 		} else if (old_value_ref_count == 1 && !relay->archive_arg.has_archive)
-			_destroy_kv_store_value(old_value);
+			_destroy_kv_store_value(relay->kv_store, old_value);
 
 		if (relay->archive_arg.has_archive) {
 			relay->archive_arg.kv_store_value      = old_value;
@@ -776,7 +951,9 @@ static bptree_update_action_t _bptree_unset_fn(const char *key,
 
 static int _unset_value(struct kv_store *kv_store, const char *key, struct kv_update_fn_relay *relay)
 {
-	int r = 0;
+	int r           = 0;
+
+	relay->kv_store = kv_store;
 
 	switch (kv_store->backend) {
 		case SID_KVS_BACKEND_HASH:
@@ -794,31 +971,298 @@ static int _unset_value(struct kv_store *kv_store, const char *key, struct kv_up
 	return 0;
 }
 
-int sid_kvs_unset(sid_res_t *kv_store_res, struct sid_kvs_unset_args *args)
+static bool _is_index_key(struct kv_store *kv_store, const char *key)
 {
-	struct kv_store          *kv_store;
-	struct kv_update_fn_relay relay;
-	const char               *c_key, *c_archive_key;
-	int                       r = 0;
+	unsigned i;
 
-	if (!args)
-		return -EINVAL;
+	for (i = 0; i < kv_store->index_count; i++) {
+		if (!strncmp(key, kv_store->indexes[i].spec.prefix, kv_store->indexes[i].prefix_len))
+			return true;
+	}
 
-	if (!sid_res_match(kv_store_res, &sid_res_type_kvs, NULL) || UTIL_STR_EMPTY(args->key))
+	return false;
+}
+
+/*
+ * Composes '<prefix><part><key>' index key, using buf if it is big enough.
+ * Returns NULL with ret_code set to 0 if the key has no part for the index.
+ */
+static char *_compose_index_key(struct kv_index *index, const char *key, char *buf, size_t buf_size, int *ret_code)
+{
+	util_mem_t mem = {.base = buf, .size = buf_size};
+	char       part[KV_INDEX_PART_SIZE];
+	char      *index_key;
+
+	*ret_code      = 0;
+
+	if (index->spec.part_fn) {
+		if (!index->spec.part_fn(key, part, sizeof(part), index->spec.fn_arg))
+			return NULL;
+	} else
+		part[0] = '\0';
+
+	if (!(index_key = util_str_comb_to_str(&mem, index->spec.prefix, part, key)) &&
+	    !(index_key = util_str_comb_to_str(NULL, index->spec.prefix, part, key)))
+		*ret_code = -ENOMEM;
+
+	return index_key;
+}
+
+static int _add_index_key(struct kv_store *kv_store, const char *key, const char *index_key)
+{
+	const char *key_dup;
+	int         r;
+
+	/*
+	 * Record the rollback before adding the alias. If we fail to add it, the rollback
+	 * finds nothing under the index key and there's nothing to do.
+	 */
+	if (kv_store->trans_rollback_buf) {
+		if (!(key_dup = strdup(index_key)))
+			return -ENOMEM;
+
+		struct kv_rollback_arg rollback_arg = {.key = key_dup, .is_index = true};
+
+		if ((r = sid_buf_add(kv_store->trans_rollback_buf, &rollback_arg, sizeof(rollback_arg), NULL, NULL)) < 0) {
+			free((void *) key_dup);
+			return r;
+		}
+	}
+
+	if (bptree_add_alias(kv_store->bpt, key, index_key, true) < 0)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static int _unset_index_key(struct kv_store *kv_store, const char *index_key, bool has_archive)
+{
+	struct kv_update_fn_relay relay = {.archive_arg.has_archive = has_archive};
+
+	return _unset_value(kv_store, index_key, &relay);
+}
+
+/*
+ * Returns 1 if the index key needs to be removed, but we are under a transaction.
+ */
+static int _update_index(struct kv_store       *kv_store,
+                         struct kv_index       *index,
+                         const char            *key,
+                         struct kv_store_value *value,
+                         bool                   match,
+                         bool                   has_archive)
+{
+	char                   buf[KV_INDEX_KEY_BUF_SIZE];
+	char                  *index_key;
+	struct kv_store_value *index_value;
+	int                    r;
+
+	if (!(index_key = _compose_index_key(index, key, buf, sizeof(buf), &r)))
+		return r;
+
+	index_value = bptree_lookup(kv_store->bpt, index_key, NULL, NULL);
+
+	if (match && index_value != value)
+		r = _add_index_key(kv_store, key, index_key);
+	else if (!match && index_value)
+		r = kv_store->trans_unset_buf ? 1 : _unset_index_key(kv_store, index_key, has_archive);
+
+	if (match && r == 0)
+		value->int_flags |= KV_STORE_VALUE_INT_INDEXED;
+
+	if (index_key != buf)
+		free(index_key);
+
+	return r;
+}
+
+/*
+ * Makes all registered indexes reflect the value currently stored under the key
+ * (value is NULL if the key has just been unset).
+ *
+ * Under a transaction, index keys are added immediately with a rollback record, but
+ * their removal is deferred like any other unset. At the end of the transaction, the
+ * indexes are updated once more for the key with whatever value it has at that time
+ * so that any later set within the same transaction is taken into account.
+ */
+/*
+ * Index keys exist only for values which matched an index. Such values are marked
+ * with KV_STORE_VALUE_INT_INDEXED and the mark is never cleared, so that it stays
+ * valid when rolling back. If neither the old value is marked nor the new value
+ * matches, there is no index key to look up, add or remove.
+ */
+static int _update_indexes(struct kv_store       *kv_store,
+                           const char            *key,
+                           struct kv_store_value *value,
+                           bool                   old_indexed,
+                           bool                   has_archive)
+{
+	struct kv_index *index;
+	const char      *key_dup;
+	unsigned         i;
+	bool             match, deferred = false;
+	int              r;
+
+	if (!kv_store->index_count || _is_index_key(kv_store, key))
+		return 0;
+
+	for (i = 0; i < kv_store->index_count; i++) {
+		index = &kv_store->indexes[i];
+		match = value && index->spec.match_fn(key, _get_data(value), value->size, value->ext_flags, index->spec.fn_arg);
+
+		if (!match && !old_indexed)
+			continue;
+
+		if ((r = _update_index(kv_store, index, key, value, match, has_archive)) < 0)
+			return r;
+
+		if (r == 1)
+			deferred = true;
+	}
+
+	if (deferred) {
+		if (!(key_dup = strdup(key)))
+			return -ENOMEM;
+
+		struct kv_unset_arg unset_arg = {.key = key_dup, .has_archive = has_archive, .is_index = true};
+
+		if ((r = sid_buf_add(kv_store->trans_unset_buf, &unset_arg, sizeof(unset_arg), NULL, NULL)) < 0) {
+			free((void *) key_dup);
+			return r;
+		}
+	}
+
+	return 0;
+}
+
+static int _build_index(sid_res_t *kv_store_res, struct kv_index *index)
+{
+	struct kv_store       *kv_store = sid_res_get_data(kv_store_res);
+	struct sid_buf        *key_buf;
+	bptree_iter_t         *iter;
+	struct kv_store_value *value;
+	const char            *key;
+	char                  *key_dup, **keys;
+	size_t                 i, nr_keys;
+	int                    r = 0;
+
+	/*
+	 * Adding aliases while iterating would restructure the tree under the iterator,
+	 * so collect matching keys first and add the index keys afterwards.
+	 */
+	if (!(key_buf = sid_buf_create(&SID_BUF_SPEC(), &SID_BUF_INIT(.alloc_step = 64 * sizeof(char *)), &r)))
+		return r;
+
+	if (!(iter = bptree_iter_create(kv_store->bpt, NULL, NULL))) {
+		r = -ENOMEM;
+		goto out;
+	}
+
+	while ((value = bptree_iter_next(iter, &key, NULL, NULL))) {
+		if (_is_index_key(kv_store, key) ||
+		    !index->spec.match_fn(key, _get_data(value), value->size, value->ext_flags, index->spec.fn_arg))
+			continue;
+
+		if (!(key_dup = strdup(key)) || (r = sid_buf_add(key_buf, &key_dup, sizeof(key_dup), NULL, NULL)) < 0) {
+			free(key_dup);
+			r = -ENOMEM;
+			break;
+		}
+	}
+
+	bptree_iter_destroy(iter);
+out:
+	sid_buf_get_data(key_buf, (const void **) &keys, &nr_keys);
+	nr_keys = nr_keys / sizeof(char *);
+
+	for (i = 0; i < nr_keys; i++) {
+		if (r == 0)
+			r = _update_index(kv_store, index, keys[i], bptree_lookup(kv_store->bpt, keys[i], NULL, NULL), true, false);
+		free(keys[i]);
+	}
+
+	sid_buf_destroy(key_buf);
+
+	if (r < 0)
+		sid_res_log_error_errno(kv_store_res, r, "Failed to build index with prefix %s", index->spec.prefix);
+
+	return r;
+}
+
+int sid_kvs_index_register(sid_res_t *kv_store_res, const struct sid_kvs_index_spec *spec)
+{
+	struct kv_store *kv_store;
+	struct kv_index *indexes;
+	char            *prefix;
+
+	if (!sid_res_match(kv_store_res, &sid_res_type_kvs, NULL) || !spec || UTIL_STR_EMPTY(spec->prefix) || !spec->match_fn)
 		return -EINVAL;
 
-	kv_store      = sid_res_get_data(kv_store_res);
+	kv_store = sid_res_get_data(kv_store_res);
 
-	c_key         = _canonicalize_key(args->key);
-	c_archive_key = _canonicalize_key(args->archive_key);
+	if (kv_store->backend != SID_KVS_BACKEND_BPTREE)
+		return -ENOTSUP;
 
-	relay         = (struct kv_update_fn_relay) {.fn                      = args->fn,
-	                                             .fn_arg                  = args->fn_arg,
-	                                             .archive_arg.has_archive = c_archive_key != NULL,
-	                                             .unset_buf               = kv_store->trans_unset_buf};
+	if (sid_kvs_transaction_active(kv_store_res))
+		return -EBUSY;
+
+	if (!(indexes = realloc(kv_store->indexes, (kv_store->index_count + 1) * sizeof(*indexes))))
+		return -ENOMEM;
+
+	kv_store->indexes = indexes;
+
+	if (!(prefix = strdup(spec->prefix)))
+		return -ENOMEM;
+
+	indexes[kv_store->index_count] = (struct kv_index) {.spec = *spec, .prefix_len = strlen(prefix)};
+	indexes[kv_store->index_count].spec.prefix = prefix;
+	kv_store->index_count++;
+
+	if (spec->flags & SID_KVS_IDX_FL_NO_BUILD)
+		return 0;
+
+	return _build_index(kv_store_res, &indexes[kv_store->index_count - 1]);
+}
+
+static int _unset_key(sid_res_t             *kv_store_res,
+                      const char            *c_key,
+                      const char            *c_archive_key,
+                      sid_kvs_update_cb_fn_t fn,
+                      void                  *fn_arg,
+                      bool                  *unset)
+{
+	struct kv_store          *kv_store = sid_res_get_data(kv_store_res);
+	struct kv_update_fn_relay relay;
+	char                      key_buf[KV_INDEX_KEY_BUF_SIZE];
+	util_mem_t                mem     = {.base = key_buf, .size = sizeof(key_buf)};
+	char                     *key_dup = NULL;
+	int                       r       = 0;
+
+	/*
+	 * The key may be the very key the store keeps for the record or for any
+	 * of its index keys (e.g. the one returned while iterating an index).
+	 * Make a copy so we can still use it after unsetting the record.
+	 */
+	if (kv_store->index_count) {
+		if (!(key_dup = util_str_comb_to_str(&mem, NULL, c_key, NULL)) && !(key_dup = strdup(c_key)))
+			return -ENOMEM;
+
+		c_key = key_dup;
+	}
+
+	relay = (struct kv_update_fn_relay) {.fn                      = fn,
+	                                     .fn_arg                  = fn_arg,
+	                                     .archive_arg.has_archive = c_archive_key != NULL,
+	                                     .unset_buf               = kv_store->trans_unset_buf};
 
 	if ((r = _unset_value(kv_store, c_key, &relay)) < 0)
-		return r;
+		goto out;
+
+	if (unset)
+		*unset = relay.changed;
+
+	if (relay.changed && (r = _update_indexes(kv_store, c_key, NULL, relay.old_indexed, relay.archive_arg.has_archive)) < 0)
+		goto out;
 
 	if (relay.archive_arg.has_archive && relay.archive_arg.kv_store_value) {
 		relay.archive_arg.has_archive = false;
@@ -838,11 +1282,147 @@ int sid_kvs_unset(sid_res_t *kv_store_res, struct sid_kvs_unset_args *args)
 				                                   .kv_store_value      = relay.archive_arg.kv_store_value,
 				                                   .kv_store_value_size = relay.archive_arg.kv_store_value_size});
 			}
-			return r;
+			goto out;
 		}
+
+		r = _update_indexes(kv_store, c_archive_key, relay.archive_arg.kv_store_value, relay.old_indexed, false);
 	}
+out:
+	if (key_dup != key_buf)
+		free(key_dup);
 
-	return 0;
+	return r;
+}
+
+int sid_kvs_unset(sid_res_t *kv_store_res, struct sid_kvs_unset_args *args)
+{
+	if (!args)
+		return -EINVAL;
+
+	if (!sid_res_match(kv_store_res, &sid_res_type_kvs, NULL) || UTIL_STR_EMPTY(args->key))
+		return -EINVAL;
+
+	return _unset_key(kv_store_res,
+	                  _canonicalize_key(args->key),
+	                  _canonicalize_key(args->archive_key),
+	                  args->fn,
+	                  args->fn_arg,
+	                  NULL);
+}
+
+static int _do_sid_kvs_unset_range(sid_res_t             *kv_store_res,
+                                   kvs_iter_method_t      method,
+                                   const char            *key_start,
+                                   const char            *key_end,
+                                   const char            *archive_prefix,
+                                   sid_kvs_update_cb_fn_t fn,
+                                   void                  *fn_arg)
+{
+	struct kv_store *kv_store;
+	struct sid_buf  *key_buf;
+	bptree_iter_t   *iter;
+	const char      *key;
+	char            *key_dup, **keys, *archive_key;
+	size_t           i, nr_keys, prefix_len;
+	bool             unset;
+	int              count = 0, r = 0;
+
+	if (!sid_res_match(kv_store_res, &sid_res_type_kvs, NULL))
+		return -EINVAL;
+
+	kv_store = sid_res_get_data(kv_store_res);
+
+	if (kv_store->backend != SID_KVS_BACKEND_BPTREE)
+		return -ENOTSUP;
+
+	/*
+	 * Unset the keys one by one, just like sid_kvs_unset would. Collect them
+	 * first as unsetting them while iterating would change the tree.
+	 */
+	if (!(key_buf = sid_buf_create(&SID_BUF_SPEC(), &SID_BUF_INIT(.alloc_step = 64 * sizeof(char *)), &r)))
+		return r;
+
+	/*
+	 * The iterator starts at the leaf where key_start belongs even if there
+	 * is no such key, so only keys from that leaf may precede the range.
+	 * A prefix is looked up as a range start too and the iteration stops
+	 * at the first key without the prefix.
+	 */
+	if (!(iter = bptree_iter_create(kv_store->bpt, key_start, method == ITER_PREFIX ? NULL : key_end))) {
+		r = -ENOMEM;
+		goto out;
+	}
+
+	prefix_len = method == ITER_PREFIX ? strlen(key_start) : 0;
+
+	while (bptree_iter_next(iter, &key, NULL, NULL)) {
+		if (key_start && strcmp(key, key_start) < 0)
+			continue;
+
+		if (prefix_len && strncmp(key, key_start, prefix_len))
+			break;
+
+		if (_is_index_key(kv_store, key))
+			continue;
+
+		if (!(key_dup = strdup(key)) || (r = sid_buf_add(key_buf, &key_dup, sizeof(key_dup), NULL, NULL)) < 0) {
+			free(key_dup);
+			r = -ENOMEM;
+			break;
+		}
+	}
+
+	bptree_iter_destroy(iter);
+out:
+	sid_buf_get_data(key_buf, (const void **) &keys, &nr_keys);
+	nr_keys = nr_keys / sizeof(char *);
+
+	for (i = 0; i < nr_keys; i++) {
+		if (r == 0) {
+			archive_key = NULL;
+
+			if (archive_prefix && !(archive_key = util_str_comb_to_str(NULL, archive_prefix, keys[i], NULL)))
+				r = -ENOMEM;
+			else if ((r = _unset_key(kv_store_res, keys[i], archive_key, fn, fn_arg, &unset)) == 0 && unset)
+				count++;
+
+			free(archive_key);
+		}
+
+		free(keys[i]);
+	}
+
+	sid_buf_destroy(key_buf);
+
+	return r < 0 ? r : count;
+}
+
+int sid_kvs_unset_range(sid_res_t *kv_store_res, struct sid_kvs_unset_range_args *args)
+{
+	if (!args)
+		return -EINVAL;
+
+	return _do_sid_kvs_unset_range(kv_store_res,
+	                               ITER_EXACT,
+	                               _canonicalize_key(args->key_start),
+	                               _canonicalize_key(args->key_end),
+	                               args->archive_prefix,
+	                               args->fn,
+	                               args->fn_arg);
+}
+
+int sid_kvs_unset_prefix(sid_res_t *kv_store_res, struct sid_kvs_unset_prefix_args *args)
+{
+	if (!args || !args->prefix)
+		return -EINVAL;
+
+	return _do_sid_kvs_unset_range(kv_store_res,
+	                               ITER_PREFIX,
+	                               _canonicalize_key(args->prefix),
+	                               NULL,
+	                               args->archive_prefix,
+	                               args->fn,
+	                               args->fn_arg);
 }
 
 static int _rollback_fn(const char             *key,
@@ -853,18 +1433,22 @@ static int _rollback_fn(const char             *key,
 	if ((!rollback_value && !curr_value) || (rollback_value && curr_value == *rollback_value))
 		return 0;
 
+	/* Index key added within the transaction - just drop it, the value belongs to the indexed key. */
+	if (trans_arg->is_index)
+		return curr_value ? 2 : 0;
+
 	if (!curr_value) {
 		/*
 		 * This is paranoia. The only way curr_value can be NULL is if we failed adding a new value. In
 		 * that case, rollback_value should always be NULL. But destroy it if it exists, just to be safe.
 		 * Otherwise, we would leak memory if it existed.
 		 */
-		_destroy_kv_store_value(*rollback_value);
+		_destroy_kv_store_value(sid_res_get_data(trans_arg->res), *rollback_value);
 		return 0;
 	}
 
 	if (!trans_arg->is_archive)
-		_destroy_kv_store_value(curr_value);
+		_destroy_kv_store_value(sid_res_get_data(trans_arg->res), curr_value);
 
 	sid_res_log_debug(trans_arg->res, "Rolling back value for key %s", key);
 
@@ -925,7 +1509,8 @@ static void _kv_store_trans_rollback_value(sid_res_t *kv_store_res, struct kv_ro
 	struct kv_store       *kv_store     = sid_res_get_data(kv_store_res);
 	struct kv_trans_fn_arg trans_fn_arg = {.res         = kv_store_res,
 	                                       .has_archive = rollback_arg->has_archive,
-	                                       .is_archive  = rollback_arg->is_archive};
+	                                       .is_archive  = rollback_arg->is_archive,
+	                                       .is_index    = rollback_arg->is_index};
 
 	switch (kv_store->backend) {
 		case SID_KVS_BACKEND_HASH:
@@ -954,11 +1539,44 @@ static void _kv_store_trans_unset_value(sid_res_t *kv_store_res, struct kv_unset
 	struct kv_store          *kv_store = sid_res_get_data(kv_store_res);
 	struct kv_update_fn_relay relay    = {0};
 
-	relay.archive_arg.has_archive      = unset_arg->has_archive;
+	if (unset_arg->is_index) {
+		(void) _update_indexes(kv_store,
+		                       unset_arg->key,
+		                       bptree_lookup(kv_store->bpt, unset_arg->key, NULL, NULL),
+		                       true,
+		                       unset_arg->has_archive);
+		return;
+	}
+
+	relay.archive_arg.has_archive = unset_arg->has_archive;
 
 	_unset_value(kv_store, unset_arg->key, &relay);
 }
 
+/*
+ * Rolls back all values recorded in the rollback buffer past 'pos' and cuts the buffer there.
+ * Go backwards so that a key changed several times ends up with the value it had at 'pos'.
+ */
+static void _kv_store_trans_rollback_values(sid_res_t *kv_store_res, size_t pos)
+{
+	struct kv_store        *kv_store = sid_res_get_data(kv_store_res);
+	struct kv_rollback_arg *rollback_args;
+	size_t                  i, nr_args;
+
+	if (sid_buf_count(kv_store->trans_rollback_buf) == pos)
+		return;
+
+	sid_buf_get_data_from(kv_store->trans_rollback_buf, pos, (const void **) &rollback_args, &nr_args);
+	nr_args = nr_args / sizeof(struct kv_rollback_arg);
+
+	for (i = nr_args; i > 0; i--) {
+		_kv_store_trans_rollback_value(kv_store_res, &rollback_args[i - 1]);
+		free((void *) rollback_args[i - 1].key);
+	}
+
+	(void) sid_buf_rewind(kv_store->trans_rollback_buf, pos, SID_BUF_POS_ABS);
+}
+
 bool sid_kvs_transaction_active(sid_res_t *kv_store_res)
 {
 	struct kv_store *kv_store;
@@ -974,7 +1592,7 @@ bool sid_kvs_transaction_active(sid_res_t *kv_store_res)
 int sid_kvs_transaction_begin(sid_res_t *kv_store_res)
 {
 	struct kv_store *kv_store;
-	struct sid_buf  *rollback_buf, *unset_buf;
+	struct sid_buf  *rollback_buf, *unset_buf, *rollback_to_buf;
 	int              r = -1;
 
 	if (!sid_res_match(kv_store_res, &sid_res_type_kvs, NULL))
@@ -992,10 +1610,18 @@ int sid_kvs_transaction_begin(sid_res_t *kv_store_res)
 		sid_buf_destroy(rollback_buf);
 		return r;
 	}
+	if (!(rollback_to_buf = sid_buf_create(&SID_BUF_SPEC(), &SID_BUF_INIT(.alloc_step = 1), &r))) {
+		sid_res_log_error_errno(kv_store_res, r, "Failed to create transaction savepoint tracker buffer");
+		sid_buf_destroy(unset_buf);
+		sid_buf_destroy(rollback_buf);
+		return r;
+	}
 
-	kv_store                     = sid_res_get_data(kv_store_res);
-	kv_store->trans_rollback_buf = rollback_buf;
-	kv_store->trans_unset_buf    = unset_buf;
+	kv_store                        = sid_res_get_data(kv_store_res);
+	kv_store->trans_rollback_buf    = rollback_buf;
+	kv_store->trans_unset_buf       = unset_buf;
+	kv_store->trans_rollback_to_buf = rollback_to_buf;
+	kv_store->trans_gen++;
 
 	return 0;
 }
@@ -1003,6 +1629,7 @@ int sid_kvs_transaction_begin(sid_res_t *kv_store_res)
 void sid_kvs_transaction_end(sid_res_t *kv_store_res, bool rollback)
 {
 	struct kv_store        *kv_store;
+	struct sid_buf         *unset_buf;
 	struct kv_rollback_arg *rollback_args;
 	struct kv_unset_arg    *unset_args;
 	size_t                  i, nr_args;
@@ -1018,9 +1645,12 @@ void sid_kvs_transaction_end(sid_res_t *kv_store_res, bool rollback)
 	kv_store = sid_res_get_data(kv_store_res);
 
 	/*
-	 * Handle unset buffer.
+	 * Handle unset buffer. Detach it first so the unsets are not deferred again.
 	 */
-	sid_buf_get_data(kv_store->trans_unset_buf, (const void **) &unset_args, &nr_args);
+	unset_buf                 = kv_store->trans_unset_buf;
+	kv_store->trans_unset_buf = NULL;
+
+	sid_buf_get_data(unset_buf, (const void **) &unset_args, &nr_args);
 	nr_args = nr_args / sizeof(struct kv_unset_arg);
 
 	for (i = 0; i < nr_args; i++) {
@@ -1030,26 +1660,116 @@ void sid_kvs_transaction_end(sid_res_t *kv_store_res, bool rollback)
 		free((void *) unset_args[i].key);
 	}
 
-	sid_buf_destroy(kv_store->trans_unset_buf);
-	kv_store->trans_unset_buf = NULL;
+	sid_buf_destroy(unset_buf);
 
 	/*
 	 * Handle rollback buffer.
 	 */
-	sid_buf_get_data(kv_store->trans_rollback_buf, (const void **) &rollback_args, &nr_args);
-	nr_args = nr_args / sizeof(struct kv_rollback_arg);
+	if (rollback)
+		_kv_store_trans_rollback_values(kv_store_res, 0);
+	else {
+		sid_buf_get_data(kv_store->trans_rollback_buf, (const void **) &rollback_args, &nr_args);
+		nr_args = nr_args / sizeof(struct kv_rollback_arg);
 
-	for (i = 0; i < nr_args; i++) {
-		if (rollback)
-			_kv_store_trans_rollback_value(kv_store_res, &rollback_args[i]);
-		else if (!rollback_args[i].has_archive)
-			_destroy_kv_store_value(rollback_args[i].kv_store_value);
+		for (i = 0; i < nr_args; i++) {
+			if (!rollback_args[i].has_archive)
+				_destroy_kv_store_value(kv_store, rollback_args[i].kv_store_value);
 
-		free((void *) rollback_args[i].key);
+			free((void *) rollback_args[i].key);
+		}
 	}
 
 	sid_buf_destroy(kv_store->trans_rollback_buf);
 	kv_store->trans_rollback_buf = NULL;
+
+	sid_buf_destroy(kv_store->trans_rollback_to_buf);
+	kv_store->trans_rollback_to_buf = NULL;
+}
+
+int sid_kvs_savepoint(sid_res_t *kv_store_res, struct sid_kvs_savepoint *savepoint)
+{
+	struct kv_store *kv_store;
+
+	if (!sid_res_match(kv_store_res, &sid_res_type_kvs, NULL) || !savepoint)
+		return -EINVAL;
+
+	if (!sid_kvs_transaction_active(kv_store_res))
+		return -ENOENT;
+
+	kv_store                = sid_res_get_data(kv_store_res);
+	savepoint->trans_gen    = kv_store->trans_gen;
+	savepoint->rollback_cnt = sid_buf_count(kv_store->trans_rollback_to_buf) / sizeof(struct sid_kvs_savepoint);
+	savepoint->rollback_pos = sid_buf_count(kv_store->trans_rollback_buf);
+	savepoint->unset_pos    = sid_buf_count(kv_store->trans_unset_buf);
+
+	return 0;
+}
+
+int sid_kvs_rollback_to(sid_res_t *kv_store_res, const struct sid_kvs_savepoint *savepoint)
+{
+	struct kv_store                *kv_store;
+	struct kv_unset_arg            *unset_args;
+	const struct sid_kvs_savepoint *rolled_back;
+	size_t                          i, nr_args, pos;
+	int                             r;
+
+	if (!sid_res_match(kv_store_res, &sid_res_type_kvs, NULL) || !savepoint)
+		return -EINVAL;
+
+	if (!sid_kvs_transaction_active(kv_store_res))
+		return -ENOENT;
+
+	kv_store = sid_res_get_data(kv_store_res);
+
+	if (savepoint->trans_gen != kv_store->trans_gen)
+		return -ERANGE;
+
+	/*
+	 * Rollbacks done after the savepoint was taken must not have gone before
+	 * it. Otherwise the changes the savepoint refers to were undone and the
+	 * positions it holds may now point to changes made later.
+	 */
+	pos = savepoint->rollback_cnt * sizeof(struct sid_kvs_savepoint);
+
+	if (pos > sid_buf_count(kv_store->trans_rollback_to_buf))
+		return -ERANGE;
+
+	if (pos < sid_buf_count(kv_store->trans_rollback_to_buf)) {
+		sid_buf_get_data_from(kv_store->trans_rollback_to_buf, pos, (const void **) &rolled_back, &nr_args);
+		nr_args = nr_args / sizeof(struct sid_kvs_savepoint);
+
+		for (i = 0; i < nr_args; i++) {
+			if (rolled_back[i].rollback_pos < savepoint->rollback_pos ||
+			    rolled_back[i].unset_pos < savepoint->unset_pos)
+				break;
+		}
+
+		(void) sid_buf_unbind(kv_store->trans_rollback_to_buf, pos, SID_BUF_POS_ABS);
+
+		if (i < nr_args)
+			return -ERANGE;
+	}
+
+	if ((r = sid_buf_add(kv_store->trans_rollback_to_buf, (void *) savepoint, sizeof(*savepoint), NULL, NULL)) < 0)
+		return r;
+
+	/*
+	 * Unsets are only deferred within a transaction, so there's nothing to undo
+	 * for those recorded after the savepoint - just forget them.
+	 */
+	if (sid_buf_count(kv_store->trans_unset_buf) > savepoint->unset_pos) {
+		sid_buf_get_data_from(kv_store->trans_unset_buf, savepoint->unset_pos, (const void **) &unset_args, &nr_args);
+		nr_args = nr_args / sizeof(struct kv_unset_arg);
+
+		for (i = 0; i < nr_args; i++)
+			free((void *) unset_args[i].key);
+
+		(void) sid_buf_rewind(kv_store->trans_unset_buf, savepoint->unset_pos, SID_BUF_POS_ABS);
+	}
+
+	_kv_store_trans_rollback_values(kv_store_res, savepoint->rollback_pos);
+
+	return 0;
 }
 
 static sid_kvs_iter_t *
@@ -1313,6 +2033,19 @@ size_t sid_kvs_get_size(sid_res_t *kv_store_res, size_t *meta_size, size_t *data
 	}
 }
 
+unsigned sid_kvs_get_slab_stats(sid_res_t *kv_store_res, struct mem_slab_stats *stats, unsigned count)
+{
+	struct kv_store *kv_store = sid_res_get_data(kv_store_res);
+	unsigned         n;
+
+	n = mem_slab_cache_get_stats(kv_store->value_cache, stats, count);
+
+	if (kv_store->backend == SID_KVS_BACKEND_BPTREE)
+		n += bptree_get_slab_stats(kv_store->bpt, stats + n, count - n);
+
+	return n;
+}
+
 static int _init_kv_store(sid_res_t *kv_store_res, const void *kickstart_data, void **data)
 {
 	const struct sid_kvs_res_params *params = kickstart_data;
@@ -1325,6 +2058,11 @@ static int _init_kv_store(sid_res_t *kv_store_res, const void *kickstart_data, v
 
 	kv_store->backend = params->backend;
 
+	if (!(kv_store->value_cache = mem_slab_cache_create("kvs-value"))) {
+		sid_res_log_error(kv_store_res, "Failed to create value cache for key-value store.");
+		goto out;
+	}
+
 	switch (kv_store->backend) {
 		case SID_KVS_BACKEND_HASH:
 			if (!(kv_store->ht = hash_create(params->hash.initial_size))) {
@@ -1343,6 +2081,8 @@ static int _init_kv_store(sid_res_t *kv_store_res, const void *kickstart_data, v
 	*data = kv_store;
 	return 0;
 out:
+	if (kv_store)
+		mem_slab_cache_destroy(kv_store->value_cache);
 	free(kv_store);
 	return -1;
 }
@@ -1350,6 +2090,7 @@ out:
 static int _destroy_kv_store(sid_res_t *kv_store_res)
 {
 	struct kv_store *kv_store = sid_res_get_data(kv_store_res);
+	unsigned         i;
 
 	switch (kv_store->backend) {
 		case SID_KVS_BACKEND_HASH:
@@ -1362,6 +2103,11 @@ static int _destroy_kv_store(sid_res_t *kv_store_res)
 			break;
 	}
 
+	for (i = 0; i < kv_store->index_count; i++)
+		free((void *) kv_store->indexes[i].spec.prefix);
+	free(kv_store->indexes);
+
+	mem_slab_cache_destroy(kv_store->value_cache);
 	free(kv_store);
 	return 0;
 }
@@ -591,6 +591,14 @@ fail:
 	return r;
 }
 
+int sid_res_ev_set_io_events(sid_res_ev_src_t *es, uint32_t events)
+{
+	if (es->type != EVENT_SOURCE_IO)
+		return -EINVAL;
+
+	return sd_event_source_set_io_events(es->sd_es, events);
+}
+
 static int _sd_signal_event_handler(sd_event_source *sd_es, int sfd, uint32_t revents, void *data)
 {
 	sid_res_ev_src_t       *es = sd_event_source_get_userdata(sd_es);
@@ -16,8 +16,11 @@
 #include "iface/ifc-internal.h"
 #include "internal/bmp.h"
 #include "internal/fmt.h"
+#include "internal/hash.h"
+#include "internal/list.h"
 #include "internal/mem.h"
 #include "internal/util.h"
+#include "internal/vdelta.h"
 #include "resource/kvs.h"
 #include "resource/mod-reg.h"
 #include "resource/res.h"
@@ -26,9 +29,7 @@
 
 #include <assert.h>
 #include <ctype.h>
-#include <dirent.h>
 #include <fcntl.h>
-#include <libgen.h>
 #include <libudev.h>
 #include <limits.h>
 #include <sys/mman.h>
@@ -52,6 +53,9 @@
 #define MAIN_WORKER_CHANNEL_ID     "main"
 
 #define SYSTEM_PROC_DEVICES_PATH   SYSTEM_PROC_PATH "/devices"
+#define SYSTEM_MODULE_SUBSYSTEM    "module"
+#define SYSFS_DENTS_BUF_SIZE       4096
+#define SCRATCH_ARENA_CHUNK_SIZE   16384
 #define MAIN_KV_STORE_FILE_PATH    "/run/sid.db"
 
 #define KV_PAIR_C                  "="
@@ -60,11 +64,8 @@
 #define ID_NULL                    ""
 #define KV_KEY_NULL                ID_NULL
 
-#define KV_INDEX_NOOP              0
-#define KV_INDEX_ADD               1
-#define KV_INDEX_REMOVE            2
-
 #define KV_PREFIX_OP_SYNC_C        ">"
+#define KV_PREFIX_OP_PERSIST_C     "%"
 #define KV_PREFIX_OP_ARCHIVE_C     "~"
 #define KV_PREFIX_OP_BLANK_C       " "
 #define KV_PREFIX_OP_SET_C         ""
@@ -85,6 +86,7 @@
 #define KV_KEY_DEV_READY           KV_PREFIX_KEY_SYS_C "RDY"
 #define KV_KEY_DEV_RESERVED        KV_PREFIX_KEY_SYS_C "RES"
 #define KV_KEY_DEV_MOD             KV_PREFIX_KEY_SYS_C "MOD"
+#define KV_KEY_DEV_SCAN_CACHE      KV_PREFIX_KEY_SYS_C "SCN"
 
 #define KV_KEY_DOM_ALIAS           "ALS"
 #define KV_KEY_DOM_GROUP           "GRP"
@@ -108,6 +110,10 @@
 
 #define DEFAULT_CMD_TIM_OUT_USEC   180000000
 
+#define SCAN_CACHE_FPR_SIZE        64   /* "<diskseq>:<size>:<hash>" */
+#define SCAN_CACHE_FPR_SPAN        (1024 * 1024) /* bytes hashed at the start and at the end of the device */
+#define SCAN_CACHE_FPR_CHUNK       (64 * 1024)
+
 #define CMD_DEV_PRINT_FMT          "%s (%s/%s)"
 #define CMD_DEV_PRINT(ucmd_ctx)    ucmd_ctx->req_env.dev.udev.name, ucmd_ctx->req_env.dev.num_s, ucmd_ctx->req_env.dev.dsq_s
 
@@ -116,26 +122,71 @@ const sid_res_type_t sid_res_type_ubr_cmn;
 const sid_res_type_t sid_res_type_ubr_con;
 const sid_res_type_t sid_res_type_ubr_cmd;
 
+#define DEV_MAJOR_NAME_SIZE 64
+
+struct dev_major {
+	int  major;
+	char name[DEV_MAJOR_NAME_SIZE];
+};
+
+/*
+ * Block device major number to driver name map as found in SYSTEM_PROC_DEVICES_PATH.
+ * Built in main process so workers inherit it and refreshed only on lookup miss or
+ * whenever a kernel module is loaded.
+ */
+struct dev_major_tbl {
+	struct dev_major *entries;
+	size_t            count;
+};
+
 struct sid_ucmd_common_ctx {
-	sid_res_t      *res;               /* resource representing this common ctx */
-	sid_res_t      *block_mod_reg_res; /* block modules */
-	sid_res_t      *type_mod_reg_res;  /* type modules */
-	sid_res_t      *kvs_res;           /* main KV store or KV store snapshot */
-	uint16_t        gennum;            /* current KV store generation number */
-	struct sid_buf *gen_buf;           /* generic buffer */
+	sid_res_t           *res;               /* resource representing this common ctx */
+	sid_res_t           *block_mod_reg_res; /* block modules */
+	struct mod_disp_tbl *block_mod_disp;    /* per-phase dispatch tables for block modules */
+	sid_res_t           *type_mod_reg_res;  /* type modules */
+	sid_res_t           *kvs_res;           /* main KV store or KV store snapshot */
+	uint16_t             gennum;            /* current KV store generation number */
+	struct sid_buf      *gen_buf;           /* generic buffer */
+	struct dev_major_tbl dev_majors;        /* block device major number to driver name map */
 };
 
 struct ulink {
 	struct udev         *udev;
 	struct udev_monitor *mon;
+	struct udev_monitor *mod_mon; /* kernel module uevents to refresh dev_majors */
 };
 
 struct ubridge {
 	sid_res_t   *internal_res;
 	int          socket_fd;
 	struct ulink ulink;
+	struct list  watchers; /* clients subscribed to changes in main KV store */
+};
+
+struct watcher {
+	struct list       list;
+	int               fd;         /* client connection */
+	sid_res_ev_src_t *es;         /* event source to detect client disconnection and to send queued messages */
+	fmt_output_t      format;     /* output format requested by client */
+	sid_kv_ns_t       ns;         /* only records in this namespace */
+	const char       *prefix;     /* only records with keys starting with this prefix */
+	char             *filter_mem; /* copy of request data the filter strings point to */
+	struct sid_buf   *buf;        /* message with change records being prepared */
+	bool              rec_open;   /* a record is open in buf */
+	unsigned          rec_count;  /* number of records in buf */
+	struct list       out_msgs;   /* messages waiting to be sent, the first one may be sent in part */
+	size_t            out_pos;    /* position in the first message up to which it is sent */
+	size_t            out_size;   /* size of all messages waiting to be sent */
+	bool              closing;    /* backlog overflowed, drop after the message being sent */
+};
+
+struct watcher_msg {
+	struct list     list;
+	struct sid_buf *buf;
 };
 
+#define WATCHER_BACKLOG_MAX (4 * 1024 * 1024) /* max size of messages waiting to be sent to one watcher */
+
 typedef enum {
 	CMD_SCAN_PHASE_A_INIT = 0,          /* core only */
 	CMD_SCAN_PHASE_A_SCAN_PRE,          /* core + modules */
@@ -157,6 +208,8 @@ typedef enum {
 	CMD_SCAN_PHASE_ERROR,
 } cmd_scan_phase_t;
 
+#define CMD_SCAN_PHASE_COUNT (CMD_SCAN_PHASE_ERROR + 1)
+
 struct scan_mod_fns {
 	sid_ucmd_fn_t *scan_a_init;
 	sid_ucmd_fn_t *scan_pre;
@@ -173,8 +226,25 @@ struct scan_mod_fns {
 	sid_ucmd_fn_t *scan_action_next;
 	sid_ucmd_fn_t *scan_b_exit;
 	sid_ucmd_fn_t *scan_error;
+	const bool    *scan_cacheable;
 } __packed;
 
+/*
+ * Modules implementing a scan phase, in the order of module priority. The
+ * tables are built once after loading the modules so executing a phase
+ * does not need to go through all the modules and their symbols.
+ */
+struct mod_disp_entry {
+	sid_res_t     *mod_res;
+	sid_ucmd_fn_t *fn;
+	const bool    *scan_cacheable;
+};
+
+struct mod_disp_tbl {
+	struct mod_disp_entry *entries;
+	unsigned               count;
+};
+
 struct udevice {
 	udev_action_t  action;
 	udev_devtype_t type;
@@ -253,6 +323,18 @@ static const char * const dev_reserved_str[] = {
 	[SID_DEV_RES_FREE]        = "RES_FREE",
 };
 
+struct kv_dump_filter {
+	sid_kv_ns_t ns;                            /* only records in this namespace */
+	const char *mod;                           /* only records owned by this module (full module name) */
+	const char *dev;                           /* only records for this device (device ID or device alias) */
+	const char *prefix;                        /* only records with keys starting with this prefix */
+	sid_kv_fl_t flags;                         /* only records with all these flags set */
+	const char *devid;                         /* device ID resolved from 'dev' */
+	const char *devno;                         /* device number resolved from 'dev' (used in KV_NS_UDEV) */
+	char        devid_buf[UTIL_UUID_STR_SIZE]; /* storage for resolved device ID */
+	char        devno_buf[16];                 /* storage for resolved device number */
+};
+
 struct sid_ucmd_ctx {
 	/* request */
 	msg_category_t            req_cat; /* request category */
@@ -273,6 +355,19 @@ struct sid_ucmd_ctx {
 	/* common context */
 	struct sid_ucmd_common_ctx *common;
 
+	/* device's sysfs directory opened with O_PATH on first use, -1 if not opened yet */
+	int dev_sysfs_fd;
+
+	/* device dependency graph for stack queries, created on first use */
+	struct hash_table *dev_graph;
+
+	/*
+	 * Memory owned by the command, released when the command is destroyed. Used for scratch
+	 * memory (delta calculation, temporary key lists) released by marks as well as for
+	 * results of sid_ucmd_*_get_scoped functions which are kept until the command ends.
+	 */
+	struct mem_arena *arena;
+
 	/* cmd specific context */
 	union {
 		struct {
@@ -282,12 +377,24 @@ struct sid_ucmd_ctx {
 			cmd_scan_phase_t   phase; /* current scan phase */
 			sid_dev_ready_t    dev_ready;
 			sid_dev_reserved_t dev_reserved;
+			char               fpr[SCAN_CACHE_FPR_SIZE]; /* device fingerprint for scan cache, empty if not available */
+			bool               cache_hit; /* stage 1 results of cacheable modules replayed from scan cache */
 		} scan;
 
 		struct {
 			void  *main_res_mem;      /* mmap-ed memory with result from main process */
 			size_t main_res_mem_size; /* overall size of main_res_mem */
 		} resources;
+
+		struct {
+			char                 *filter_mem; /* copy of request data the filter strings point to */
+			struct kv_dump_filter filter;
+		} dbdump;
+
+		struct {
+			char  *filter_mem;  /* copy of request data with the filter, passed to main process */
+			size_t filter_size; /* size of filter_mem */
+		} watch;
 	};
 
 	/* cmd stage and state tracking */
@@ -317,11 +424,20 @@ struct cmd_reg {
 	const char **stage_names;
 };
 
+/*
+ * Owner of a KV record is stored as an ID of the owner name interned in
+ * process-wide owner table (see _get_owner_id and _get_owner_str).
+ */
+typedef uint16_t kv_owner_t;
+
+#define OWNER_ID_CORE 0
+
 typedef struct {
 	uint64_t    seqnum;
 	sid_kv_fl_t flags;
 	uint16_t    gennum;
-	char        data[]; /* contains both internal (owner + padding) and external data (user value) */
+	kv_owner_t  owner;
+	char        data[]; /* contains both internal (padding) and external data (user value) */
 } kv_scalar_t;
 
 enum {
@@ -353,19 +469,20 @@ typedef struct iovec kv_vector_t;
 #define VVALUE_SEQNUM(vvalue) (*((uint64_t *) ((kv_vector_t *) vvalue)[VVALUE_IDX_SEQNUM].iov_base))
 #define VVALUE_FLAGS(vvalue)  (*((sid_kv_fl_t *) ((kv_vector_t *) vvalue)[VVALUE_IDX_FLAGS].iov_base))
 #define VVALUE_GENNUM(vvalue) (*((uint16_t *) ((kv_vector_t *) vvalue)[VVALUE_IDX_GENNUM].iov_base))
-#define VVALUE_OWNER(vvalue)  ((char *) ((kv_vector_t *) vvalue)[VVALUE_IDX_OWNER].iov_base)
+#define VVALUE_OWNER(vvalue)  (*((kv_owner_t *) ((kv_vector_t *) vvalue)[VVALUE_IDX_OWNER].iov_base))
 
 struct kv_unset_nfo {
-	uint64_t    seqnum;
-	const char *owner;
+	uint64_t   seqnum;
+	kv_owner_t owner;
 };
 
 struct kv_update_arg {
-	sid_res_t      *res;
-	struct sid_buf *gen_buf;
-	bool            is_sync;
-	void           *custom;   /* in/out */
-	int             ret_code; /* out */
+	sid_res_t        *res;
+	struct sid_buf   *gen_buf;
+	struct mem_arena *arena; /* scratch memory for delta calculation */
+	bool              is_sync;
+	void             *custom;   /* in/out */
+	int               ret_code; /* out */
 };
 
 #define KV_UPDATE_ARG(...) ((struct kv_update_arg) {__VA_ARGS__})
@@ -390,12 +507,19 @@ typedef enum {
 	DELTA_WITH_REL  = 0x2, /* as DELTA_WITH_DIFF, but also update referenced relatives */
 } delta_fl_t;
 
+/*
+ * The plus, minus and final vectors are allocated from kv_update_arg's arena,
+ * NULL if not calculated.
+ */
 struct kv_delta {
-	kv_op_t         op;
-	delta_fl_t      flags;
-	struct sid_buf *plus;
-	struct sid_buf *minus;
-	struct sid_buf *final;
+	kv_op_t      op;
+	delta_fl_t   flags;
+	kv_vector_t *plus;
+	size_t       plus_size;
+	kv_vector_t *minus;
+	size_t       minus_size;
+	kv_vector_t *final;
+	size_t       final_size;
 };
 
 #define KV_DELTA(...) ((struct kv_delta) {__VA_ARGS__})
@@ -412,6 +536,17 @@ typedef enum {
 	_KEY_PART_COUNT,
 } key_part_t;
 
+/*
+ * Key with precomputed part offsets. The key string is scanned for
+ * SID_KVS_KEY_JOIN only once and then any part is accessed directly.
+ */
+struct kv_key {
+	const char *str;
+	key_part_t  last_part; /* last part present in the key */
+	uint32_t    off[_KEY_PART_COUNT];
+	uint32_t    len[_KEY_PART_COUNT];
+};
+
 struct kv_key_spec {
 	const char *extra_op;
 	kv_op_t     op;
@@ -428,6 +563,9 @@ struct kv_key_spec {
 static const char *op_to_key_prefix_map[] =
 	{[KV_OP_SET] = KV_PREFIX_OP_SET_C, [KV_OP_PLUS] = KV_PREFIX_OP_PLUS_C, [KV_OP_MINUS] = KV_PREFIX_OP_MINUS_C};
 
+static const vdelta_op_t op_to_vdelta_op_map[] =
+	{[KV_OP_SET] = VDELTA_OP_SET, [KV_OP_PLUS] = VDELTA_OP_PLUS, [KV_OP_MINUS] = VDELTA_OP_MINUS};
+
 static const char *ns_to_key_prefix_map[] = {[SID_KV_NS_UNDEFINED] = KV_PREFIX_NS_UNDEFINED_C,
                                              [SID_KV_NS_UDEV]      = KV_PREFIX_NS_UDEV_C,
                                              [SID_KV_NS_DEV]       = KV_PREFIX_NS_DEV_C,
@@ -444,23 +582,16 @@ struct kv_rel_spec {
 
 #define KV_REL_SPEC(...) ((struct kv_rel_spec) {__VA_ARGS__})
 
-struct cross_bitmap_calc_arg {
-	kv_vector_t *old_vvalue;
-	size_t       old_vsize;
-	struct bmp  *old_bmp;
-	kv_vector_t *new_vvalue;
-	size_t       new_vsize;
-	struct bmp  *new_bmp;
-};
-
 struct sid_dbstats {
-	uint64_t key_size;
-	uint64_t value_int_size;
-	uint64_t value_int_data_size;
-	uint64_t value_ext_size;
-	uint64_t value_ext_data_size;
-	uint64_t meta_size;
-	uint32_t nr_kv_pairs;
+	uint64_t              key_size;
+	uint64_t              value_int_size;
+	uint64_t              value_int_data_size;
+	uint64_t              value_ext_size;
+	uint64_t              value_ext_data_size;
+	uint64_t              meta_size;
+	uint32_t              nr_kv_pairs;
+	unsigned              nr_slabs;
+	struct mem_slab_stats slabs[SID_KVS_SLAB_STATS_COUNT];
 };
 
 typedef enum {
@@ -478,7 +609,8 @@ typedef enum {
 	SYSTEM_CMD_SYNC,
 	SYSTEM_CMD_UMONITOR,
 	SYSTEM_CMD_RESOURCES,
-	_SYSTEM_CMD_END = SYSTEM_CMD_RESOURCES,
+	SYSTEM_CMD_WATCH,
+	_SYSTEM_CMD_END = SYSTEM_CMD_WATCH,
 } system_cmd_t;
 
 struct sid_msg {
@@ -531,14 +663,27 @@ static bool _cmd_root_only[] = {
 	[SID_IFC_CMD_DBSTATS]    = true,
 	[SID_IFC_CMD_RESOURCES]  = true,
 	[SID_IFC_CMD_DEVICES]    = true,
+	[SID_IFC_CMD_WATCH]      = true,
 };
 
 static struct cmd_reg _cmd_scan_phase_regs[];
 static sid_kv_fl_t    value_flags_no_sync = (DEFAULT_VALUE_FLAGS_CORE) & ~SID_KV_FL_SC;
-static char          *core_owner          = OWNER_CORE;
+static kv_owner_t     core_owner          = OWNER_ID_CORE;
 static uint64_t       null_int            = 0;
 static struct iovec   null_iovec          = {.iov_base = NULL, .iov_len = 0};
 
+/*
+ * Owner names interned for KV records. The owner IDs are only valid within one
+ * process - KV records sent to other processes or saved in db file always carry
+ * the owner name instead (see _build_cmd_kv_buffers and _sync_main_kv_store).
+ */
+static struct owner_tbl {
+	struct hash_table *ht;    /* owner name --> interned name, owner ID stored as data size */
+	char             **names; /* owner ID --> interned name, OWNER_ID_CORE not stored */
+	unsigned           count;
+	unsigned           alloc;
+} owner_tbl = {.count = OWNER_ID_CORE + 1};
+
 static int _do_kv_delta_set(char *key, kv_vector_t *vvalue, size_t vsize, struct kv_update_arg *update_arg);
 
 udev_action_t sid_ucmd_ev_get_dev_action(struct sid_ucmd_ctx *ucmd_ctx)
@@ -566,6 +711,31 @@ const char *sid_ucmd_ev_get_dev_name(struct sid_ucmd_ctx *ucmd_ctx)
 	return ucmd_ctx->req_env.dev.udev.name;
 }
 
+int sid_ucmd_ev_get_dev_sysfs_fd(struct sid_ucmd_ctx *ucmd_ctx)
+{
+	const char *s;
+	int         r;
+
+	if (ucmd_ctx->dev_sysfs_fd >= 0)
+		return ucmd_ctx->dev_sysfs_fd;
+
+	if ((r = sid_buf_add_fmt(ucmd_ctx->common->gen_buf,
+	                         (const void **) &s,
+	                         NULL,
+	                         "%s%s",
+	                         SYSTEM_SYSFS_PATH,
+	                         ucmd_ctx->req_env.dev.udev.path)) < 0)
+		return r;
+
+	r = sid_util_sysfs_open(s);
+	sid_buf_rewind_mem(ucmd_ctx->common->gen_buf, s);
+
+	if (r < 0)
+		return r;
+
+	return ucmd_ctx->dev_sysfs_fd = r;
+}
+
 udev_devtype_t sid_ucmd_ev_get_dev_type(struct sid_ucmd_ctx *ucmd_ctx)
 {
 	return ucmd_ctx->req_env.dev.udev.type;
@@ -607,46 +777,59 @@ static char *_cat_prefix_and_key(struct sid_buf *buf, const char *prefix, const
 	return full_key;
 }
 
+#define STR_TO_IOVEC(str) (str) ? ((struct iovec) {.iov_base = (void *) (str), .iov_len = strlen((str))}) : null_iovec
+
+static void _key_spec_to_parts(struct kv_key_spec *key_spec, struct iovec *parts)
+{
+	parts[KEY_PART_OP]      = STR_TO_IOVEC(op_to_key_prefix_map[key_spec->op]);
+	parts[KEY_PART_DOM]     = STR_TO_IOVEC(key_spec->dom);
+	parts[KEY_PART_NS]      = STR_TO_IOVEC(ns_to_key_prefix_map[key_spec->ns]);
+	parts[KEY_PART_NS_PART] = STR_TO_IOVEC(key_spec->ns_part);
+	parts[KEY_PART_ID_CAT]  = STR_TO_IOVEC(key_spec->id_cat);
+	parts[KEY_PART_ID]      = STR_TO_IOVEC(key_spec->id);
+	parts[KEY_PART_CORE]    = STR_TO_IOVEC(key_spec->core);
+}
+
 static char *_do_compose_key(struct sid_buf *buf, struct kv_key_spec *key_spec, int prefix_only)
 {
-	static const char fmt[] = "%s"                  /* space for extra op */
-				  "%s" SID_KVS_KEY_JOIN /* op */
-				  "%s" SID_KVS_KEY_JOIN /* dom */
-				  "%s" SID_KVS_KEY_JOIN /* ns */
-				  "%s" SID_KVS_KEY_JOIN /* ns_part */
-				  "%s" SID_KVS_KEY_JOIN /* id_cat */
-				  "%s" SID_KVS_KEY_JOIN /* id */
-				  "%s";
-	char *key;
+	struct iovec parts[_KEY_PART_COUNT];
+	const char  *extra_op;
+	size_t       extra_op_len, key_size;
+	key_part_t   part;
+	char        *key, *p;
 
 	/* <op>:<dom>:<ns>:<ns_part>:<id_cat>:<id>[:<core>] */
 
+	extra_op     = prefix_only ? KV_KEY_NULL : key_spec->extra_op ?: KV_PREFIX_OP_BLANK_C;
+	extra_op_len = strlen(extra_op);
+
+	_key_spec_to_parts(key_spec, parts);
+
+	if (prefix_only)
+		parts[KEY_PART_CORE] = null_iovec;
+
+	/* there's a separator after each part except the last one which is followed by '\0' instead */
+	key_size = extra_op_len + _KEY_PART_COUNT;
+
+	for (part = _KEY_PART_START; part < _KEY_PART_COUNT; part++)
+		key_size += parts[part].iov_len;
+
 	if (buf) {
-		if (sid_buf_add_fmt(buf,
-		                       (const void **) &key,
-		                       NULL,
-		                       fmt,
-		                       prefix_only ? KV_KEY_NULL : key_spec->extra_op ?: KV_PREFIX_OP_BLANK_C,
-		                       op_to_key_prefix_map[key_spec->op],
-		                       key_spec->dom ?: ID_NULL,
-		                       ns_to_key_prefix_map[key_spec->ns],
-		                       key_spec->ns_part ?: ID_NULL,
-		                       key_spec->id_cat ?: ID_NULL,
-		                       key_spec->id ?: ID_NULL,
-		                       prefix_only ? KV_KEY_NULL : key_spec->core ?: ID_NULL) < 0)
-			key = NULL;
-	} else {
-		if (asprintf((char **) &key,
-		             fmt,
-		             prefix_only ? KV_KEY_NULL : key_spec->extra_op ?: KV_PREFIX_OP_BLANK_C,
-		             op_to_key_prefix_map[key_spec->op],
-		             key_spec->dom ?: ID_NULL,
-		             ns_to_key_prefix_map[key_spec->ns],
-		             key_spec->ns_part ?: ID_NULL,
-		             key_spec->id_cat ?: ID_NULL,
-		             key_spec->id ?: ID_NULL,
-		             prefix_only ? KV_KEY_NULL : key_spec->core ?: ID_NULL) < 0)
-			key = NULL;
+		if (sid_buf_add(buf, NULL, key_size, (const void **) &key, NULL) < 0)
+			return NULL;
+	} else if (!(key = malloc(key_size)))
+		return NULL;
+
+	memcpy(key, extra_op, extra_op_len);
+	p = key + extra_op_len;
+
+	for (part = _KEY_PART_START; part < _KEY_PART_COUNT; part++) {
+		if (parts[part].iov_len) {
+			memcpy(p, parts[part].iov_base, parts[part].iov_len);
+			p += parts[part].iov_len;
+		}
+
+		*p++ = part < _KEY_PART_COUNT - 1 ? SID_KVS_KEY_JOIN[0] : '\0';
 	}
 
 	return key;
@@ -689,19 +872,6 @@ static key_part_t _decompose_key(const char *key, struct iovec *parts)
 	return part;
 }
 
-#define STR_TO_IOVEC(str) (str) ? ((struct iovec) {.iov_base = (void *) (str), .iov_len = strlen((str))}) : null_iovec
-
-static void _key_spec_to_parts(struct kv_key_spec *key_spec, struct iovec *parts)
-{
-	parts[KEY_PART_OP]      = STR_TO_IOVEC(op_to_key_prefix_map[key_spec->op]);
-	parts[KEY_PART_DOM]     = STR_TO_IOVEC(key_spec->dom);
-	parts[KEY_PART_NS]      = STR_TO_IOVEC(ns_to_key_prefix_map[key_spec->ns]);
-	parts[KEY_PART_NS_PART] = STR_TO_IOVEC(key_spec->ns_part);
-	parts[KEY_PART_ID_CAT]  = STR_TO_IOVEC(key_spec->id_cat);
-	parts[KEY_PART_ID]      = STR_TO_IOVEC(key_spec->id);
-	parts[KEY_PART_CORE]    = STR_TO_IOVEC(key_spec->core);
-}
-
 static void _destroy_key(struct sid_buf *buf, const char *key)
 {
 	if (!key)
@@ -737,19 +907,69 @@ static const char *_get_key_part(const char *key, key_part_t req_part, size_t *l
 	return start;
 }
 
-static kv_op_t _get_op_from_key(const char *key)
+static void _kv_key_parse(struct kv_key *kv_key, const char *key)
 {
-	const char *str;
-	size_t      len;
+	const char *start = key, *end;
+	key_part_t  part;
 
-	/* |<>|
-	 * <op>:<dom>:<ns>:<ns_part>:<id_cat>:<id>[:<core>]
-	 */
+	kv_key->str = key;
 
-	if (!(str = _get_key_part(key, KEY_PART_OP, &len)) || len > 1)
-		return KV_OP_SET;
+	for (part = _KEY_PART_START;; part++) {
+		kv_key->off[part] = start - key;
+
+		if ((part == (_KEY_PART_COUNT - 1)) || !(end = strchr(start, SID_KVS_KEY_JOIN[0]))) {
+			kv_key->len[part] = strlen(start);
+			break;
+		}
+
+		kv_key->len[part] = end - start;
+		start             = end + 1;
+	}
+
+	kv_key->last_part = part;
+
+	/* parts not present in the key are empty and located at its very end */
+	for (part++; part < _KEY_PART_COUNT; part++) {
+		kv_key->off[part] = kv_key->off[kv_key->last_part] + kv_key->len[kv_key->last_part];
+		kv_key->len[part] = 0;
+	}
+}
+
+/*
+ * Same as _get_key_part with len, that is, each part except
+ * KEY_PART_CORE must be followed by SID_KVS_KEY_JOIN to be found.
+ */
+static const char *_kv_key_get_part(const struct kv_key *kv_key, key_part_t part, size_t *len)
+{
+	if ((part > kv_key->last_part) || ((part == kv_key->last_part) && (part != KEY_PART_CORE)))
+		return NULL;
+
+	if (len)
+		*len = kv_key->len[part];
+
+	return kv_key->str + kv_key->off[part];
+}
+
+/*
+ * Compares keys up to and including given part. The result follows
+ * the order of keys in KV store, that is, it is the same as strcmp
+ * on both keys cut right after the part.
+ */
+static int _kv_key_cmp(const struct kv_key *kv_key1, const struct kv_key *kv_key2, key_part_t part)
+{
+	size_t len1 = kv_key1->off[part] + kv_key1->len[part];
+	size_t len2 = kv_key2->off[part] + kv_key2->len[part];
+	int    r;
+
+	if ((r = memcmp(kv_key1->str, kv_key2->str, len1 < len2 ? len1 : len2)))
+		return r;
+
+	return (len1 > len2) - (len1 < len2);
+}
 
-	if (!len)
+static kv_op_t _get_op_from_key_part(const char *str, size_t len)
+{
+	if (!str || len != 1)
 		return KV_OP_SET;
 
 	if (str[0] == KV_PREFIX_OP_PLUS_C[0])
@@ -760,16 +980,33 @@ static kv_op_t _get_op_from_key(const char *key)
 	return KV_OP_SET;
 }
 
-static sid_kv_ns_t _get_ns_from_key(const char *key)
+static kv_op_t _get_op_from_key(const char *key)
 {
 	const char *str;
 	size_t      len;
 
-	/*            |<>|
+	/* |<>|
 	 * <op>:<dom>:<ns>:<ns_part>:<id_cat>:<id>[:<core>]
 	 */
 
-	if (!(str = _get_key_part(key, KEY_PART_NS, &len)) || len > 1)
+	str = _get_key_part(key, KEY_PART_OP, &len);
+
+	return _get_op_from_key_part(str, len);
+}
+
+static kv_op_t _get_op_from_kv_key(const struct kv_key *kv_key)
+{
+	const char *str;
+	size_t      len;
+
+	str = _kv_key_get_part(kv_key, KEY_PART_OP, &len);
+
+	return _get_op_from_key_part(str, len);
+}
+
+static sid_kv_ns_t _get_ns_from_key_part(const char *str, size_t len)
+{
+	if (!str || len != 1)
 		return SID_KV_NS_UNDEFINED;
 
 	if (str[0] == KV_PREFIX_NS_UDEV_C[0])
@@ -786,6 +1023,30 @@ static sid_kv_ns_t _get_ns_from_key(const char *key)
 		return SID_KV_NS_UNDEFINED;
 }
 
+static sid_kv_ns_t _get_ns_from_key(const char *key)
+{
+	const char *str;
+	size_t      len;
+
+	/*            |<>|
+	 * <op>:<dom>:<ns>:<ns_part>:<id_cat>:<id>[:<core>]
+	 */
+
+	str = _get_key_part(key, KEY_PART_NS, &len);
+
+	return _get_ns_from_key_part(str, len);
+}
+
+static sid_kv_ns_t _get_ns_from_kv_key(const struct kv_key *kv_key)
+{
+	const char *str;
+	size_t      len;
+
+	str = _kv_key_get_part(kv_key, KEY_PART_NS, &len);
+
+	return _get_ns_from_key_part(str, len);
+}
+
 static const char *_copy_ns_part_from_key(const char *key, char *buf, size_t buf_size)
 {
 	const char *str;
@@ -821,21 +1082,18 @@ static void _vvalue_header_prep(kv_vector_t *vvalue,
                                 uint64_t    *seqnum,
                                 sid_kv_fl_t *flags,
                                 uint16_t    *gennum,
-                                char        *owner)
+                                kv_owner_t  *owner)
 {
-	size_t owner_size = strlen(owner) + 1;
-
 	if (*flags & SID_KV_FL_AL) {
 		assert(vvalue_size >= VVALUE_HEADER_ALIGNED_CNT);
-		vvalue[VVALUE_IDX_PADDING] =
-			(kv_vector_t) {padding, MEM_ALIGN_UP_PAD(SVALUE_HEADER_SIZE + owner_size, SVALUE_DATA_ALIGNMENT)};
+		vvalue[VVALUE_IDX_PADDING] = (kv_vector_t) {padding, MEM_ALIGN_UP_PAD(SVALUE_HEADER_SIZE, SVALUE_DATA_ALIGNMENT)};
 	} else
 		assert(vvalue_size >= VVALUE_HEADER_CNT);
 
 	vvalue[VVALUE_IDX_SEQNUM] = (kv_vector_t) {seqnum, sizeof(*seqnum)};
 	vvalue[VVALUE_IDX_FLAGS]  = (kv_vector_t) {flags, sizeof(*flags)};
 	vvalue[VVALUE_IDX_GENNUM] = (kv_vector_t) {gennum, sizeof(*gennum)};
-	vvalue[VVALUE_IDX_OWNER]  = (kv_vector_t) {owner, owner_size};
+	vvalue[VVALUE_IDX_OWNER]  = (kv_vector_t) {owner, sizeof(*owner)};
 }
 
 static void _vvalue_data_prep(kv_vector_t *vvalue, size_t vvalue_size, size_t idx, void *data, size_t data_size)
@@ -853,7 +1111,6 @@ static kv_vector_t *
 	_get_vvalue(sid_kvs_val_fl_t kv_store_value_flags, void *value, size_t value_size, kv_vector_t *vvalue, size_t vvalue_size)
 {
 	kv_scalar_t *svalue;
-	size_t       owner_size;
 	size_t       padding_size;
 
 	if (!value)
@@ -862,24 +1119,23 @@ static kv_vector_t *
 	if (kv_store_value_flags & SID_KVS_VAL_FL_VECTOR)
 		return value;
 
-	svalue     = value;
-	owner_size = strlen(svalue->data) + 1;
+	svalue = value;
 
 	if (svalue->flags & SID_KV_FL_AL) {
 		assert(vvalue_size >= VVALUE_SINGLE_ALIGNED_CNT);
-		padding_size                    = MEM_ALIGN_UP_PAD(SVALUE_HEADER_SIZE + owner_size, SVALUE_DATA_ALIGNMENT);
-		vvalue[VVALUE_IDX_PADDING]      = (kv_vector_t) {svalue->data + owner_size, padding_size};
-		vvalue[VVALUE_IDX_DATA_ALIGNED] = (kv_vector_t) {svalue->data + owner_size + padding_size,
-		                                                 value_size - SVALUE_HEADER_SIZE - owner_size - padding_size};
+		padding_size                    = MEM_ALIGN_UP_PAD(SVALUE_HEADER_SIZE, SVALUE_DATA_ALIGNMENT);
+		vvalue[VVALUE_IDX_PADDING]      = (kv_vector_t) {svalue->data, padding_size};
+		vvalue[VVALUE_IDX_DATA_ALIGNED] = (kv_vector_t) {svalue->data + padding_size,
+		                                                 value_size - SVALUE_HEADER_SIZE - padding_size};
 	} else {
 		assert(vvalue_size >= VVALUE_SINGLE_CNT);
-		vvalue[VVALUE_IDX_DATA] = (kv_vector_t) {svalue->data + owner_size, value_size - SVALUE_HEADER_SIZE - owner_size};
+		vvalue[VVALUE_IDX_DATA] = (kv_vector_t) {svalue->data, value_size - SVALUE_HEADER_SIZE};
 	}
 
 	vvalue[VVALUE_IDX_SEQNUM] = (kv_vector_t) {&svalue->seqnum, sizeof(svalue->seqnum)};
 	vvalue[VVALUE_IDX_FLAGS]  = (kv_vector_t) {&svalue->flags, sizeof(svalue->flags)};
 	vvalue[VVALUE_IDX_GENNUM] = (kv_vector_t) {&svalue->gennum, sizeof(svalue->gennum)};
-	vvalue[VVALUE_IDX_OWNER]  = (kv_vector_t) {svalue->data, owner_size};
+	vvalue[VVALUE_IDX_OWNER]  = (kv_vector_t) {&svalue->owner, sizeof(svalue->owner)};
 
 	return vvalue;
 }
@@ -943,65 +1199,142 @@ static int _write_kv_store_stats(struct sid_dbstats *stats, sid_res_t *kv_store_
 		                  stats->value_int_size,
 		                  int_size);
 	stats->meta_size = meta_size;
+	stats->nr_slabs  = sid_kvs_get_slab_stats(kv_store_res, stats->slabs, SID_KVS_SLAB_STATS_COUNT);
 	sid_kvs_iter_destroy(iter);
 	return 0;
 }
 
-static int _check_kv_index_needed(struct kv_update_arg *update_arg, kv_vector_t *vvalue_old, kv_vector_t *vvalue_new)
+/*
+ * Index of records to sync with main KV store. It is registered only in worker's KV store snapshot.
+ * Archived records are never synced.
+ */
+static bool _kv_index_match_sync(const char *key, void *data, size_t data_size, sid_kvs_val_fl_t flags, void *arg)
 {
-	int old_indexed, new_indexed;
+	kv_vector_t  tmp_vvalue[VVALUE_SINGLE_ALIGNED_CNT];
+	kv_vector_t *vvalue;
+
+	if (key[0] == KV_PREFIX_OP_ARCHIVE_C[0])
+		return false;
 
-	if (update_arg->is_sync)
-		return KV_INDEX_NOOP;
+	vvalue = _get_vvalue(flags, data, data_size, tmp_vvalue, VVALUE_CNT(tmp_vvalue));
 
-	old_indexed = vvalue_old ? VVALUE_FLAGS(vvalue_old) & SID_KV_FL_SC : 0;
-	new_indexed = vvalue_new ? VVALUE_FLAGS(vvalue_new) & SID_KV_FL_SC : 0;
+	return VVALUE_FLAGS(vvalue) & SID_KV_FL_SC;
+}
 
-	if (old_indexed && !new_indexed)
-		return KV_INDEX_REMOVE;
+/*
+ * Index of records to store persistently, including archived records.
+ */
+static bool _kv_index_match_persist(const char *key, void *data, size_t data_size, sid_kvs_val_fl_t flags, void *arg)
+{
+	kv_vector_t  tmp_vvalue[VVALUE_SINGLE_ALIGNED_CNT];
+	kv_vector_t *vvalue;
 
-	if (!old_indexed && new_indexed)
-		return KV_INDEX_ADD;
+	vvalue = _get_vvalue(flags, data, data_size, tmp_vvalue, VVALUE_CNT(tmp_vvalue));
 
-	return KV_INDEX_NOOP;
+	return VVALUE_FLAGS(vvalue) & SID_KV_FL_PS;
 }
 
-static int _manage_kv_index(struct kv_update_arg *update_arg, char *key)
+static const struct sid_kvs_index_spec kv_index_sync_spec    = {.prefix   = KV_PREFIX_OP_SYNC_C,
+                                                                .match_fn = _kv_index_match_sync,
+                                                                .flags    = SID_KVS_IDX_FL_NO_BUILD};
+
+static const struct sid_kvs_index_spec kv_index_persist_spec = {.prefix   = KV_PREFIX_OP_PERSIST_C,
+                                                                .match_fn = _kv_index_match_persist};
+
+static bool _is_kv_index_key(const char *key)
 {
-	int r;
+	return key[0] == KV_PREFIX_OP_SYNC_C[0] || key[0] == KV_PREFIX_OP_PERSIST_C[0];
+}
 
-	switch (update_arg->ret_code) {
-		case KV_INDEX_ADD:
-			key[0] = KV_PREFIX_OP_SYNC_C[0];
-			r      = sid_kvs_add_alias(update_arg->res, key + 1, key, false);
-			key[0] = ' ';
-			break;
-		case KV_INDEX_REMOVE:
-			key[0] = KV_PREFIX_OP_SYNC_C[0];
-			r      = sid_kvs_va_unset(update_arg->res, .key = key);
-			key[0] = ' ';
-			break;
-		default:
-			r = 0;
+static int _get_owner_id(const char *owner, kv_owner_t *owner_id)
+{
+	size_t owner_len = strlen(owner);
+	size_t id;
+	char  *name, **names;
+
+	if (!strcmp(owner, OWNER_CORE)) {
+		*owner_id = OWNER_ID_CORE;
+		return 0;
 	}
 
-	return r;
+	/* owner name size needs to fit kv_owner_t too, see _build_cmd_kv_buffers */
+	if (owner_len >= UINT16_MAX)
+		return -ENAMETOOLONG;
+
+	if (!owner_tbl.ht && !(owner_tbl.ht = hash_create(32)))
+		return -ENOMEM;
+
+	if (hash_lookup(owner_tbl.ht, owner, owner_len, &id)) {
+		*owner_id = id;
+		return 0;
+	}
+
+	if (owner_tbl.count > UINT16_MAX)
+		return -ENOSPC;
+
+	if (owner_tbl.count >= owner_tbl.alloc) {
+		if (!(names = realloc(owner_tbl.names, (owner_tbl.count + 16) * sizeof(*names))))
+			return -ENOMEM;
+
+		owner_tbl.names = names;
+		owner_tbl.alloc = owner_tbl.count + 16;
+	}
+
+	if (!(name = strdup(owner)))
+		return -ENOMEM;
+
+	if (hash_add(owner_tbl.ht, name, owner_len, name, owner_tbl.count) < 0) {
+		free(name);
+		return -ENOMEM;
+	}
+
+	owner_tbl.names[owner_tbl.count] = name;
+	*owner_id                        = owner_tbl.count++;
+	return 0;
 }
 
-static mod_match_t _mod_match(const char *mod1, const char *mod2)
+static const char *_get_owner_str(kv_owner_t owner_id)
 {
-	size_t i = 0;
+	if (owner_id == OWNER_ID_CORE)
+		return OWNER_CORE;
 
-	if (!strcmp(mod2, MOD_NAME_CORE))
-		return MOD_CORE_MATCH;
+	assert(owner_id < owner_tbl.count);
+	return owner_tbl.names[owner_id];
+}
 
-	while ((mod1[i] && mod2[i]) && (mod1[i] == mod2[i]))
-		i++;
+static void _destroy_owner_tbl(void)
+{
+	unsigned i;
+
+	for (i = OWNER_ID_CORE + 1; i < owner_tbl.count; i++)
+		free(owner_tbl.names[i]);
+
+	free(owner_tbl.names);
+
+	if (owner_tbl.ht)
+		hash_destroy(owner_tbl.ht);
 
-	if (!mod1[i] && !mod2[i])
+	owner_tbl = (struct owner_tbl) {.count = OWNER_ID_CORE + 1};
+}
+
+static mod_match_t _mod_match(kv_owner_t owner1, kv_owner_t owner2)
+{
+	const char *mod1, *mod2;
+	size_t      i = 0;
+
+	if (owner2 == OWNER_ID_CORE)
+		return MOD_CORE_MATCH;
+
+	if (owner1 == owner2)
 		/* match - same mod */
 		return MOD_MATCH;
 
+	mod1 = _get_owner_str(owner1);
+	mod2 = _get_owner_str(owner2);
+
+	while ((mod1[i] && mod2[i]) && (mod1[i] == mod2[i]))
+		i++;
+
 	if (i && mod2[i]) {
 		if (i == SID_MOD_NAME_DELIM_LEN || !strncmp(mod2 + i, SID_MOD_NAME_DELIM, SID_MOD_NAME_DELIM_LEN))
 			/* match - mod2 is submnod of mod1 */
@@ -1026,8 +1359,8 @@ static int _check_kv_wr_allowed(struct kv_update_arg *update_arg, const char *ke
 	static const char    reason_private[]  = "private";
 	struct kv_unset_nfo *unset_nfo;
 	sid_kv_fl_t          old_flags;
-	const char          *old_owner;
-	const char          *new_owner;
+	kv_owner_t           old_owner;
+	kv_owner_t           new_owner;
 	const char          *reason;
 	int                  r = 0;
 
@@ -1102,10 +1435,10 @@ static int _check_kv_wr_allowed(struct kv_update_arg *update_arg, const char *ke
 	if (r < 0)
 		sid_res_log_debug(update_arg->res,
 		                  "Module %s can't write value with key %s which is %s and already attached to module %s.",
-		                  new_owner,
+		                  _get_owner_str(new_owner),
 		                  key,
 		                  reason,
-		                  old_owner);
+		                  _get_owner_str(old_owner));
 
 	return r;
 }
@@ -1123,7 +1456,7 @@ static int _kv_cb_write(struct sid_kvs_update_spec *spec)
 	if ((update_arg->ret_code = _check_kv_wr_allowed(update_arg, spec->key, vvalue_old, vvalue_new)) < 0)
 		return 0;
 
-	update_arg->ret_code = _check_kv_index_needed(update_arg, vvalue_old, vvalue_new);
+	update_arg->ret_code = 0;
 	return 1;
 }
 
@@ -1134,7 +1467,7 @@ static int _kv_cb_reserve(struct sid_kvs_update_spec *spec)
 	kv_vector_t           tmp_vvalue_new[VVALUE_SINGLE_ALIGNED_CNT];
 	kv_vector_t          *vvalue_old, *vvalue_new;
 	struct kv_unset_nfo  *unset_nfo;
-	const char           *new_owner;
+	kv_owner_t            new_owner;
 
 	vvalue_new = _get_vvalue(spec->new_flags, spec->new_data, spec->new_data_size, tmp_vvalue_new, VVALUE_CNT(tmp_vvalue_new));
 
@@ -1161,15 +1494,15 @@ static int _kv_cb_reserve(struct sid_kvs_update_spec *spec)
 			case MOD_SUP_MATCH:
 				sid_res_log_debug(update_arg->res,
 				                  "Module %s can't reserve key %s which is already reserved by module %s.",
-				                  new_owner,
+				                  _get_owner_str(new_owner),
 				                  spec->key,
-				                  VVALUE_OWNER(vvalue_old));
+				                  _get_owner_str(VVALUE_OWNER(vvalue_old)));
 				update_arg->ret_code = -EPERM;
 				return 0;
 		}
 	}
 
-	update_arg->ret_code = _check_kv_index_needed(update_arg, vvalue_old, vvalue_new);
+	update_arg->ret_code = 0;
 	return 1;
 }
 
@@ -1180,12 +1513,10 @@ static const char *_owner_name(sid_res_t *res)
 
 static size_t _svalue_ext_data_offset(const kv_scalar_t *svalue)
 {
-	size_t owner_size = strlen(svalue->data) + 1;
-
 	if (svalue->flags & SID_KV_FL_AL)
-		return owner_size + MEM_ALIGN_UP_PAD(SVALUE_HEADER_SIZE + owner_size, SVALUE_DATA_ALIGNMENT);
+		return MEM_ALIGN_UP_PAD(SVALUE_HEADER_SIZE, SVALUE_DATA_ALIGNMENT);
 
-	return owner_size;
+	return 0;
 }
 
 static bool _is_string_data(char *ptr, size_t len)
@@ -1285,46 +1616,208 @@ static fmt_output_t flags_to_format(uint16_t flags)
 			return FMT_JSON;
 		case SID_IFC_CMD_FL_FMT_ENV:
 			return FMT_ENV;
+		case SID_IFC_CMD_FL_FMT_CBOR:
+			return FMT_CBOR;
 	}
 	return FMT_TABLE; /* default to TABLE on invalid format */
 }
 
-static int _build_cmd_kv_buffers(sid_res_t *cmd_res, uint32_t flags)
-{
-	static const char    failed_unset_buf_msg[] = "Failed to add record to unset buffer while building KV buffers.";
-	struct sid_ucmd_ctx *ucmd_ctx               = sid_res_get_data(cmd_res);
-	fmt_output_t         format;
-	struct sid_buf_spec  buf_spec;
-	kv_scalar_t         *svalue;
-	sid_kvs_iter_t      *iter;
-	const char          *key, *index_key;
-	void                *raw_value;
-	bool                 vector, is_sync;
-	size_t               size, vvalue_size, key_size, ext_data_offset;
-	sid_kvs_val_fl_t     kv_store_value_flags;
-	kv_vector_t         *vvalue;
-	unsigned             i, records = 0;
-	int                  r          = -1;
-	struct sid_buf      *export_buf = NULL, *unset_buf = NULL;
-	bool                 needs_comma = false;
-	kv_vector_t          tmp_vvalue[VVALUE_SINGLE_ALIGNED_CNT];
+struct kv_dump_scan {
+	const struct kv_dump_filter *filter;
+	unsigned                     next; /* next prefix combination to scan */
+	char                         prefix[UTIL_UUID_STR_SIZE + 16];
+};
 
-	if (!(flags & (CMD_KV_EXPORT_UDEV_TO_RESBUF | CMD_KV_EXPORT_UDEV_TO_EXPBUF | CMD_KV_EXPORT_SID_TO_RESBUF |
-	               CMD_KV_EXPORT_SID_TO_EXPBUF)))
+/*
+ * Key prefix combinations used to narrow down the iteration for filtered KV dumps.
+ * Transient delta records (KV_OP_PLUS and KV_OP_MINUS) are not part of filtered dumps.
+ */
+static const char *const _kv_dump_scan_ops[]     = {KV_PREFIX_OP_SET_C, KV_PREFIX_OP_ARCHIVE_C};
+static const char *const _kv_dump_scan_doms[]    = {ID_NULL, KV_KEY_DOM_ALIAS, KV_KEY_DOM_GROUP, KV_KEY_DOM_USER};
+static const sid_kv_ns_t _kv_dump_scan_dev_nss[] = {SID_KV_NS_UDEV, SID_KV_NS_DEV, SID_KV_NS_DEVMOD};
+
+#define KV_DUMP_SCAN_CNT(arr) (sizeof(arr) / sizeof(arr[0]))
+
+static const char *_kv_dump_scan_next_prefix(struct kv_dump_scan *scan)
+{
+	const struct kv_dump_filter *filter = scan->filter;
+	const sid_kv_ns_t           *nss;
+	size_t                       nss_cnt, doms_cnt = KV_DUMP_SCAN_CNT(_kv_dump_scan_doms);
+	const char                  *op, *dom, *ns_part;
+	sid_kv_ns_t                  ns;
+	unsigned                     i;
+
+	/* an explicit key prefix always wins and it is scanned only once */
+	if (filter->prefix)
+		return scan->next++ ? NULL : filter->prefix;
+
+	if (filter->ns != SID_KV_NS_UNDEFINED) {
+		nss     = &filter->ns;
+		nss_cnt = 1;
+	} else if (filter->devid) {
+		nss     = _kv_dump_scan_dev_nss;
+		nss_cnt = KV_DUMP_SCAN_CNT(_kv_dump_scan_dev_nss);
+	} else
+		/* no key-based filter - full scan needed */
+		return NULL;
+
+	while (scan->next < KV_DUMP_SCAN_CNT(_kv_dump_scan_ops) * doms_cnt * nss_cnt) {
+		i   = scan->next++;
+		ns  = nss[i % nss_cnt];
+		dom = _kv_dump_scan_doms[(i / nss_cnt) % doms_cnt];
+		op  = _kv_dump_scan_ops[i / (nss_cnt * doms_cnt)];
+
+		/* <op>:<dom>:<ns>:[<ns_part>:] */
+		if (filter->devid) {
+			if (!(ns_part = (ns == SID_KV_NS_UDEV) ? filter->devno : filter->devid))
+				continue;
+
+			snprintf(scan->prefix,
+			         sizeof(scan->prefix),
+			         "%s" SID_KVS_KEY_JOIN "%s" SID_KVS_KEY_JOIN "%s" SID_KVS_KEY_JOIN "%s" SID_KVS_KEY_JOIN,
+			         op,
+			         dom,
+			         ns_to_key_prefix_map[ns],
+			         ns_part);
+		} else
+			snprintf(scan->prefix,
+			         sizeof(scan->prefix),
+			         "%s" SID_KVS_KEY_JOIN "%s" SID_KVS_KEY_JOIN "%s" SID_KVS_KEY_JOIN,
+			         op,
+			         dom,
+			         ns_to_key_prefix_map[ns]);
+
+		return scan->prefix;
+	}
+
+	return NULL;
+}
+
+static bool _kv_dump_filter_match(const struct kv_dump_filter *filter,
+                                  const struct kv_key         *kv_key,
+                                  void                        *raw_value,
+                                  size_t                       size,
+                                  sid_kvs_val_fl_t             kv_store_value_flags)
+{
+	kv_vector_t  tmp_vvalue[VVALUE_SINGLE_ALIGNED_CNT];
+	kv_vector_t *vvalue;
+	sid_kv_ns_t  ns;
+	const char  *ns_part, *str;
+	size_t       len;
+
+	ns = _get_ns_from_kv_key(kv_key);
+
+	if ((filter->ns != SID_KV_NS_UNDEFINED) && (ns != filter->ns))
+		return false;
+
+	if (filter->devid) {
+		switch (ns) {
+			case SID_KV_NS_UDEV:
+				ns_part = filter->devno;
+				break;
+			case SID_KV_NS_DEV:
+			case SID_KV_NS_DEVMOD:
+				ns_part = filter->devid;
+				break;
+			default:
+				ns_part = NULL;
+		}
+
+		if (!ns_part || !(str = _kv_key_get_part(kv_key, KEY_PART_NS_PART, &len)) || (len != strlen(ns_part)) ||
+		    strncmp(str, ns_part, len))
+			return false;
+	}
+
+	if (filter->mod || filter->flags) {
+		vvalue = _get_vvalue(kv_store_value_flags, raw_value, size, tmp_vvalue, VVALUE_CNT(tmp_vvalue));
+
+		if (filter->mod && strcmp(_get_owner_str(VVALUE_OWNER(vvalue)), filter->mod))
+			return false;
+
+		if ((VVALUE_FLAGS(vvalue) & filter->flags) != filter->flags)
+			return false;
+	}
+
+	return true;
+}
+
+static void *_kv_dump_iter_next(sid_kvs_iter_t      *iter,
+                                struct kv_dump_scan *scan,
+                                size_t              *size,
+                                const char         **key,
+                                sid_kvs_val_fl_t    *flags)
+{
+	const char *prefix;
+	void       *raw_value;
+
+	for (;;) {
+		if (!(raw_value = sid_kvs_iter_next(iter, size, key, flags))) {
+			if (!scan || !(prefix = _kv_dump_scan_next_prefix(scan)))
+				return NULL;
+
+			sid_kvs_iter_reset_prefix(iter, prefix);
+			continue;
+		}
+
+		return raw_value;
+	}
+}
+
+static int _build_cmd_kv_buffers(sid_res_t *cmd_res, uint32_t flags)
+{
+	static const char    failed_unset_buf_msg[] = "Failed to add record to unset buffer while building KV buffers.";
+	struct sid_ucmd_ctx *ucmd_ctx               = sid_res_get_data(cmd_res);
+	fmt_output_t         format;
+	struct sid_buf_spec  buf_spec;
+	kv_scalar_t         *svalue, svalue_hdr;
+	sid_kvs_iter_t      *iter;
+	const char          *key, *key_core, *index_key, *index_prefix = NULL;
+	const char          *owner;
+	struct kv_key        kv_key;
+	void                *raw_value;
+	bool                 vector, is_sync;
+	size_t               size, vvalue_size, key_size, ext_data_offset, owner_size, data_size;
+	sid_kvs_val_fl_t     kv_store_value_flags;
+	kv_vector_t         *vvalue, item;
+	unsigned             i, records = 0;
+	int                  r          = -1;
+	struct sid_buf      *export_buf = NULL, *unset_buf = NULL;
+	bool                 needs_comma = false;
+	kv_vector_t          tmp_vvalue[VVALUE_SINGLE_ALIGNED_CNT];
+	struct kv_dump_scan  scan, *scan_p = NULL;
+	const char          *prefix;
+
+	if (!(flags & (CMD_KV_EXPORT_UDEV_TO_RESBUF | CMD_KV_EXPORT_UDEV_TO_EXPBUF | CMD_KV_EXPORT_SID_TO_RESBUF |
+	               CMD_KV_EXPORT_SID_TO_EXPBUF)))
 		/* nothing to export for this command */
 		return 0;
 
 	/*
-	 * Note that, right now, for commands with CMD_KV_EXPORT_PERSISTENT,
-	 * we iterate through all records and match the ones with KV_SYNC_P
-	 * flag set. This is because we don't expect this kind of dump to be
-	 * used frequently. If this matters in the future, we can create an index
-	 * just like we do for KV_SYNC records. Right now, it would not be worth
-	 * the extra memory usage caused by creating the index keys.
+	 * For commands with CMD_KV_EXPORT_SYNC and CMD_KV_EXPORT_PERSISTENT,
+	 * we iterate through the index the KV store maintains for records
+	 * with SID_KV_FL_SC and SID_KV_FL_PS flag set respectively.
+	 *
+	 * For filtered dumps requested by clients, we turn the filter into
+	 * a sequence of the narrowest key prefixes we can iterate through.
+	 * Only if this is not possible, we fall back to iterating through
+	 * all records. In both cases, each record is then matched against
+	 * the filter.
 	 */
+	if ((ucmd_ctx->req_cat == MSG_CATEGORY_CLIENT) && (ucmd_ctx->req_hdr.cmd == SID_IFC_CMD_DBDUMP) &&
+	    ucmd_ctx->dbdump.filter_mem) {
+		scan   = (struct kv_dump_scan) {.filter = &ucmd_ctx->dbdump.filter};
+		scan_p = &scan;
+	}
 
 	if ((is_sync = flags & CMD_KV_EXPORT_SYNC))
-		iter = sid_kvs_iter_create_prefix(ucmd_ctx->common->kvs_res, KV_PREFIX_OP_SYNC_C);
+		index_prefix = KV_PREFIX_OP_SYNC_C;
+	else if (flags & CMD_KV_EXPORT_PERSISTENT)
+		index_prefix = KV_PREFIX_OP_PERSIST_C;
+
+	if (index_prefix)
+		iter = sid_kvs_iter_create_prefix(ucmd_ctx->common->kvs_res, index_prefix);
+	else if (scan_p && (prefix = _kv_dump_scan_next_prefix(scan_p)))
+		iter = sid_kvs_iter_create_prefix(ucmd_ctx->common->kvs_res, prefix);
 	else
 		iter = sid_kvs_iter_create(ucmd_ctx->common->kvs_res, NULL, NULL);
 
@@ -1366,7 +1859,22 @@ static int _build_cmd_kv_buffers(sid_res_t *cmd_res, uint32_t flags)
 		fmt_arr_start(format, export_buf, 1, "siddb", false);
 	}
 
-	while ((raw_value = sid_kvs_iter_next(iter, &size, &key, &kv_store_value_flags))) {
+	while ((raw_value = _kv_dump_iter_next(iter, scan_p, &size, &key, &kv_store_value_flags))) {
+		if (index_prefix) {
+			/* remove leading index prefix */
+			index_key  = key;
+			key       += 1;
+		} else if (_is_kv_index_key(key))
+			/* index keys are aliases for records we get to anyway */
+			continue;
+		else
+			index_key = NULL;
+
+		_kv_key_parse(&kv_key, key);
+
+		if (scan_p && !_kv_dump_filter_match(scan_p->filter, &kv_key, raw_value, size, kv_store_value_flags))
+			continue;
+
 		vector = kv_store_value_flags & SID_KVS_VAL_FL_VECTOR;
 
 		if (vector) {
@@ -1397,17 +1905,10 @@ static int _build_cmd_kv_buffers(sid_res_t *cmd_res, uint32_t flags)
 			}
 		}
 
-		/* remove leading KV_PREFIX_OP_SYNC_C if present */
-		if (*key == KV_PREFIX_OP_SYNC_C[0]) {
-			index_key  = key;
-			key       += 1;
-		} else
-			index_key = NULL;
-
-		key_size = strlen(key) + 1;
+		key_size = kv_key.off[KEY_PART_CORE] + kv_key.len[KEY_PART_CORE] + 1;
 
 		// TODO: Also deal with situation if the udev namespace values are defined as vectors by chance.
-		if (_get_ns_from_key(key) == SID_KV_NS_UDEV) {
+		if (_get_ns_from_kv_key(&kv_key) == SID_KV_NS_UDEV) {
 			if (!(flags & (CMD_KV_EXPORT_UDEV_TO_RESBUF | CMD_KV_EXPORT_UDEV_TO_EXPBUF))) {
 				sid_res_log_debug(cmd_res, "Ignoring request to export record with key %s to udev.", key);
 				goto next;
@@ -1427,9 +1928,13 @@ static int _build_cmd_kv_buffers(sid_res_t *cmd_res, uint32_t flags)
 				/* only export if there's a value assigned and the value is not an empty string */
 				if ((size > (SVALUE_HEADER_SIZE + ext_data_offset + 1)) &&
 				    ((svalue->data + ext_data_offset)[0] != '\0')) {
-					key = _get_key_part(key, KEY_PART_CORE, NULL);
+					key_core = kv_key.str + kv_key.off[KEY_PART_CORE];
 
-					if (((r = sid_buf_add(ucmd_ctx->res_buf, (void *) key, strlen(key), NULL, NULL)) < 0) ||
+					if (((r = sid_buf_add(ucmd_ctx->res_buf,
+					                      (void *) key_core,
+					                      kv_key.len[KEY_PART_CORE],
+					                      NULL,
+					                      NULL)) < 0) ||
 					    ((r = sid_buf_add(ucmd_ctx->res_buf, KV_PAIR_C, 1, NULL, NULL)) < 0) ||
 					    ((r = sid_buf_add(ucmd_ctx->res_buf,
 					                      svalue->data + ext_data_offset,
@@ -1439,21 +1944,21 @@ static int _build_cmd_kv_buffers(sid_res_t *cmd_res, uint32_t flags)
 					    ((r = sid_buf_add(ucmd_ctx->res_buf, KV_END_C, 1, NULL, NULL)) < 0)) {
 						sid_res_log_error(cmd_res,
 						                  "Failed to add udev property %s=%s to response buffer.",
-						                  key,
+						                  key_core,
 						                  svalue->data + ext_data_offset);
 						goto fail;
 					}
 
 					sid_res_log_debug(ucmd_ctx->common->kvs_res,
 					                  "Exported udev property %s=%s",
-					                  key,
+					                  key_core,
 					                  svalue->data + ext_data_offset);
 				}
 			}
 
 			if (!(flags & CMD_KV_EXPORT_UDEV_TO_EXPBUF))
 				goto next;
-		} else { /* _get_ns_from_key(key) != KV_NS_UDEV */
+		} else { /* _get_ns_from_kv_key(&kv_key) != KV_NS_UDEV */
 			if (!(flags & (CMD_KV_EXPORT_SID_TO_RESBUF | CMD_KV_EXPORT_SID_TO_EXPBUF))) {
 				sid_res_log_debug(cmd_res,
 				                  "Ignoring request to export record with key %s to SID main KV store.",
@@ -1484,32 +1989,49 @@ static int _build_cmd_kv_buffers(sid_res_t *cmd_res, uint32_t flags)
 			 *  6b) vector item data
 			 *
 			 * Repeat 2) - 7) as long as there are keys to send.
+			 *
+			 * Owner IDs are valid only within this process, so the owner
+			 * is always exported by its name. For a vector, the owner
+			 * vector item contains the name. For a scalar, the owner
+			 * field in the header contains the size of the name which
+			 * directly follows the header and then the value itself
+			 * follows, without any alignment padding.
 			 */
+			if (!vector) {
+				owner           = _get_owner_str(svalue->owner);
+				owner_size      = strlen(owner) + 1;
+				ext_data_offset = _svalue_ext_data_offset(svalue);
+				data_size       = size - SVALUE_HEADER_SIZE - ext_data_offset;
+				size            = SVALUE_HEADER_SIZE + owner_size + data_size;
+				memcpy(&svalue_hdr, svalue, SVALUE_HEADER_SIZE);
+				svalue_hdr.owner = owner_size;
+			}
 
 			if (((r = sid_buf_add(export_buf, &kv_store_value_flags, sizeof(kv_store_value_flags), NULL, NULL)) < 0) ||
 			    ((r = sid_buf_add(export_buf, &key_size, sizeof(key_size), NULL, NULL)) < 0) ||
 			    ((r = sid_buf_add(export_buf, &size, sizeof(size), NULL, NULL)) < 0) ||
-			    ((r = sid_buf_add(export_buf, (char *) key, strlen(key) + 1, NULL, NULL)) < 0)) {
+			    ((r = sid_buf_add(export_buf, (char *) key, key_size, NULL, NULL)) < 0)) {
 				sid_res_log_error_errno(cmd_res, errno, "sid_buf_add failed");
 				goto fail;
 			}
 
 			if (vector) {
-				for (i = 0, size = 0; i < vvalue_size; i++) {
-					size += vvalue[i].iov_len;
-
-					if (((r = sid_buf_add(export_buf,
-					                      &vvalue[i].iov_len,
-					                      sizeof(vvalue->iov_len),
-					                      NULL,
-					                      NULL)) < 0) ||
-					    ((r = sid_buf_add(export_buf, vvalue[i].iov_base, vvalue[i].iov_len, NULL, NULL)) <
-					     0)) {
+				for (i = 0; i < vvalue_size; i++) {
+					if (i == VVALUE_IDX_OWNER) {
+						owner = _get_owner_str(VVALUE_OWNER(vvalue));
+						item  = (kv_vector_t) {(void *) owner, strlen(owner) + 1};
+					} else
+						item = vvalue[i];
+
+					if (((r = sid_buf_add(export_buf, &item.iov_len, sizeof(item.iov_len), NULL, NULL)) < 0) ||
+					    ((r = sid_buf_add(export_buf, item.iov_base, item.iov_len, NULL, NULL)) < 0)) {
 						sid_res_log_error_errno(cmd_res, errno, "sid_buf_add failed");
 						goto fail;
 					}
 				}
-			} else if ((r = sid_buf_add(export_buf, svalue, size, NULL, NULL)) < 0) {
+			} else if (((r = sid_buf_add(export_buf, &svalue_hdr, SVALUE_HEADER_SIZE, NULL, NULL)) < 0) ||
+			           ((r = sid_buf_add(export_buf, (void *) owner, owner_size, NULL, NULL)) < 0) ||
+			           ((r = sid_buf_add(export_buf, svalue->data + ext_data_offset, data_size, NULL, NULL)) < 0)) {
 				sid_res_log_error_errno(cmd_res, errno, "sid_buf_add failed");
 				goto fail;
 			}
@@ -1521,34 +2043,36 @@ static int _build_cmd_kv_buffers(sid_res_t *cmd_res, uint32_t flags)
 			fmt_fld_uint(format, export_buf, 3, "gennum", VVALUE_GENNUM(vvalue), true);
 			fmt_fld_uint64(format, export_buf, 3, "seqnum", VVALUE_SEQNUM(vvalue), true);
 			_print_flags(vvalue, "flags", format, export_buf, 3);
-			fmt_fld_str(format, export_buf, 3, "owner", VVALUE_OWNER(vvalue), true);
+			fmt_fld_str(format, export_buf, 3, "owner", _get_owner_str(VVALUE_OWNER(vvalue)), true);
 			_print_vvalue(vvalue, vector, size, vector ? "values" : "value", format, export_buf, 3);
 			fmt_elm_end(format, export_buf, 2);
 			needs_comma = true;
 		}
 		records++;
 next:
-		switch (_get_op_from_key(key)) {
+		switch (_get_op_from_kv_key(&kv_key)) {
 			case KV_OP_PLUS:
 			case KV_OP_MINUS:
-				/* schedule removal of any delta record */
+				/*
+				 * Schedule removal of any delta record. The KV store removes
+				 * its index keys together with the record itself.
+				 */
 				if (sid_buf_add(unset_buf, (void *) &key, sizeof(uintptr_t), NULL, NULL) < 0) {
 					sid_res_log_error(cmd_res, failed_unset_buf_msg);
 					goto fail;
 				}
 				break;
 			case KV_OP_SET:
-				/* keep */
+				/*
+				 * Keep the record, but schedule removal of the index key (the alias
+				 * with KV_PREFIX_OP_SYNC_C) as the record is in sync now.
+				 */
+				if (is_sync && sid_buf_add(unset_buf, (void *) &index_key, sizeof(uintptr_t), NULL, NULL) < 0) {
+					sid_res_log_error(cmd_res, failed_unset_buf_msg);
+					goto fail;
+				}
 				break;
 		}
-
-		if (index_key) {
-			/* schedule removal of the index key (the alias with KV_PREFIX_OP_SYNC) */
-			if (sid_buf_add(unset_buf, (void *) &index_key, sizeof(uintptr_t), NULL, NULL) < 0) {
-				sid_res_log_error(cmd_res, failed_unset_buf_msg);
-				goto fail;
-			}
-		}
 	}
 
 	if (format != FMT_NONE) {
@@ -1605,7 +2129,7 @@ out:
 }
 
 static int _check_global_kv_rs_for_wr(struct sid_ucmd_ctx         *ucmd_ctx,
-                                      const char                  *owner,
+                                      kv_owner_t                   owner,
                                       const char                  *dom,
                                       struct sid_ucmd_kv_set_args *set_args)
 {
@@ -1653,9 +2177,9 @@ static int _check_global_kv_rs_for_wr(struct sid_ucmd_ctx         *ucmd_ctx,
 	if (!r)
 		sid_res_log_debug(ucmd_ctx->common->kvs_res,
 		                  "Module %s can't overwrite value with key %s which is reserved and attached to %s module.",
-		                  owner,
+		                  _get_owner_str(owner),
 		                  key,
-		                  VVALUE_OWNER(vvalue));
+		                  _get_owner_str(VVALUE_OWNER(vvalue)));
 out:
 	_destroy_key(ucmd_ctx->common->gen_buf, key);
 	return r;
@@ -1701,302 +2225,76 @@ static const char *_get_foreign_ns_part(struct sid_ucmd_ctx *ucmd_ctx,
 	return ID_NULL;
 }
 
-static void _destroy_delta_buffers(struct kv_delta *delta)
+static void _reset_delta(struct kv_delta *delta)
 {
-	if (delta->plus) {
-		sid_buf_destroy(delta->plus);
-		delta->plus = NULL;
-	}
-
-	if (delta->minus) {
-		sid_buf_destroy(delta->minus);
-		delta->minus = NULL;
-	}
-
-	if (delta->final) {
-		sid_buf_destroy(delta->final);
-		delta->final = NULL;
-	}
+	delta->plus       = NULL;
+	delta->plus_size  = 0;
+	delta->minus      = NULL;
+	delta->minus_size = 0;
+	delta->final      = NULL;
+	delta->final_size = 0;
 }
 
-static void _destroy_unused_delta_buffers(struct kv_delta *delta)
+static struct vdelta_vec _vvalue_to_vdelta_vec(kv_vector_t *vvalue, size_t vsize)
 {
-	if (delta->plus) {
-		if (sid_buf_count(delta->plus) < VVALUE_SINGLE_CNT) {
-			sid_buf_destroy(delta->plus);
-			delta->plus = NULL;
-		}
-	}
+	if (!vvalue || vsize <= VVALUE_HEADER_CNT)
+		return (struct vdelta_vec) {0};
 
-	if (delta->minus) {
-		if (sid_buf_count(delta->minus) < VVALUE_SINGLE_CNT) {
-			sid_buf_destroy(delta->minus);
-			delta->minus = NULL;
-		}
-	}
+	return (struct vdelta_vec) {.v = vvalue + VVALUE_IDX_DATA, .cnt = vsize - VVALUE_HEADER_CNT};
 }
 
-static int _init_delta_buffer(kv_vector_t *vheader, struct sid_buf **delta_buf, size_t size)
+/*
+ * Takes space for a vector with given number of data items out of 'mem' and copies the header in.
+ * The vdelta functions then append data items right after the header.
+ */
+static struct vdelta_vec _delta_vvalue_init(kv_vector_t **mem, kv_vector_t *vheader, size_t data_cnt)
 {
-	struct sid_buf *buf = NULL;
-	size_t          i;
-	int             r = 0;
-
-	if (!size)
-		return 0;
-
-	if (size < VVALUE_HEADER_CNT) {
-		r = -EINVAL;
-		goto out;
-	}
-
-	if (!(buf = sid_buf_create(&SID_BUF_SPEC(.type = SID_BUF_TYPE_VECTOR), &SID_BUF_INIT(.size = size), &r)))
-		goto out;
-
-	for (i = 0; i < VVALUE_HEADER_CNT; i++) {
-		if ((r = sid_buf_add(buf, vheader[i].iov_base, vheader[i].iov_len, NULL, NULL)) < 0)
-			goto out;
-	}
-out:
-	if (r < 0) {
-		if (buf)
-			sid_buf_destroy(buf);
-	} else
-		*delta_buf = buf;
-	return r;
-}
+	struct vdelta_vec vec = {.v = *mem, .cnt = VVALUE_HEADER_CNT};
 
-static int _init_delta_buffers(struct kv_delta *delta, kv_vector_t *vheader, size_t minus_size, size_t plus_size, size_t final_size)
-{
-	if (_init_delta_buffer(vheader, &delta->plus, plus_size) < 0 ||
-	    _init_delta_buffer(vheader, &delta->minus, minus_size) < 0 ||
-	    _init_delta_buffer(vheader, &delta->final, final_size) < 0) {
-		_destroy_delta_buffers(delta);
-		return -1;
-	}
+	memcpy(vec.v, vheader, VVALUE_HEADER_CNT * sizeof(kv_vector_t));
+	*mem += VVALUE_HEADER_CNT + data_cnt;
 
-	return 0;
+	return vec;
 }
 
 static int _delta_step_calc(struct sid_kvs_update_spec *spec)
 {
 	struct kv_update_arg *update_arg = spec->arg;
 	struct kv_delta      *delta      = ((struct kv_rel_spec *) update_arg->custom)->delta;
-	kv_vector_t          *old_vvalue = spec->old_data;
-	size_t                old_vsize  = spec->old_data_size;
-	kv_vector_t          *new_vvalue = spec->new_data;
-	size_t                new_vsize  = spec->new_data_size;
-	size_t                i_old, i_new;
-	int                   cmp_result;
-	int                   r = -1;
-
-	if (_init_delta_buffers(delta, new_vvalue, old_vsize, new_vsize, old_vsize + new_vsize) < 0)
-		goto out;
+	struct vdelta_vec     old        = _vvalue_to_vdelta_vec(spec->old_data, spec->old_data_size);
+	struct vdelta_vec     new        = _vvalue_to_vdelta_vec(spec->new_data, spec->new_data_size);
+	struct vdelta_vec     plus, minus, final;
+	kv_vector_t          *mem;
 
-	if (!old_vsize)
-		old_vsize = VVALUE_HEADER_CNT;
-
-	if (!new_vsize)
-		new_vsize = VVALUE_HEADER_CNT;
-
-	/* start right beyond the header */
-	i_old = i_new = VVALUE_HEADER_CNT;
-
-	/* look for differences between old_vvalue and new_vvalue vector */
-	while (1) {
-		if ((i_old < old_vsize) && (i_new < new_vsize)) {
-			/* both vectors still still have items to handle */
-			cmp_result = strcmp(old_vvalue[i_old].iov_base, new_vvalue[i_new].iov_base);
-			if (cmp_result < 0) {
-				/* the old vector has item the new one doesn't have */
-				switch (delta->op) {
-					case KV_OP_SET:
-						/* we have detected removed item: add it to delta->minus */
-						if ((r = sid_buf_add(delta->minus,
-						                     old_vvalue[i_old].iov_base,
-						                     old_vvalue[i_old].iov_len,
-						                     NULL,
-						                     NULL)) < 0)
-							goto out;
-						break;
-					case KV_OP_PLUS:
-					/* we're keeping old item: add it to delta->final */
-					/* no break here intentionally! */
-					case KV_OP_MINUS:
-						/* we're keeping old item: add it to delta->final */
-						if ((r = sid_buf_add(delta->final,
-						                     old_vvalue[i_old].iov_base,
-						                     old_vvalue[i_old].iov_len,
-						                     NULL,
-						                     NULL)) < 0)
-							goto out;
-						break;
-				}
-				i_old++;
-			} else if (cmp_result > 0) {
-				/* the new vector has item the old one doesn't have */
-				switch (delta->op) {
-					case KV_OP_SET:
-					/* we have detected new item: add it to delta->plus and delta->final */
-					/* no break here intentionally! */
-					case KV_OP_PLUS:
-						/* we're adding new item: add it to delta->plus and delta->final */
-						if (((r = sid_buf_add(delta->plus,
-						                      new_vvalue[i_new].iov_base,
-						                      new_vvalue[i_new].iov_len,
-						                      NULL,
-						                      NULL)) < 0) ||
-						    ((r = sid_buf_add(delta->final,
-						                      new_vvalue[i_new].iov_base,
-						                      new_vvalue[i_new].iov_len,
-						                      NULL,
-						                      NULL)) < 0))
-							goto out;
-						break;
-					case KV_OP_MINUS:
-						/* we're trying to remove non-existing item: ignore it */
-						break;
-				}
-				i_new++;
-			} else {
-				/* both old and new has the item */
-				switch (delta->op) {
-					case KV_OP_SET:
-					/* we have detected no change for this item: add it to delta->final */
-					/* no break here intentionally! */
-					case KV_OP_PLUS:
-						/* we're trying to add already existing item: add it to delta->final but not
-						 * delta->plus */
-						if ((r = sid_buf_add(delta->final,
-						                     new_vvalue[i_new].iov_base,
-						                     new_vvalue[i_new].iov_len,
-						                     NULL,
-						                     NULL)) < 0)
-							goto out;
-						break;
-					case KV_OP_MINUS:
-						/* we're removing item: add it to delta->minus */
-						if ((r = sid_buf_add(delta->minus,
-						                     new_vvalue[i_new].iov_base,
-						                     new_vvalue[i_new].iov_len,
-						                     NULL,
-						                     NULL)) < 0)
-							goto out;
-						break;
-				}
-				i_old++;
-				i_new++;
-			}
-			continue;
-		} else if (i_old == old_vsize) {
-			/* only new vector still has items to handle */
-			while (i_new < new_vsize) {
-				switch (delta->op) {
-					case KV_OP_SET:
-					/* we have detected new item: add it to delta->final */
-					/* no break here intentionally! */
-					case KV_OP_PLUS:
-						/* we're adding new item: add it to delta->plus and delta->final */
-						if (((r = sid_buf_add(delta->plus,
-						                      new_vvalue[i_new].iov_base,
-						                      new_vvalue[i_new].iov_len,
-						                      NULL,
-						                      NULL)) < 0) ||
-						    ((r = sid_buf_add(delta->final,
-						                      new_vvalue[i_new].iov_base,
-						                      new_vvalue[i_new].iov_len,
-						                      NULL,
-						                      NULL)) < 0))
-							goto out;
-						break;
-					case KV_OP_MINUS:
-						/* we're removing non-existing item: don't add to delta->minus */
-						break;
-				}
-				i_new++;
-			}
-		} else if (i_new == new_vsize) {
-			/* only old vector still has items to handle */
-			while (i_old < old_vsize) {
-				switch (delta->op) {
-					case KV_OP_SET:
-						/* we have detected removed item: add it to delta->minus */
-						if ((r = sid_buf_add(delta->minus,
-						                     old_vvalue[i_old].iov_base,
-						                     old_vvalue[i_old].iov_len,
-						                     NULL,
-						                     NULL)) < 0)
-							goto out;
-						break;
-					case KV_OP_PLUS:
-					/* we're keeping old item: add it to delta->final */
-					/* no break here intentionally! */
-					case KV_OP_MINUS:
-						/* we're not changing the old item so add it to delta->final */
-						if ((r = sid_buf_add(delta->final,
-						                     old_vvalue[i_old].iov_base,
-						                     old_vvalue[i_old].iov_len,
-						                     NULL,
-						                     NULL)) < 0)
-							goto out;
-						break;
-				}
-				i_old++;
-			}
-		}
-		/* no more items to process in both old and new vector: exit */
-		break;
-	}
+	if (!spec->old_data_size && !spec->new_data_size)
+		return 0;
 
-	r = 0;
-out:
-	if (r < 0)
-		_destroy_delta_buffers(delta);
-	else
-		_destroy_unused_delta_buffers(delta);
+	/* one chunk for all three vectors, see vdelta_step for the capacities needed */
+	if (!(mem = mem_arena_alloc(update_arg->arena,
+	                            (3 * VVALUE_HEADER_CNT + 2 * (old.cnt + new.cnt)) * sizeof(kv_vector_t))))
+		return -ENOMEM;
 
-	return r;
-}
+	plus  = _delta_vvalue_init(&mem, spec->new_data, new.cnt);
+	minus = _delta_vvalue_init(&mem, spec->new_data, old.cnt);
+	final = _delta_vvalue_init(&mem, spec->new_data, old.cnt + new.cnt);
 
-static void _delta_cross_bitmap_calc(struct cross_bitmap_calc_arg *cross)
-{
-	size_t old_vsize, new_vsize;
-	size_t i_old, i_new;
-	int    cmp_result;
+	vdelta_step(op_to_vdelta_op_map[delta->op], &old, &new, &plus, &minus, &final);
 
-	if ((old_vsize = cross->old_vsize) < VVALUE_HEADER_CNT)
-		old_vsize = VVALUE_HEADER_CNT;
+	/* plus and minus are only interesting if there are any items, final is always stored */
+	if (plus.cnt > VVALUE_HEADER_CNT) {
+		delta->plus      = plus.v;
+		delta->plus_size = plus.cnt;
+	}
 
-	if ((new_vsize = cross->new_vsize) < VVALUE_HEADER_CNT)
-		new_vsize = VVALUE_HEADER_CNT;
+	if (minus.cnt > VVALUE_HEADER_CNT) {
+		delta->minus      = minus.v;
+		delta->minus_size = minus.cnt;
+	}
 
-	i_old = i_new = VVALUE_HEADER_CNT;
+	delta->final      = final.v;
+	delta->final_size = final.cnt;
 
-	while (1) {
-		if ((i_old < old_vsize) && (i_new < new_vsize)) {
-			/* both vectors still have items to handle */
-			cmp_result = strcmp(cross->old_vvalue[i_old].iov_base, cross->new_vvalue[i_new].iov_base);
-			if (cmp_result < 0) {
-				/* the old vector has item the new one doesn't have: OK */
-				i_old++;
-			} else if (cmp_result > 0) {
-				/* the new vector has item the old one doesn't have: OK */
-				i_new++;
-			} else {
-				/* both old and new has the item: we have found contradiction! */
-				bmp_unset_bit(cross->old_bmp, i_old);
-				bmp_unset_bit(cross->new_bmp, i_new);
-				i_old++;
-				i_new++;
-			}
-		} else if (i_old == old_vsize) {
-			/* only new vector still has items to handle: nothing else to compare */
-			break;
-		} else if (i_new == new_vsize) {
-			/* only old vector still has items to handle: nothing else to compare */
-			break;
-		}
-	}
+	return 0;
 }
 
 static int _vvalue_str_cmp(const void *a, const void *b)
@@ -2009,165 +2307,74 @@ static int _vvalue_str_cmp(const void *a, const void *b)
 
 static int _delta_abs_calc(kv_vector_t *vheader, struct kv_update_arg *update_arg)
 {
-	struct cross_bitmap_calc_arg cross1   = {0};
-	struct cross_bitmap_calc_arg cross2   = {0};
-	struct kv_rel_spec          *rel_spec = update_arg->custom;
-	kv_op_t                      orig_op  = rel_spec->cur_key_spec->op;
-	const char                  *delta_key;
-	kv_vector_t                 *abs_plus_v, *abs_minus_v;
-	size_t                       i, abs_plus_vsize, abs_minus_vsize;
-	int                          r = -1;
+	struct kv_rel_spec *rel_spec  = update_arg->custom;
+	struct kv_delta    *delta     = rel_spec->delta;
+	struct kv_delta    *abs_delta = rel_spec->abs_delta;
+	kv_op_t             orig_op   = rel_spec->cur_key_spec->op;
+	const char         *delta_key;
+	kv_vector_t        *old_plus_vvalue, *old_minus_vvalue, *mem;
+	size_t              old_plus_vsize, old_minus_vsize;
+	struct vdelta_vec   old_plus, old_minus, new_plus, new_minus, abs_plus, abs_minus;
+	int                 r = -1;
 
-	if (!rel_spec->delta->plus && !rel_spec->delta->minus)
+	if (!delta->plus && !delta->minus)
 		return 0;
 
 	rel_spec->cur_key_spec->op = KV_OP_PLUS;
 	if (!(delta_key = _compose_key(update_arg->gen_buf, rel_spec->cur_key_spec)))
 		goto out;
-	cross1.old_vvalue = sid_kvs_va_get(update_arg->res, .key = delta_key, .size = &cross1.old_vsize);
+	old_plus_vvalue = sid_kvs_va_get(update_arg->res, .key = delta_key, .size = &old_plus_vsize);
 	_destroy_key(update_arg->gen_buf, delta_key);
-	if (cross1.old_vvalue && !(cross1.old_bmp = bmp_create(cross1.old_vsize, true, NULL)))
-		goto out;
 
 	rel_spec->cur_key_spec->op = KV_OP_MINUS;
 	if (!(delta_key = _compose_key(update_arg->gen_buf, rel_spec->cur_key_spec)))
 		goto out;
-	cross2.old_vvalue = sid_kvs_va_get(update_arg->res, .key = delta_key, .size = &cross2.old_vsize);
+	old_minus_vvalue = sid_kvs_va_get(update_arg->res, .key = delta_key, .size = &old_minus_vsize);
 	_destroy_key(update_arg->gen_buf, delta_key);
-	if (cross2.old_vvalue && !(cross2.old_bmp = bmp_create(cross2.old_vsize, true, NULL)))
-		goto out;
-
-	/*
-	 * set up cross1 - old plus vs. new minus
-	 *
-	 * OLD              NEW
-	 *
-	 * plus  <----|     plus
-	 * minus      |---> minus
-	 */
-	if (rel_spec->delta->minus) {
-		sid_buf_get_data(rel_spec->delta->minus, (const void **) &cross1.new_vvalue, &cross1.new_vsize);
-
-		if (!(cross1.new_bmp = bmp_create(cross1.new_vsize, true, NULL)))
-			goto out;
-
-		/* cross-compare old_plus with new_minus and unset bitmap positions where we find contradiction */
-		_delta_cross_bitmap_calc(&cross1);
-	}
 
-	/*
-	 * setup cross2 - old minus vs. new plus
-	 *
-	 * OLD             NEW
-	 *
-	 * plus      |---> plus
-	 * minus <---|     minus
-	 */
-	if (rel_spec->delta->plus) {
-		sid_buf_get_data(rel_spec->delta->plus, (const void **) &cross2.new_vvalue, &cross2.new_vsize);
+	old_plus  = _vvalue_to_vdelta_vec(old_plus_vvalue, old_plus_vsize);
+	old_minus = _vvalue_to_vdelta_vec(old_minus_vvalue, old_minus_vsize);
+	new_plus  = _vvalue_to_vdelta_vec(delta->plus, delta->plus_size);
+	new_minus = _vvalue_to_vdelta_vec(delta->minus, delta->minus_size);
 
-		if (!(cross2.new_bmp = bmp_create(cross2.new_vsize, true, NULL)))
-			goto out;
+	if (!(mem = mem_arena_alloc(update_arg->arena,
+	                            (2 * VVALUE_HEADER_CNT + old_plus.cnt + new_plus.cnt + old_minus.cnt + new_minus.cnt) *
+	                                    sizeof(kv_vector_t))))
+		goto out;
 
-		/* cross-compare old_minus with new_plus and unset bitmap positions where we find contradiction */
-		_delta_cross_bitmap_calc(&cross2);
-	}
+	abs_plus  = _delta_vvalue_init(&mem, vheader, old_plus.cnt + new_plus.cnt);
+	abs_minus = _delta_vvalue_init(&mem, vheader, old_minus.cnt + new_minus.cnt);
 
 	/*
-	 * count overall size for both plus and minus taking only non-contradicting items
+	 * Merge old and new plus and minus vectors, taking only non-contradicting items:
 	 *
 	 * OLD             NEW
 	 *
 	 * plus  <---+---> plus
 	 * minus <---+---> minus
 	 */
-	abs_minus_vsize = ((cross2.old_bmp ? bmp_get_bit_set_count(cross2.old_bmp) : 0) +
-	                   (cross1.new_bmp ? bmp_get_bit_set_count(cross1.new_bmp) : 0));
-	if (cross2.old_bmp && cross1.new_bmp)
-		abs_minus_vsize -= VVALUE_HEADER_CNT;
-
-	abs_plus_vsize = ((cross1.old_bmp ? bmp_get_bit_set_count(cross1.old_bmp) : 0) +
-	                  (cross2.new_bmp ? bmp_get_bit_set_count(cross2.new_bmp) : 0));
-	if (cross1.old_bmp && cross2.new_bmp)
-		abs_plus_vsize -= VVALUE_HEADER_CNT;
-
-	/* go through the old and new plus and minus vectors and merge non-contradicting items */
-	if (_init_delta_buffers(rel_spec->abs_delta, vheader, abs_minus_vsize, abs_plus_vsize, 0) < 0)
-		goto out;
-
-	if (rel_spec->delta->flags & DELTA_WITH_REL)
-		rel_spec->abs_delta->flags |= DELTA_WITH_REL;
-
-	if (cross1.old_vvalue) {
-		for (i = VVALUE_IDX_DATA; i < cross1.old_vsize; i++) {
-			if (bmp_bit_is_set(cross1.old_bmp, i, NULL) && ((r = sid_buf_add(rel_spec->abs_delta->plus,
-			                                                                 cross1.old_vvalue[i].iov_base,
-			                                                                 cross1.old_vvalue[i].iov_len,
-			                                                                 NULL,
-			                                                                 NULL)) < 0))
-				goto out;
-		}
-	}
-
-	if (cross1.new_vvalue) {
-		for (i = VVALUE_IDX_DATA; i < cross1.new_vsize; i++) {
-			if (bmp_bit_is_set(cross1.new_bmp, i, NULL) && ((r = sid_buf_add(rel_spec->abs_delta->minus,
-			                                                                 cross1.new_vvalue[i].iov_base,
-			                                                                 cross1.new_vvalue[i].iov_len,
-			                                                                 NULL,
-			                                                                 NULL)) < 0))
-				goto out;
-		}
-	}
-
-	if (cross2.old_vvalue) {
-		for (i = VVALUE_IDX_DATA; i < cross2.old_vsize; i++) {
-			if (bmp_bit_is_set(cross2.old_bmp, i, NULL) && ((r = sid_buf_add(rel_spec->abs_delta->minus,
-			                                                                 cross2.old_vvalue[i].iov_base,
-			                                                                 cross2.old_vvalue[i].iov_len,
-			                                                                 NULL,
-			                                                                 NULL)) < 0))
-				goto out;
-		}
-	}
+	vdelta_abs(&old_plus, &old_minus, &new_plus, &new_minus, &abs_plus, &abs_minus);
 
-	if (cross2.new_vvalue) {
-		for (i = VVALUE_IDX_DATA; i < cross2.new_vsize; i++) {
-			if (bmp_bit_is_set(cross2.new_bmp, i, NULL) && ((r = sid_buf_add(rel_spec->abs_delta->plus,
-			                                                                 cross2.new_vvalue[i].iov_base,
-			                                                                 cross2.new_vvalue[i].iov_len,
-			                                                                 NULL,
-			                                                                 NULL)) < 0))
-				goto out;
-		}
+	/*
+	 * Keep the abs vector even if all the items cancelled each other out
+	 * so that _delta_update removes the stored record.
+	 */
+	if (old_plus_vvalue || delta->plus) {
+		abs_delta->plus      = abs_plus.v;
+		abs_delta->plus_size = abs_plus.cnt;
 	}
 
-	if (rel_spec->abs_delta->plus) {
-		sid_buf_get_data(rel_spec->abs_delta->plus, (const void **) &abs_plus_v, &abs_plus_vsize);
-		qsort(abs_plus_v + VVALUE_IDX_DATA, abs_plus_vsize - VVALUE_IDX_DATA, sizeof(kv_vector_t), _vvalue_str_cmp);
+	if (old_minus_vvalue || delta->minus) {
+		abs_delta->minus      = abs_minus.v;
+		abs_delta->minus_size = abs_minus.cnt;
 	}
 
-	if (rel_spec->abs_delta->minus) {
-		sid_buf_get_data(rel_spec->abs_delta->minus, (const void **) &abs_minus_v, &abs_minus_vsize);
-		qsort(abs_minus_v + VVALUE_IDX_DATA, abs_minus_vsize - VVALUE_IDX_DATA, sizeof(kv_vector_t), _vvalue_str_cmp);
-	}
+	if (delta->flags & DELTA_WITH_REL)
+		abs_delta->flags |= DELTA_WITH_REL;
 
 	r = 0;
 out:
-	if (cross1.old_bmp)
-		bmp_destroy(cross1.old_bmp);
-	if (cross1.new_bmp)
-		bmp_destroy(cross1.new_bmp);
-	if (cross2.old_bmp)
-		bmp_destroy(cross2.old_bmp);
-	if (cross2.new_bmp)
-		bmp_destroy(cross2.new_bmp);
-
 	rel_spec->cur_key_spec->op = orig_op;
-
-	if (r < 0)
-		_destroy_delta_buffers(rel_spec->abs_delta);
-
 	return r;
 }
 
@@ -2197,28 +2404,22 @@ static int _delta_update(kv_vector_t *vheader, kv_op_t op, struct kv_update_arg
 		if (!update_arg->is_sync) {
 			if (!rel_spec->abs_delta->plus)
 				return 0;
-			sid_buf_get_data(rel_spec->abs_delta->plus, (const void **) &abs_delta_vvalue, &abs_delta_vsize);
+			abs_delta_vvalue = rel_spec->abs_delta->plus;
+			abs_delta_vsize  = rel_spec->abs_delta->plus_size;
 		}
 
-		if (rel_spec->delta->plus)
-			sid_buf_get_data(rel_spec->delta->plus, (const void **) &delta_vvalue, &delta_vsize);
-		else {
-			delta_vvalue = NULL;
-			delta_vsize  = 0;
-		}
+		delta_vvalue = rel_spec->delta->plus;
+		delta_vsize  = rel_spec->delta->plus_size;
 	} else if (op == KV_OP_MINUS) {
 		if (!update_arg->is_sync) {
 			if (!rel_spec->abs_delta->minus)
 				return 0;
-			sid_buf_get_data(rel_spec->abs_delta->minus, (const void **) &abs_delta_vvalue, &abs_delta_vsize);
+			abs_delta_vvalue = rel_spec->abs_delta->minus;
+			abs_delta_vsize  = rel_spec->abs_delta->minus_size;
 		}
 
-		if (rel_spec->delta->minus)
-			sid_buf_get_data(rel_spec->delta->minus, (const void **) &delta_vvalue, &delta_vsize);
-		else {
-			delta_vvalue = NULL;
-			delta_vsize  = 0;
-		}
+		delta_vvalue = rel_spec->delta->minus;
+		delta_vsize  = rel_spec->delta->minus_size;
 	} else {
 		sid_res_log_error(update_arg->res, SID_INTERNAL_ERROR "%s: incorrect delta operation requested.", __func__);
 		return -1;
@@ -2253,8 +2454,6 @@ static int _delta_update(kv_vector_t *vheader, kv_op_t op, struct kv_update_arg
 
 		_value_vector_mark_sync(abs_delta_vvalue, 0);
 
-		(void) _manage_kv_index(update_arg, key);
-
 		_destroy_key(update_arg->gen_buf, key);
 	}
 
@@ -2290,7 +2489,7 @@ static int _delta_update(kv_vector_t *vheader, kv_op_t op, struct kv_update_arg
 	                    &VVALUE_SEQNUM(vheader),
 	                    &value_flags_no_sync,
 	                    &VVALUE_GENNUM(vheader),
-	                    VVALUE_OWNER(vheader));
+	                    &VVALUE_OWNER(vheader));
 	_vvalue_data_prep(rel_vvalue, VVALUE_CNT(rel_vvalue), 0, (void *) key_prefix, strlen(key_prefix) + 1);
 
 	for (i = VVALUE_IDX_DATA; i < delta_vsize; i++) {
@@ -2358,8 +2557,9 @@ static int _kv_cb_delta_step(struct sid_kvs_update_spec *spec)
 	}
 
 	if (rel_spec->delta->final) {
-		sid_buf_get_data(rel_spec->delta->final, (const void **) &spec->new_data, &spec->new_data_size);
-		spec->new_flags &= ~SID_KVS_VAL_FL_REF;
+		spec->new_data       = rel_spec->delta->final;
+		spec->new_data_size  = rel_spec->delta->final_size;
+		spec->new_flags     &= ~SID_KVS_VAL_FL_REF;
 		r                = 1;
 		goto out;
 	}
@@ -2385,8 +2585,9 @@ out:
 
 static int _do_kv_delta_set(char *key, kv_vector_t *vvalue, size_t vsize, struct kv_update_arg *update_arg)
 {
-	struct kv_rel_spec *rel_spec = update_arg->custom;
-	int                 r        = -1;
+	struct kv_rel_spec   *rel_spec = update_arg->custom;
+	struct mem_arena_mark mark     = mem_arena_get_mark(update_arg->arena);
+	int                   r        = -1;
 
 	// TODO: assign proper return code, including update_arg->ret_code
 
@@ -2398,7 +2599,8 @@ static int _do_kv_delta_set(char *key, kv_vector_t *vvalue, size_t vsize, struct
 	 *   KV_OP_PLUS adds items listed in new vvalue to old vvalue
 	 *   KV_OP_MINUS remove items listed in new vvalue from old vvalue
 	 *
-	 * The result of _delta_step_calc is stored in rel_spec->delta:
+	 * The result of _delta_step_calc is stored in rel_spec->delta, allocated from update_arg->arena
+	 * which is released once we are done here:
 	 *   delta->final contains the final new vvalue to be stored in db snapshot
 	 *   delta->plus contains list of items which have been added to the old vvalue (not stored in db)
 	 *   delta->minus contains list of items which have been remove from the old vvalue (not stored in db)
@@ -2413,8 +2615,6 @@ static int _do_kv_delta_set(char *key, kv_vector_t *vvalue, size_t vsize, struct
 	    update_arg->ret_code < 0)
 		goto out;
 
-	(void) _manage_kv_index(update_arg, key);
-
 	/*
 	 * Next, depending on further requested handling based on rel_spec->delta->flags,
 	 * we calculate absolute delta (_delta_abs_calc) which is a cummulative difference
@@ -2460,8 +2660,9 @@ static int _do_kv_delta_set(char *key, kv_vector_t *vvalue, size_t vsize, struct
 
 	r = 0;
 out:
-	_destroy_delta_buffers(rel_spec->abs_delta);
-	_destroy_delta_buffers(rel_spec->delta);
+	_reset_delta(rel_spec->abs_delta);
+	_reset_delta(rel_spec->delta);
+	mem_arena_release(update_arg->arena, mark);
 	return r;
 }
 
@@ -2496,8 +2697,12 @@ static int _do_sid_ucmd_kv_set(sid_res_t                   *res,
 	struct kv_update_arg update_arg;
 	const kv_scalar_t   *svalue;
 	const void          *stored_value;
+	kv_owner_t           owner_id;
 	int                  r = 0;
 
+	if ((r = _get_owner_id(owner, &owner_id)) < 0)
+		goto out;
+
 	/*
 	 * First, we check if the KV is not reserved globally. This applies to reservations
 	 * where the namespace stores records with finer granularity than module scope.
@@ -2516,8 +2721,8 @@ static int _do_sid_ucmd_kv_set(sid_res_t                   *res,
 	 *        scheme so there's only one lookup?
 	 */
 
-	if (!((args->ns == SID_KV_NS_UDEV) && !strcmp(owner, OWNER_CORE))) {
-		if ((r = _check_global_kv_rs_for_wr(ucmd_ctx, owner, dom, args)) < 0)
+	if (!((args->ns == SID_KV_NS_UDEV) && (owner_id == OWNER_ID_CORE))) {
+		if ((r = _check_global_kv_rs_for_wr(ucmd_ctx, owner_id, dom, args)) < 0)
 			goto out;
 	}
 
@@ -2541,7 +2746,7 @@ static int _do_sid_ucmd_kv_set(sid_res_t                   *res,
 	                    &ucmd_ctx->req_env.dev.udev.seqnum,
 	                    &flags,
 	                    &ucmd_ctx->common->gennum,
-	                    (char *) owner);
+	                    &owner_id);
 	_vvalue_data_prep(vvalue, vvalue_cnt, 0, (void *) value, value ? args->sz ?: strlen(value) + 1 : 0);
 
 	key[0]     = KV_PREFIX_OP_ARCHIVE_C[0];
@@ -2560,7 +2765,6 @@ static int _do_sid_ucmd_kv_set(sid_res_t                   *res,
 		goto out;
 
 	stored_value = value ? svalue->data + _svalue_ext_data_offset(svalue) : SID_UCMD_KV_UNSET;
-	(void) _manage_kv_index(&update_arg, key);
 out:
 	_destroy_key(ucmd_ctx->common->gen_buf, key);
 
@@ -2600,15 +2804,19 @@ static void *_cmd_get_key_value(sid_res_t           *res,
 	void            *val;
 	kv_vector_t     *vvalue;
 	size_t           size, ext_data_offset;
+	kv_owner_t       owner_id;
 	void            *ret = NULL;
 	int              r   = 0;
 
 	if (!(val = sid_kvs_va_get(ucmd_ctx->common->kvs_res, .key = key, .size = &size, .flags = &kvs_flags, .ret_code = &r)))
 		goto out;
 
+	if ((r = _get_owner_id(owner, &owner_id)) < 0)
+		goto out;
+
 	vvalue = _get_vvalue(kvs_flags, val, size, tmp_vvalue, VVALUE_CNT(tmp_vvalue));
 
-	switch (_mod_match(VVALUE_OWNER(vvalue), owner)) {
+	switch (_mod_match(VVALUE_OWNER(vvalue), owner_id)) {
 		case MOD_NO_MATCH:
 			if (!(VVALUE_FLAGS(vvalue) & SID_KV_FL_FRG_RD)) {
 				r = -EPERM;
@@ -2703,7 +2911,16 @@ static bool _key_parts_match(struct iovec *key_parts1, struct iovec *key_parts2,
 	return true;
 }
 
-static char **_get_key_strv_from_vvalue(const kv_vector_t  *vvalue,
+/*
+ * Allocates from the arena if it is given, otherwise the result needs to be freed with free().
+ */
+static void *_arena_or_malloc(struct mem_arena *arena, size_t size)
+{
+	return arena ? mem_arena_alloc(arena, size) : malloc(size);
+}
+
+static char **_get_key_strv_from_vvalue(struct mem_arena   *arena,
+                                        const kv_vector_t  *vvalue,
                                         size_t              size,
                                         struct kv_key_spec *key_filter,
                                         size_t             *ret_count,
@@ -2738,7 +2955,7 @@ static char **_get_key_strv_from_vvalue(const kv_vector_t  *vvalue,
 		}
 	}
 
-	if (!(strv = malloc(bmp_get_bit_set_count(bmp) * sizeof(char *) + count * sizeof(char)))) {
+	if (!(strv = _arena_or_malloc(arena, bmp_get_bit_set_count(bmp) * sizeof(char *) + count * sizeof(char)))) {
 		r = -ENOMEM;
 		goto out;
 	}
@@ -2761,69 +2978,33 @@ out:
 	return strv;
 }
 
-static char **_strv_add_strv(char **strv1, size_t size1, char **strv2, size_t size2)
-{
-	char **strv = NULL;
-	char  *p1, *p2;
-	size_t size, i;
-
-	if (!(strv1 && size1 && strv2 && size2))
-		return NULL;
-
-	size = size1 + size2;
-	p1   = strv1[size1 - 1];
-	p2   = strv2[size2 - 1];
-
-	if (!(strv = malloc((size * sizeof(char *)) + (p1 + strlen(p1) + 1 - strv1[0]) + (p2 + strlen(p2) + 1 - strv2[0]))))
-		return NULL;
-
-	p1 = (char *) strv + size * sizeof(char *);
-
-	for (i = 0; i < size; i++) {
-		if (i < size1)
-			p2 = stpcpy(p1, strv1[i]);
-		else
-			p2 = stpcpy(p1, strv2[i - size1]);
-
-		strv[i] = p1;
-		p1      = p2 + 1;
-	}
-
-	return strv;
-}
-
-static char **_strv_add_str(char **strv1, size_t size1, char *str)
+/*
+ * Creates strv with copies of given strings in a single allocation so it can be freed with one free(),
+ * or allocated from the arena if it is given.
+ */
+static char **_strv_from_ptrs(struct mem_arena *arena, const char **ptrs, size_t count)
 {
-	char **strv = NULL;
-	char  *p1, *p2;
-	size_t mem_size, i = 0;
+	char **strv;
+	char  *p;
+	size_t mem_size, i;
 
-	if (!str)
+	if (!count)
 		return NULL;
 
-	mem_size = sizeof(char *) + strlen(str) + 1;
-
-	if (strv1) {
-		p1        = strv1[size1 - 1];
-		mem_size += p1 + strlen(p1) + 1 - (char *) strv1;
-	}
+	mem_size = count * sizeof(char *);
+	for (i = 0; i < count; i++)
+		mem_size += strlen(ptrs[i]) + 1;
 
-	if (!(strv = malloc(mem_size)))
+	if (!(strv = _arena_or_malloc(arena, mem_size)))
 		return NULL;
 
-	p1 = (char *) strv + (size1 + 1) * sizeof(char *);
+	p = (char *) (strv + count);
 
-	if (strv1) {
-		for (; i < size1; i++) {
-			p2      = stpcpy(p1, strv1[i]);
-			strv[i] = p1;
-			p1      = p2 + 1;
-		}
+	for (i = 0; i < count; i++) {
+		strv[i] = p;
+		p       = stpcpy(p, ptrs[i]) + 1;
 	}
 
-	strv[i] = p1;
-	(void) stpcpy(p1, str);
-
 	return strv;
 }
 
@@ -2939,14 +3120,15 @@ static int _dev_key_to_devid(struct sid_ucmd_ctx *ucmd_ctx,
 static int _dev_key_to_dsq(struct sid_ucmd_ctx *ucmd_ctx, const char *dev_key, uint16_t *gennum, char *buf, size_t buf_size)
 
 {
-	struct iovec key_parts[_KEY_PART_COUNT];
-	key_part_t   last_key_part;
-	const char  *key;
-	kv_vector_t *vvalue;
-	size_t       vvalue_size;
-	char       **key_strv = NULL;
-	size_t       count;
-	int          r;
+	struct iovec          key_parts[_KEY_PART_COUNT];
+	key_part_t            last_key_part;
+	const char           *key;
+	kv_vector_t          *vvalue;
+	size_t                vvalue_size;
+	char                **key_strv;
+	size_t                count;
+	struct mem_arena_mark mark;
+	int                   r;
 
 	last_key_part = _decompose_key(dev_key, key_parts);
 
@@ -2962,6 +3144,8 @@ static int _dev_key_to_dsq(struct sid_ucmd_ctx *ucmd_ctx, const char *dev_key, u
 	if (!(key = _cat_prefix_and_key(ucmd_ctx->common->gen_buf, dev_key, KV_KEY_GEN_GROUP_IN)))
 		return -ENOMEM;
 
+	mark = mem_arena_get_mark(ucmd_ctx->arena);
+
 	if (!(vvalue = sid_kvs_va_get(ucmd_ctx->common->kvs_res, .key = key, .size = &vvalue_size))) {
 		r = -ENODATA;
 		goto out;
@@ -2974,6 +3158,7 @@ static int _dev_key_to_dsq(struct sid_ucmd_ctx *ucmd_ctx, const char *dev_key, u
 	vvalue_size -= VVALUE_HEADER_CNT;
 
 	key_strv     = _get_key_strv_from_vvalue(
+                ucmd_ctx->arena,
                 vvalue,
                 vvalue_size,
                 &KV_KEY_SPEC(.dom = KV_KEY_DOM_ALIAS, .ns = SID_KV_NS_MOD, .ns_part = _owner_name(NULL), .id_cat = DEV_ALIAS_DSEQ),
@@ -2992,7 +3177,7 @@ static int _dev_key_to_dsq(struct sid_ucmd_ctx *ucmd_ctx, const char *dev_key, u
 
 	r = 0;
 out:
-	free(key_strv);
+	mem_arena_release(ucmd_ctx->arena, mark);
 	_destroy_key(ucmd_ctx->common->gen_buf, key);
 	return r;
 }
@@ -3115,10 +3300,14 @@ static int _do_sid_ucmd_mod_reserve_kv(sid_res_t                  *res,
 	kv_vector_t          vvalue[VVALUE_HEADER_CNT]; /* only header */
 	struct kv_update_arg update_arg;
 	struct kv_unset_nfo  unset_nfo;
+	kv_owner_t           owner_id;
 	int                  is_worker;
 	struct kv_key_spec   key_spec = KV_KEY_SPEC(.dom = dom, .ns = ns, .core = key_core);
 	int                  r        = -1;
 
+	if (_get_owner_id(owner, &owner_id) < 0)
+		goto out;
+
 	if (!(key = _compose_key(common->gen_buf, &key_spec)))
 		goto out;
 
@@ -3139,7 +3328,7 @@ static int _do_sid_ucmd_mod_reserve_kv(sid_res_t                  *res,
 		flags |= SID_KV_FL_RS | SID_KV_FL_SCPS;
 
 	if (unset && !is_worker) {
-		unset_nfo.owner   = owner;
+		unset_nfo.owner   = owner_id;
 		unset_nfo.seqnum  = 0; /* reservation is handled before/after any events, so no seqnum here - use 0 instead */
 		update_arg.custom = &unset_nfo;
 
@@ -3147,7 +3336,7 @@ static int _do_sid_ucmd_mod_reserve_kv(sid_res_t                  *res,
 		    update_arg.ret_code < 0)
 			goto out;
 	} else {
-		_vvalue_header_prep(vvalue, VVALUE_CNT(vvalue), &null_int, &flags, &common->gennum, (char *) owner);
+		_vvalue_header_prep(vvalue, VVALUE_CNT(vvalue), &null_int, &flags, &common->gennum, &owner_id);
 		if (sid_kvs_va_set(common->kvs_res,
 		                   .key      = key,
 		                   .value    = vvalue,
@@ -3157,8 +3346,6 @@ static int _do_sid_ucmd_mod_reserve_kv(sid_res_t                  *res,
 		                   .fn       = _kv_cb_reserve,
 		                   .fn_arg   = &update_arg) < 0)
 			goto out;
-
-		(void) _manage_kv_index(&update_arg, key);
 	}
 
 	r = 0;
@@ -3518,6 +3705,7 @@ static int _handle_devs_for_group(sid_res_t           *res,
 
 	struct kv_update_arg update_arg = KV_UPDATE_ARG(.res     = ucmd_ctx->common->kvs_res,
 	                                                .gen_buf = ucmd_ctx->common->gen_buf,
+	                                                .arena   = ucmd_ctx->arena,
 	                                                .is_sync = is_sync,
 	                                                .custom  = &rel_spec);
 
@@ -3537,7 +3725,12 @@ static int _handle_devs_for_group(sid_res_t           *res,
 		vvalue_size = VVALUE_CNT(single_vvalue);
 	}
 
-	_vvalue_header_prep(vvalue, vvalue_size, &ucmd_ctx->req_env.dev.udev.seqnum, &flags, &ucmd_ctx->common->gennum, core_owner);
+	_vvalue_header_prep(vvalue,
+	                    vvalue_size,
+	                    &ucmd_ctx->req_env.dev.udev.seqnum,
+	                    &flags,
+	                    &ucmd_ctx->common->gennum,
+	                    &core_owner);
 
 	if (vdevs) {
 		for (i = 0; i < vdevs_size; i++)
@@ -3588,8 +3781,10 @@ static int _do_sid_ucmd_group_destroy(sid_res_t           *res,
 
 	                                          .rel_key_spec = &KV_KEY_SPEC(.ns = SID_KV_NS_DEV, .core = KV_KEY_GEN_GROUP_IN));
 
-	struct kv_update_arg update_arg =
-		KV_UPDATE_ARG(.res = ucmd_ctx->common->kvs_res, .gen_buf = ucmd_ctx->common->gen_buf, .custom = &rel_spec);
+	struct kv_update_arg update_arg = KV_UPDATE_ARG(.res     = ucmd_ctx->common->kvs_res,
+	                                                .gen_buf = ucmd_ctx->common->gen_buf,
+	                                                .arena   = ucmd_ctx->arena,
+	                                                .custom  = &rel_spec);
 
 	// TODO: do not call kv_store_get_value, only kv_store_set_value and provide _kv_cb_delta wrapper
 	//       to do the "is empty?" check before the actual _kv_cb_delta operation
@@ -3610,7 +3805,7 @@ static int _do_sid_ucmd_group_destroy(sid_res_t           *res,
 	                    &ucmd_ctx->req_env.dev.udev.seqnum,
 	                    &kv_flags_sync_no_reserved,
 	                    &ucmd_ctx->common->gennum,
-	                    core_owner);
+	                    &core_owner);
 
 	if ((r = _kv_delta_set(key, vvalue, VVALUE_HEADER_CNT, &update_arg)) < 0)
 		goto out;
@@ -3713,7 +3908,10 @@ int sid_ucmd_dev_alias_del(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx, co
 	                              false);
 }
 
-const char **sid_ucmd_dev_alias_get(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx, struct sid_ucmd_dev_alias_get_args *args)
+static const char **_do_sid_ucmd_dev_alias_get(sid_res_t                          *mod_res,
+                                               struct sid_ucmd_ctx                *ucmd_ctx,
+                                               struct mem_arena                   *arena,
+                                               struct sid_ucmd_dev_alias_get_args *args)
 {
 	char               buf[UTIL_UUID_STR_SIZE];
 	const char        *devid;
@@ -3751,6 +3949,7 @@ const char **sid_ucmd_dev_alias_get(sid_res_t *mod_res, struct sid_ucmd_ctx *ucm
 		goto out;
 
 	key_strv = _get_key_strv_from_vvalue(
+		arena,
 		vvalue,
 		vvalue_size,
 		&KV_KEY_SPEC(.dom = KV_KEY_DOM_ALIAS, .ns = SID_KV_NS_MOD, .ns_part = args->mod_name, .id_cat = args->alias_key),
@@ -3762,6 +3961,17 @@ out:
 	return (const char **) key_strv;
 }
 
+const char **sid_ucmd_dev_alias_get(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx, struct sid_ucmd_dev_alias_get_args *args)
+{
+	return _do_sid_ucmd_dev_alias_get(mod_res, ucmd_ctx, NULL, args);
+}
+
+const char **
+	sid_ucmd_dev_alias_get_scoped(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx, struct sid_ucmd_dev_alias_get_args *args)
+{
+	return _do_sid_ucmd_dev_alias_get(mod_res, ucmd_ctx, ucmd_ctx ? ucmd_ctx->arena : NULL, args);
+}
+
 static int _kv_cb_write_new_only(struct sid_kvs_update_spec *spec)
 {
 	if (spec->old_data)
@@ -3781,6 +3991,7 @@ static int _do_sid_ucmd_group_create(sid_res_t           *res,
 {
 	char       *key = NULL;
 	kv_vector_t vvalue[VVALUE_HEADER_CNT];
+	kv_owner_t  owner_id;
 	int         r                   = -1;
 
 	struct kv_key_spec key_spec     = KV_KEY_SPEC(.dom     = dom ?: ID_NULL,
@@ -3792,6 +4003,9 @@ static int _do_sid_ucmd_group_create(sid_res_t           *res,
 
 	struct kv_update_arg update_arg = KV_UPDATE_ARG(.res = ucmd_ctx->common->kvs_res, .gen_buf = ucmd_ctx->common->gen_buf);
 
+	if (_get_owner_id(owner, &owner_id) < 0)
+		goto out;
+
 	if (!(key = _compose_key(ucmd_ctx->common->gen_buf, &key_spec)))
 		goto out;
 
@@ -3800,7 +4014,7 @@ static int _do_sid_ucmd_group_create(sid_res_t           *res,
 	                    &ucmd_ctx->req_env.dev.udev.seqnum,
 	                    &group_flags,
 	                    &ucmd_ctx->common->gennum,
-	                    (char *) owner);
+	                    &owner_id);
 
 	if (sid_kvs_va_set(ucmd_ctx->common->kvs_res,
 	                   .key    = key,
@@ -3811,8 +4025,6 @@ static int _do_sid_ucmd_group_create(sid_res_t           *res,
 	                   .fn_arg = &update_arg) < 0)
 		goto out;
 
-	(void) _manage_kv_index(&update_arg, key);
-
 	r = 0;
 out:
 	_destroy_key(ucmd_ctx->common->gen_buf, key);
@@ -3960,7 +4172,8 @@ static char **_get_dev_imm_deps(sid_res_t           *mod_res,
 			if (*ret_code < 0 && *ret_code != -ENOENT)
 				return NULL;
 
-			return _get_key_strv_from_vvalue(vvalue,
+			return _get_key_strv_from_vvalue(NULL,
+			                                 vvalue,
 			                                 vvalue_size,
 			                                 &KV_KEY_SPEC(.dom     = KV_KEY_DOM_ALIAS,
 			                                              .ns      = SID_KV_NS_MOD,
@@ -3997,7 +4210,8 @@ static char **_get_dev_imm_deps(sid_res_t           *mod_res,
 			if (*ret_code < 0 && *ret_code != -ENOENT)
 				return NULL;
 
-			return _get_key_strv_from_vvalue(vvalue,
+			return _get_key_strv_from_vvalue(NULL,
+			                                 vvalue,
 			                                 vvalue_size,
 			                                 &KV_KEY_SPEC(.ns = SID_KV_NS_DEV),
 			                                 ret_count,
@@ -4009,136 +4223,254 @@ static char **_get_dev_imm_deps(sid_res_t           *mod_res,
 	}
 }
 
+/*
+ * Device dependency graph used to serve stack queries. Each node holds immediate
+ * dependencies of a device in one direction as read from KV_KEY_GEN_GROUP_MEMBERS
+ * (ancestors) or KV_KEY_GEN_GROUP_IN (descendants) records. Results of transitive
+ * queries are stored for their root device too so any further query for the same
+ * device and method is answered without walking the graph again.
+ *
+ * The graph is populated on demand and it is kept for the lifetime of the command.
+ * It is dropped whenever the command updates device dependency records itself.
+ */
+struct dev_graph_node {
+	char **strv;
+	size_t count;
+};
+
+#define DEV_GRAPH_HASH_SIZE_HINT 64
+
+static void _dev_graph_destroy(struct sid_ucmd_ctx *ucmd_ctx)
+{
+	struct hash_node      *n;
+	struct dev_graph_node *node;
+
+	if (!ucmd_ctx->dev_graph)
+		return;
+
+	for (n = hash_get_first(ucmd_ctx->dev_graph); n; n = hash_get_next(ucmd_ctx->dev_graph, n)) {
+		node = hash_get_data(ucmd_ctx->dev_graph, n, NULL);
+		free(node->strv);
+		free(node);
+	}
+
+	hash_destroy(ucmd_ctx->dev_graph);
+	ucmd_ctx->dev_graph = NULL;
+}
+
+static struct dev_graph_node *_dev_graph_lookup(struct sid_ucmd_ctx *ucmd_ctx, const char *dev_key, sid_dev_search_t method)
+{
+	struct dev_graph_node *node;
+	const char            *key;
+
+	if (!ucmd_ctx->dev_graph)
+		return NULL;
+
+	if (sid_buf_add_fmt(ucmd_ctx->common->gen_buf, (const void **) &key, NULL, "%c%s", '0' + method, dev_key ?: "") < 0)
+		return NULL;
+
+	node = hash_lookup(ucmd_ctx->dev_graph, key, strlen(key), NULL);
+	sid_buf_rewind_mem(ucmd_ctx->common->gen_buf, key);
+
+	return node;
+}
+
+static struct dev_graph_node *
+	_dev_graph_add(struct sid_ucmd_ctx *ucmd_ctx, const char *dev_key, sid_dev_search_t method, char **strv, size_t count)
+{
+	struct dev_graph_node *node = NULL;
+	const char            *key  = NULL;
+
+	if (!ucmd_ctx->dev_graph && !(ucmd_ctx->dev_graph = hash_create(DEV_GRAPH_HASH_SIZE_HINT)))
+		goto fail;
+
+	if (!(node = malloc(sizeof(*node))))
+		goto fail;
+
+	node->strv  = strv;
+	node->count = count;
+
+	if (sid_buf_add_fmt(ucmd_ctx->common->gen_buf, (const void **) &key, NULL, "%c%s", '0' + method, dev_key ?: "") < 0)
+		goto fail;
+
+	if (hash_add(ucmd_ctx->dev_graph, key, strlen(key), node, sizeof(*node)) < 0)
+		goto fail;
+
+	sid_buf_rewind_mem(ucmd_ctx->common->gen_buf, key);
+	return node;
+fail:
+	if (key)
+		sid_buf_rewind_mem(ucmd_ctx->common->gen_buf, key);
+	free(node);
+	free(strv);
+	return NULL;
+}
+
+static struct dev_graph_node *_dev_graph_get_imm_deps(sid_res_t           *mod_res,
+                                                      struct sid_ucmd_ctx *ucmd_ctx,
+                                                      const char          *dev_key,
+                                                      sid_dev_search_t     method,
+                                                      int                 *ret_code)
+{
+	struct dev_graph_node *node;
+	char                 **strv;
+	size_t                 count;
+
+	if ((node = _dev_graph_lookup(ucmd_ctx, dev_key, method)))
+		return node;
+
+	strv = _get_dev_imm_deps(mod_res, ucmd_ctx, dev_key, method, &count, ret_code);
+
+	if (*ret_code < 0)
+		return NULL;
+
+	if (!(node = _dev_graph_add(ucmd_ctx, dev_key, method, strv, count)))
+		*ret_code = -ENOMEM;
+
+	return node;
+}
+
+static int _dev_graph_enqueue_deps(const char          ***devs,
+                                   size_t                *devs_alloc,
+                                   size_t                *count,
+                                   struct hash_table     *visited,
+                                   struct dev_graph_node *node)
+{
+	const char **tmp;
+	size_t       i;
+
+	for (i = 0; i < node->count; i++) {
+		if (hash_lookup(visited, node->strv[i], strlen(node->strv[i]), NULL))
+			continue;
+
+		if (hash_add(visited, node->strv[i], strlen(node->strv[i]), node->strv[i], 0) < 0)
+			return -ENOMEM;
+
+		if (*count == *devs_alloc) {
+			if (!(tmp = realloc(*devs, *devs_alloc * 2 * sizeof(*tmp))))
+				return -ENOMEM;
+			*devs        = tmp;
+			*devs_alloc *= 2;
+		}
+
+		(*devs)[(*count)++] = node->strv[i];
+	}
+
+	return 0;
+}
+
 static char **_do_sid_ucmd_dev_stack_get(sid_res_t           *mod_res,
                                          struct sid_ucmd_ctx *ucmd_ctx,
+                                         struct mem_arena    *arena,
                                          const char          *dev_key,
                                          sid_dev_search_t     method,
                                          size_t              *ret_count,
                                          int                 *ret_code)
 {
-	size_t i, count, count1, count2;
-	char **strv = NULL, **strv1 = NULL, **strv2 = NULL;
-	char **strv_merged;
-	int    r;
-
-	strv = _get_dev_imm_deps(mod_res, ucmd_ctx, dev_key, method, &count, &r);
-
-	if (r < 0)
-		goto fail;
+	sid_dev_search_t       imm_method;
+	struct dev_graph_node *node, *root;
+	struct hash_table     *visited = NULL;
+	const char           **devs    = NULL;
+	size_t                 devs_alloc, count = 0, leaf_count = 0, i;
+	char                 **strv = NULL;
+	int                    r    = 0;
 
 	switch (method) {
 		case SID_DEV_SEARCH_IMM_ANC:
-		case SID_DEV_SEARCH_IMM_DESC:
+		case SID_DEV_SEARCH_ANC:
+		case SID_DEV_SEARCH_BASE:
+			imm_method = SID_DEV_SEARCH_IMM_ANC;
 			break;
 
-		case SID_DEV_SEARCH_ANC:
+		case SID_DEV_SEARCH_IMM_DESC:
 		case SID_DEV_SEARCH_DESC:
-			if (count == 0)
-				goto out;
-
-			strv1  = strv;
-			count1 = count;
-
-			for (i = 0; i < count; i++) {
-				strv2 = _do_sid_ucmd_dev_stack_get(mod_res, ucmd_ctx, strv[i], method, &count2, &r);
-
-				if (r < 0)
-					goto fail;
-
-				if (!strv2)
-					continue;
+		case SID_DEV_SEARCH_TOP:
+			imm_method = SID_DEV_SEARCH_IMM_DESC;
+			break;
 
-				if (!(strv_merged = _strv_add_strv(strv1, count1, strv2, count2))) {
-					r = -ENOMEM;
-					goto fail;
-				}
+		default:
+			r = -EINVAL;
+			goto out;
+	}
 
-				if (strv1 != strv)
-					free(strv1);
-				free(strv2);
+	if (method == imm_method) {
+		if (!(node = _dev_graph_get_imm_deps(mod_res, ucmd_ctx, dev_key, method, &r)))
+			goto out;
+	} else if (!(node = _dev_graph_lookup(ucmd_ctx, dev_key, method))) {
+		if (!(root = _dev_graph_get_imm_deps(mod_res, ucmd_ctx, dev_key, imm_method, &r)))
+			goto out;
 
-				strv1   = strv_merged;
-				count1 += count2;
-			}
+		if (root->count) {
+			/*
+			 * Walk the graph breadth-first, using devs as the queue and visiting each
+			 * device only once even if it is reachable through more paths. For BASE
+			 * and TOP, devices without further dependencies are moved to the front
+			 * of devs as we go - all the devices there are already processed.
+			 */
+			devs_alloc = root->count * 4;
 
-			if (strv1 != strv) {
-				free(strv);
-				strv  = strv1;
-				count = count1;
+			if (!(devs = malloc(devs_alloc * sizeof(*devs))) || !(visited = hash_create(devs_alloc)) ||
+			    hash_add(visited, dev_key ?: "", strlen(dev_key ?: ""), (void *) root, 0) < 0) {
+				r = -ENOMEM;
+				goto out;
 			}
-			break;
 
-		case SID_DEV_SEARCH_BASE:
-		case SID_DEV_SEARCH_TOP:
-			if (count == 0)
+			if ((r = _dev_graph_enqueue_deps(&devs, &devs_alloc, &count, visited, root)) < 0)
 				goto out;
 
-			strv1  = NULL;
-			count1 = 0;
-
 			for (i = 0; i < count; i++) {
-				strv2 = _do_sid_ucmd_dev_stack_get(mod_res, ucmd_ctx, strv[i], method, &count2, &r);
-
-				if (r < 0)
-					goto fail;
+				if (!(node = _dev_graph_get_imm_deps(mod_res, ucmd_ctx, devs[i], imm_method, &r)))
+					goto out;
 
-				if (!strv2) {
-					if (!(strv_merged = _strv_add_str(strv1, count1, strv[i]))) {
-						r = -ENOMEM;
-						goto fail;
-					}
+				if (!node->count)
+					devs[leaf_count++] = devs[i];
+				else if ((r = _dev_graph_enqueue_deps(&devs, &devs_alloc, &count, visited, node)) < 0)
+					goto out;
+			}
 
-					free(strv1);
-					free(strv2);
+			if (method == SID_DEV_SEARCH_BASE || method == SID_DEV_SEARCH_TOP)
+				count = leaf_count;
+		}
 
-					strv1   = strv_merged;
-					count1 += 1;
-				} else {
-					if (strv1) {
-						if (!(strv_merged = _strv_add_strv(strv1, count1, strv2, count2))) {
-							r = -ENOMEM;
-							goto fail;
-						}
-
-						free(strv1);
-						free(strv2);
-
-						strv1   = strv_merged;
-						count1 += count2;
-					} else {
-						strv1  = strv2;
-						count1 = count2;
-					}
-				}
-			}
+		if (count && !(strv = _strv_from_ptrs(NULL, devs, count))) {
+			r = -ENOMEM;
+			goto out;
+		}
 
-			free(strv);
-			strv  = strv1;
-			count = count1;
-			break;
+		if (!(node = _dev_graph_add(ucmd_ctx, dev_key, method, strv, count))) {
+			r = -ENOMEM;
+			goto out;
+		}
+	}
 
-		default:
-			break;
+	/* The node stays in the graph, return a copy. */
+	if (node->count && !(strv = _strv_from_ptrs(arena, (const char **) node->strv, node->count))) {
+		r = -ENOMEM;
+		goto out;
 	}
+
+	count = node->count;
 out:
+	free(devs);
+	if (visited)
+		hash_destroy(visited);
+
+	if (r < 0) {
+		strv  = NULL;
+		count = 0;
+	}
+
 	if (ret_count)
 		*ret_count = count;
-	if (ret_code)
-		*ret_code = 0;
-	return strv;
-fail:
-	free(strv1);
-	free(strv2);
-	if (strv != strv1)
-		free(strv);
-	if (ret_count)
-		*ret_count = 0;
 	if (ret_code)
 		*ret_code = r;
-	return NULL;
+	return strv;
 }
 
-const char **sid_ucmd_dev_stack_get(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx, struct sid_ucmd_dev_stack_get_args *args)
+static const char **_get_dev_stack(sid_res_t                          *mod_res,
+                                   struct sid_ucmd_ctx                *ucmd_ctx,
+                                   struct mem_arena                   *arena,
+                                   struct sid_ucmd_dev_stack_get_args *args)
 {
 	char        buf[UTIL_UUID_STR_SIZE];
 	const char *devid;
@@ -4154,7 +4486,19 @@ const char **sid_ucmd_dev_stack_get(sid_res_t *mod_res, struct sid_ucmd_ctx *ucm
 		return NULL;
 	}
 
-	return (const char **) _do_sid_ucmd_dev_stack_get(mod_res, ucmd_ctx, devid, args->method, args->count, args->ret_code);
+	return (const char **)
+		_do_sid_ucmd_dev_stack_get(mod_res, ucmd_ctx, arena, devid, args->method, args->count, args->ret_code);
+}
+
+const char **sid_ucmd_dev_stack_get(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx, struct sid_ucmd_dev_stack_get_args *args)
+{
+	return _get_dev_stack(mod_res, ucmd_ctx, NULL, args);
+}
+
+const char **
+	sid_ucmd_dev_stack_get_scoped(sid_res_t *mod_res, struct sid_ucmd_ctx *ucmd_ctx, struct sid_ucmd_dev_stack_get_args *args)
+{
+	return _get_dev_stack(mod_res, ucmd_ctx, ucmd_ctx ? ucmd_ctx->arena : NULL, args);
 }
 
 static int _device_add_field(sid_res_t *res, struct sid_ucmd_ctx *ucmd_ctx, const char *start)
@@ -4267,26 +4611,22 @@ static void _canonicalize_module_name(char *name)
 
 static int _part_get_whole_disk(sid_res_t *res, struct sid_ucmd_ctx *ucmd_ctx, char *devno_buf, size_t devno_buf_size)
 {
-	const char *s;
-	int         r;
+	int fd, r;
 
-	if ((r = sid_buf_add_fmt(ucmd_ctx->common->gen_buf,
-	                         (const void **) &s,
-	                         NULL,
-	                         "%s%s/../dev",
-	                         SYSTEM_SYSFS_PATH,
-	                         ucmd_ctx->req_env.dev.udev.path)) < 0) {
+	if ((fd = sid_ucmd_ev_get_dev_sysfs_fd(ucmd_ctx)) < 0) {
 		sid_res_log_error_errno(res,
-		                        r,
-		                        "Failed to compose sysfs path for whole device of partition device " CMD_DEV_PRINT_FMT,
+		                        fd,
+		                        "Failed to open sysfs directory for partition device " CMD_DEV_PRINT_FMT,
 		                        CMD_DEV_PRINT(ucmd_ctx));
-		return r;
+		return fd;
 	}
 
-	if ((r = sid_util_sysfs_get(s, devno_buf, devno_buf_size, NULL)) < 0 || !*devno_buf)
-		sid_res_log_error_errno(res, r, "Failed to read whole disk device number from sysfs file %s.", s);
+	if ((r = sid_util_sysfs_get_at(fd, "../dev", devno_buf, devno_buf_size, NULL)) < 0 || !*devno_buf)
+		sid_res_log_error_errno(res,
+		                        r,
+		                        "Failed to read whole disk device number from sysfs for partition " CMD_DEV_PRINT_FMT,
+		                        CMD_DEV_PRINT(ucmd_ctx));
 
-	sid_buf_rewind_mem(ucmd_ctx->common->gen_buf, s);
 	return r;
 }
 
@@ -4356,28 +4696,23 @@ static char *_owner_name_from_blkext(sid_res_t *cmd_res, char *buf, size_t buf_s
 	return NULL;
 }
 
-/*
- *  Module name is equal to the name as exposed in SYSTEM_PROC_DEVICES_PATH.
- */
-static char *_lookup_mod_name(sid_res_t *cmd_res, const int dev_major, const char *dev_name, char *buf, size_t buf_size)
+static int _refresh_dev_majors(sid_res_t *res, struct dev_major_tbl *tbl)
 {
-	char  *p, *end, *found = NULL, *mod_name = NULL;
-	FILE  *f = NULL;
-	char   line[80];
-	int    in_block_section = 0;
-	int    major;
-	size_t len;
+	struct dev_major *entries = NULL, *tmp;
+	size_t            count = 0, alloc = 0;
+	char             *p, *end;
+	FILE             *f;
+	char              line[80];
+	int               in_block_section = 0;
+	int               major;
+	int               r = 0;
 
 	if (!(f = fopen(SYSTEM_PROC_DEVICES_PATH, "r"))) {
-		sid_res_log_sys_error(cmd_res, "fopen", SYSTEM_PROC_DEVICES_PATH);
-		goto out;
+		r = -errno;
+		sid_res_log_sys_error(res, "fopen", SYSTEM_PROC_DEVICES_PATH);
+		return r;
 	}
 
-	/*
-	 *  FIXME: Maybe cache this so we don't need to parse the file again
-	 *  	   on next lookup and reread the file/refresh the cache only
-	 *  	   if we don't find the device in the cache.
-	 */
 	while (fgets(line, sizeof(line), f) != NULL) {
 		/* we need to be under "Block devices:" section */
 		if (!in_block_section) {
@@ -4408,35 +4743,98 @@ static char *_lookup_mod_name(sid_res_t *cmd_res, const int dev_major, const cha
 		if ((major = atoi(p)) == 0)
 			continue;
 
-		/* is it the major we're looking for? */
-		if (major == dev_major) {
-			found = end + 1;
-			break;
+		/* the name follows the number up to the end of line */
+		p   = end + 1;
+		end = p;
+		while (isprint(*end))
+			end++;
+
+		if ((size_t) (end - p) >= DEV_MAJOR_NAME_SIZE) {
+			sid_res_log_warning(res,
+			                    "Skipping too long device name for major number %d in %s.",
+			                    major,
+			                    SYSTEM_PROC_DEVICES_PATH);
+			continue;
+		}
+
+		if (count == alloc) {
+			alloc = alloc ? alloc * 2 : 32;
+			if (!(tmp = realloc(entries, alloc * sizeof(*entries)))) {
+				sid_res_log_error(res, "Failed to allocate device major number map.");
+				r = -ENOMEM;
+				goto out;
+			}
+			entries = tmp;
 		}
+
+		entries[count].major = major;
+		memcpy(entries[count].name, p, end - p);
+		entries[count].name[end - p] = '\0';
+		count++;
 	}
 
-	if (!found) {
-		sid_res_log_error(cmd_res,
-		                  "Unable to find major number %d for device %s in %s.",
-		                  dev_major,
-		                  dev_name,
-		                  SYSTEM_PROC_DEVICES_PATH);
-		goto out;
+	free(tbl->entries);
+	tbl->entries = entries;
+	tbl->count   = count;
+	entries      = NULL;
+out:
+	free(entries);
+	fclose(f);
+	return r;
+}
+
+static const char *_find_dev_major(struct dev_major_tbl *tbl, int dev_major)
+{
+	size_t i;
+
+	for (i = 0; i < tbl->count; i++) {
+		if (tbl->entries[i].major == dev_major)
+			return tbl->entries[i].name;
 	}
 
-	p = found;
-	while (isprint(*p))
-		p++;
-	p[0] = '\0';
+	return NULL;
+}
+
+/*
+ *  Module name is equal to the name as exposed in SYSTEM_PROC_DEVICES_PATH.
+ */
+static char *_lookup_mod_name(sid_res_t *cmd_res, const int dev_major, const char *dev_name, char *buf, size_t buf_size)
+{
+	struct sid_ucmd_ctx  *ucmd_ctx = sid_res_get_data(cmd_res);
+	struct dev_major_tbl *tbl      = &ucmd_ctx->common->dev_majors;
+	const char           *found;
+	size_t                len;
+
+	/*
+	 * The map is inherited from main process. On a miss, the device
+	 * may be driven by a module loaded after the map was last built
+	 * so reread SYSTEM_PROC_DEVICES_PATH before giving up.
+	 */
+	if (!(found = _find_dev_major(tbl, dev_major))) {
+		if (_refresh_dev_majors(cmd_res, tbl) < 0)
+			return NULL;
+
+		if (!(found = _find_dev_major(tbl, dev_major))) {
+			sid_res_log_error(cmd_res,
+			                  "Unable to find major number %d for device %s in %s.",
+			                  dev_major,
+			                  dev_name,
+			                  SYSTEM_PROC_DEVICES_PATH);
+			return NULL;
+		}
+	}
 
 	if (!strncmp(found, MOD_NAME_BLKEXT, sizeof(MOD_NAME_BLKEXT))) {
 		if (!(found = _owner_name_from_blkext(cmd_res, buf, buf_size))) {
 			sid_res_log_error(cmd_res, "Failed to get module name for blkext device.");
-			goto out;
+			return NULL;
 		}
-		len = strlen(found);
-	} else
-		len = p - found;
+		/* _owner_name_from_blkext may have already filled in buf */
+		if (found == buf)
+			return buf;
+	}
+
+	len = strlen(found);
 
 	if (len >= buf_size) {
 		sid_res_log_error(cmd_res,
@@ -4444,19 +4842,15 @@ static char *_lookup_mod_name(sid_res_t *cmd_res, const int dev_major, const cha
 		                  "found string \"%s\", buffer size is only %zu.",
 		                  SYSTEM_PROC_DEVICES_PATH,
 		                  found,
-		                  sizeof(buf));
-		goto out;
+		                  buf_size);
+		return NULL;
 	}
 
 	memcpy(buf, found, len);
 	buf[len] = '\0';
 	_canonicalize_module_name(buf);
-	mod_name = buf;
-out:
-	if (f)
-		fclose(f);
 
-	return mod_name;
+	return buf;
 }
 
 static int _connection_cleanup(sid_res_t *conn_res)
@@ -4704,45 +5098,44 @@ static const char *_sval_to_dev_reserved_str(kv_scalar_t *val)
 
 static int _cmd_exec_devices(sid_res_t *cmd_res)
 {
-	char                 devid_buf1[UTIL_UUID_STR_SIZE];
-	char                 devid_buf2[UTIL_UUID_STR_SIZE];
+	char                 devid[UTIL_UUID_STR_SIZE];
 	struct sid_ucmd_ctx *ucmd_ctx = sid_res_get_data(cmd_res);
 	fmt_output_t         format   = flags_to_format(ucmd_ctx->req_hdr.flags);
 	struct sid_buf      *prn_buf  = ucmd_ctx->prn_buf;
 	kv_vector_t          tmp_vvalue[VVALUE_SINGLE_CNT];
 	sid_kvs_iter_t      *iter;
 	void                *data;
-	size_t               size;
+	size_t               size, len;
 	sid_kvs_val_fl_t     kv_store_value_flags;
-	const char          *key, *key_core;
-	char                *prev_devid, *devid;
+	const char          *key, *key_core, *str;
+	struct kv_key        kv_key_buf1, kv_key_buf2;
+	struct kv_key       *prev_kv_key = NULL, *kv_key = &kv_key_buf1;
 	kv_vector_t         *vvalue;
 	bool                 with_comma = false;
 	int                  r          = 0;
 
-	prev_devid                      = devid_buf1;
-	devid                           = devid_buf2;
-
 	if (!(iter = sid_kvs_iter_create_prefix(ucmd_ctx->common->kvs_res, "::D:")))
 		goto out;
 
 	fmt_doc_start(format, prn_buf, 0);
 	fmt_arr_start(format, prn_buf, 1, "siddevices", false);
 
-	prev_devid[0] = 0;
-
+	/*
+	 * Keys for the same device are adjacent and the iterator keeps the key strings
+	 * valid, so compare the parsed keys directly to detect the next device.
+	 */
 	while ((data = sid_kvs_iter_next(iter, &size, &key, &kv_store_value_flags))) {
-		if (!_copy_ns_part_from_key(key, devid, sizeof(devid_buf1)))
-			continue;
+		_kv_key_parse(kv_key, key);
 
-		if (!(key_core = _get_key_part(key, KEY_PART_CORE, NULL)))
+		if (!(str = _kv_key_get_part(kv_key, KEY_PART_NS_PART, &len)) || (len >= sizeof(devid)) ||
+		    !(key_core = _kv_key_get_part(kv_key, KEY_PART_CORE, NULL)))
 			continue;
 
-		if (strcmp(prev_devid, devid)) {
-			if (prev_devid[0] != 0)
+		if (!prev_kv_key || _kv_key_cmp(prev_kv_key, kv_key, KEY_PART_NS_PART)) {
+			if (prev_kv_key)
 				fmt_elm_end(format, prn_buf, 2);
 			fmt_elm_start(format, prn_buf, 2, with_comma);
-			fmt_fld_str(format, prn_buf, 3, "DEVID", devid, false);
+			fmt_fld_str(format, prn_buf, 3, "DEVID", util_str_copy_len(str, len, devid, sizeof(devid)), false);
 		}
 
 		if (!strcmp(key_core, KV_KEY_GEN_GROUP_IN) || !strcmp(key_core, KV_KEY_GEN_GROUP_MEMBERS)) {
@@ -4754,11 +5147,12 @@ static int _cmd_exec_devices(sid_res_t *cmd_res)
 			fmt_fld_str(format, prn_buf, 3, KV_KEY_DEV_RESERVED, _sval_to_dev_reserved_str(data), with_comma);
 		}
 
-		UTIL_SWAP(devid, prev_devid);
-		with_comma = true;
+		prev_kv_key = kv_key;
+		kv_key      = kv_key == &kv_key_buf1 ? &kv_key_buf2 : &kv_key_buf1;
+		with_comma  = true;
 	}
 
-	if (prev_devid[0] != 0)
+	if (prev_kv_key)
 		fmt_elm_end(format, prn_buf, 2);
 
 	fmt_arr_end(format, prn_buf, 1);
@@ -4774,51 +5168,136 @@ out:
 	return r;
 }
 
-static int _cmd_exec_dbstats(sid_res_t *cmd_res)
+static int _cmd_exec_watch(sid_res_t *cmd_res)
 {
-	int                  r;
 	struct sid_ucmd_ctx *ucmd_ctx = sid_res_get_data(cmd_res);
-	struct sid_buf      *prn_buf  = ucmd_ctx->prn_buf;
-	struct sid_dbstats   stats;
-	char                *stats_data;
+	struct sid_buf      *gen_buf  = ucmd_ctx->common->gen_buf;
+	sid_res_t           *conn_res;
+	struct connection   *conn;
+	size_t               buf_pos;
+	char                *data;
 	size_t               size;
-	fmt_output_t         format = flags_to_format(ucmd_ctx->req_hdr.flags);
-
-	if ((r = _write_kv_store_stats(&stats, ucmd_ctx->common->kvs_res)) == 0) {
-		fmt_doc_start(format, prn_buf, 0);
+	int                  r;
 
-		fmt_fld_uint64(format, prn_buf, 1, "KEYS_SIZE", stats.key_size, false);
-		fmt_fld_uint64(format, prn_buf, 1, "VALUES_INTERNAL_SIZE", stats.value_int_size, true);
-		fmt_fld_uint64(format, prn_buf, 1, "VALUES_INTERNAL_DATA_SIZE", stats.value_int_data_size, true);
-		fmt_fld_uint64(format, prn_buf, 1, "VALUES_EXTERNAL_SIZE", stats.value_ext_size, true);
-		fmt_fld_uint64(format, prn_buf, 1, "VALUES_EXTERNAL_DATA_SIZE", stats.value_ext_data_size, true);
-		fmt_fld_uint64(format, prn_buf, 1, "METADATA_SIZE", stats.meta_size, true);
-		fmt_fld_uint(format, prn_buf, 1, "NR_KEY_VALUE_PAIRS", stats.nr_kv_pairs, true);
+	if (!(conn_res = sid_res_search(cmd_res, SID_RES_SEARCH_IMM_ANC, &sid_res_type_ubr_con, NULL))) {
+		sid_res_log_error(cmd_res, SID_INTERNAL_ERROR "%s: Connection resource missing for watch command.", __func__);
+		return -1;
+	}
+	conn = sid_res_get_data(conn_res);
 
-		fmt_doc_end(format, prn_buf, 0);
-		fmt_null_byte(prn_buf);
+	/*
+	 * Only the main process sees all the changes committed to the main KV store,
+	 * so it is the main process which holds the subscription. Pass the client
+	 * connection, together with the filter, to the main process which then sends
+	 * the reply and all subsequent change records directly to the client.
+	 *
+	 * We keep our copy of the connection until the client disconnects, the same
+	 * way we do for any other command.
+	 */
+	buf_pos = sid_buf_count(gen_buf);
+
+	if ((r = sid_buf_add(gen_buf,
+	                     &(struct internal_msg_header) {.cat    = MSG_CATEGORY_SYSTEM,
+	                                                    .header = (struct sid_ifc_msg_header) {
+								    .status = 0,
+								    .prot   = 0,
+								    .cmd    = SYSTEM_CMD_WATCH,
+								    .flags  = ucmd_ctx->req_hdr.flags,
+							    }},
+	                     INTERNAL_MSG_HEADER_SIZE,
+	                     NULL,
+	                     NULL)) < 0 ||
+	    (ucmd_ctx->watch.filter_size &&
+	     (r = sid_buf_add(gen_buf, ucmd_ctx->watch.filter_mem, ucmd_ctx->watch.filter_size, NULL, NULL)) < 0)) {
+		sid_res_log_error_errno(cmd_res, r, "Failed to prepare watch request for main process.");
+		goto fail;
+	}
 
-		sid_buf_get_data(prn_buf, (const void **) &stats_data, &size);
-		r = sid_buf_add(ucmd_ctx->res_buf, stats_data, size, NULL, NULL);
+	sid_buf_get_data_from(gen_buf, buf_pos, (const void **) &data, &size);
+
+	r = sid_wrk_ctl_chan_send(
+		cmd_res,
+		MAIN_WORKER_CHANNEL_ID,
+		&SID_WRK_DATA_SPEC(.data = data, .data_size = size, .ext.used = true, .ext.socket.fd_pass = conn->fd));
+
+	if (r < 0) {
+		sid_res_log_error_errno(cmd_res, r, "Failed to pass watch request to main process.");
+		goto fail;
 	}
-	return r;
+
+	sid_buf_rewind(gen_buf, buf_pos, SID_BUF_POS_ABS);
+
+	/* the main process replies to the client */
+	sid_buf_destroy(ucmd_ctx->res_buf);
+	ucmd_ctx->res_buf = NULL;
+
+	return 0;
+fail:
+	sid_buf_rewind(gen_buf, buf_pos, SID_BUF_POS_ABS);
+
+	/*
+	 * Reply with failure ourselves. The response header is already in res_buf,
+	 * so put it there again with the failure status. The client then does not
+	 * wait for any change records.
+	 */
+	ucmd_ctx->res_hdr.status |= SID_IFC_CMD_STATUS_FAILURE;
+
+	if ((r = sid_buf_reset(ucmd_ctx->res_buf)) < 0 ||
+	    (r = sid_buf_add(ucmd_ctx->res_buf, &ucmd_ctx->res_hdr, sizeof(ucmd_ctx->res_hdr), NULL, NULL)) < 0)
+		return r;
+
+	return 0;
 }
 
-static int _set_new_dev_kvs(sid_res_t *res, struct sid_ucmd_ctx *ucmd_ctx, bool is_sync)
+static int _cmd_exec_dbstats(sid_res_t *cmd_res)
 {
-	static const char failed_msg[] = "Failed to set %s for new device %s (%s/%s).";
-	const char       *rec_name     = NULL;
-	int               r;
+	int                  r;
+	struct sid_ucmd_ctx *ucmd_ctx = sid_res_get_data(cmd_res);
+	struct sid_buf      *prn_buf  = ucmd_ctx->prn_buf;
+	struct sid_dbstats   stats;
+	char                *stats_data;
+	size_t               size;
+	unsigned             i;
+	fmt_output_t         format = flags_to_format(ucmd_ctx->req_hdr.flags);
 
-	if ((r = _do_sid_ucmd_dev_set_ready(res, ucmd_ctx, _owner_name(NULL), SID_DEV_RDY_UNPROCESSED, is_sync)) < 0) {
-		rec_name = "ready state";
-		goto out;
-	}
+	if ((r = _write_kv_store_stats(&stats, ucmd_ctx->common->kvs_res)) == 0) {
+		fmt_doc_start(format, prn_buf, 0);
 
-	if ((r = _do_sid_ucmd_dev_set_reserved(res, ucmd_ctx, _owner_name(NULL), SID_DEV_RES_UNPROCESSED, is_sync)) < 0) {
-		rec_name = "reserved state";
-		goto out;
+		fmt_fld_uint64(format, prn_buf, 1, "KEYS_SIZE", stats.key_size, false);
+		fmt_fld_uint64(format, prn_buf, 1, "VALUES_INTERNAL_SIZE", stats.value_int_size, true);
+		fmt_fld_uint64(format, prn_buf, 1, "VALUES_INTERNAL_DATA_SIZE", stats.value_int_data_size, true);
+		fmt_fld_uint64(format, prn_buf, 1, "VALUES_EXTERNAL_SIZE", stats.value_ext_size, true);
+		fmt_fld_uint64(format, prn_buf, 1, "VALUES_EXTERNAL_DATA_SIZE", stats.value_ext_data_size, true);
+		fmt_fld_uint64(format, prn_buf, 1, "METADATA_SIZE", stats.meta_size, true);
+		fmt_fld_uint(format, prn_buf, 1, "NR_KEY_VALUE_PAIRS", stats.nr_kv_pairs, true);
+
+		fmt_arr_start(format, prn_buf, 1, "SLABS", true);
+		for (i = 0; i < stats.nr_slabs; i++) {
+			fmt_elm_start(format, prn_buf, 2, i > 0);
+			fmt_fld_str(format, prn_buf, 3, "NAME", stats.slabs[i].name, false);
+			fmt_fld_uint64(format, prn_buf, 3, "OBJECT_SIZE", stats.slabs[i].obj_size, true);
+			fmt_fld_uint64(format, prn_buf, 3, "NR_OBJECTS", stats.slabs[i].obj_count, true);
+			fmt_fld_uint64(format, prn_buf, 3, "NR_OBJECTS_LIMIT", stats.slabs[i].obj_limit, true);
+			fmt_fld_uint64(format, prn_buf, 3, "NR_PAGES", stats.slabs[i].page_count, true);
+			fmt_fld_uint64(format, prn_buf, 3, "MEMORY_SIZE", stats.slabs[i].mem_size, true);
+			fmt_elm_end(format, prn_buf, 2);
+		}
+		fmt_arr_end(format, prn_buf, 1);
+
+		fmt_doc_end(format, prn_buf, 0);
+		fmt_null_byte(prn_buf);
+
+		sid_buf_get_data(prn_buf, (const void **) &stats_data, &size);
+		r = sid_buf_add(ucmd_ctx->res_buf, stats_data, size, NULL, NULL);
 	}
+	return r;
+}
+
+static const char _failed_new_dev_kv_msg[] = "Failed to set %s for new device %s (%s/%s).";
+
+static int _set_new_dev_alias_kvs(sid_res_t *res, struct sid_ucmd_ctx *ucmd_ctx, bool is_sync, const char **rec_name)
+{
+	int r;
 
 	if ((r = _handle_devs_for_group(res,
 	                                ucmd_ctx,
@@ -4831,8 +5310,8 @@ static int _set_new_dev_kvs(sid_res_t *res, struct sid_ucmd_ctx *ucmd_ctx, bool
 	                                ucmd_ctx->req_env.dev.dsq_s,
 	                                KV_OP_PLUS,
 	                                is_sync)) < 0) {
-		rec_name = "device sequence number";
-		goto out;
+		*rec_name = "device sequence number";
+		return r;
 	}
 
 	if ((r = _handle_devs_for_group(res,
@@ -4846,8 +5325,8 @@ static int _set_new_dev_kvs(sid_res_t *res, struct sid_ucmd_ctx *ucmd_ctx, bool
 	                                ucmd_ctx->req_env.dev.num_s,
 	                                KV_OP_PLUS,
 	                                is_sync)) < 0) {
-		rec_name = "device number";
-		goto out;
+		*rec_name = "device number";
+		return r;
 	}
 
 	if ((r = _handle_devs_for_group(res,
@@ -4861,14 +5340,34 @@ static int _set_new_dev_kvs(sid_res_t *res, struct sid_ucmd_ctx *ucmd_ctx, bool
 	                                ucmd_ctx->req_env.dev.udev.name,
 	                                KV_OP_PLUS,
 	                                is_sync)) < 0) {
-		rec_name = "device name";
+		*rec_name = "device name";
+		return r;
+	}
+
+	return 0;
+}
+
+static int _set_new_dev_kvs(sid_res_t *res, struct sid_ucmd_ctx *ucmd_ctx, bool is_sync)
+{
+	const char *rec_name = NULL;
+	int         r;
+
+	if ((r = _do_sid_ucmd_dev_set_ready(res, ucmd_ctx, _owner_name(NULL), SID_DEV_RDY_UNPROCESSED, is_sync)) < 0) {
+		rec_name = "ready state";
+		goto out;
+	}
+
+	if ((r = _do_sid_ucmd_dev_set_reserved(res, ucmd_ctx, _owner_name(NULL), SID_DEV_RES_UNPROCESSED, is_sync)) < 0) {
+		rec_name = "reserved state";
 		goto out;
 	}
+
+	r = _set_new_dev_alias_kvs(res, ucmd_ctx, is_sync, &rec_name);
 out:
 	if (r < 0)
 		sid_res_log_error_errno(res,
 		                        r,
-		                        failed_msg,
+		                        _failed_new_dev_kv_msg,
 		                        rec_name,
 		                        ucmd_ctx->req_env.dev.udev.name,
 		                        ucmd_ctx->req_env.dev.num_s,
@@ -4883,64 +5382,76 @@ static const char *
 	_get_dep_dev_dseq(sid_res_t *res, struct sid_ucmd_ctx *ucmd_ctx, const char *dep_name, char *buf, size_t buf_size)
 {
 	static const char err_msg[] = "%s for %s while processing " CMD_DEV_PRINT_FMT;
-	char             *dep_path  = NULL;
-	const char       *msg, *s = NULL;
-	int               r = 0, ret = -1;
+	char              path[sizeof(SYSTEM_SYSFS_SLAVES) + NAME_MAX + sizeof("/diskseq") + 1];
+	const char       *msg;
+	int               fd, r;
 
 	if (dep_name) {
 		/* handling a whole device: dep device is under the SYSTEM_SYSFS_SLAVES directory */
-		if (asprintf(&dep_path,
-		             "%s%s/%s/%s",
-		             SYSTEM_SYSFS_PATH,
-		             ucmd_ctx->req_env.dev.udev.path,
-		             SYSTEM_SYSFS_SLAVES,
-		             dep_name) < 0) {
+		if ((size_t) snprintf(path, sizeof(path), "%s/%s/diskseq", SYSTEM_SYSFS_SLAVES, dep_name) >= sizeof(path)) {
+			r   = -ENAMETOOLONG;
 			msg = "Failed to compose underlying device's sysfs path";
-			goto out;
+			goto fail;
 		}
-
 	} else {
-		/* handling a partition device: dep device == whole device */
-		if (asprintf(&dep_path, "%s%s", SYSTEM_SYSFS_PATH, ucmd_ctx->req_env.dev.udev.path) < 0) {
-			msg = "Failed to compose partition sysfs path";
-			goto out;
-		}
-
-		/* we also set the actual dep path here by using the dirname which cuts off the partition suffix */
-		dep_name = basename(dirname(dep_path));
+		/* handling a partition device: dep device == whole device which is the parent sysfs directory */
+		strcpy(path, "../diskseq");
+		dep_name = "whole device";
 	}
 
-	if ((r = sid_buf_add_fmt(ucmd_ctx->common->gen_buf, (const void **) &s, NULL, "%s/diskseq", dep_path)) < 0) {
-		msg = "Failed to compose underlying device's sysfs 'dev' attribute path";
-		goto out;
+	if ((fd = sid_ucmd_ev_get_dev_sysfs_fd(ucmd_ctx)) < 0) {
+		r   = fd;
+		msg = "Failed to open device's sysfs directory";
+		goto fail;
 	}
 
-	if ((r = sid_util_sysfs_get(s, buf, buf_size, NULL)) < 0) {
+	if ((r = sid_util_sysfs_get_at(fd, path, buf, buf_size, NULL)) < 0) {
 		msg = "Failed to read underlying device's 'dseq' sysfs attribute";
-		goto out;
-	}
-
-	ret = 0;
-out:
-	if (s)
-		sid_buf_rewind_mem(ucmd_ctx->common->gen_buf, s);
-	free(dep_path);
-
-	if (ret < 0) {
-		if (r < 0)
-			sid_res_log_error_errno(res, r, err_msg, msg, dep_name, CMD_DEV_PRINT(ucmd_ctx));
-		else
-			sid_res_log_error(res, err_msg, msg, dep_name, CMD_DEV_PRINT(ucmd_ctx));
-
-		return NULL;
+		goto fail;
 	}
 
 	return buf;
+fail:
+	sid_res_log_error_errno(res, r, err_msg, msg, dep_name, CMD_DEV_PRINT(ucmd_ctx));
+	return NULL;
 }
 
 static const char _key_prefix_err_msg[] =
 	"Failed to compose key prefix to update device dependency records for " CMD_DEV_PRINT_FMT ".";
 
+struct sysfs_dep_arg {
+	sid_res_t           *cmd_res;
+	struct sid_ucmd_ctx *ucmd_ctx;
+	struct kv_rel_spec  *rel_spec;
+	struct sid_buf      *vec_buf;
+};
+
+static int _add_sysfs_dep(const char *dep_name, void *arg)
+{
+	struct sysfs_dep_arg *dep_arg = arg;
+	char                  buf[UTIL_UUID_STR_SIZE];
+	const char           *dep_dseq;
+	const char           *s;
+	int                   r;
+
+	if (!(dep_dseq = _get_dep_dev_dseq(dep_arg->cmd_res, dep_arg->ucmd_ctx, dep_name, buf, sizeof(buf))))
+		return 0;
+
+	dep_arg->rel_spec->rel_key_spec->id = dep_dseq;
+	s                                   = _compose_key_prefix(NULL, dep_arg->rel_spec->rel_key_spec);
+	dep_arg->rel_spec->rel_key_spec->id = ID_NULL;
+
+	if (!s)
+		return -ENOMEM;
+
+	if ((r = sid_buf_add(dep_arg->vec_buf, (void *) s, strlen(s) + 1, NULL, NULL)) < 0) {
+		_destroy_key(NULL, s);
+		return r;
+	}
+
+	return 0;
+}
+
 static int _update_disk_deps_from_sysfs(sid_res_t *cmd_res)
 {
 	/*
@@ -4948,13 +5459,12 @@ static int _update_disk_deps_from_sysfs(sid_res_t *cmd_res)
 	 */
 	struct sid_ucmd_ctx *ucmd_ctx = sid_res_get_data(cmd_res);
 	char                *s;
-	struct dirent      **dirent  = NULL;
 	struct sid_buf      *vec_buf = NULL;
 	kv_vector_t         *vvalue;
 	size_t               vsize = 0;
-	int                  count = 0, i = 0;
-	char                 buf[UTIL_UUID_STR_SIZE];
-	const char          *dep_dseq;
+	size_t               i;
+	char                 dents_buf[SYSFS_DENTS_BUF_SIZE];
+	int                  fd;
 	int                  r = -1;
 
 	struct kv_rel_spec rel_spec =
@@ -4972,48 +5482,20 @@ static int _update_disk_deps_from_sysfs(sid_res_t *cmd_res)
 	                                                 /* .id will be calculated later */
 	                                                 .core    = KV_KEY_GEN_GROUP_IN));
 
-	struct kv_update_arg update_arg =
-		KV_UPDATE_ARG(.res = ucmd_ctx->common->kvs_res, .gen_buf = ucmd_ctx->common->gen_buf, .custom = &rel_spec);
-
-	if (ucmd_ctx->req_env.dev.udev.action != UDEV_ACTION_REMOVE) {
-		if ((r = sid_buf_add_fmt(ucmd_ctx->common->gen_buf,
-		                         (const void **) &s,
-		                         NULL,
-		                         "%s%s/%s",
-		                         SYSTEM_SYSFS_PATH,
-		                         ucmd_ctx->req_env.dev.udev.path,
-		                         SYSTEM_SYSFS_SLAVES)) < 0) {
-			sid_res_log_error_errno(cmd_res,
-			                        r,
-			                        "Failed to compose sysfs %s path for device " CMD_DEV_PRINT_FMT,
-			                        SYSTEM_SYSFS_SLAVES,
-			                        CMD_DEV_PRINT(ucmd_ctx));
-			goto out;
-		}
-
-		count = scandir(s, &dirent, NULL, NULL);
-		sid_buf_rewind_mem(ucmd_ctx->common->gen_buf, s);
+	struct kv_update_arg update_arg = KV_UPDATE_ARG(.res     = ucmd_ctx->common->kvs_res,
+	                                                .gen_buf = ucmd_ctx->common->gen_buf,
+	                                                .arena   = ucmd_ctx->arena,
+	                                                .custom  = &rel_spec);
 
-		if (count < 0) {
-			/*
-			 * FIXME: Add code to deal with/warn about: (errno == ENOENT) && (ucmd_ctx->req_env.dev.udev.action
-			 * != UDEV_ACTION_REMOVE). That means we don't have REMOVE uevent, but at the same time, we don't
-			 * have sysfs content, e.g. because we're processing this uevent too late: the device has already
-			 * been removed right after this uevent was triggered. For now, error out even in this case.
-			 */
-			sid_res_log_sys_error(cmd_res, "scandir", s);
-			goto out;
-		}
-	}
+	struct sysfs_dep_arg dep_arg = {.cmd_res = cmd_res, .ucmd_ctx = ucmd_ctx, .rel_spec = &rel_spec};
 
 	/*
 	 * Create vec_buf used to set up database records.
-	 * The size of the vec_buf is:
-	 *   +VVALUE_HEADER_CNT to include record header
-	 *   -2 to subtract "." and ".." directory which we're not interested in
+	 * The buffer starts with VVALUE_HEADER_CNT items for the record header,
+	 * then each relative found in sysfs is appended.
 	 */
 	if (!(vec_buf = sid_buf_create(&SID_BUF_SPEC(.type = SID_BUF_TYPE_VECTOR),
-	                               &SID_BUF_INIT(.size = VVALUE_HEADER_CNT + (count >= 2 ? count - 2 : 0), .alloc_step = 1),
+	                               &SID_BUF_INIT(.size = VVALUE_HEADER_CNT + 1, .alloc_step = 1),
 	                               &r))) {
 		sid_res_log_error_errno(cmd_res,
 		                        r,
@@ -5031,32 +5513,37 @@ static int _update_disk_deps_from_sysfs(sid_res_t *cmd_res)
 	                    &ucmd_ctx->req_env.dev.udev.seqnum,
 	                    &value_flags_no_sync,
 	                    &ucmd_ctx->common->gennum,
-	                    core_owner);
+	                    &core_owner);
 	sid_buf_unbind_mem(vec_buf, vvalue);
+	dep_arg.vec_buf = vec_buf;
 
 	/* Read relatives from sysfs into vec_buf. */
 	if (ucmd_ctx->req_env.dev.udev.action != UDEV_ACTION_REMOVE) {
-		for (i = 0; i < count; i++) {
-			if (dirent[i]->d_name[0] == '.')
-				goto next;
-
-			if (!(dep_dseq = _get_dep_dev_dseq(cmd_res, ucmd_ctx, dirent[i]->d_name, buf, sizeof(buf))))
-				goto next;
-
-			rel_spec.rel_key_spec->id = dep_dseq;
-
-			s                         = _compose_key_prefix(NULL, rel_spec.rel_key_spec);
-			if (!s || ((r = sid_buf_add(vec_buf, (void *) s, strlen(s) + 1, NULL, NULL)) < 0)) {
-				_destroy_key(NULL, s);
-				goto out;
-			}
-next:
-			free(dirent[i]);
+		if ((fd = sid_ucmd_ev_get_dev_sysfs_fd(ucmd_ctx)) < 0)
+			r = fd;
+		else
+			r = sid_util_sysfs_dir_iter_at(fd,
+			                               SYSTEM_SYSFS_SLAVES,
+			                               dents_buf,
+			                               sizeof(dents_buf),
+			                               _add_sysfs_dep,
+			                               &dep_arg);
+
+		if (r < 0) {
+			/*
+			 * FIXME: Add code to deal with/warn about: (errno == ENOENT) && (ucmd_ctx->req_env.dev.udev.action
+			 * != UDEV_ACTION_REMOVE). That means we don't have REMOVE uevent, but at the same time, we don't
+			 * have sysfs content, e.g. because we're processing this uevent too late: the device has already
+			 * been removed right after this uevent was triggered. For now, error out even in this case.
+			 */
+			sid_res_log_error_errno(cmd_res,
+			                        r,
+			                        "Failed to read sysfs %s directory for device " CMD_DEV_PRINT_FMT,
+			                        SYSTEM_SYSFS_SLAVES,
+			                        CMD_DEV_PRINT(ucmd_ctx));
+			vsize = 0;
+			goto out;
 		}
-
-		free(dirent);
-		dirent                    = NULL;
-		rel_spec.rel_key_spec->id = ID_NULL;
 	}
 
 	/* Get the actual vector with relatives and sort it. */
@@ -5073,15 +5560,11 @@ next:
 	}
 
 	_kv_delta_set(s, vvalue, vsize, &update_arg);
+	_dev_graph_destroy(ucmd_ctx);
 
 	_destroy_key(NULL, s);
 	r = 0;
 out:
-	if (dirent) {
-		for (; i < count; i++)
-			free(dirent[i]);
-		free(dirent);
-	}
 	if (vec_buf) {
 		if (!vsize)
 			sid_buf_get_data(vec_buf, (const void **) (&vvalue), &vsize);
@@ -5120,8 +5603,10 @@ static int _update_part_deps_from_sysfs(sid_res_t *cmd_res)
 	                                                 /* .id will be calculated later */
 	                                                 .core    = KV_KEY_GEN_GROUP_IN));
 
-	struct kv_update_arg update_arg =
-		KV_UPDATE_ARG(.res = ucmd_ctx->common->kvs_res, .gen_buf = ucmd_ctx->common->gen_buf, .custom = &rel_spec);
+	struct kv_update_arg update_arg = KV_UPDATE_ARG(.res     = ucmd_ctx->common->kvs_res,
+	                                                .gen_buf = ucmd_ctx->common->gen_buf,
+	                                                .arena   = ucmd_ctx->arena,
+	                                                .custom  = &rel_spec);
 
 	count = (ucmd_ctx->req_env.dev.udev.action == UDEV_ACTION_REMOVE) ? VVALUE_HEADER_CNT : VVALUE_SINGLE_CNT;
 	_vvalue_header_prep(vvalue,
@@ -5129,7 +5614,7 @@ static int _update_part_deps_from_sysfs(sid_res_t *cmd_res)
 	                    &ucmd_ctx->req_env.dev.udev.seqnum,
 	                    &value_flags_no_sync,
 	                    &ucmd_ctx->common->gennum,
-	                    core_owner);
+	                    &core_owner);
 
 	if (ucmd_ctx->req_env.dev.udev.action != UDEV_ACTION_REMOVE) {
 		if (!(dep_dseq = _get_dep_dev_dseq(cmd_res, ucmd_ctx, NULL, buf, sizeof(buf))))
@@ -5160,6 +5645,7 @@ static int _update_part_deps_from_sysfs(sid_res_t *cmd_res)
 	 * record.
 	 */
 	_kv_delta_set(key, vvalue, count, &update_arg);
+	_dev_graph_destroy(ucmd_ctx);
 
 	r = 0;
 out:
@@ -5188,31 +5674,86 @@ static int _update_dev_deps_from_sysfs(sid_res_t *cmd_res)
 	return 0;
 }
 
-static int _exec_block_mods(sid_res_t *cmd_res, bool reverse)
+static bool _is_scan_cached(struct sid_ucmd_ctx *ucmd_ctx, const bool *scan_cacheable)
 {
-	struct sid_ucmd_ctx       *ucmd_ctx = sid_res_get_data(cmd_res);
-	sid_res_t                 *block_mod_res;
-	const struct scan_mod_fns *block_mod_fns;
-	sid_ucmd_fn_t             *block_mod_fn;
+	/* stage A results of cacheable modules were already replayed from the scan cache */
+	return ucmd_ctx->scan.cache_hit && ucmd_ctx->scan.phase <= CMD_SCAN_PHASE_A_EXIT && scan_cacheable && *scan_cacheable;
+}
 
-	sid_res_iter_reset(ucmd_ctx->scan.block_mod_iter);
+static void _destroy_mod_disp(struct mod_disp_tbl *disp)
+{
+	unsigned phase;
 
-	while (true) {
-		if (!(block_mod_res = reverse ? sid_res_iter_previous(ucmd_ctx->scan.block_mod_iter)
-		                              : sid_res_iter_next(ucmd_ctx->scan.block_mod_iter)))
-			break;
+	if (!disp)
+		return;
 
-		if (sid_mod_reg_get_mod_syms(block_mod_res, (const void ***) &block_mod_fns) < 0) {
-			sid_res_log_error(cmd_res, "Failed to retrieve module symbols from module %s.", ID(block_mod_res));
-			return -1;
-		}
+	for (phase = 0; phase < CMD_SCAN_PHASE_COUNT; phase++)
+		free(disp[phase].entries);
 
-		if ((block_mod_fn = *(((sid_ucmd_fn_t **) block_mod_fns) + ucmd_ctx->scan.phase))) {
-			if (block_mod_fn(block_mod_res, ucmd_ctx) < 0)
-				return -1;
+	free(disp);
+}
+
+static struct mod_disp_tbl *_create_mod_disp(sid_res_t *mod_reg_res)
+{
+	struct mod_disp_tbl       *disp;
+	sid_res_iter_t            *iter = NULL;
+	sid_res_t                 *mod_res;
+	const struct scan_mod_fns *mod_fns;
+	sid_ucmd_fn_t             *fn;
+	unsigned                   mod_count = 0, phase;
+
+	if (!(disp = mem_zalloc(CMD_SCAN_PHASE_COUNT * sizeof(*disp))) || !(iter = sid_res_iter_create(mod_reg_res)))
+		goto fail;
+
+	while (sid_res_iter_next(iter))
+		mod_count++;
+
+	for (phase = 0; phase < CMD_SCAN_PHASE_COUNT; phase++) {
+		if (mod_count && !(disp[phase].entries = malloc(mod_count * sizeof(struct mod_disp_entry))))
+			goto fail;
+
+		sid_res_iter_reset(iter);
+
+		while ((mod_res = sid_res_iter_next(iter))) {
+			if (sid_mod_reg_get_mod_syms(mod_res, (const void ***) &mod_fns) < 0) {
+				sid_res_log_error(mod_reg_res, "Failed to retrieve module symbols from module %s.", ID(mod_res));
+				goto fail;
+			}
+
+			if (!(fn = *(((sid_ucmd_fn_t **) mod_fns) + phase)))
+				continue;
+
+			disp[phase].entries[disp[phase].count++] =
+				(struct mod_disp_entry) {.mod_res = mod_res, .fn = fn, .scan_cacheable = mod_fns->scan_cacheable};
 		}
 	}
 
+	sid_res_iter_destroy(iter);
+	return disp;
+fail:
+	if (iter)
+		sid_res_iter_destroy(iter);
+	_destroy_mod_disp(disp);
+	return NULL;
+}
+
+static int _exec_block_mods(sid_res_t *cmd_res, bool reverse)
+{
+	struct sid_ucmd_ctx         *ucmd_ctx = sid_res_get_data(cmd_res);
+	const struct mod_disp_tbl   *tbl      = &ucmd_ctx->common->block_mod_disp[ucmd_ctx->scan.phase];
+	const struct mod_disp_entry *entry;
+	unsigned                     i;
+
+	for (i = 0; i < tbl->count; i++) {
+		entry = &tbl->entries[reverse ? tbl->count - 1 - i : i];
+
+		if (_is_scan_cached(ucmd_ctx, entry->scan_cacheable))
+			continue;
+
+		if (entry->fn(entry->mod_res, ucmd_ctx) < 0)
+			return -1;
+	}
+
 	return 0;
 }
 
@@ -5230,6 +5771,9 @@ static int _exec_type_mod(sid_res_t *cmd_res, sid_res_t *type_mod_res)
 		return -1;
 	}
 
+	if (_is_scan_cached(ucmd_ctx, type_mod_fns->scan_cacheable))
+		return 0;
+
 	if ((type_mod_fn = *(((sid_ucmd_fn_t **) type_mod_fns) + ucmd_ctx->scan.phase))) {
 		if (type_mod_fn(type_mod_res, ucmd_ctx) < 0)
 			return -1;
@@ -5381,53 +5925,330 @@ static const char *_get_base_mod_name(sid_res_t *cmd_res, char *buf, size_t buf_
 	return mod_name;
 }
 
-static int _common_scan_init(sid_res_t *cmd_res)
+static uint64_t _hash_fnv1a(uint64_t hash, const unsigned char *data, size_t size)
 {
-	char                 buf[80];
-	struct sid_ucmd_ctx *ucmd_ctx = sid_res_get_data(cmd_res);
-	const char          *mod_name;
+	size_t i;
 
-	if (!(ucmd_ctx->scan.block_mod_iter = sid_res_iter_create(ucmd_ctx->common->block_mod_reg_res))) {
-		sid_res_log_error(cmd_res, "Failed to create block module iterator.");
-		goto fail;
+	for (i = 0; i < size; i++) {
+		hash ^= data[i];
+		hash *= UINT64_C(0x100000001b3);
 	}
 
-	if (_set_dev_kvs(cmd_res) < 0)
-		goto fail;
-
-	if (!(mod_name = _get_base_mod_name(cmd_res, buf, sizeof(buf))))
-		goto fail;
+	return hash;
+}
 
-	if (ucmd_ctx->req_env.dev.udev.action != UDEV_ACTION_REMOVE) {
-		if (_update_dev_deps_from_sysfs(cmd_res) < 0)
-			goto fail;
-	}
+static int _hash_dev_area(int fd, off_t offset, off_t len, uint64_t *hash)
+{
+	unsigned char data[SCAN_CACHE_FPR_CHUNK];
+	ssize_t       n;
 
-	_exec_block_mods(cmd_res, false);
+	while (len > 0) {
+		if ((n = pread(fd, data, len < (off_t) sizeof(data) ? (size_t) len : sizeof(data), offset)) < 0) {
+			if (errno == EINTR)
+				continue;
+			return -errno;
+		}
 
-	if (!(ucmd_ctx->scan.type_mod_res_current = sid_mod_reg_get_mod(ucmd_ctx->common->type_mod_reg_res, mod_name)))
-		sid_res_log_debug(cmd_res, "Module %s not loaded.", mod_name);
+		if (n == 0)
+			break;
 
-	return _exec_type_mod(cmd_res, ucmd_ctx->scan.type_mod_res_current);
-fail:
-	if (ucmd_ctx->scan.block_mod_iter) {
-		sid_res_iter_destroy(ucmd_ctx->scan.block_mod_iter);
-		ucmd_ctx->scan.block_mod_iter = NULL;
+		*hash   = _hash_fnv1a(*hash, data, n);
+		offset += n;
+		len    -= n;
 	}
 
-	return -1;
+	return 0;
 }
 
-static int _cmd_exec_scan_a_init(sid_res_t *cmd_res)
+/*
+ * The fingerprint covers the areas at the start and at the end of the device
+ * where cacheable modules look for signatures. For blkid, that's the same
+ * area it prefetches before probing (e.g. btrfs superblock at 64 KiB, ISO9660
+ * at 32 KiB, MD 1.2 at 4 KiB, ZFS labels in the first and last 512 KiB).
+ */
+static int _get_fingerprint(int fd, uint64_t diskseq, char *fpr, size_t fpr_size)
 {
-	return _common_scan_init(cmd_res);
-}
+	uint64_t hash = UINT64_C(0xcbf29ce484222325);
+	off_t    size, tail;
+	int      r;
 
-static int _cmd_exec_scan_a_pre(sid_res_t *cmd_res)
-{
-	struct sid_ucmd_ctx *ucmd_ctx = sid_res_get_data(cmd_res);
+	if ((size = lseek(fd, 0, SEEK_END)) < 0)
+		return -errno;
 
-	_exec_block_mods(cmd_res, false);
+	if ((r = _hash_dev_area(fd, 0, size < SCAN_CACHE_FPR_SPAN ? size : SCAN_CACHE_FPR_SPAN, &hash)) < 0)
+		return r;
+
+	if (size > SCAN_CACHE_FPR_SPAN) {
+		tail = size - SCAN_CACHE_FPR_SPAN > SCAN_CACHE_FPR_SPAN ? size - SCAN_CACHE_FPR_SPAN : SCAN_CACHE_FPR_SPAN;
+
+		if ((r = _hash_dev_area(fd, tail, size - tail, &hash)) < 0)
+			return r;
+	}
+
+	snprintf(fpr, fpr_size, "%" PRIu64 ":%" PRIu64 ":%016" PRIx64, diskseq, (uint64_t) size, hash);
+	return 0;
+}
+
+static void _set_dev_fingerprint(sid_res_t *cmd_res)
+{
+	struct sid_ucmd_ctx *ucmd_ctx = sid_res_get_data(cmd_res);
+	char                 dev_path[PATH_MAX];
+	int                  fd, r;
+
+	UTIL_STR_END_PUT(ucmd_ctx->scan.fpr);
+
+	/* without diskseq, we can't tell whether the media changed in the meantime */
+	if (!ucmd_ctx->req_env.dev.udev.diskseq)
+		return;
+
+	snprintf(dev_path, sizeof(dev_path), SYSTEM_DEV_PATH "/%s", ucmd_ctx->req_env.dev.udev.name);
+
+	if ((fd = open(dev_path, O_RDONLY | O_CLOEXEC | O_NONBLOCK)) < 0) {
+		sid_res_log_debug(cmd_res,
+		                  "Failed to open device %s to compute scan cache fingerprint: %s.",
+		                  dev_path,
+		                  strerror(errno));
+		return;
+	}
+
+	if ((r = _get_fingerprint(fd, ucmd_ctx->req_env.dev.udev.diskseq, ucmd_ctx->scan.fpr, sizeof(ucmd_ctx->scan.fpr))) < 0) {
+		UTIL_STR_END_PUT(ucmd_ctx->scan.fpr);
+		sid_res_log_debug(cmd_res,
+		                  "Failed to read device %s to compute scan cache fingerprint: %s.",
+		                  dev_path,
+		                  strerror(-r));
+	}
+
+	close(fd);
+}
+
+static bool _is_mod_scan_cacheable(sid_res_t *mod_res)
+{
+	const struct scan_mod_fns *mod_fns;
+
+	if (sid_mod_reg_get_mod_syms(mod_res, (const void ***) &mod_fns) < 0)
+		return false;
+
+	return mod_fns->scan_cacheable && *mod_fns->scan_cacheable;
+}
+
+static bool _has_scan_cacheable_mods(struct sid_ucmd_ctx *ucmd_ctx)
+{
+	sid_res_t *mod_res;
+
+	sid_res_iter_reset(ucmd_ctx->scan.block_mod_iter);
+
+	while ((mod_res = sid_res_iter_next(ucmd_ctx->scan.block_mod_iter))) {
+		if (_is_mod_scan_cacheable(mod_res))
+			return true;
+	}
+
+	return ucmd_ctx->scan.type_mod_res_current && _is_mod_scan_cacheable(ucmd_ctx->scan.type_mod_res_current);
+}
+
+static bool _is_scan_cacheable_owner(struct sid_ucmd_ctx *ucmd_ctx, const char *owner)
+{
+	sid_res_t *mod_res;
+
+	sid_res_iter_reset(ucmd_ctx->scan.block_mod_iter);
+
+	while ((mod_res = sid_res_iter_next(ucmd_ctx->scan.block_mod_iter))) {
+		if (!strcmp(owner, _owner_name(mod_res)))
+			goto found;
+	}
+
+	if ((mod_res = ucmd_ctx->scan.type_mod_res_current) && !strcmp(owner, _owner_name(mod_res)))
+		goto found;
+
+	if ((mod_res = ucmd_ctx->scan.type_mod_res_next) && !strcmp(owner, _owner_name(mod_res)))
+		goto found;
+
+	return false;
+found:
+	return _is_mod_scan_cacheable(mod_res);
+}
+
+/*
+ * The scan cache is stored as a device core record with a sequence of strings:
+ *
+ *   <fingerprint>\0[<owner>\0<flags>\0<key>\0<value>\0]...
+ *
+ * Each owner/flags/key/value quadruple describes one SID_KV_NS_UDEV record set
+ * by a cacheable module during stage A.
+ */
+static int _replay_scan_cache(sid_res_t *cmd_res)
+{
+	struct sid_ucmd_ctx *ucmd_ctx = sid_res_get_data(cmd_res);
+	const char          *cache, *end, *owner, *flags, *key, *value;
+	size_t               cache_size;
+	int                  r;
+
+	if (!(cache = _do_sid_ucmd_get_kv(
+		      cmd_res,
+		      ucmd_ctx,
+		      _owner_name(NULL),
+		      NULL,
+		      &((struct sid_ucmd_kv_get_args) {.ns = SID_KV_NS_DEV, .key = KV_KEY_DEV_SCAN_CACHE, .sz = &cache_size}))))
+		return 0;
+
+	end = cache + cache_size;
+
+	if (cache_size == 0 || end[-1] != '\0' || strcmp(cache, ucmd_ctx->scan.fpr))
+		return 0;
+
+	for (owner = cache + strlen(cache) + 1; owner < end; owner = value + strlen(value) + 1) {
+		if ((flags = owner + strlen(owner) + 1) >= end || (key = flags + strlen(flags) + 1) >= end ||
+		    (value = key + strlen(key) + 1) >= end) {
+			sid_res_log_error(cmd_res,
+			                  "Incomplete scan cache record for device " CMD_DEV_PRINT_FMT ".",
+			                  CMD_DEV_PRINT(ucmd_ctx));
+			return -EBADMSG;
+		}
+
+		if ((r = _do_sid_ucmd_kv_set(cmd_res,
+		                             ucmd_ctx,
+		                             owner,
+		                             NULL,
+		                             &KV_SET_ARGS(.ns  = SID_KV_NS_UDEV,
+		                                          .key = key,
+		                                          .val = value,
+		                                          .fl  = strtoull(flags, NULL, 16)))) < 0) {
+			sid_res_log_error_errno(cmd_res, r, "Failed to replay scan cache record %s from module %s", key, owner);
+			return r;
+		}
+	}
+
+	sid_res_log_debug(cmd_res, "Replayed scan cache for device " CMD_DEV_PRINT_FMT ".", CMD_DEV_PRINT(ucmd_ctx));
+	ucmd_ctx->scan.cache_hit = true;
+
+	return 0;
+}
+
+static int _store_scan_cache(sid_res_t *cmd_res)
+{
+	struct sid_ucmd_ctx *ucmd_ctx  = sid_res_get_data(cmd_res);
+	struct sid_buf      *cache_buf = NULL;
+	sid_kvs_iter_t      *iter      = NULL;
+	char                *prefix    = NULL;
+	const void          *cache     = SID_UCMD_KV_UNSET;
+	size_t               cache_size = 0;
+	const char          *key, *value;
+	kv_scalar_t         *svalue;
+	size_t               size, value_size;
+	sid_kvs_val_fl_t     kvs_flags;
+	int                  r = -ENOMEM;
+
+	if (!(cache_buf = sid_buf_create(&SID_BUF_SPEC(), &SID_BUF_INIT(.size = 256, .alloc_step = 256), &r)) ||
+	    ((r = sid_buf_add_fmt(cache_buf, NULL, NULL, "%s", ucmd_ctx->scan.fpr)) < 0))
+		goto out;
+
+	if (!(prefix = _compose_key_prefix(
+		      NULL,
+		      &KV_KEY_SPEC(.ns = SID_KV_NS_UDEV, .ns_part = _get_ns_part(ucmd_ctx, _owner_name(NULL), SID_KV_NS_UDEV)))) ||
+	    !(iter = sid_kvs_iter_create_prefix(ucmd_ctx->common->kvs_res, prefix))) {
+		r = -ENOMEM;
+		goto out;
+	}
+
+	while ((svalue = sid_kvs_iter_next(iter, &size, &key, &kvs_flags))) {
+		if ((kvs_flags & SID_KVS_VAL_FL_VECTOR) || !_is_scan_cacheable_owner(ucmd_ctx, _get_owner_str(svalue->owner)))
+			continue;
+
+		value      = svalue->data + _svalue_ext_data_offset(svalue);
+		value_size = size - SVALUE_HEADER_SIZE - _svalue_ext_data_offset(svalue);
+
+		/*
+		 * Only plain string values can be replayed. If there's anything else,
+		 * including unset records, do not cache the results for this device.
+		 */
+		if (!value_size || value[value_size - 1] != '\0' || strlen(value) + 1 != value_size) {
+			sid_res_log_debug(cmd_res, "Not caching scan results: record %s can not be cached.", key);
+			goto store;
+		}
+
+		if (((r = sid_buf_add_fmt(cache_buf, NULL, NULL, "%s", _get_owner_str(svalue->owner))) < 0) ||
+		    ((r = sid_buf_add_fmt(cache_buf, NULL, NULL, "%" PRIx64, svalue->flags)) < 0) ||
+		    ((r = sid_buf_add_fmt(cache_buf, NULL, NULL, "%s", _get_key_part(key, KEY_PART_CORE, NULL))) < 0) ||
+		    ((r = sid_buf_add(cache_buf, value, value_size, NULL, NULL)) < 0))
+			goto out;
+	}
+
+	if ((r = sid_buf_get_data(cache_buf, &cache, &cache_size)) < 0)
+		goto out;
+store:
+	sid_kvs_iter_destroy(iter);
+	iter = NULL;
+
+	if ((r = _do_sid_ucmd_kv_set(cmd_res,
+	                             ucmd_ctx,
+	                             _owner_name(NULL),
+	                             NULL,
+	                             &KV_SET_ARGS(.ns  = SID_KV_NS_DEV,
+	                                          .key = KV_KEY_DEV_SCAN_CACHE,
+	                                          .val = cache,
+	                                          .sz  = cache_size,
+	                                          .fl  = DEFAULT_VALUE_FLAGS_CORE))) < 0)
+		sid_res_log_error_errno(cmd_res,
+		                        r,
+		                        "Failed to store scan cache for device " CMD_DEV_PRINT_FMT,
+		                        CMD_DEV_PRINT(ucmd_ctx));
+out:
+	if (iter)
+		sid_kvs_iter_destroy(iter);
+	free(prefix);
+	if (cache_buf)
+		sid_buf_destroy(cache_buf);
+
+	return r;
+}
+
+static int _common_scan_init(sid_res_t *cmd_res)
+{
+	char                 buf[80];
+	struct sid_ucmd_ctx *ucmd_ctx = sid_res_get_data(cmd_res);
+	const char          *mod_name;
+
+	if (!(ucmd_ctx->scan.block_mod_iter = sid_res_iter_create(ucmd_ctx->common->block_mod_reg_res))) {
+		sid_res_log_error(cmd_res, "Failed to create block module iterator.");
+		goto fail;
+	}
+
+	if (_set_dev_kvs(cmd_res) < 0)
+		goto fail;
+
+	if (!(mod_name = _get_base_mod_name(cmd_res, buf, sizeof(buf))))
+		goto fail;
+
+	if (ucmd_ctx->req_env.dev.udev.action != UDEV_ACTION_REMOVE) {
+		if (_update_dev_deps_from_sysfs(cmd_res) < 0)
+			goto fail;
+	}
+
+	_exec_block_mods(cmd_res, false);
+
+	if (!(ucmd_ctx->scan.type_mod_res_current = sid_mod_reg_get_mod(ucmd_ctx->common->type_mod_reg_res, mod_name)))
+		sid_res_log_debug(cmd_res, "Module %s not loaded.", mod_name);
+
+	return _exec_type_mod(cmd_res, ucmd_ctx->scan.type_mod_res_current);
+fail:
+	if (ucmd_ctx->scan.block_mod_iter) {
+		sid_res_iter_destroy(ucmd_ctx->scan.block_mod_iter);
+		ucmd_ctx->scan.block_mod_iter = NULL;
+	}
+
+	return -1;
+}
+
+static int _cmd_exec_scan_a_init(sid_res_t *cmd_res)
+{
+	return _common_scan_init(cmd_res);
+}
+
+static int _cmd_exec_scan_a_pre(sid_res_t *cmd_res)
+{
+	struct sid_ucmd_ctx *ucmd_ctx = sid_res_get_data(cmd_res);
+
+	_exec_block_mods(cmd_res, false);
 	return _exec_type_mod(cmd_res, ucmd_ctx->scan.type_mod_res_current);
 }
 
@@ -5465,6 +6286,19 @@ static int _cmd_exec_scan_a_next(sid_res_t *cmd_res)
 	if (!UTIL_IN_SET(ready, SID_DEV_RDY_PUBLIC))
 		return 1;
 
+	/*
+	 * Reading the device to compute the fingerprint is only safe once we know the
+	 * device is ready and it is only worth it if there's a module using the cache.
+	 * Cacheable modules only read the device from this phase on too.
+	 */
+	if (_has_scan_cacheable_mods(ucmd_ctx)) {
+		_set_dev_fingerprint(cmd_res);
+
+		if (ucmd_ctx->req_env.dev.udev.action == UDEV_ACTION_CHANGE && !UTIL_STR_END(ucmd_ctx->scan.fpr) &&
+		    _replay_scan_cache(cmd_res) < 0)
+			return -1;
+	}
+
 	_exec_block_mods(cmd_res, false);
 
 	if ((next_mod_name = _do_sid_ucmd_get_kv(
@@ -5521,6 +6355,11 @@ static int _cmd_exec_scan_a_exit(sid_res_t *cmd_res)
 		if (_do_sid_ucmd_dev_set_reserved(cmd_res, ucmd_ctx, _owner_name(NULL), SID_DEV_RES_FREE, false) < 0)
 			r = -1;
 
+	/* only public devices went through all stage A phases so the results are complete */
+	if (r == 0 && !ucmd_ctx->scan.cache_hit && !UTIL_STR_END(ucmd_ctx->scan.fpr) &&
+	    _do_sid_ucmd_dev_get_ready(cmd_res, ucmd_ctx, _owner_name(NULL), 0) == SID_DEV_RDY_PUBLIC)
+		(void) _store_scan_cache(cmd_res);
+
 	return r;
 }
 
@@ -5743,6 +6582,7 @@ static struct cmd_reg _client_cmd_regs[] = {
 	[SID_IFC_CMD_DBSTATS]    = {.name = "c-dbstats", .flags = 0, .exec = _cmd_exec_dbstats},
 	[SID_IFC_CMD_RESOURCES]  = {.name = "c-resource", .flags = 0, .exec = _cmd_exec_resources},
 	[SID_IFC_CMD_DEVICES]    = {.name = "c-devices", .flags = 0, .exec = _cmd_exec_devices},
+	[SID_IFC_CMD_WATCH]      = {.name = "c-watch", .flags = 0, .exec = _cmd_exec_watch},
 };
 
 static struct cmd_reg _self_cmd_regs[] = {
@@ -6246,6 +7086,206 @@ static int _destroy_connection(sid_res_t *res)
 	return 0;
 }
 
+static sid_kv_ns_t _ns_str_to_ns(const char *str)
+{
+	static const char *ns_names[] = {[SID_KV_NS_UNDEFINED] = NULL,
+	                                 [SID_KV_NS_UDEV]      = "udev",
+	                                 [SID_KV_NS_DEV]       = "dev",
+	                                 [SID_KV_NS_MOD]       = "mod",
+	                                 [SID_KV_NS_DEVMOD]    = "devmod",
+	                                 [SID_KV_NS_GLOB]      = "glob"};
+	sid_kv_ns_t        ns;
+
+	for (ns = SID_KV_NS_UDEV; ns <= SID_KV_NS_GLOB; ns++) {
+		if (!strcasecmp(str, ns_names[ns]) || !strcmp(str, ns_to_key_prefix_map[ns]))
+			return ns;
+	}
+
+	return SID_KV_NS_UNDEFINED;
+}
+
+static int _devid_to_devno(struct sid_ucmd_ctx *ucmd_ctx, const char *devid, char *buf, size_t buf_size)
+{
+	const char           *prefix, *key = NULL;
+	kv_vector_t          *vvalue;
+	size_t                vvalue_size;
+	char                **key_strv;
+	size_t                count;
+	struct mem_arena_mark mark = mem_arena_get_mark(ucmd_ctx->arena);
+	int                   r;
+
+	if (!(prefix = _compose_key_prefix(NULL, &KV_KEY_SPEC(.ns = SID_KV_NS_DEV, .ns_part = devid))))
+		return -ENOMEM;
+
+	if (!(key = _cat_prefix_and_key(ucmd_ctx->common->gen_buf, prefix, KV_KEY_GEN_GROUP_IN))) {
+		r = -ENOMEM;
+		goto out;
+	}
+
+	if (!(vvalue = sid_kvs_va_get(ucmd_ctx->common->kvs_res, .key = key, .size = &vvalue_size))) {
+		r = -ENODATA;
+		goto out;
+	}
+
+	vvalue      += VVALUE_HEADER_CNT;
+	vvalue_size -= VVALUE_HEADER_CNT;
+
+	key_strv     = _get_key_strv_from_vvalue(
+                ucmd_ctx->arena,
+                vvalue,
+                vvalue_size,
+                &KV_KEY_SPEC(.dom = KV_KEY_DOM_ALIAS, .ns = SID_KV_NS_MOD, .ns_part = _owner_name(NULL), .id_cat = DEV_ALIAS_DEVNO),
+                &count,
+                &r);
+
+	if (count != 1) {
+		r = -EMLINK;
+		goto out;
+	}
+
+	if (!_copy_id_from_key(key_strv[0], buf, buf_size)) {
+		r = -ENOBUFS;
+		goto out;
+	}
+
+	r = 0;
+out:
+	mem_arena_release(ucmd_ctx->arena, mark);
+	_destroy_key(ucmd_ctx->common->gen_buf, key);
+	_destroy_key(NULL, prefix);
+	return r;
+}
+
+static int _resolve_dump_filter_dev(sid_res_t *res, struct sid_ucmd_ctx *ucmd_ctx, struct kv_dump_filter *filter)
+{
+	unsigned    major, minor;
+	const char *alias_key;
+	int         n = 0, r;
+
+	/*
+	 * We accept these forms of device identification:
+	 *   - device ID (UUID)
+	 *   - device alias key
+	 *   - device number in "major:minor" or "major_minor" format
+	 *   - device name
+	 */
+	if (util_uuid_check_str(filter->dev) || _key_is_alias(filter->dev)) {
+		if (!(filter->devid = _get_devid(ucmd_ctx, filter->dev, filter->devid_buf, sizeof(filter->devid_buf), &r)))
+			goto out;
+	} else {
+		if ((sscanf(filter->dev, "%u%*1[:_]%u%n", &major, &minor, &n) == 2) && !filter->dev[n]) {
+			snprintf(filter->devno_buf, sizeof(filter->devno_buf), "%u_%u", major, minor);
+			filter->devno = filter->devno_buf;
+			alias_key     = _compose_key_prefix(NULL,
+                                                        &KV_KEY_SPEC(.dom     = KV_KEY_DOM_ALIAS,
+			                                             .ns      = SID_KV_NS_MOD,
+			                                             .ns_part = _owner_name(NULL),
+			                                             .id_cat  = DEV_ALIAS_DEVNO,
+			                                             .id      = filter->devno));
+		} else
+			alias_key = _compose_key_prefix(NULL,
+			                                &KV_KEY_SPEC(.dom     = KV_KEY_DOM_ALIAS,
+			                                             .ns      = SID_KV_NS_MOD,
+			                                             .ns_part = _owner_name(NULL),
+			                                             .id_cat  = DEV_ALIAS_NAME,
+			                                             .id      = filter->dev));
+		if (!alias_key) {
+			r = -ENOMEM;
+			goto out;
+		}
+
+		filter->devid = _get_devid(ucmd_ctx, alias_key, filter->devid_buf, sizeof(filter->devid_buf), &r);
+		_destroy_key(NULL, alias_key);
+
+		if (!filter->devid)
+			goto out;
+	}
+
+	/* the device number is part of the keys in KV_NS_UDEV so we need it too */
+	if (!filter->devno &&
+	    _devid_to_devno(ucmd_ctx, filter->devid, filter->devno_buf, sizeof(filter->devno_buf)) == 0)
+		filter->devno = filter->devno_buf;
+
+	r = 0;
+out:
+	if (!filter->devid) {
+		if (!r)
+			r = -ENODEV;
+		sid_res_log_error_errno(res, r, "Failed to resolve device %s for KV dump filter", filter->dev);
+	}
+
+	return r;
+}
+
+static int _parse_cmd_dbdump_filter(sid_res_t *res, struct sid_ucmd_ctx *ucmd_ctx, const char *data, size_t data_size)
+{
+	struct kv_dump_filter *filter = &ucmd_ctx->dbdump.filter;
+	char                  *p, *end, *next, *value, *value_end;
+	unsigned long long     flags;
+
+	if (!data_size)
+		return 0;
+
+	if (!(ucmd_ctx->dbdump.filter_mem = malloc(data_size + 1)))
+		return -ENOMEM;
+
+	memcpy(ucmd_ctx->dbdump.filter_mem, data, data_size);
+	ucmd_ctx->dbdump.filter_mem[data_size] = '\0';
+
+	/*
+	 * We have this on input:
+	 *
+	 *   key1=value1\0key2=value2\0...
+	 *
+	 * All filter strings point directly to our copy of the input.
+	 */
+	for (p = ucmd_ctx->dbdump.filter_mem, end = p + data_size; p < end; p = next) {
+		next = p + strlen(p) + 1;
+
+		if (!(value = strchr(p, KV_PAIR_C[0])) || !value[1]) {
+			sid_res_log_error(res, "Malformed KV dump filter %s.", p);
+			return -EINVAL;
+		}
+
+		*value++ = '\0';
+
+		if (!strcmp(p, SID_IFC_DBDUMP_KEY_NS)) {
+			if ((filter->ns = _ns_str_to_ns(value)) == SID_KV_NS_UNDEFINED) {
+				sid_res_log_error(res, "Unknown namespace %s in KV dump filter.", value);
+				return -EINVAL;
+			}
+		} else if (!strcmp(p, SID_IFC_DBDUMP_KEY_MOD))
+			filter->mod = value;
+		else if (!strcmp(p, SID_IFC_DBDUMP_KEY_DEV))
+			filter->dev = value;
+		else if (!strcmp(p, SID_IFC_DBDUMP_KEY_PREFIX))
+			filter->prefix = value;
+		else if (!strcmp(p, SID_IFC_DBDUMP_KEY_FLAGS)) {
+			errno = 0;
+			flags = strtoull(value, &value_end, 0);
+			if (errno || *value_end) {
+				sid_res_log_error(res, "Incorrect flags %s in KV dump filter.", value);
+				return -EINVAL;
+			}
+			filter->flags = flags;
+		} else {
+			sid_res_log_error(res, "Unknown KV dump filter %s.", p);
+			return -EINVAL;
+		}
+	}
+
+	if (filter->dev) {
+		if ((filter->ns == SID_KV_NS_MOD) || (filter->ns == SID_KV_NS_GLOB)) {
+			sid_res_log_error(res, "Device filter can not be used together with namespace without devices.");
+			return -EINVAL;
+		}
+
+		return _resolve_dump_filter_dev(res, ucmd_ctx, filter);
+	}
+
+	return 0;
+}
+
 static int _init_command(sid_res_t *res, const void *kickstart_data, void **data)
 {
 	const struct sid_msg     *msg      = kickstart_data;
@@ -6262,6 +7302,7 @@ static int _init_command(sid_res_t *res, const void *kickstart_data, void **data
 		sid_res_log_error(res, "Failed to allocate new command structure.");
 		goto fail;
 	}
+	ucmd_ctx->dev_sysfs_fd = -1;
 
 	*data = ucmd_ctx;
 	if ((r = _change_cmd_state(res, CMD_STATE_INI)) < 0)
@@ -6281,6 +7322,11 @@ static int _init_command(sid_res_t *res, const void *kickstart_data, void **data
 		goto fail;
 	}
 
+	if (!(ucmd_ctx->arena = mem_arena_create(SCRATCH_ARENA_CHUNK_SIZE))) {
+		sid_res_log_error(res, "Failed to create scratch memory arena.");
+		goto fail;
+	}
+
 	/* FIXME: Not all commands require print buffer - add command flag to control creation of this buffer. */
 	if (!(ucmd_ctx->prn_buf = sid_buf_create(&SID_BUF_SPEC(), &SID_BUF_INIT(.alloc_step = PATH_MAX), &r))) {
 		sid_res_log_error_errno(res, r, "Failed to create print buffer");
@@ -6330,6 +7376,27 @@ static int _init_command(sid_res_t *res, const void *kickstart_data, void **data
 			goto fail;
 	}
 
+	if ((ucmd_ctx->req_cat == MSG_CATEGORY_CLIENT) && (ucmd_ctx->req_hdr.cmd == SID_IFC_CMD_DBDUMP)) {
+		if ((r = _parse_cmd_dbdump_filter(res,
+		                                  ucmd_ctx,
+		                                  (const char *) msg->header + SID_IFC_MSG_HEADER_SIZE,
+		                                  msg->size - SID_IFC_MSG_HEADER_SIZE)) < 0) {
+			sid_res_log_error_errno(res, r, "Failed to parse KV dump filter");
+			goto fail;
+		}
+	}
+
+	if ((ucmd_ctx->req_cat == MSG_CATEGORY_CLIENT) && (ucmd_ctx->req_hdr.cmd == SID_IFC_CMD_WATCH)) {
+		/* the filter is parsed by main process, just keep a copy to pass it on */
+		if ((ucmd_ctx->watch.filter_size = msg->size - SID_IFC_MSG_HEADER_SIZE)) {
+			if (!(ucmd_ctx->watch.filter_mem = malloc(ucmd_ctx->watch.filter_size)))
+				goto fail;
+			memcpy(ucmd_ctx->watch.filter_mem,
+			       (const char *) msg->header + SID_IFC_MSG_HEADER_SIZE,
+			       ucmd_ctx->watch.filter_size);
+		}
+	}
+
 	if (cmd_reg->flags & CMD_SESSION_ID) {
 		if (!(worker_id = sid_wrk_ctl_get_worker_id(res))) {
 			sid_res_log_error(res, "Failed to get worker ID to set %s udev variable.", KV_KEY_UDEV_SID_SESSION_ID);
@@ -6371,6 +7438,8 @@ fail:
 		if (ucmd_ctx->res_buf)
 			sid_buf_destroy(ucmd_ctx->res_buf);
 
+		mem_arena_destroy(ucmd_ctx->arena);
+
 		if (ucmd_ctx->req_env.dev.num_s)
 			free((char *) ucmd_ctx->req_env.dev.num_s);
 
@@ -6380,6 +7449,12 @@ fail:
 		if (ucmd_ctx->req_env.dev.dsq_s)
 			free((char *) ucmd_ctx->req_env.dev.dsq_s);
 
+		if ((ucmd_ctx->req_cat == MSG_CATEGORY_CLIENT) && (ucmd_ctx->req_hdr.cmd == SID_IFC_CMD_DBDUMP))
+			free(ucmd_ctx->dbdump.filter_mem);
+
+		if ((ucmd_ctx->req_cat == MSG_CATEGORY_CLIENT) && (ucmd_ctx->req_hdr.cmd == SID_IFC_CMD_WATCH))
+			free(ucmd_ctx->watch.filter_mem);
+
 		free(ucmd_ctx);
 	}
 	return -1;
@@ -6399,11 +7474,24 @@ static int _destroy_command(sid_res_t *res)
 	if (ucmd_ctx->exp_buf)
 		sid_buf_destroy(ucmd_ctx->exp_buf);
 
+	if (ucmd_ctx->dev_sysfs_fd >= 0)
+		(void) close(ucmd_ctx->dev_sysfs_fd);
+
+	_dev_graph_destroy(ucmd_ctx);
+
+	mem_arena_destroy(ucmd_ctx->arena);
+
 	if (ucmd_ctx->req_hdr.cmd == SID_IFC_CMD_RESOURCES) {
 		if (ucmd_ctx->resources.main_res_mem)
 			(void) munmap(ucmd_ctx->resources.main_res_mem, ucmd_ctx->resources.main_res_mem_size);
 	}
 
+	if ((ucmd_ctx->req_cat == MSG_CATEGORY_CLIENT) && (ucmd_ctx->req_hdr.cmd == SID_IFC_CMD_DBDUMP))
+		free(ucmd_ctx->dbdump.filter_mem);
+
+	if ((ucmd_ctx->req_cat == MSG_CATEGORY_CLIENT) && (ucmd_ctx->req_hdr.cmd == SID_IFC_CMD_WATCH))
+		free(ucmd_ctx->watch.filter_mem);
+
 	if ((cmd_reg->flags & CMD_KV_EXPBUF_TO_FILE))
 		free((void *) ucmd_ctx->req_env.exp_path);
 	else {
@@ -6424,107 +7512,404 @@ static int _kv_cb_main_unset(struct sid_kvs_update_spec *spec)
 	kv_vector_t          *old_vvalue;
 	int                   r = 0;
 
-	if (!spec->old_data) {
-		sid_res_log_debug(update_arg->res,
-		                  "Skipping unset for key %s as it is already unset (new seqnum %" PRIu64 ").",
-		                  spec->key,
-		                  unset_nfo->seqnum);
-		return 1;
-	}
+	if (!spec->old_data) {
+		sid_res_log_debug(update_arg->res,
+		                  "Skipping unset for key %s as it is already unset (new seqnum %" PRIu64 ").",
+		                  spec->key,
+		                  unset_nfo->seqnum);
+		return 1;
+	}
+
+	old_vvalue = _get_vvalue(spec->old_flags, spec->old_data, spec->old_data_size, tmp_old_vvalue, VVALUE_CNT(tmp_old_vvalue));
+
+	r          = ((unset_nfo->seqnum == 0) || (unset_nfo->seqnum >= VVALUE_SEQNUM(old_vvalue))) && _kv_cb_write(spec);
+
+	if (r)
+		sid_res_log_debug(update_arg->res,
+		                  "Unsetting key %s (old seqnum %" PRIu64 ", new seqnum %" PRIu64 ").",
+		                  spec->key,
+		                  VVALUE_SEQNUM(old_vvalue),
+		                  unset_nfo->seqnum);
+	else
+		sid_res_log_debug(update_arg->res,
+		                  "Keeping key %s (old seqnum %" PRIu64 ", new seqnum %" PRIu64 ").",
+		                  spec->key,
+		                  VVALUE_SEQNUM(old_vvalue),
+		                  unset_nfo->seqnum);
+
+	return r;
+}
+
+static int _kv_cb_main_set(struct sid_kvs_update_spec *spec)
+{
+	struct kv_update_arg *update_arg = spec->arg;
+	kv_vector_t           tmp_old_vvalue[VVALUE_SINGLE_ALIGNED_CNT];
+	kv_vector_t           tmp_new_vvalue[VVALUE_SINGLE_ALIGNED_CNT];
+	kv_vector_t          *old_vvalue, *new_vvalue;
+	int                   r;
+
+	new_vvalue = _get_vvalue(spec->new_flags, spec->new_data, spec->new_data_size, tmp_new_vvalue, VVALUE_CNT(tmp_new_vvalue));
+
+	if (!spec->old_data) {
+		sid_res_log_debug(update_arg->res,
+		                  "Adding value for key %s (new seqnum %" PRIu64 ").",
+		                  spec->key,
+		                  VVALUE_SEQNUM(new_vvalue));
+		return 1;
+	}
+
+	old_vvalue = _get_vvalue(spec->old_flags, spec->old_data, spec->old_data_size, tmp_old_vvalue, VVALUE_CNT(tmp_old_vvalue));
+
+	/* overwrite whole value */
+	/* note that 'VVALUE_SEQNUM(new_vvalue) == 0' means 'skip seqnum check' */
+	r = ((VVALUE_SEQNUM(new_vvalue) == 0) || (VVALUE_SEQNUM(new_vvalue) >= VVALUE_SEQNUM(old_vvalue))) && _kv_cb_write(spec);
+
+	if (r)
+		sid_res_log_debug(update_arg->res,
+		                  "Updating value for key %s (old seqnum %" PRIu64 ", new seqnum %" PRIu64 ").",
+		                  spec->key,
+		                  old_vvalue ? VVALUE_SEQNUM(old_vvalue) : 0,
+		                  VVALUE_SEQNUM(new_vvalue));
+	else
+		sid_res_log_debug(update_arg->res,
+		                  "Keeping old value for key %s (old seqnum %" PRIu64 ", new seqnum %" PRIu64 ").",
+		                  spec->key,
+		                  old_vvalue ? VVALUE_SEQNUM(old_vvalue) : 0,
+		                  VVALUE_SEQNUM(new_vvalue));
+
+	return r;
+}
+
+static char *_compose_archive_key(sid_res_t *res, struct mem_arena *arena, const char *key, size_t key_size)
+{
+	char *archive_key;
+
+	if (!(archive_key = mem_arena_alloc(arena, key_size + 1))) {
+		sid_res_log_error(res, "Failed to create archive key for key %s.", key);
+		return NULL;
+	}
+
+	memcpy(archive_key + 1, key, key_size);
+	archive_key[0] = KV_PREFIX_OP_ARCHIVE_C[0];
+
+	return archive_key;
+}
+
+static void _destroy_watcher_msg(struct watcher_msg *msg)
+{
+	list_del(&msg->list);
+	sid_buf_destroy(msg->buf);
+	free(msg);
+}
+
+static void _destroy_watcher(struct watcher *watcher)
+{
+	struct watcher_msg *msg, *tmp;
+
+	(void) close(watcher->fd);
+
+	if (watcher->buf)
+		sid_buf_destroy(watcher->buf);
+
+	list_iterate_items_safe (msg, tmp, &watcher->out_msgs)
+		_destroy_watcher_msg(msg);
+
+	free(watcher->filter_mem);
+	free(watcher);
+}
+
+static void _drop_watcher(struct watcher *watcher)
+{
+	list_del(&watcher->list);
+	(void) sid_res_ev_destroy(&watcher->es);
+	_destroy_watcher(watcher);
+}
+
+/*
+ * Write the message from 'pos' on until it is sent completely (returns 0) or
+ * until the connection does not take more data (returns -EAGAIN).
+ */
+static int _write_watcher_msg(struct watcher *watcher, struct sid_buf *buf, size_t *pos)
+{
+	ssize_t n;
+
+	for (;; *pos += n) {
+		if ((n = sid_buf_write(buf, watcher->fd, *pos)) < 0) {
+			if (n == -ENODATA)
+				return 0;
+
+			if (n == -EINTR) {
+				n = 0;
+				continue;
+			}
+
+			return n;
+		}
+	}
+}
+
+/*
+ * Send queued messages in order. If the backlog overflowed before, this
+ * returns -ENOBUFS as soon as the message being sent then is complete.
+ */
+static int _send_watcher_queue(struct watcher *watcher)
+{
+	struct watcher_msg *msg;
+	int                 r;
+
+	while (!list_is_empty(&watcher->out_msgs)) {
+		msg = list_item(watcher->out_msgs.n, struct watcher_msg);
+
+		if ((r = _write_watcher_msg(watcher, msg->buf, &watcher->out_pos)) < 0)
+			return r == -EAGAIN ? 0 : r;
+
+		watcher->out_size -= sid_buf_count(msg->buf);
+		watcher->out_pos   = 0;
+		_destroy_watcher_msg(msg);
+
+		if (watcher->closing)
+			return -ENOBUFS;
+	}
+
+	return sid_res_ev_set_io_events(watcher->es, EPOLLIN);
+}
+
+/*
+ * Send the message prepared in watcher's buffer. The connection is non-blocking,
+ * so whatever the client does not take right away is queued and sent once the
+ * connection is writable again. Messages are never split: if the backlog grows
+ * over WATCHER_BACKLOG_MAX, new messages are discarded and the watcher is dropped
+ * once the message being sent is complete. Returns -ENOBUFS if it is to be
+ * dropped right away.
+ */
+static int _send_watcher_buf(struct watcher *watcher)
+{
+	struct watcher_msg *msg, *tmp, *first;
+	size_t              pos = 0;
+	int                 r;
+
+	if (watcher->closing)
+		return sid_buf_reset(watcher->buf);
+
+	if (list_is_empty(&watcher->out_msgs)) {
+		if ((r = _write_watcher_msg(watcher, watcher->buf, &pos)) == 0)
+			return sid_buf_reset(watcher->buf);
+
+		if (r != -EAGAIN)
+			return r;
+	} else if (watcher->out_size + sid_buf_count(watcher->buf) > WATCHER_BACKLOG_MAX) {
+		(void) sid_buf_reset(watcher->buf);
+		first = list_item(watcher->out_msgs.n, struct watcher_msg);
+
+		list_iterate_items_safe (msg, tmp, &watcher->out_msgs) {
+			if (msg == first && watcher->out_pos)
+				continue;
+
+			watcher->out_size -= sid_buf_count(msg->buf);
+			_destroy_watcher_msg(msg);
+		}
+
+		if (list_is_empty(&watcher->out_msgs))
+			return -ENOBUFS;
+
+		watcher->closing = true;
+		return 0;
+	}
+
+	if (!(msg = malloc(sizeof(*msg))))
+		return -ENOMEM;
+
+	msg->buf = watcher->buf;
+
+	if (!(watcher->buf = sid_buf_create(&SID_BUF_SPEC(.mode = SID_BUF_MODE_SIZE_PREFIX),
+	                                    &SID_BUF_INIT(.alloc_step = PATH_MAX),
+	                                    &r))) {
+		watcher->buf = msg->buf;
+		free(msg);
+		return r;
+	}
+
+	if (list_is_empty(&watcher->out_msgs)) {
+		watcher->out_pos = pos;
+
+		if ((r = sid_res_ev_set_io_events(watcher->es, EPOLLIN | EPOLLOUT)) < 0) {
+			sid_buf_destroy(watcher->buf);
+			watcher->buf = msg->buf;
+			free(msg);
+			return r;
+		}
+	}
+
+	list_add(&watcher->out_msgs, &msg->list);
+	watcher->out_size += sid_buf_count(msg->buf);
+
+	return 0;
+}
+
+static bool _watcher_match(struct watcher *watcher, const char *key)
+{
+	if ((watcher->ns != SID_KV_NS_UNDEFINED) && (_get_ns_from_key(key) != watcher->ns))
+		return false;
+
+	if (watcher->prefix && strncmp(key, watcher->prefix, strlen(watcher->prefix)))
+		return false;
+
+	return true;
+}
+
+static void _print_watch_value(struct watcher  *watcher,
+                               const char      *name,
+                               const char      *vector_name,
+                               void            *value,
+                               size_t           size,
+                               sid_kvs_val_fl_t flags)
+{
+	kv_vector_t  tmp_vvalue[VVALUE_SINGLE_ALIGNED_CNT];
+	kv_vector_t *vvalue;
+	bool         vector = flags & SID_KVS_VAL_FL_VECTOR;
+
+	if (!(vvalue = _get_vvalue(flags, value, size, tmp_vvalue, VVALUE_CNT(tmp_vvalue))))
+		return;
+
+	_print_vvalue(vvalue, vector, size, vector ? vector_name : name, watcher->format, watcher->buf, 3);
+}
+
+/*
+ * Start change record for key in all matching watchers' buffers with the value
+ * the key has right before the change is applied. Returns true if there is at
+ * least one matching watcher.
+ */
+static bool _watchers_rec_start(struct list *watchers, sid_res_t *kvs_res, const char *key, uint64_t seqnum)
+{
+	struct watcher  *watcher;
+	void            *value = NULL;
+	size_t           size  = 0;
+	sid_kvs_val_fl_t flags = 0;
+	bool             match = false;
+
+	list_iterate_items (watcher, watchers) {
+		if (!_watcher_match(watcher, key))
+			continue;
+
+		if (!match) {
+			value = sid_kvs_va_get(kvs_res, .key = key, .size = &size, .flags = &flags);
+			match = true;
+		}
 
-	old_vvalue = _get_vvalue(spec->old_flags, spec->old_data, spec->old_data_size, tmp_old_vvalue, VVALUE_CNT(tmp_old_vvalue));
+		if (!watcher->rec_count && !watcher->rec_open) {
+			sid_buf_add(watcher->buf,
+			            &(struct sid_ifc_msg_header) {.status = SID_IFC_CMD_STATUS_SUCCESS,
+			                                          .prot   = SID_IFC_PROTOCOL,
+			                                          .cmd    = SID_IFC_CMD_REPLY},
+			            SID_IFC_MSG_HEADER_SIZE,
+			            NULL,
+			            NULL);
+			fmt_doc_start(watcher->format, watcher->buf, 0);
+			fmt_arr_start(watcher->format, watcher->buf, 1, "sidwatch", false);
+		}
 
-	r          = ((unset_nfo->seqnum == 0) || (unset_nfo->seqnum >= VVALUE_SEQNUM(old_vvalue))) && _kv_cb_write(spec);
+		watcher->rec_open = true;
 
-	if (r)
-		sid_res_log_debug(update_arg->res,
-		                  "Unsetting key %s (old seqnum %" PRIu64 ", new seqnum %" PRIu64 ").",
-		                  spec->key,
-		                  VVALUE_SEQNUM(old_vvalue),
-		                  unset_nfo->seqnum);
-	else
-		sid_res_log_debug(update_arg->res,
-		                  "Keeping key %s (old seqnum %" PRIu64 ", new seqnum %" PRIu64 ").",
-		                  spec->key,
-		                  VVALUE_SEQNUM(old_vvalue),
-		                  unset_nfo->seqnum);
+		fmt_elm_start(watcher->format, watcher->buf, 2, watcher->rec_count > 0);
+		fmt_fld_str(watcher->format, watcher->buf, 3, "key", key, false);
+		fmt_fld_uint64(watcher->format, watcher->buf, 3, "seqnum", seqnum, true);
+		if (value)
+			_print_watch_value(watcher, "old_value", "old_values", value, size, flags);
+	}
 
-	return r;
+	return match;
 }
 
-static int _kv_cb_main_set(struct sid_kvs_update_spec *spec)
+/*
+ * Finish change records started by _watchers_rec_start with the value the key
+ * has after the change is applied.
+ */
+static void _watchers_rec_end(struct list *watchers, sid_res_t *kvs_res, const char *key)
 {
-	struct kv_update_arg *update_arg = spec->arg;
-	kv_vector_t           tmp_old_vvalue[VVALUE_SINGLE_ALIGNED_CNT];
-	kv_vector_t           tmp_new_vvalue[VVALUE_SINGLE_ALIGNED_CNT];
-	kv_vector_t          *old_vvalue, *new_vvalue;
-	int                   r;
-
-	new_vvalue = _get_vvalue(spec->new_flags, spec->new_data, spec->new_data_size, tmp_new_vvalue, VVALUE_CNT(tmp_new_vvalue));
+	struct watcher  *watcher;
+	void            *value;
+	size_t           size  = 0;
+	sid_kvs_val_fl_t flags = 0;
 
-	if (!spec->old_data) {
-		sid_res_log_debug(update_arg->res,
-		                  "Adding value for key %s (new seqnum %" PRIu64 ").",
-		                  spec->key,
-		                  VVALUE_SEQNUM(new_vvalue));
-		return 1;
-	}
+	value = sid_kvs_va_get(kvs_res, .key = key, .size = &size, .flags = &flags);
 
-	old_vvalue = _get_vvalue(spec->old_flags, spec->old_data, spec->old_data_size, tmp_old_vvalue, VVALUE_CNT(tmp_old_vvalue));
+	list_iterate_items (watcher, watchers) {
+		if (!watcher->rec_open)
+			continue;
 
-	/* overwrite whole value */
-	/* note that 'VVALUE_SEQNUM(new_vvalue) == 0' means 'skip seqnum check' */
-	r = ((VVALUE_SEQNUM(new_vvalue) == 0) || (VVALUE_SEQNUM(new_vvalue) >= VVALUE_SEQNUM(old_vvalue))) && _kv_cb_write(spec);
+		watcher->rec_open = false;
 
-	if (r)
-		sid_res_log_debug(update_arg->res,
-		                  "Updating value for key %s (old seqnum %" PRIu64 ", new seqnum %" PRIu64 ").",
-		                  spec->key,
-		                  old_vvalue ? VVALUE_SEQNUM(old_vvalue) : 0,
-		                  VVALUE_SEQNUM(new_vvalue));
-	else
-		sid_res_log_debug(update_arg->res,
-		                  "Keeping old value for key %s (old seqnum %" PRIu64 ", new seqnum %" PRIu64 ").",
-		                  spec->key,
-		                  old_vvalue ? VVALUE_SEQNUM(old_vvalue) : 0,
-		                  VVALUE_SEQNUM(new_vvalue));
+		if (value)
+			_print_watch_value(watcher, "new_value", "new_values", value, size, flags);
 
-	return r;
+		fmt_elm_end(watcher->format, watcher->buf, 2);
+		watcher->rec_count++;
+	}
 }
 
-static char *_compose_archive_key(sid_res_t *res, const char *key, size_t key_size)
+/*
+ * Send out all change records collected while syncing main KV store. If the
+ * changes were not committed, the records are discarded instead.
+ */
+static void _watchers_flush(sid_res_t *res, struct list *watchers, bool commit)
 {
-	char *archive_key;
+	struct watcher *watcher, *tmp;
+	bool            closing;
+	int             r;
 
-	if (!(archive_key = malloc(key_size + 1))) {
-		sid_res_log_error(res, "Failed to create archive key for key %s.", key);
-		return NULL;
-	}
+	list_iterate_items_safe (watcher, tmp, watchers) {
+		if (!commit || !watcher->rec_count) {
+			watcher->rec_count = 0;
+			watcher->rec_open  = false;
+			(void) sid_buf_reset(watcher->buf);
+			continue;
+		}
 
-	memcpy(archive_key + 1, key, key_size);
-	archive_key[0] = KV_PREFIX_OP_ARCHIVE_C[0];
+		watcher->rec_count = 0;
 
-	return archive_key;
+		fmt_arr_end(watcher->format, watcher->buf, 1);
+		fmt_doc_end(watcher->format, watcher->buf, 0);
+		fmt_null_byte(watcher->buf);
+
+		closing = watcher->closing;
+
+		if ((r = _send_watcher_buf(watcher)) < 0) {
+			sid_res_log_warning(res,
+			                    "Dropping watcher on fd %d: client not accepting change records (%d).",
+			                    watcher->fd,
+			                    r);
+			_drop_watcher(watcher);
+		} else if (watcher->closing && !closing)
+			sid_res_log_warning(res,
+			                    "Dropping watcher on fd %d after current message: client not accepting change records.",
+			                    watcher->fd);
+	}
 }
 
-static int _sync_main_kv_store(sid_res_t *res, struct sid_ucmd_common_ctx *common_ctx, int fd)
+static int _sync_main_kv_store(sid_res_t *res, struct sid_ucmd_common_ctx *common_ctx, struct list *watchers, int fd)
 {
-	static const char        syncing_msg[] = "Syncing main key-value store:  %s = %s (seqnum %" PRIu64 ")";
+	static const char        syncing_msg[]   = "Syncing main key-value store:  %s = %s (seqnum %" PRIu64 ")";
+	static const char        bad_owner_msg[] = "Received incorrect owner for key %s to sync with main key-value store.";
 	sid_kvs_val_fl_t         kv_store_value_flags;
 	SID_BUF_SIZE_PREFIX_TYPE msg_size;
-	size_t                   key_size, value_size, ext_data_offset, i;
-	char                    *key, *archive_key = NULL, *shm = MAP_FAILED, *p, *end;
+	size_t                   key_size, value_size, ext_data_offset, owner_size, data_size, i;
+	char                    *key, *archive_key, *shm = MAP_FAILED, *p, *end;
+	const char              *owner;
 	kv_scalar_t              tmp_svalue, *svalue = NULL;
 	kv_vector_t             *vvalue = NULL;
 	const char              *vvalue_str;
 	void                    *value_to_store;
-	const void              *final_value;
+	kv_vector_t             *final_value;
 	struct kv_rel_spec       rel_spec   = KV_REL_SPEC(.delta = &KV_DELTA(), .abs_delta = &KV_DELTA());
 	struct kv_update_arg     update_arg = KV_UPDATE_ARG(.gen_buf = common_ctx->gen_buf, .is_sync = true, .custom = &rel_spec);
 	struct kv_unset_nfo      unset_nfo;
-	bool                     unset, archive;
+	struct mem_arena_mark    rec_mark, mark;
+	bool                     unset, archive, watched;
 	int                      r = -1;
 
+	if (watchers && list_is_empty(watchers))
+		watchers = NULL;
+
 	if (read(fd, &msg_size, SID_BUF_SIZE_PREFIX_LEN) != SID_BUF_SIZE_PREFIX_LEN) {
 		sid_res_log_error_errno(res, errno, "Failed to read shared memory size");
 		goto out;
@@ -6546,12 +7931,19 @@ static int _sync_main_kv_store(sid_res_t *res, struct sid_ucmd_common_ctx *commo
 	end  = p + msg_size;
 	p   += sizeof(msg_size);
 
+	if (!(update_arg.arena = mem_arena_create(SCRATCH_ARENA_CHUNK_SIZE))) {
+		sid_res_log_error(res, "Failed to create scratch memory arena.");
+		goto out;
+	}
+
 	if (sid_kvs_transaction_begin(common_ctx->kvs_res) < 0) {
 		sid_res_log_error(res, "Failed to start key-value store transaction");
 		goto out;
 	}
 
 	while (p < end) {
+		rec_mark = mem_arena_get_mark(update_arg.arena);
+
 		memcpy(&kv_store_value_flags, p, sizeof(kv_store_value_flags));
 		p += sizeof(kv_store_value_flags);
 
@@ -6597,6 +7989,17 @@ static int _sync_main_kv_store(sid_res_t *res, struct sid_ucmd_common_ctx *commo
 			memcpy(&tmp_svalue.gennum, vvalue[VVALUE_IDX_GENNUM].iov_base, sizeof(tmp_svalue.gennum));
 			vvalue[VVALUE_IDX_GENNUM].iov_base = &tmp_svalue.gennum;
 
+			/* Owner is received as name, replace it with owner ID */
+			owner      = vvalue[VVALUE_IDX_OWNER].iov_base;
+			owner_size = vvalue[VVALUE_IDX_OWNER].iov_len;
+
+			if (!owner_size || owner[owner_size - 1] || _get_owner_id(owner, &tmp_svalue.owner) < 0) {
+				sid_res_log_error(res, bad_owner_msg, key);
+				goto out;
+			}
+
+			vvalue[VVALUE_IDX_OWNER] = (kv_vector_t) {&tmp_svalue.owner, sizeof(tmp_svalue.owner)};
+
 			unset               = !(VVALUE_FLAGS(vvalue) & SID_KV_FL_RS) && (value_size == VVALUE_HEADER_CNT);
 
 			update_arg.res      = common_ctx->kvs_res;
@@ -6631,21 +8034,36 @@ static int _sync_main_kv_store(sid_res_t *res, struct sid_ucmd_common_ctx *commo
 				goto out;
 			}
 
-			if (!(svalue = malloc(value_size))) {
+			/* Owner is received as name right after the header, replace it with owner ID */
+			memcpy(&tmp_svalue, p, SVALUE_HEADER_SIZE);
+			owner      = p + SVALUE_HEADER_SIZE;
+			owner_size = tmp_svalue.owner;
+
+			if (!owner_size || (value_size < SVALUE_HEADER_SIZE + owner_size) || owner[owner_size - 1] ||
+			    _get_owner_id(owner, &tmp_svalue.owner) < 0) {
+				sid_res_log_error(res, bad_owner_msg, key);
+				goto out;
+			}
+
+			data_size       = value_size - SVALUE_HEADER_SIZE - owner_size;
+			ext_data_offset = _svalue_ext_data_offset(&tmp_svalue);
+			p              += value_size;
+			value_size      = SVALUE_HEADER_SIZE + ext_data_offset + data_size;
+
+			if (!(svalue = mem_zalloc(value_size))) {
 				sid_res_log_error(res, "Failed to allocate svalue to sync main key-value store.");
 				goto out;
 			}
 
-			memcpy(svalue, p, value_size);
-			p               += value_size;
+			memcpy(svalue, &tmp_svalue, SVALUE_HEADER_SIZE);
+			memcpy(svalue->data + ext_data_offset, owner + owner_size, data_size);
 
-			ext_data_offset  = _svalue_ext_data_offset(svalue);
 			unset          = ((svalue->flags != SID_KV_FL_RS) && (value_size == SVALUE_HEADER_SIZE + ext_data_offset));
 
 			update_arg.res = common_ctx->kvs_res;
 			update_arg.ret_code = 0;
 
-			unset_nfo.owner     = svalue->data;
+			unset_nfo.owner     = svalue->owner;
 			unset_nfo.seqnum    = svalue->seqnum;
 
 			sid_res_log_debug(res, syncing_msg, key, unset ? "NULL" : svalue->data + ext_data_offset, svalue->seqnum);
@@ -6656,8 +8074,10 @@ static int _sync_main_kv_store(sid_res_t *res, struct sid_ucmd_common_ctx *commo
 			value_to_store     = svalue;
 		}
 
+		watched = watchers && _watchers_rec_start(watchers, common_ctx->kvs_res, key, unset_nfo.seqnum);
+
 		if (unset) {
-			if (!(archive_key = _compose_archive_key(res, key, key_size)))
+			if (!(archive_key = _compose_archive_key(res, update_arg.arena, key, key_size)))
 				goto out;
 
 			update_arg.custom = &unset_nfo;
@@ -6678,7 +8098,7 @@ static int _sync_main_kv_store(sid_res_t *res, struct sid_ucmd_common_ctx *commo
 			}
 		} else {
 			if (rel_spec.delta->op == KV_OP_SET) {
-				if (!(archive_key = _compose_archive_key(res, key, key_size)))
+				if (!(archive_key = _compose_archive_key(res, update_arg.arena, key, key_size)))
 					goto out;
 
 				if (sid_kvs_va_set(common_ctx->kvs_res,
@@ -6701,6 +8121,8 @@ static int _sync_main_kv_store(sid_res_t *res, struct sid_ucmd_common_ctx *commo
 						goto out;
 				}
 			} else {
+				mark = mem_arena_get_mark(update_arg.arena);
+
 				if (sid_kvs_va_set(common_ctx->kvs_res,
 				                   .key      = key,
 				                   .value    = value_to_store,
@@ -6709,13 +8131,16 @@ static int _sync_main_kv_store(sid_res_t *res, struct sid_ucmd_common_ctx *commo
 				                   .op_flags = SID_KVS_VAL_OP_NONE,
 				                   .fn       = _kv_cb_delta_step,
 				                   .fn_arg   = &update_arg) < 0) {
-					_destroy_delta_buffers(rel_spec.delta);
+					_reset_delta(rel_spec.delta);
+					mem_arena_release(update_arg.arena, mark);
 					goto out;
 				}
 
-				sid_buf_get_data(rel_spec.delta->final, &final_value, &value_size);
+				final_value = rel_spec.delta->final;
+				value_size  = rel_spec.delta->final_size;
 
-				unset = !(VVALUE_FLAGS(final_value) & SID_KV_FL_RS) && (value_size == VVALUE_HEADER_CNT);
+				unset = final_value && !(VVALUE_FLAGS(final_value) & SID_KV_FL_RS) &&
+				        (value_size == VVALUE_HEADER_CNT);
 				if (unset) {
 					if (value_size == VVALUE_HEADER_CNT) {
 						unset_nfo.owner   = VVALUE_OWNER(final_value);
@@ -6728,13 +8153,17 @@ static int _sync_main_kv_store(sid_res_t *res, struct sid_ucmd_common_ctx *commo
 					}
 				}
 
-				_destroy_delta_buffers(rel_spec.delta);
+				_reset_delta(rel_spec.delta);
+				mem_arena_release(update_arg.arena, mark);
 			}
 		}
 
-		svalue      = mem_freen(svalue);
-		vvalue      = mem_freen(vvalue);
-		archive_key = mem_freen(archive_key);
+		if (watched)
+			_watchers_rec_end(watchers, common_ctx->kvs_res, key);
+
+		svalue = mem_freen(svalue);
+		vvalue = mem_freen(vvalue);
+		mem_arena_release(update_arg.arena, rec_mark);
 	}
 
 	r = 0;
@@ -6742,9 +8171,12 @@ out:
 	if (sid_kvs_transaction_active(common_ctx->kvs_res))
 		sid_kvs_transaction_end(common_ctx->kvs_res, (r < 0));
 
+	if (watchers)
+		_watchers_flush(res, watchers, r == 0);
+
 	free(vvalue);
 	free(svalue);
-	free(archive_key);
+	mem_arena_destroy(update_arg.arena);
 
 	if (shm != MAP_FAILED && munmap(shm, msg_size) < 0) {
 		sid_res_log_error_errno(res, errno, "Failed to unmap memory with key-value store");
@@ -6757,6 +8189,8 @@ out:
 static int _worker_proxy_recv_system_cmd_sync(sid_res_t *worker_proxy_res, struct sid_wrk_data_spec *data_spec, void *arg)
 {
 	struct sid_ucmd_common_ctx *common_ctx = arg;
+	sid_res_t                  *ubridge_res;
+	struct list                *watchers = NULL;
 	int                         r;
 
 	if (!data_spec->ext.used) {
@@ -6766,7 +8200,10 @@ static int _worker_proxy_recv_system_cmd_sync(sid_res_t *worker_proxy_res, struc
 		return -1;
 	}
 
-	(void) _sync_main_kv_store(worker_proxy_res, common_ctx, data_spec->ext.socket.fd_pass);
+	if ((ubridge_res = sid_res_search(worker_proxy_res, SID_RES_SEARCH_ANC, &sid_res_type_ubr, NULL)))
+		watchers = &((struct ubridge *) sid_res_get_data(ubridge_res))->watchers;
+
+	(void) _sync_main_kv_store(worker_proxy_res, common_ctx, watchers, data_spec->ext.socket.fd_pass);
 
 	r = sid_wrk_ctl_chan_send(
 		worker_proxy_res,
@@ -6815,6 +8252,164 @@ out:
 	return r;
 }
 
+static int _on_watcher_event(sid_res_ev_src_t *es, int fd, uint32_t revents, void *data)
+{
+	struct watcher *watcher = data;
+	char            buf[64];
+	ssize_t         n;
+
+	if (revents & EPOLLERR)
+		goto drop;
+
+	/* the client is not supposed to send anything, we are only waiting for disconnection */
+	if (revents & EPOLLIN) {
+		while ((n = read(fd, buf, sizeof(buf))) > 0)
+			;
+
+		if (n == 0 || (errno != EAGAIN && errno != EINTR))
+			goto drop;
+	}
+
+	if ((revents & EPOLLOUT) && _send_watcher_queue(watcher) < 0)
+		goto drop;
+
+	return 0;
+drop:
+	_drop_watcher(watcher);
+	return 0;
+}
+
+static int _parse_watch_filter(sid_res_t *res, struct watcher *watcher, const char *data, size_t data_size)
+{
+	char *p, *end, *next, *value;
+
+	if (!data_size)
+		return 0;
+
+	if (!(watcher->filter_mem = malloc(data_size + 1)))
+		return -ENOMEM;
+
+	memcpy(watcher->filter_mem, data, data_size);
+	watcher->filter_mem[data_size] = '\0';
+
+	for (p = watcher->filter_mem, end = p + data_size; p < end; p = next) {
+		next = p + strlen(p) + 1;
+
+		if (!(value = strchr(p, KV_PAIR_C[0])) || !value[1]) {
+			sid_res_log_error(res, "Malformed watch filter %s.", p);
+			return -EINVAL;
+		}
+
+		*value++ = '\0';
+
+		if (!strcmp(p, SID_IFC_WATCH_KEY_NS)) {
+			if ((watcher->ns = _ns_str_to_ns(value)) == SID_KV_NS_UNDEFINED) {
+				sid_res_log_error(res, "Unknown namespace %s in watch filter.", value);
+				return -EINVAL;
+			}
+		} else if (!strcmp(p, SID_IFC_WATCH_KEY_PREFIX))
+			watcher->prefix = value;
+		else {
+			sid_res_log_error(res, "Unknown watch filter %s.", p);
+			return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static int _worker_proxy_recv_system_cmd_watch(sid_res_t                *worker_proxy_res,
+                                               struct sid_wrk_data_spec *data_spec,
+                                               void *arg                 __unused)
+{
+	struct internal_msg_header int_msg;
+	struct sid_ifc_msg_header  res_hdr = {.status = SID_IFC_CMD_STATUS_SUCCESS,
+	                                      .prot   = SID_IFC_PROTOCOL,
+	                                      .cmd    = SID_IFC_CMD_REPLY};
+	sid_res_t                 *ubridge_res;
+	struct ubridge            *ubridge;
+	struct watcher            *watcher = NULL;
+	int                        flags, r = -1;
+
+	if (!data_spec->ext.used) {
+		sid_res_log_error(worker_proxy_res,
+		                  SID_INTERNAL_ERROR "%s: Received watch request, but client connection missing.",
+		                  __func__);
+		return -1;
+	}
+
+	memcpy(&int_msg, data_spec->data, INTERNAL_MSG_HEADER_SIZE);
+
+	if (!(ubridge_res = sid_res_search(worker_proxy_res, SID_RES_SEARCH_ANC, &sid_res_type_ubr, NULL))) {
+		sid_res_log_error(worker_proxy_res, SID_INTERNAL_ERROR "%s: Failed to find ubridge resource.", __func__);
+		goto out;
+	}
+	ubridge = sid_res_get_data(ubridge_res);
+
+	if (!(watcher = mem_zalloc(sizeof(*watcher)))) {
+		sid_res_log_error(worker_proxy_res, "Failed to allocate watcher structure.");
+		goto out;
+	}
+
+	list_init(&watcher->out_msgs);
+	watcher->fd     = data_spec->ext.socket.fd_pass;
+	watcher->format = flags_to_format(int_msg.header.flags);
+	watcher->ns     = SID_KV_NS_UNDEFINED;
+
+	if (!(watcher->buf = sid_buf_create(&SID_BUF_SPEC(.mode = SID_BUF_MODE_SIZE_PREFIX),
+	                                    &SID_BUF_INIT(.alloc_step = PATH_MAX),
+	                                    &r))) {
+		sid_res_log_error_errno(worker_proxy_res, r, "Failed to create watcher buffer");
+		goto out;
+	}
+
+	if ((r = _parse_watch_filter(worker_proxy_res,
+	                             watcher,
+	                             (const char *) data_spec->data + INTERNAL_MSG_HEADER_SIZE,
+	                             data_spec->data_size - INTERNAL_MSG_HEADER_SIZE)) < 0) {
+		sid_res_log_error_errno(worker_proxy_res, r, "Failed to parse watch filter");
+		res_hdr.status |= SID_IFC_CMD_STATUS_FAILURE;
+		goto reply;
+	}
+
+	if ((flags = fcntl(watcher->fd, F_GETFL)) < 0 || fcntl(watcher->fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+		r = -errno;
+		sid_res_log_error_errno(worker_proxy_res, r, "Failed to set watcher connection non-blocking");
+		goto out;
+	}
+
+	if ((r = sid_res_ev_create_io(ubridge_res, &watcher->es, watcher->fd, _on_watcher_event, 0, "watcher", watcher)) < 0) {
+		sid_res_log_error_errno(worker_proxy_res, r, "Failed to register watcher event handler");
+		goto out;
+	}
+reply:
+	/*
+	 * Send the reply before adding the watcher to the list so the
+	 * client always receives the reply before any change records.
+	 */
+	if ((r = sid_buf_add(watcher->buf, &res_hdr, sizeof(res_hdr), NULL, NULL)) < 0 || (r = _send_watcher_buf(watcher)) < 0) {
+		sid_res_log_error_errno(worker_proxy_res, r, "Failed to send reply to watch request");
+		goto out;
+	}
+
+	if (res_hdr.status & SID_IFC_CMD_STATUS_FAILURE)
+		goto out;
+
+	list_add(&ubridge->watchers, &watcher->list);
+	sid_res_log_debug(worker_proxy_res, "Added watcher on fd %d.", watcher->fd);
+	return 0;
+out:
+	if (watcher) {
+		if (watcher->es)
+			(void) sid_res_ev_destroy(&watcher->es);
+		_destroy_watcher(watcher);
+	} else
+		(void) close(data_spec->ext.socket.fd_pass);
+
+	/* failures here only concern this client */
+	return 0;
+}
+
 static int _worker_proxy_recv_fn(sid_res_t                *worker_proxy_res,
                                  struct sid_wrk_chan      *chan,
                                  struct sid_wrk_data_spec *data_spec,
@@ -6841,6 +8436,9 @@ static int _worker_proxy_recv_fn(sid_res_t                *worker_proxy_res,
 		case SYSTEM_CMD_RESOURCES:
 			return _worker_proxy_recv_system_cmd_resources(worker_proxy_res, data_spec, arg);
 
+		case SYSTEM_CMD_WATCH:
+			return _worker_proxy_recv_system_cmd_watch(worker_proxy_res, data_spec, arg);
+
 		default:
 			sid_res_log_error(worker_proxy_res, "Unknown system command.");
 			return -1;
@@ -7040,7 +8638,11 @@ static int _worker_init_fn(sid_res_t *worker_res, void *arg)
 	/* destroy remaining resources */
 	(void) sid_res_unref(old_top_res);
 
-	return 0;
+	/*
+	 * Records inherited from main KV store are already in sync,
+	 * so only changes done in this worker are indexed from now on.
+	 */
+	return sid_kvs_index_register(common_ctx->kvs_res, &kv_index_sync_spec);
 }
 
 /* *res_p is set to the worker_proxy resource. If a new worker process is created, when it returns, *res_p will be NULL */
@@ -7179,7 +8781,7 @@ static int _load_kv_store(sid_res_t *ubridge_res, struct sid_ucmd_common_ctx *co
 		return -1;
 	}
 
-	r = _sync_main_kv_store(ubridge_res, common_ctx, fd);
+	r = _sync_main_kv_store(ubridge_res, common_ctx, NULL, fd);
 
 	(void) close(fd);
 	return r;
@@ -7238,6 +8840,45 @@ out:
 	return r;
 }
 
+static int _on_ubridge_mod_umonitor_event(sid_res_ev_src_t *es, int fd, uint32_t revents, void *data)
+{
+	sid_res_t                  *ubridge_res = data;
+	struct ubridge             *ubridge     = sid_res_get_data(ubridge_res);
+	struct sid_ucmd_common_ctx *common_ctx;
+	sid_res_t                  *common_res;
+	struct udev_device         *udev_dev;
+	const char                 *action;
+	int                         r = 0;
+
+	if (!(udev_dev = udev_monitor_receive_device(ubridge->ulink.mod_mon)))
+		return 0;
+
+	/*
+	 * A newly loaded module may register new block device major number.
+	 * Refresh the map here in main process so that all subsequently
+	 * created workers inherit it instead of each rereading it on a miss.
+	 */
+	if (!(action = udev_device_get_action(udev_dev)) || strcmp(action, "add"))
+		goto out;
+
+	if (!(common_res = sid_res_search(ubridge->internal_res, SID_RES_SEARCH_IMM_DESC, &sid_res_type_ubr_cmn, COMMON_ID))) {
+		sid_res_log_error(ubridge_res, SID_INTERNAL_ERROR "%s: Failed to find common resource.", __func__);
+		r = -ENOENT;
+		goto out;
+	}
+
+	common_ctx = sid_res_get_data(common_res);
+
+	sid_res_log_debug(ubridge_res,
+	                  "Refreshing device major number map after loading module %s.",
+	                  udev_device_get_sysname(udev_dev));
+
+	r = _refresh_dev_majors(ubridge_res, &common_ctx->dev_majors);
+out:
+	udev_device_unref(udev_dev);
+	return r;
+}
+
 static void _destroy_ulink(sid_res_t *ubridge_res, struct ulink *ulink)
 {
 	if (!ulink->udev)
@@ -7248,6 +8889,11 @@ static void _destroy_ulink(sid_res_t *ubridge_res, struct ulink *ulink)
 		ulink->mon = NULL;
 	}
 
+	if (ulink->mod_mon) {
+		udev_monitor_unref(ulink->mod_mon);
+		ulink->mod_mon = NULL;
+	}
+
 	udev_unref(ulink->udev);
 	ulink->udev = NULL;
 }
@@ -7307,7 +8953,7 @@ static int _set_up_kv_store_generation(struct sid_ucmd_common_ctx *ctx)
 
 	sid_res_log_debug(ctx->res, "Current generation number: %" PRIu16, ctx->gennum);
 
-	_vvalue_header_prep(vvalue, VVALUE_CNT(vvalue), &null_int, &flags, &ctx->gennum, core_owner);
+	_vvalue_header_prep(vvalue, VVALUE_CNT(vvalue), &null_int, &flags, &ctx->gennum, &core_owner);
 	_vvalue_data_prep(vvalue, VVALUE_CNT(vvalue), 0, &ctx->gennum, sizeof(ctx->gennum));
 
 	if (sid_kvs_va_set(ctx->kvs_res,
@@ -7347,7 +8993,7 @@ static int _set_up_boot_id(struct sid_ucmd_common_ctx *ctx)
 
 	sid_res_log_debug(ctx->res, "Current system boot id: %s.", boot_id);
 
-	_vvalue_header_prep(vvalue, VVALUE_CNT(vvalue), &null_int, &value_flags_no_sync, &ctx->gennum, core_owner);
+	_vvalue_header_prep(vvalue, VVALUE_CNT(vvalue), &null_int, &value_flags_no_sync, &ctx->gennum, &core_owner);
 	_vvalue_data_prep(vvalue, VVALUE_CNT(vvalue), 0, boot_id, sizeof(boot_id));
 
 	if (sid_kvs_va_set(ctx->kvs_res,
@@ -7362,18 +9008,54 @@ static int _set_up_boot_id(struct sid_ucmd_common_ctx *ctx)
 	return 0;
 }
 
+/*
+ * Core record of a device found in udev db. Ready and reserved state records
+ * are collected for all the devices and set in one batch at the end of the
+ * import. The record owns everything the batch item refers to.
+ */
+struct import_rec {
+	char       *key; /* archive key, the record key follows its first character */
+	sid_kv_fl_t flags;
+	kv_vector_t vvalue[VVALUE_SINGLE_CNT];
+};
+
+static int _prep_import_rec(struct sid_ucmd_ctx *ucmd_ctx, struct import_rec *rec, const char *key_core, void *value, size_t size)
+{
+	if (!(rec->key = _compose_key(NULL,
+	                              &KV_KEY_SPEC(.ns      = SID_KV_NS_DEV,
+	                                           .ns_part = _get_ns_part(ucmd_ctx, _owner_name(NULL), SID_KV_NS_DEV),
+	                                           .id_cat  = ID_NULL,
+	                                           .id      = ID_NULL,
+	                                           .core    = key_core))))
+		return -ENOMEM;
+
+	rec->key[0] = KV_PREFIX_OP_ARCHIVE_C[0];
+	rec->flags  = SID_KV_FL_AR | SID_KV_FL_RD | SID_KV_FL_SUB_WR | SID_KV_FL_SUP_WR;
+
+	_vvalue_header_prep(rec->vvalue, VVALUE_CNT(rec->vvalue), &null_int, &rec->flags, &ucmd_ctx->common->gennum, &core_owner);
+	_vvalue_data_prep(rec->vvalue, VVALUE_CNT(rec->vvalue), 0, value, size);
+
+	return 0;
+}
+
 static int _ulink_import(sid_res_t *ubridge_res, struct sid_ucmd_common_ctx *common_ctx, struct ulink *ulink)
 {
-	struct sid_ucmd_ctx     ucmd_ctx = {0}; /* dummy context so we can still use _set_new_dev_kvs */
-	struct udev_enumerate  *udev_enum;
-	struct udev_list_entry *udev_entry;
-	const char             *udev_name;
-	struct udev_device     *udev_dev;
-	const char             *dev_id, *dev_seq, *dev_name;
-	const char             *partn = NULL;
-	dev_t                   dev_num;
-	char                    devno_buf[16];
-	int                     r;
+	static sid_dev_ready_t    ready    = SID_DEV_RDY_UNPROCESSED;
+	static sid_dev_reserved_t reserved = SID_DEV_RES_UNPROCESSED;
+	struct sid_ucmd_ctx       ucmd_ctx = {.dev_sysfs_fd = -1}; /* dummy context so we can still use _set_new_dev_alias_kvs */
+	struct kv_update_arg      update_arg;
+	struct import_rec        *recs = NULL;
+	struct sid_kvs_set_args  *args = NULL;
+	struct udev_enumerate    *udev_enum;
+	struct udev_list_entry   *udev_entry;
+	const char               *udev_name;
+	struct udev_device       *udev_dev;
+	const char               *dev_id, *dev_seq, *dev_name, *rec_name;
+	const char               *partn = NULL;
+	dev_t                     dev_num;
+	char                      devno_buf[16];
+	size_t                    i, nr_devs = 0, nr_recs = 0;
+	int                       r;
 
 	ucmd_ctx.common = common_ctx;
 
@@ -7387,6 +9069,27 @@ static int _ulink_import(sid_res_t *ubridge_res, struct sid_ucmd_common_ctx *com
 		return -1;
 	}
 
+	udev_list_entry_foreach(udev_entry, udev_enumerate_get_list_entry(udev_enum))
+	{
+		nr_devs++;
+	}
+
+	/* two records for each device: ready and reserved state */
+	if (nr_devs && (!(recs = calloc(2 * nr_devs, sizeof(*recs))) || !(args = calloc(2 * nr_devs, sizeof(*args))))) {
+		sid_res_log_error(ubridge_res, "Failed to allocate records to import.");
+		free(recs);
+		udev_enumerate_unref(udev_enum);
+		return -1;
+	}
+
+	if (!(ucmd_ctx.arena = mem_arena_create(SCRATCH_ARENA_CHUNK_SIZE))) {
+		sid_res_log_error(ubridge_res, "Failed to create scratch memory arena.");
+		free(args);
+		free(recs);
+		udev_enumerate_unref(udev_enum);
+		return -1;
+	}
+
 	r = 0;
 	udev_list_entry_foreach(udev_entry, udev_enumerate_get_list_entry(udev_enum))
 	{
@@ -7425,8 +9128,6 @@ static int _ulink_import(sid_res_t *ubridge_res, struct sid_ucmd_common_ctx *com
 		ucmd_ctx.req_env.dev.num_s     = devno_buf;
 		ucmd_ctx.req_env.dev.uid_s     = (char *) dev_id;
 		ucmd_ctx.req_env.dev.udev.name = dev_name;
-		ucmd_ctx.scan.dev_ready        = SID_DEV_RDY_UNDEFINED;
-		ucmd_ctx.scan.dev_reserved     = SID_DEV_RES_UNDEFINED;
 
 		sid_res_log_debug(ubridge_res,
 		                  "Found udev db record tagged with " UDEV_TAG_SID ". Importing id=%s, dseq=%s, devno=%s, name=%s.",
@@ -7435,16 +9136,47 @@ static int _ulink_import(sid_res_t *ubridge_res, struct sid_ucmd_common_ctx *com
 		                  devno_buf,
 		                  dev_name);
 
-		r = _set_new_dev_kvs(ubridge_res, &ucmd_ctx, true);
+		rec_name = "records";
+
+		if ((r = _prep_import_rec(&ucmd_ctx, &recs[nr_recs], KV_KEY_DEV_READY, &ready, sizeof(ready))) == 0 &&
+		    (r = _prep_import_rec(&ucmd_ctx, &recs[nr_recs + 1], KV_KEY_DEV_RESERVED, &reserved, sizeof(reserved))) == 0)
+			r = _set_new_dev_alias_kvs(ubridge_res, &ucmd_ctx, true, &rec_name);
+
+		/* a record prepared before a failure still needs to be freed */
+		nr_recs += recs[nr_recs + 1].key ? 2 : recs[nr_recs].key ? 1 : 0;
+
+		if (r < 0)
+			sid_res_log_error_errno(ubridge_res, r, _failed_new_dev_kv_msg, rec_name, dev_name, devno_buf, dev_seq);
 
 		if (partn)
 			free((void *) ucmd_ctx.req_env.dev.dsq_s);
 		udev_device_unref(udev_dev);
 
 		if (r < 0)
-			break;
+			goto out;
 	}
 
+	/* the device records follow one another in the store so set them in one go */
+	update_arg = KV_UPDATE_ARG(.res = common_ctx->kvs_res, .gen_buf = common_ctx->gen_buf, .ret_code = -EREMOTEIO);
+
+	for (i = 0; i < nr_recs; i++)
+		args[i] = (struct sid_kvs_set_args) {.key         = recs[i].key + 1,
+		                                     .value       = recs[i].vvalue,
+		                                     .size        = VVALUE_CNT(recs[i].vvalue),
+		                                     .flags       = SID_KVS_VAL_FL_VECTOR,
+		                                     .op_flags    = SID_KVS_VAL_OP_MERGE,
+		                                     .archive_key = recs[i].key,
+		                                     .fn          = _kv_cb_write,
+		                                     .fn_arg      = &update_arg};
+
+	if ((r = sid_kvs_set_batch(common_ctx->kvs_res, args, nr_recs, NULL)) < 0)
+		sid_res_log_error_errno(ubridge_res, r, "Failed to set ready and reserved state for imported devices");
+out:
+	for (i = 0; i < nr_recs; i++)
+		_destroy_key(NULL, recs[i].key);
+	free(args);
+	free(recs);
+	mem_arena_destroy(ucmd_ctx.arena);
 	udev_enumerate_unref(udev_enum);
 	return r;
 }
@@ -7482,6 +9214,27 @@ static int _set_up_ulink(sid_res_t *ubridge_res, struct sid_ucmd_common_ctx *com
 		goto fail;
 	}
 
+	if (!(ulink->mod_mon = udev_monitor_new_from_netlink(ulink->udev, "kernel"))) {
+		sid_res_log_error(ubridge_res, "Failed to create udev monitor for kernel modules.");
+		goto fail;
+	}
+
+	if (udev_monitor_filter_add_match_subsystem_devtype(ulink->mod_mon, SYSTEM_MODULE_SUBSYSTEM, NULL) < 0) {
+		sid_res_log_error(ubridge_res, "Failed to create kernel module subsystem filter.");
+		goto fail;
+	}
+
+	if (sid_res_ev_create_io(ubridge_res,
+	                         NULL,
+	                         udev_monitor_get_fd(ulink->mod_mon),
+	                         _on_ubridge_mod_umonitor_event,
+	                         0,
+	                         "udev module monitor",
+	                         ubridge_res) < 0) {
+		sid_res_log_error(ubridge_res, "Failed to register udev kernel module monitoring.");
+		goto fail;
+	}
+
 	if (_ulink_import(ubridge_res, common_ctx, ulink) < 0) {
 		sid_res_log_error(ubridge_res, "Failed to import records from udev database.");
 		goto fail;
@@ -7492,6 +9245,11 @@ static int _set_up_ulink(sid_res_t *ubridge_res, struct sid_ucmd_common_ctx *com
 		goto fail;
 	}
 
+	if (udev_monitor_enable_receiving(ulink->mod_mon) < 0) {
+		sid_res_log_error(ubridge_res, "Failed to enable udev kernel module monitoring.");
+		goto fail;
+	}
+
 	return 0;
 fail:
 	_destroy_ulink(ubridge_res, ulink);
@@ -7527,6 +9285,11 @@ static int _init_common(sid_res_t *res, const void *kickstart_data, void **data)
 		goto fail;
 	}
 
+	if ((r = sid_kvs_index_register(common_ctx->kvs_res, &kv_index_persist_spec)) < 0) {
+		sid_res_log_error_errno(res, r, "Failed to register persistent record index");
+		goto fail;
+	}
+
 	if (!(common_ctx->gen_buf = sid_buf_create(&SID_BUF_SPEC(), &SID_BUF_INIT(.alloc_step = PATH_MAX), &r))) {
 		sid_res_log_error_errno(res, r, "Failed to create generic buffer");
 		goto fail;
@@ -7536,6 +9299,9 @@ static int _init_common(sid_res_t *res, const void *kickstart_data, void **data)
 	if (_set_up_kv_store_generation(common_ctx) < 0 || _set_up_boot_id(common_ctx) < 0)
 		goto fail;
 
+	if (_refresh_dev_majors(res, &common_ctx->dev_majors) < 0)
+		goto fail;
+
 	{
 		mod_reg_res_params = &(struct sid_mod_reg_res_params) {
 			.directory     = SID_UCMD_BLOCK_MOD_DIR,
@@ -7560,7 +9326,8 @@ static int _init_common(sid_res_t *res, const void *kickstart_data, void **data)
 				SID_MOD_SYM_PARAMS(.name = SID_UCMD_MOD_FN_NAME_SCAN_ACTION_NEXT, .flags = SID_MOD_SYM_FL_INDIRECT),
 				SID_MOD_SYM_PARAMS(.name = SID_UCMD_MOD_FN_NAME_SCAN_B_EXIT, .flags = SID_MOD_SYM_FL_INDIRECT),
 				SID_MOD_SYM_PARAMS(.name  = SID_UCMD_MOD_FN_NAME_SCAN_ERROR,
-		                                   .flags = SID_MOD_SYM_FL_FAIL_ON_MISSING | SID_MOD_SYM_FL_INDIRECT)),
+		                                   .flags = SID_MOD_SYM_FL_FAIL_ON_MISSING | SID_MOD_SYM_FL_INDIRECT),
+				SID_MOD_SYM_PARAMS(.name = SID_UCMD_MOD_SYM_NAME_SCAN_CACHEABLE)),
 			.cb_arg = common_ctx,
 		};
 
@@ -7601,7 +9368,8 @@ static int _init_common(sid_res_t *res, const void *kickstart_data, void **data)
 				SID_MOD_SYM_PARAMS(.name = SID_UCMD_MOD_FN_NAME_SCAN_ACTION_NEXT, .flags = SID_MOD_SYM_FL_INDIRECT),
 				SID_MOD_SYM_PARAMS(.name = SID_UCMD_MOD_FN_NAME_SCAN_B_EXIT, .flags = SID_MOD_SYM_FL_INDIRECT),
 				SID_MOD_SYM_PARAMS(.name  = SID_UCMD_MOD_FN_NAME_SCAN_ERROR,
-		                                   .flags = SID_MOD_SYM_FL_FAIL_ON_MISSING | SID_MOD_SYM_FL_INDIRECT)),
+		                                   .flags = SID_MOD_SYM_FL_FAIL_ON_MISSING | SID_MOD_SYM_FL_INDIRECT),
+				SID_MOD_SYM_PARAMS(.name = SID_UCMD_MOD_SYM_NAME_SCAN_CACHEABLE)),
 			.cb_arg = common_ctx,
 		};
 
@@ -7628,6 +9396,11 @@ static int _init_common(sid_res_t *res, const void *kickstart_data, void **data)
 		}
 	}
 
+	if (!(common_ctx->block_mod_disp = _create_mod_disp(common_ctx->block_mod_reg_res))) {
+		sid_res_log_error(res, "Failed to create block module dispatch tables.");
+		goto fail;
+	}
+
 	if ((r = sid_mod_reg_load_mods(common_ctx->type_mod_reg_res)) < 0) {
 		if (r == -ENOENT)
 			sid_res_log_debug(res, "Type module directory %s not present.", SID_UCMD_TYPE_MOD_DIR);
@@ -7643,6 +9416,8 @@ static int _init_common(sid_res_t *res, const void *kickstart_data, void **data)
 	return 0;
 fail:
 	if (common_ctx) {
+		_destroy_mod_disp(common_ctx->block_mod_disp);
+		free(common_ctx->dev_majors.entries);
 		if (common_ctx->gen_buf)
 			sid_buf_destroy(common_ctx->gen_buf);
 		free(common_ctx);
@@ -7655,6 +9430,8 @@ static int _destroy_common(sid_res_t *res)
 {
 	struct sid_ucmd_common_ctx *common_ctx = sid_res_get_data(res);
 
+	_destroy_mod_disp(common_ctx->block_mod_disp);
+	free(common_ctx->dev_majors.entries);
 	sid_buf_destroy(common_ctx->gen_buf);
 	free(common_ctx);
 
@@ -7673,6 +9450,7 @@ static int _init_ubridge(sid_res_t *res, const void *kickstart_data, void **data
 		goto fail;
 	}
 	ubridge->socket_fd = -1;
+	list_init(&ubridge->watchers);
 
 	if (!(ubridge->internal_res = sid_res_create(res,
 	                                             &sid_res_type_aggr,
@@ -7779,12 +9557,21 @@ fail:
 static int _destroy_ubridge(sid_res_t *res)
 {
 	struct ubridge *ubridge = sid_res_get_data(res);
+	struct watcher *watcher, *tmp;
+
+	/* watchers' event sources are already destroyed together with this resource's event sources */
+	list_iterate_items_safe (watcher, tmp, &ubridge->watchers) {
+		list_del(&watcher->list);
+		_destroy_watcher(watcher);
+	}
 
 	_destroy_ulink(res, &ubridge->ulink);
 
 	if (ubridge->socket_fd != -1)
 		(void) close(ubridge->socket_fd);
 
+	_destroy_owner_tbl();
+
 	free(ubridge);
 	return 0;
 }
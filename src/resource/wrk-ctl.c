@@ -66,6 +66,7 @@ struct worker_init {
 struct worker_control {
 	sid_wrk_type_t              worker_type;
 	struct sid_wrk_init_cb_spec init_cb_spec;
+	struct sid_wrk_exit_cb_spec exit_cb_spec;
 	unsigned                    channel_spec_count;
 	struct sid_wrk_chan_spec   *channel_specs;
 	struct worker_init          worker_init;
@@ -87,6 +88,7 @@ struct worker_kickstart {
 	struct sid_wrk_chan        *channels;
 	unsigned                    channel_count;
 	struct sid_wrk_timeout_spec timeout_spec;
+	struct sid_wrk_exit_cb_spec exit_cb_spec;
 	void                       *arg;
 };
 
@@ -99,6 +101,7 @@ struct worker_proxy {
 	struct sid_wrk_chan        *channels;        /* NULL-terminated array of worker_proxy --> worker channels */
 	unsigned                    channel_count;
 	struct sid_wrk_timeout_spec timeout_spec;
+	struct sid_wrk_exit_cb_spec exit_cb_spec;
 	void                       *arg;
 };
 
@@ -909,6 +912,7 @@ static int _do_worker_control_get_new_worker(sid_res_t             *worker_contr
 	kickstart.channels      = worker_proxy_channels;
 	kickstart.channel_count = worker_control->channel_spec_count;
 	kickstart.arg           = params->worker_proxy_arg;
+	kickstart.exit_cb_spec  = worker_control->exit_cb_spec;
 
 	if (params->timeout_spec.usec)
 		/* override default timeout for this single worker */
@@ -1203,6 +1207,20 @@ void *sid_wrk_ctl_get_worker_arg(sid_res_t *res)
 	return NULL;
 }
 
+pid_t sid_wrk_ctl_get_worker_pid(sid_res_t *res)
+{
+	if (!res)
+		return 0;
+
+	do {
+		if (sid_res_match(res, &sid_res_type_wrk_prx, NULL) ||
+		    sid_res_match(res, &sid_res_type_wrk_prx_with_ev_loop, NULL))
+			return (((struct worker_proxy *) sid_res_get_data(res))->pid);
+	} while ((res = sid_res_search(res, SID_RES_SEARCH_IMM_ANC, NULL, NULL)));
+
+	return 0;
+}
+
 /* FIXME: Consider making this a part of event loop. */
 static int _chan_buf_send(const struct sid_wrk_chan *chan, worker_channel_cmd_t chan_cmd, struct sid_wrk_data_spec *data_spec)
 {
@@ -1389,7 +1407,8 @@ int sid_wrk_ctl_yield_worker(sid_res_t *res)
 
 static int _on_worker_proxy_child_event(sid_res_ev_src_t *es, const siginfo_t *si, void *data)
 {
-	sid_res_t *worker_proxy_res = data;
+	sid_res_t           *worker_proxy_res = data;
+	struct worker_proxy *worker_proxy     = sid_res_get_data(worker_proxy_res);
 
 	switch (si->si_code) {
 		case CLD_EXITED:
@@ -1408,6 +1427,9 @@ static int _on_worker_proxy_child_event(sid_res_ev_src_t *es, const siginfo_t *s
 
 	_change_worker_proxy_state(worker_proxy_res, SID_WRK_STATE_EXITED);
 
+	if (worker_proxy->exit_cb_spec.fn)
+		(void) worker_proxy->exit_cb_spec.fn(worker_proxy_res, si, worker_proxy->exit_cb_spec.arg);
+
 	/*
 	 * NOTE: We have set lower priority for this _on_worker_proxy_child_event handler
 	 * for us to be able to process all remaining events (e.g. data reception on channels)
@@ -1501,6 +1523,7 @@ static int _init_worker_proxy(sid_res_t *worker_proxy_res, const void *kickstart
 	worker_proxy->channels      = kickstart->channels;
 	worker_proxy->channel_count = kickstart->channel_count;
 	worker_proxy->timeout_spec  = kickstart->timeout_spec;
+	worker_proxy->exit_cb_spec  = kickstart->exit_cb_spec;
 	worker_proxy->arg           = kickstart->arg;
 
 	if (sid_res_ev_create_child(worker_proxy_res,
@@ -1654,6 +1677,7 @@ static int _init_worker_control(sid_res_t *worker_control_res, const void *kicks
 
 	worker_control->worker_type  = params->worker_type;
 	worker_control->init_cb_spec = params->init_cb_spec;
+	worker_control->exit_cb_spec = params->exit_cb_spec;
 	worker_control->timeout_spec = params->timeout_spec;
 
 	*data                        = worker_control;
@@ -9,6 +9,7 @@
 #include "internal/fmt.h"
 #include "log/log.h"
 
+#include <errno.h>
 #include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -28,21 +29,67 @@
 #define KEY_SID_MINOR        "SID_MINOR"
 #define KEY_SID_RELEASE      "SID_RELEASE"
 
-static int _sid_cmd(sid_ifc_cmd_t cmd, uint16_t format)
+static void _print_data(struct sid_ifc_req *req, const char *data, size_t size)
+{
+	if ((req->flags & SID_IFC_CMD_FL_FMT_MASK) == SID_IFC_CMD_FL_FMT_CBOR) {
+		/* binary output, the terminating null byte is not part of it */
+		if (size && data[size - 1] == '\0')
+			size--;
+		fwrite(data, 1, size, stdout);
+	} else
+		printf("%s", data);
+}
+
+static int _sid_cmd_watch(struct sid_ifc_req *req)
 {
 	struct sid_ifc_rsl *rsl = NULL;
 	const char         *data;
 	size_t              size;
+	uint64_t            status;
 	int                 r;
-	struct sid_ifc_req  req = {.cmd = cmd, .flags = format};
 
-	if ((r = sid_ifc_req(&req, &rsl)) < 0) {
+	if ((r = sid_ifc_req(req, &rsl)) < 0) {
+		sid_log_error_errno(LOG_PREFIX, r, "Command request failed");
+		return -1;
+	}
+
+	if (sid_ifc_rsl_get_status(rsl, &status) != 0 || status & SID_IFC_CMD_STATUS_FAILURE) {
+		sid_log_error(LOG_PREFIX, "Command failed");
+		r = -1;
+		goto out;
+	}
+
+	/* each message carries change records from one update of the database */
+	while ((r = sid_ifc_rsl_next(rsl)) == 0) {
+		if ((data = sid_ifc_rsl_get_data(rsl, &size)) != NULL) {
+			_print_data(req, data, size);
+			fflush(stdout);
+		}
+	}
+
+	if (r == -ENODATA)
+		r = 0;
+	else
+		sid_log_error_errno(LOG_PREFIX, r, "Failed to receive change records");
+out:
+	sid_ifc_rsl_free(rsl);
+	return r;
+}
+
+static int _sid_cmd(struct sid_ifc_req *req)
+{
+	struct sid_ifc_rsl *rsl = NULL;
+	const char         *data;
+	size_t              size;
+	int                 r;
+
+	if ((r = sid_ifc_req(req, &rsl)) < 0) {
 		sid_log_error_errno(LOG_PREFIX, r, "Command request failed");
 		return -1;
 	}
 
 	if ((data = sid_ifc_rsl_get_data(rsl, &size)) != NULL)
-		printf("%s", data);
+		_print_data(req, data, size);
 	else {
 		uint64_t status;
 		if (sid_ifc_rsl_get_status(rsl, &status) != 0 || status & SID_IFC_CMD_STATUS_FAILURE) {
@@ -77,7 +124,7 @@ static int _sid_cmd_version(uint16_t format)
 	if ((r = sid_buf_write_all(outbuf, fileno(stdout))) < 0)
 		sid_log_error_errno(LOG_PREFIX, r, "failed to write version information");
 	sid_buf_reset(outbuf);
-	if (_sid_cmd(SID_IFC_CMD_VERSION, format) < 0) {
+	if (_sid_cmd(&((struct sid_ifc_req) {.cmd = SID_IFC_CMD_VERSION, .flags = format})) < 0) {
 		fmt_doc_start(format, outbuf, 0);
 		fmt_doc_end(format, outbuf, 0);
 	} else
@@ -98,10 +145,10 @@ static void _help(FILE *f)
 	        "Control and Query the SID daemon.\n"
 	        "\n"
 	        "Global options:\n"
-	        "    -f|--format env|json|table  Show the output in specified format.\n"
-	        "    -h|--help                   Show this help information.\n"
-	        "    -v|--verbose                Verbose mode, repeat to increase level.\n"
-	        "    -V|--version                Show SIDCTL version.\n"
+	        "    -f|--format env|json|table|cbor  Show the output in specified format.\n"
+	        "    -h|--help                        Show this help information.\n"
+	        "    -v|--verbose                     Verbose mode, repeat to increase level.\n"
+	        "    -V|--version                     Show SIDCTL version.\n"
 	        "\n"
 	        "Commands and arguments:\n"
 	        "\n"
@@ -113,8 +160,20 @@ static void _help(FILE *f)
 	        "\n"
 	        "    dbdump\n"
 	        "      Dump the SID daemon database.\n"
-	        "      Input:  None.\n"
-	        "      Output: Listing of all database entries.\n"
+	        "      Input:  None or any combination of these filters:\n"
+	        "                --ns udev|dev|mod|devmod|glob  Only entries in given namespace.\n"
+	        "                --dev <device>                 Only entries for given device ID, major:minor,\n"
+	        "                                               device name or device alias key.\n"
+	        "                --mod <module>                 Only entries owned by given module (full name).\n"
+	        "                --prefix <prefix>              Only entries with keys starting with given prefix.\n"
+	        "      Output: Listing of all matching database entries.\n"
+	        "\n"
+	        "    watch\n"
+	        "      Watch changes in the SID daemon database until interrupted.\n"
+	        "      Input:  None or any combination of these filters:\n"
+	        "                --ns udev|dev|mod|devmod|glob  Only entries in given namespace.\n"
+	        "                --prefix <prefix>              Only entries with keys starting with given prefix.\n"
+	        "      Output: Listing of changed entries with old and new values for each database update.\n"
 	        "\n"
 	        "    dbstats\n"
 	        "      Show stats for the SID daemon database.\n"
@@ -150,22 +209,30 @@ static int _get_format(char *format)
 		return SID_IFC_CMD_FL_FMT_ENV;
 	if (!strcasecmp(format, "table"))
 		return SID_IFC_CMD_FL_FMT_TABLE;
+	if (!strcasecmp(format, "cbor"))
+		return SID_IFC_CMD_FL_FMT_CBOR;
 	return -1;
 }
 
 int main(int argc, char *argv[])
 {
-	int           opt;
-	int           verbose = 0;
-	int           r       = -1;
-	int           format  = SID_IFC_CMD_FL_FMT_TABLE;
-	sid_ifc_cmd_t cmd;
+	int                        opt;
+	int                        verbose = 0;
+	int                        r       = -1;
+	int                        format  = SID_IFC_CMD_FL_FMT_TABLE;
+	sid_ifc_cmd_t              cmd;
+	struct sid_ifc_dbdump_data dbdump  = {0};
+	bool                       filter  = false;
 
 	struct option longopts[] = {
 		{"format", required_argument, NULL, 'f'},
 		{"help", no_argument, NULL, 'h'},
 		{"verbose", no_argument, NULL, 'v'},
 		{"version", no_argument, NULL, 'V'},
+		{"ns", required_argument, NULL, 'n'},
+		{"dev", required_argument, NULL, 'd'},
+		{"mod", required_argument, NULL, 'm'},
+		{"prefix", required_argument, NULL, 'p'},
 		{NULL, no_argument, NULL, 0},
 	};
 
@@ -186,6 +253,22 @@ int main(int argc, char *argv[])
 			case 'V':
 				_version(stdout);
 				return EXIT_SUCCESS;
+			case 'n':
+				dbdump.ns = optarg;
+				filter    = true;
+				break;
+			case 'd':
+				dbdump.dev = optarg;
+				filter     = true;
+				break;
+			case 'm':
+				dbdump.mod = optarg;
+				filter     = true;
+				break;
+			case 'p':
+				dbdump.prefix = optarg;
+				filter        = true;
+				break;
 			default:
 				_help(stderr);
 				return EXIT_FAILURE;
@@ -199,15 +282,29 @@ int main(int argc, char *argv[])
 
 	sid_log_init(SID_LOG_TGT_STANDARD, verbose);
 
-	switch ((cmd = sid_ifc_cmd_name_to_type(argv[optind]))) {
+	cmd = sid_ifc_cmd_name_to_type(argv[optind]);
+
+	if (filter && cmd != SID_IFC_CMD_DBDUMP && (cmd != SID_IFC_CMD_WATCH || dbdump.dev || dbdump.mod)) {
+		sid_log_error(LOG_PREFIX, "Filters can be used only with dbdump and watch commands (--ns and --prefix).");
+		return EXIT_FAILURE;
+	}
+
+	switch (cmd) {
 		case SID_IFC_CMD_VERSION:
 			r = _sid_cmd_version(format);
 			break;
 		case SID_IFC_CMD_DBDUMP:
+			r = _sid_cmd(&((struct sid_ifc_req) {.cmd = cmd, .flags = format, .data.dbdump = dbdump}));
+			break;
+		case SID_IFC_CMD_WATCH:
+			r = _sid_cmd_watch(&((struct sid_ifc_req) {.cmd        = cmd,
+			                                           .flags      = format,
+			                                           .data.watch = {.ns = dbdump.ns, .prefix = dbdump.prefix}}));
+			break;
 		case SID_IFC_CMD_DBSTATS:
 		case SID_IFC_CMD_RESOURCES:
 		case SID_IFC_CMD_DEVICES:
-			r = _sid_cmd(cmd, format);
+			r = _sid_cmd(&((struct sid_ifc_req) {.cmd = cmd, .flags = format}));
 			break;
 		default:
 			_help(stderr);
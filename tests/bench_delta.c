@@ -0,0 +1,405 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2017-2025 Red Hat, Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/*
+ * Benchmark for vector value delta calculation. It runs the step and absolute
+ * delta calculation over vectors with given number of members, as used for
+ * large device groups (e.g. multipath or LVM), with the vdelta merge and with
+ * a reference implementation of the former sid_buf/bitmap/qsort calculation.
+ * Results of both are compared and the time spent for each is reported.
+ *
+ * Usage: bench_delta [number of members] [number of rounds]
+ */
+
+#include "base/buf.h"
+#include "internal/bmp.h"
+#include "internal/mem.h"
+#include "internal/vdelta.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define BENCH_DEFAULT_ROUNDS 100
+#define BENCH_ITEM_SIZE      48
+
+static const size_t _default_members[] = {1000, 5000, 10000};
+
+struct delta_input {
+	struct vdelta_vec old;       /* stored vector */
+	struct vdelta_vec new;       /* vector to set */
+	struct vdelta_vec old_plus;  /* stored absolute plus */
+	struct vdelta_vec old_minus; /* stored absolute minus */
+	char             *mem;
+};
+
+struct delta_result {
+	struct vdelta_vec plus;
+	struct vdelta_vec minus;
+	struct vdelta_vec final;
+	struct vdelta_vec abs_plus;
+	struct vdelta_vec abs_minus;
+};
+
+static double _elapsed_ms(struct timespec *start, struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) * 1e3 + (end->tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static void _vec_fill(struct vdelta_vec *vec, char *mem, size_t from, size_t count, size_t step)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		vec->v[i].iov_base = mem + (from + i * step) * BENCH_ITEM_SIZE;
+		vec->v[i].iov_len  = strlen(vec->v[i].iov_base) + 1;
+	}
+
+	vec->cnt = count;
+}
+
+/*
+ * Member names are zero-padded so the numeric order is the same as strcmp order.
+ * The new vector drops the first tenth of the old vector and adds a new tenth at
+ * the end. Stored absolute delta has every 7th and every 11th member so some of
+ * the items cancel each other out.
+ */
+static int _input_init(struct delta_input *in, size_t members)
+{
+	size_t all = members + members / 10 + 1, i;
+
+	if (!(in->mem = malloc(all * BENCH_ITEM_SIZE)))
+		return -1;
+
+	for (i = 0; i < all; i++)
+		snprintf(in->mem + i * BENCH_ITEM_SIZE, BENCH_ITEM_SIZE, "D:dm-uuid-mpath-%012zu", i);
+
+	in->old.v       = malloc(members * sizeof(struct iovec));
+	in->new.v       = malloc(members * sizeof(struct iovec));
+	in->old_plus.v  = malloc((members / 7 + 1) * sizeof(struct iovec));
+	in->old_minus.v = malloc((members / 11 + 1) * sizeof(struct iovec));
+
+	if (!in->old.v || !in->new.v || !in->old_plus.v || !in->old_minus.v)
+		return -1;
+
+	_vec_fill(&in->old, in->mem, 0, members, 1);
+	_vec_fill(&in->new, in->mem, members / 10, members, 1);
+	_vec_fill(&in->old_plus, in->mem, 0, members / 7 + 1, 7);
+	_vec_fill(&in->old_minus, in->mem, 0, members / 11 + 1, 11);
+
+	return 0;
+}
+
+static void _input_destroy(struct delta_input *in)
+{
+	free(in->old.v);
+	free(in->new.v);
+	free(in->old_plus.v);
+	free(in->old_minus.v);
+	free(in->mem);
+}
+
+/*
+ * Reference implementation - former calculation based on vector buffers.
+ */
+static struct sid_buf *_ref_buf_create(size_t size)
+{
+	return sid_buf_create(&SID_BUF_SPEC(.type = SID_BUF_TYPE_VECTOR), &SID_BUF_INIT(.size = size ?: 1), NULL);
+}
+
+static int _ref_buf_add(struct sid_buf *buf, const struct iovec *item)
+{
+	return sid_buf_add(buf, item->iov_base, item->iov_len, NULL, NULL);
+}
+
+static int _ref_step(const struct vdelta_vec *old,
+                     const struct vdelta_vec *new,
+                     struct sid_buf          *plus,
+                     struct sid_buf          *minus,
+                     struct sid_buf          *final)
+{
+	size_t i_old = 0, i_new = 0;
+	int    cmp_result, r = 0;
+
+	while (!r && (i_old < old->cnt || i_new < new->cnt)) {
+		if (i_old == old->cnt)
+			cmp_result = 1;
+		else if (i_new == new->cnt)
+			cmp_result = -1;
+		else
+			cmp_result = strcmp(old->v[i_old].iov_base, new->v[i_new].iov_base);
+
+		if (cmp_result < 0)
+			r = _ref_buf_add(minus, &old->v[i_old++]);
+		else if (cmp_result > 0) {
+			if (!(r = _ref_buf_add(plus, &new->v[i_new])))
+				r = _ref_buf_add(final, &new->v[i_new]);
+			i_new++;
+		} else {
+			r = _ref_buf_add(final, &new->v[i_new]);
+			i_old++;
+			i_new++;
+		}
+	}
+
+	return r;
+}
+
+static void _ref_cross_bitmap_calc(const struct vdelta_vec *old,
+                                   struct bmp              *old_bmp,
+                                   const struct vdelta_vec *new,
+                                   struct bmp              *new_bmp)
+{
+	size_t i_old = 0, i_new = 0;
+	int    cmp_result;
+
+	while (i_old < old->cnt && i_new < new->cnt) {
+		cmp_result = strcmp(old->v[i_old].iov_base, new->v[i_new].iov_base);
+		if (cmp_result < 0)
+			i_old++;
+		else if (cmp_result > 0)
+			i_new++;
+		else {
+			bmp_unset_bit(old_bmp, i_old++);
+			bmp_unset_bit(new_bmp, i_new++);
+		}
+	}
+}
+
+static int _ref_add_set(struct sid_buf *buf, const struct vdelta_vec *vec, struct bmp *bmp)
+{
+	size_t i;
+	int    r;
+
+	for (i = 0; i < vec->cnt; i++) {
+		if (bmp_bit_is_set(bmp, i, NULL) && (r = _ref_buf_add(buf, &vec->v[i])) < 0)
+			return r;
+	}
+
+	return 0;
+}
+
+static int _ref_str_cmp(const void *a, const void *b)
+{
+	return strcmp(((const struct iovec *) a)->iov_base, ((const struct iovec *) b)->iov_base);
+}
+
+static int _ref_abs(const struct delta_input *in,
+                    const struct vdelta_vec  *new_plus,
+                    const struct vdelta_vec  *new_minus,
+                    struct sid_buf          **abs_plus,
+                    struct sid_buf          **abs_minus)
+{
+	struct bmp   *old_plus_bmp, *old_minus_bmp, *new_plus_bmp, *new_minus_bmp;
+	struct iovec *v;
+	size_t        size;
+	int           r = -1;
+
+	old_plus_bmp  = bmp_create(in->old_plus.cnt, true, NULL);
+	old_minus_bmp = bmp_create(in->old_minus.cnt, true, NULL);
+	new_plus_bmp  = bmp_create(new_plus->cnt ?: 1, true, NULL);
+	new_minus_bmp = bmp_create(new_minus->cnt ?: 1, true, NULL);
+
+	if (!old_plus_bmp || !old_minus_bmp || !new_plus_bmp || !new_minus_bmp)
+		goto out;
+
+	_ref_cross_bitmap_calc(&in->old_plus, old_plus_bmp, new_minus, new_minus_bmp);
+	_ref_cross_bitmap_calc(&in->old_minus, old_minus_bmp, new_plus, new_plus_bmp);
+
+	if (!(*abs_plus = _ref_buf_create(bmp_get_bit_set_count(old_plus_bmp) + bmp_get_bit_set_count(new_plus_bmp))) ||
+	    !(*abs_minus = _ref_buf_create(bmp_get_bit_set_count(old_minus_bmp) + bmp_get_bit_set_count(new_minus_bmp))))
+		goto out;
+
+	if (_ref_add_set(*abs_plus, &in->old_plus, old_plus_bmp) < 0 || _ref_add_set(*abs_minus, new_minus, new_minus_bmp) < 0 ||
+	    _ref_add_set(*abs_minus, &in->old_minus, old_minus_bmp) < 0 || _ref_add_set(*abs_plus, new_plus, new_plus_bmp) < 0)
+		goto out;
+
+	sid_buf_get_data(*abs_plus, (const void **) &v, &size);
+	qsort(v, size, sizeof(struct iovec), _ref_str_cmp);
+	sid_buf_get_data(*abs_minus, (const void **) &v, &size);
+	qsort(v, size, sizeof(struct iovec), _ref_str_cmp);
+
+	r = 0;
+out:
+	if (old_plus_bmp)
+		bmp_destroy(old_plus_bmp);
+	if (old_minus_bmp)
+		bmp_destroy(old_minus_bmp);
+	if (new_plus_bmp)
+		bmp_destroy(new_plus_bmp);
+	if (new_minus_bmp)
+		bmp_destroy(new_minus_bmp);
+	return r;
+}
+
+static struct vdelta_vec _ref_buf_vec(struct sid_buf *buf)
+{
+	struct vdelta_vec vec;
+
+	sid_buf_get_data(buf, (const void **) &vec.v, &vec.cnt);
+	return vec;
+}
+
+static int _ref_round(const struct delta_input *in, struct delta_result *res, struct sid_buf *bufs[5])
+{
+	struct vdelta_vec new_plus, new_minus;
+	int               i;
+
+	for (i = 0; i < 5; i++) {
+		if (bufs[i])
+			sid_buf_destroy(bufs[i]);
+		bufs[i] = NULL;
+	}
+
+	if (!(bufs[0] = _ref_buf_create(in->new.cnt)) || !(bufs[1] = _ref_buf_create(in->old.cnt)) ||
+	    !(bufs[2] = _ref_buf_create(in->old.cnt + in->new.cnt)))
+		return -1;
+
+	if (_ref_step(&in->old, &in->new, bufs[0], bufs[1], bufs[2]) < 0)
+		return -1;
+
+	new_plus  = _ref_buf_vec(bufs[0]);
+	new_minus = _ref_buf_vec(bufs[1]);
+
+	if (_ref_abs(in, &new_plus, &new_minus, &bufs[3], &bufs[4]) < 0)
+		return -1;
+
+	res->plus      = new_plus;
+	res->minus     = new_minus;
+	res->final     = _ref_buf_vec(bufs[2]);
+	res->abs_plus  = _ref_buf_vec(bufs[3]);
+	res->abs_minus = _ref_buf_vec(bufs[4]);
+
+	return 0;
+}
+
+/*
+ * The vdelta merge with scratch memory from an arena, released after each round.
+ */
+static int _vdelta_round(const struct delta_input *in, struct delta_result *res, struct mem_arena *arena)
+{
+	size_t        old_cnt = in->old.cnt, new_cnt = in->new.cnt;
+	struct iovec *mem;
+
+	if (!(mem = mem_arena_alloc(arena,
+	                            (2 * (old_cnt + new_cnt) + in->old_plus.cnt + in->old_minus.cnt + old_cnt + new_cnt) *
+	                                    sizeof(struct iovec))))
+		return -1;
+
+	res->plus      = (struct vdelta_vec) {.v = mem};
+	res->minus     = (struct vdelta_vec) {.v = mem += new_cnt};
+	res->final     = (struct vdelta_vec) {.v = mem += old_cnt};
+	res->abs_plus  = (struct vdelta_vec) {.v = mem += old_cnt + new_cnt};
+	res->abs_minus = (struct vdelta_vec) {.v = mem += in->old_plus.cnt + new_cnt};
+
+	vdelta_step(VDELTA_OP_SET, &in->old, &in->new, &res->plus, &res->minus, &res->final);
+	vdelta_abs(&in->old_plus, &in->old_minus, &res->plus, &res->minus, &res->abs_plus, &res->abs_minus);
+
+	return 0;
+}
+
+static int _vec_cmp(const char *name, const struct vdelta_vec *a, const struct vdelta_vec *b)
+{
+	size_t i;
+
+	if (a->cnt != b->cnt) {
+		fprintf(stderr, "%s: item count mismatch: %zu != %zu\n", name, a->cnt, b->cnt);
+		return -1;
+	}
+
+	for (i = 0; i < a->cnt; i++) {
+		if (strcmp(a->v[i].iov_base, b->v[i].iov_base)) {
+			fprintf(stderr,
+			        "%s: item %zu mismatch: %s != %s\n",
+			        name,
+			        i,
+			        (const char *) a->v[i].iov_base,
+			        (const char *) b->v[i].iov_base);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int _bench(size_t members, unsigned rounds)
+{
+	struct delta_input    in = {0};
+	struct delta_result   ref = {0}, res = {0};
+	struct sid_buf       *bufs[5] = {0};
+	struct mem_arena     *arena   = NULL;
+	struct mem_arena_mark mark;
+	struct timespec       start, end;
+	double                ref_ms, vdelta_ms;
+	unsigned              round;
+	int                   i, r = -1;
+
+	if (_input_init(&in, members) < 0 || !(arena = mem_arena_create(16384)))
+		goto out;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (round = 0; round < rounds; round++) {
+		if (_ref_round(&in, &ref, bufs) < 0)
+			goto out;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	ref_ms = _elapsed_ms(&start, &end);
+
+	mark = mem_arena_get_mark(arena);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (round = 0; round < rounds; round++) {
+		mem_arena_release(arena, mark);
+		if (_vdelta_round(&in, &res, arena) < 0)
+			goto out;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	vdelta_ms = _elapsed_ms(&start, &end);
+
+	if (_vec_cmp("plus", &ref.plus, &res.plus) < 0 || _vec_cmp("minus", &ref.minus, &res.minus) < 0 ||
+	    _vec_cmp("final", &ref.final, &res.final) < 0 || _vec_cmp("abs plus", &ref.abs_plus, &res.abs_plus) < 0 ||
+	    _vec_cmp("abs minus", &ref.abs_minus, &res.abs_minus) < 0)
+		goto out;
+
+	printf("%6zu members %u rounds  reference %10.3f ms  vdelta %10.3f ms  speedup %6.2fx\n",
+	       members,
+	       rounds,
+	       ref_ms,
+	       vdelta_ms,
+	       vdelta_ms > 0 ? ref_ms / vdelta_ms : 0);
+
+	r = 0;
+out:
+	for (i = 0; i < 5; i++) {
+		if (bufs[i])
+			sid_buf_destroy(bufs[i]);
+	}
+	mem_arena_destroy(arena);
+	_input_destroy(&in);
+
+	if (r < 0)
+		fprintf(stderr, "%zu members: delta calculation failed\n", members);
+	return r;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned rounds = BENCH_DEFAULT_ROUNDS;
+	size_t   i;
+
+	if (argc > 2)
+		rounds = strtoul(argv[2], NULL, 10);
+
+	if (argc > 1)
+		return _bench(strtoul(argv[1], NULL, 10), rounds) < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+
+	for (i = 0; i < sizeof(_default_members) / sizeof(_default_members[0]); i++) {
+		if (_bench(_default_members[i], rounds) < 0)
+			return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
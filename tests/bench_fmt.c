@@ -0,0 +1,117 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2017-2025 Red Hat, Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/*
+ * Benchmark for the output formatter. It formats a synthetic dbdump with
+ * the same sequence of fmt_* calls as the dbdump command uses for each
+ * record and reports the time spent for each output format.
+ *
+ * Usage: bench_fmt [number of records]
+ */
+
+#include "base/buf.h"
+#include "internal/fmt.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_DEFAULT_RECORDS 100000
+
+static const char *const _flags[] = {"AL", "SC", "PS", "AR", "RS", "FR_RD", "SB_RD", "SP_RD", "FR_WR", "SB_WR", "SP_WR"};
+
+static int _format_record(fmt_output_t format, struct sid_buf *buf, unsigned rec, bool with_comma)
+{
+	char key[128];
+	char value[64];
+	int  i, r = 0;
+
+	snprintf(key, sizeof(key), "::D:9e5bc6f1-0b2a-4c47-a4cd-%012u:::#RDY_%u", rec, rec % 7);
+	snprintf(value, sizeof(value), "/dev/mapper/vg%u-lv%u \"synthetic\"", rec % 13, rec);
+
+	r |= fmt_elm_start(format, buf, 2, with_comma);
+	r |= fmt_fld_uint(format, buf, 3, "RECORD", rec, false);
+	r |= fmt_fld_str(format, buf, 3, "key", key, true);
+	r |= fmt_fld_uint(format, buf, 3, "gennum", rec % 3, true);
+	r |= fmt_fld_uint64(format, buf, 3, "seqnum", UINT64_C(1) << 40 | rec, true);
+
+	r |= fmt_arr_start(format, buf, 3, "flags", true);
+	for (i = 0; i < rec % 4; i++)
+		r |= fmt_arr_fld_str(format, buf, 4, _flags[(rec + i) % 11], i > 0);
+	r |= fmt_arr_end(format, buf, 3);
+
+	r |= fmt_fld_str(format, buf, 3, "owner", rec % 2 ? "/type/dm" : "/", true);
+
+	if (rec % 5) {
+		r |= fmt_fld_str(format, buf, 3, "value", value, true);
+	} else {
+		r |= fmt_arr_start(format, buf, 3, "values", true);
+		for (i = 0; i < 4; i++)
+			r |= fmt_arr_fld_str(format, buf, 4, value, i > 0);
+		r |= fmt_arr_end(format, buf, 3);
+	}
+
+	r |= fmt_elm_end(format, buf, 2);
+
+	return r;
+}
+
+static int _bench(fmt_output_t format, const char *name, unsigned records)
+{
+	struct sid_buf *buf;
+	struct timespec start, end;
+	size_t          size;
+	unsigned        rec;
+	int             r = 0;
+
+	if (!(buf = sid_buf_create(&SID_BUF_SPEC(.backend = SID_BUF_BACKEND_MEMFD, .mode = SID_BUF_MODE_SIZE_PREFIX),
+	                           &SID_BUF_INIT(.alloc_step = PATH_MAX),
+	                           &r)))
+		return r;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	r |= fmt_doc_start(format, buf, 0);
+	r |= fmt_arr_start(format, buf, 1, "siddb", false);
+	for (rec = 0; rec < records; rec++)
+		r |= _format_record(format, buf, rec, rec > 0);
+	r |= fmt_arr_end(format, buf, 1);
+	r |= fmt_doc_end(format, buf, 0);
+	r |= fmt_null_byte(buf);
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	size = sid_buf_count(buf);
+	sid_buf_destroy(buf);
+
+	if (r) {
+		fprintf(stderr, "%s: formatting failed\n", name);
+		return -1;
+	}
+
+	printf("%-6s %u records %10zu bytes %10.3f ms\n",
+	       name,
+	       records,
+	       size,
+	       (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6);
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned records = BENCH_DEFAULT_RECORDS;
+
+	if (argc > 1)
+		records = strtoul(argv[1], NULL, 10);
+
+	if (_bench(FMT_JSON, "json", records) < 0 || _bench(FMT_ENV, "env", records) < 0 ||
+	    _bench(FMT_TABLE, "table", records) < 0 || _bench(FMT_CBOR, "cbor", records) < 0)
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,163 @@
+/*
+ * SPDX-FileCopyrightText: (C) 2017-2025 Red Hat, Inc.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+/*
+ * Benchmark for setting many records in the key-value store at once. It sets
+ * records in random key order into a store which already contains records
+ * with given number of keys, first with a loop of single sid_kvs_set calls,
+ * then with the same loop under a transaction and finally with one
+ * sid_kvs_set_batch call, and reports the time spent for each.
+ *
+ * Usage: bench_kvs [number of records] [number of records to set]
+ */
+
+#include "resource/kvs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define BENCH_DEFAULT_RECORDS 100000
+#define BENCH_DEFAULT_SETS    10000
+#define BENCH_KEY_SIZE        64
+
+static const struct sid_kvs_res_params _kvs_params = {.backend = SID_KVS_BACKEND_BPTREE, .bptree.order = 4};
+
+typedef enum {
+	BENCH_LOOP,
+	BENCH_LOOP_TRANS,
+	BENCH_BATCH,
+} bench_method_t;
+
+static void _make_key(char *key, unsigned rec)
+{
+	snprintf(key, BENCH_KEY_SIZE, "::D:9e5bc6f1-0b2a-4c47-a4cd-%012u:::#RDY", rec);
+}
+
+static sid_res_t *_create_store(unsigned records)
+{
+	sid_res_t *kvs_res;
+	char       key[BENCH_KEY_SIZE];
+	unsigned   rec;
+
+	if (!(kvs_res = sid_res_create(SID_RES_NO_PARENT,
+	                               &sid_res_type_kvs,
+	                               SID_RES_FL_NONE,
+	                               "benchkvs",
+	                               &_kvs_params,
+	                               SID_RES_PRIO_NORMAL,
+	                               SID_RES_NO_SERVICE_LINKS)))
+		return NULL;
+
+	/* every other key is left out so the sets are both updates and additions */
+	for (rec = 0; rec < records; rec++) {
+		_make_key(key, rec * 2);
+
+		if (sid_kvs_va_set(kvs_res, .key = key, .value = "old", .size = sizeof("old")) < 0) {
+			sid_res_unref(kvs_res);
+			return NULL;
+		}
+	}
+
+	return kvs_res;
+}
+
+static int _bench(bench_method_t method, const char *name, unsigned records, struct sid_kvs_set_args *args, unsigned sets)
+{
+	sid_res_t      *kvs_res;
+	struct timespec start, end;
+	unsigned        i;
+	int             r = 0;
+
+	if (!(kvs_res = _create_store(records))) {
+		fprintf(stderr, "%s: failed to create key-value store\n", name);
+		return -1;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	switch (method) {
+		case BENCH_LOOP:
+			for (i = 0; i < sets && !r; i++)
+				r = sid_kvs_set(kvs_res, &args[i]);
+			break;
+
+		case BENCH_LOOP_TRANS:
+			if ((r = sid_kvs_transaction_begin(kvs_res)) < 0)
+				break;
+			for (i = 0; i < sets && !r; i++)
+				r = sid_kvs_set(kvs_res, &args[i]);
+			sid_kvs_transaction_end(kvs_res, r < 0);
+			break;
+
+		case BENCH_BATCH:
+			r = sid_kvs_set_batch(kvs_res, args, sets, NULL);
+			break;
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	sid_res_unref(kvs_res);
+
+	if (r < 0) {
+		fprintf(stderr, "%s: setting records failed\n", name);
+		return -1;
+	}
+
+	printf("%-10s %u records %u sets %10.3f ms\n",
+	       name,
+	       records,
+	       sets,
+	       (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6);
+
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	unsigned                 records = BENCH_DEFAULT_RECORDS;
+	unsigned                 sets    = BENCH_DEFAULT_SETS;
+	struct sid_kvs_set_args *args    = NULL;
+	char                    *keys    = NULL;
+	char                    *key;
+	unsigned                 i, j;
+	struct sid_kvs_set_args  tmp;
+	int                      r = EXIT_FAILURE;
+
+	if (argc > 1)
+		records = strtoul(argv[1], NULL, 10);
+	if (argc > 2)
+		sets = strtoul(argv[2], NULL, 10);
+
+	if (!sets || !(args = calloc(sets, sizeof(*args))) || !(keys = malloc((size_t) sets * BENCH_KEY_SIZE)))
+		goto out;
+
+	for (i = 0; i < sets; i++) {
+		key = keys + (size_t) i * BENCH_KEY_SIZE;
+		_make_key(key, i);
+		args[i] = (struct sid_kvs_set_args) {.key = key, .value = "new", .size = sizeof("new")};
+	}
+
+	/* shuffle with fixed seed so each run sets records in the same order */
+	srand(1);
+	for (i = sets - 1; i > 0; i--) {
+		j       = rand() % (i + 1);
+		tmp     = args[i];
+		args[i] = args[j];
+		args[j] = tmp;
+	}
+
+	if (_bench(BENCH_LOOP, "loop", records, args, sets) < 0 ||
+	    _bench(BENCH_LOOP_TRANS, "loop+trans", records, args, sets) < 0 ||
+	    _bench(BENCH_BATCH, "batch", records, args, sets) < 0)
+		goto out;
+
+	r = EXIT_SUCCESS;
+out:
+	free(keys);
+	free(args);
+	return r;
+}
@@ -589,6 +589,57 @@ static void test_bptree_remove_3_height()
 	do_test_bptree_actions(ids, 22, ids, 22, false, 0);
 }
 
+/* the leaf found through the cursor must be the one found by descending from the root */
+static void assert_cursor_leaf(bptree_t *bptree, const char *key)
+{
+	bptree_cursor_t cursor = bptree->cursor;
+	bptree_node_t  *leaf   = _find_leaf(bptree, key);
+
+	bptree->cursor = (bptree_cursor_t) {0};
+	assert_ptr_equal(_find_leaf(bptree, key), leaf);
+	bptree->cursor = cursor;
+}
+
+static void test_bptree_cursor()
+{
+	checker_t *checker = init_checker(150);
+	bptree_t  *bptree  = bptree_create(4);
+	int        i;
+
+	assert_non_null(bptree);
+	bptree_cursor_begin(bptree);
+
+	/* in order, then in between the keys already in the tree */
+	for (i = 0; i < 150; i += 2) {
+		insert_from_checker(bptree, checker, i);
+		assert_cursor_leaf(bptree, checker->keys[i]);
+	}
+	for (i = 1; i < 150; i += 2) {
+		assert_cursor_leaf(bptree, checker->keys[i]);
+		insert_from_checker(bptree, checker, i);
+		assert_cursor_leaf(bptree, checker->keys[i - 1]);
+		lookup_from_checker(bptree, checker, i);
+	}
+	verify_bptree(bptree);
+
+	/* removals change the tree's structure */
+	for (i = 10; i < 140; i += 3) {
+		remove_from_checker(bptree, checker, i);
+		assert_cursor_leaf(bptree, checker->keys[i + 1]);
+		lookup_from_checker(bptree, checker, i + 1);
+	}
+	for (i = 0; i < 150; i++)
+		assert_cursor_leaf(bptree, checker->keys[i]);
+
+	bptree_cursor_end(bptree);
+	verify_bptree(bptree);
+	lookup_all_from_checker(bptree, checker);
+	bptree_iter(bptree, NULL, NULL, checker_fn, checker);
+	assert_checker_finished(checker);
+	bptree_destroy(bptree);
+	free_checker(checker);
+}
+
 int main(void)
 {
 	const struct CMUnitTest tests[] = {
@@ -634,6 +685,7 @@ int main(void)
 		cmocka_unit_test(test_coalesce_coalesce_right),
 		cmocka_unit_test(test_coalesce_till_root),
 		cmocka_unit_test(test_bptree_remove_3_height),
+		cmocka_unit_test(test_bptree_cursor),
 	};
 	return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -159,13 +159,19 @@ static void _check_kv(struct sid_ucmd_ctx *ucmd_ctx, const char *core, char **da
 	_destroy_key(ucmd_ctx->common->gen_buf, key);
 }
 
-static void _set_kv(struct sid_ucmd_ctx *ucmd_ctx, const char *core, char **data, size_t nr_data, kv_op_t op, bool vector)
-{
-	const char          *owner    = _owner_name(NULL);
+static void _do_set_kv(struct sid_ucmd_ctx *ucmd_ctx,
+                       const char          *core,
+                       kv_owner_t           owner,
+                       sid_kv_fl_t          flags,
+                       char               **data,
+                       size_t               nr_data,
+                       kv_op_t              op,
+                       bool                 vector)
+{
+	size_t               hdr_cnt  = flags & SID_KV_FL_AL ? VVALUE_HEADER_ALIGNED_CNT : VVALUE_HEADER_CNT;
 	struct kv_key_spec   key_spec = base_spec;
 	char                *key;
-	kv_vector_t          vvalue[VVALUE_HEADER_CNT + nr_data];
-	sid_kv_fl_t          flags      = SID_KV_FL_RD;
+	kv_vector_t          vvalue[hdr_cnt + nr_data];
 	struct kv_update_arg update_arg = {.res      = ucmd_ctx->common->kvs_res,
 	                                   .gen_buf  = ucmd_ctx->common->gen_buf,
 	                                   .custom   = NULL,
@@ -181,14 +187,14 @@ static void _set_kv(struct sid_ucmd_ctx *ucmd_ctx, const char *core, char **data
 	                    &ucmd_ctx->req_env.dev.udev.seqnum,
 	                    &flags,
 	                    &ucmd_ctx->common->gennum,
-	                    (char *) owner);
+	                    &owner);
 	for (i = 0; i < nr_data; i++)
 		_vvalue_data_prep(vvalue, VVALUE_CNT(vvalue), i, data[i], data[i] ? strlen(data[i]) + 1 : 0);
 
 	assert_int_equal(sid_kvs_va_set(ucmd_ctx->common->kvs_res,
 	                                .key      = key,
 	                                .value    = vvalue,
-	                                .size     = VVALUE_HEADER_CNT + nr_data,
+	                                .size     = hdr_cnt + nr_data,
 	                                .flags    = SID_KVS_VAL_FL_VECTOR,
 	                                .op_flags = vector ? SID_KVS_VAL_OP_NONE : SID_KVS_VAL_OP_MERGE,
 	                                .fn       = _kv_cb_write,
@@ -199,9 +205,14 @@ static void _set_kv(struct sid_ucmd_ctx *ucmd_ctx, const char *core, char **data
 	_destroy_key(ucmd_ctx->common->gen_buf, key);
 }
 
+static void _set_kv(struct sid_ucmd_ctx *ucmd_ctx, const char *core, char **data, size_t nr_data, kv_op_t op, bool vector)
+{
+	_do_set_kv(ucmd_ctx, core, OWNER_ID_CORE, SID_KV_FL_RD, data, nr_data, op, vector);
+}
+
 static void _set_broken_kv(struct sid_ucmd_ctx *ucmd_ctx, const char *core)
 {
-	const char          *owner    = _owner_name(NULL);
+	kv_owner_t           owner    = OWNER_ID_CORE;
 	struct kv_key_spec   key_spec = base_spec;
 	char                *key;
 	kv_vector_t          vvalue[VVALUE_HEADER_CNT];
@@ -219,7 +230,7 @@ static void _set_broken_kv(struct sid_ucmd_ctx *ucmd_ctx, const char *core)
 	                    &ucmd_ctx->req_env.dev.udev.seqnum,
 	                    &flags,
 	                    &ucmd_ctx->common->gennum,
-	                    (char *) owner);
+	                    &owner);
 	assert_int_equal(sid_kvs_va_set(ucmd_ctx->common->kvs_res,
 	                                .key    = key,
 	                                .value  = vvalue,
@@ -284,7 +295,7 @@ static void test_scalar(void **state)
 
 	_set_kv(ts->work_ctx, "key", data, ARRAY_LEN(data), KV_OP_SET, false);
 	fd = _do_build_buffers(ts->work_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), 0);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), 0);
 	_check_kv(ts->main_ctx, "key", data, ARRAY_LEN(data), false);
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 1);
 }
@@ -297,7 +308,7 @@ static void test_vector(void **state)
 
 	_set_kv(ts->work_ctx, "key", data, ARRAY_LEN(data), KV_OP_SET, true);
 	fd = _do_build_buffers(ts->work_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), 0);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), 0);
 	_check_kv(ts->main_ctx, "key", data, ARRAY_LEN(data), true);
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 1);
 }
@@ -312,7 +323,7 @@ static void test_unset_scalar(void **state)
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 1);
 	_set_kv(ts->work_ctx, "key", NULL, 0, KV_OP_SET, false);
 	fd = _do_build_buffers(ts->work_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), 0);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), 0);
 	_check_missing_kv(ts->main_ctx, "key");
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 0);
 }
@@ -327,7 +338,7 @@ static void test_unset_vector(void **state)
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 1);
 	_set_kv(ts->work_ctx, "key", NULL, 0, KV_OP_SET, true);
 	fd = _do_build_buffers(ts->work_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), 0);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), 0);
 	_check_missing_kv(ts->main_ctx, "key");
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 0);
 }
@@ -339,7 +350,7 @@ static void test_unset_missing(void **state)
 
 	_set_kv(ts->work_ctx, "key", NULL, 0, KV_OP_SET, false);
 	fd = _do_build_buffers(ts->work_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), 0);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), 0);
 	_check_missing_kv(ts->main_ctx, "key");
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 0);
 }
@@ -352,7 +363,7 @@ static void test_subtract_missing(void **state)
 
 	_set_kv(ts->work_ctx, "key", data, 1, KV_OP_MINUS, true);
 	fd = _do_build_buffers(ts->work_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), 0);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), 0);
 	_check_missing_kv(ts->main_ctx, "key");
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 0);
 }
@@ -365,7 +376,7 @@ static void test_add_missing(void **state)
 
 	_set_kv(ts->work_ctx, "key", data, 1, KV_OP_PLUS, true);
 	fd = _do_build_buffers(ts->work_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), 0);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), 0);
 	_check_kv(ts->main_ctx, "key", data, 1, true);
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 1);
 }
@@ -380,7 +391,7 @@ static void test_vector_subtract(void **state)
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 1);
 	_set_kv(ts->work_ctx, "key", data, 2, KV_OP_MINUS, true);
 	fd = _do_build_buffers(ts->work_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), 0);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), 0);
 	_check_kv(ts->main_ctx, "key", &data[2], 1, true);
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 1);
 }
@@ -395,7 +406,7 @@ static void test_vector_add(void **state)
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 1);
 	_set_kv(ts->work_ctx, "key", &data[1], 1, KV_OP_PLUS, true);
 	fd = _do_build_buffers(ts->work_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), 0);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), 0);
 	_check_kv(ts->main_ctx, "key", data, ARRAY_LEN(data), true);
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 1);
 }
@@ -410,7 +421,7 @@ static void test_vector_change(void **state)
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 1);
 	_set_kv(ts->work_ctx, "key", data, ARRAY_LEN(data), KV_OP_SET, true);
 	fd = _do_build_buffers(ts->work_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), 0);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), 0);
 	_check_kv(ts->main_ctx, "key", data, ARRAY_LEN(data), true);
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 1);
 }
@@ -426,7 +437,7 @@ static void test_scalar_change(void **state)
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 1);
 	_set_kv(ts->work_ctx, "key", data2, ARRAY_LEN(data2), KV_OP_SET, false);
 	fd = _do_build_buffers(ts->work_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), 0);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), 0);
 	_check_kv(ts->main_ctx, "key", data2, ARRAY_LEN(data2), false);
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 1);
 }
@@ -441,7 +452,7 @@ static void test_type_change1(void **state)
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 1);
 	_set_kv(ts->work_ctx, "key", data, ARRAY_LEN(data), KV_OP_SET, true);
 	fd = _do_build_buffers(ts->work_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), 0);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), 0);
 	_check_kv(ts->main_ctx, "key", data, ARRAY_LEN(data), true);
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 1);
 }
@@ -456,7 +467,7 @@ static void test_type_change2(void **state)
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 1);
 	_set_kv(ts->work_ctx, "key", data, 1, KV_OP_SET, false);
 	fd = _do_build_buffers(ts->work_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), 0);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), 0);
 	_check_kv(ts->main_ctx, "key", data, 1, false);
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 1);
 }
@@ -468,7 +479,7 @@ static void test_empty_broken(void **state)
 
 	_set_broken_kv(ts->work_ctx, "key");
 	fd = _do_build_buffers(ts->work_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), -1);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), -1);
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 0);
 }
 
@@ -481,7 +492,7 @@ static void test_set_broken(void **state)
 	_set_kv(ts->work_ctx, "key1", data, ARRAY_LEN(data), KV_OP_SET, false);
 	_set_broken_kv(ts->work_ctx, "key2");
 	fd = _do_build_buffers(ts->work_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), -1);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), -1);
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 0);
 }
 
@@ -497,7 +508,7 @@ static void test_unset_broken(void **state)
 	_set_broken_kv(ts->work_ctx, "key2");
 	fd  = _do_build_buffers(ts->work_res);
 	old = dump_db(ts->main_ctx->common->kvs_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), -1);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), -1);
 	new = dump_db(ts->main_ctx->common->kvs_res);
 	compare_dumps(old, new);
 }
@@ -514,7 +525,7 @@ static void test_change_broken(void **state)
 	_set_broken_kv(ts->work_ctx, "key2");
 	fd  = _do_build_buffers(ts->work_res);
 	old = dump_db(ts->main_ctx->common->kvs_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), -1);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), -1);
 	new = dump_db(ts->main_ctx->common->kvs_res);
 	compare_dumps(old, new);
 }
@@ -532,7 +543,7 @@ static void test_subtract_broken(void **state)
 	_set_broken_kv(ts->work_ctx, "key2");
 	fd  = _do_build_buffers(ts->work_res);
 	old = dump_db(ts->main_ctx->common->kvs_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), -1);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), -1);
 	new = dump_db(ts->main_ctx->common->kvs_res);
 	compare_dumps(old, new);
 }
@@ -550,7 +561,7 @@ static void test_add_broken(void **state)
 	_set_broken_kv(ts->work_ctx, "key2");
 	fd  = _do_build_buffers(ts->work_res);
 	old = dump_db(ts->main_ctx->common->kvs_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), -1);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), -1);
 	new = dump_db(ts->main_ctx->common->kvs_res);
 	compare_dumps(old, new);
 }
@@ -569,7 +580,7 @@ static void test_multi_1(void **state)
 	_set_kv(ts->work_ctx, "key3", &data[2], 2, KV_OP_PLUS, true);
 	_set_kv(ts->work_ctx, "key2", NULL, 0, KV_OP_SET, false);
 	fd = _do_build_buffers(ts->work_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), 0);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), 0);
 	_check_kv(ts->main_ctx, "key1", &data[1], 1, true);
 	_check_kv(ts->main_ctx, "key3", data, ARRAY_LEN(data), true);
 	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 2);
@@ -592,7 +603,7 @@ static void test_multi_broken_1(void **state)
 	_set_broken_kv(ts->work_ctx, "key4");
 	fd  = _do_build_buffers(ts->work_res);
 	old = dump_db(ts->main_ctx->common->kvs_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), -1);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), -1);
 	new = dump_db(ts->main_ctx->common->kvs_res);
 	compare_dumps(old, new);
 }
@@ -613,7 +624,7 @@ static void test_multi_2(void **state)
 	_set_kv(ts->work_ctx, "key4", data, 1, KV_OP_MINUS, true);
 	_set_kv(ts->work_ctx, "key5", &data[1], 3, KV_OP_SET, true);
 	fd = _do_build_buffers(ts->work_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), 0);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), 0);
 	_check_kv(ts->main_ctx, "key1", &data[2], 1, false);
 	_check_kv(ts->main_ctx, "key3", data, 4, true);
 	_check_kv(ts->main_ctx, "key4", &data[3], 1, true);
@@ -640,7 +651,7 @@ static void test_multi_broken_2(void **state)
 	_set_broken_kv(ts->work_ctx, "key6");
 	fd  = _do_build_buffers(ts->work_res);
 	old = dump_db(ts->main_ctx->common->kvs_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), -1);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), -1);
 	new = dump_db(ts->main_ctx->common->kvs_res);
 	compare_dumps(old, new);
 }
@@ -664,11 +675,60 @@ static void test_multi_broken_3(void **state)
 	_set_kv(ts->work_ctx, "key6", &data[1], 3, KV_OP_SET, true);
 	fd  = _do_build_buffers(ts->work_res);
 	old = dump_db(ts->main_ctx->common->kvs_res);
-	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, fd), -1);
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), -1);
 	new = dump_db(ts->main_ctx->common->kvs_res);
 	compare_dumps(old, new);
 }
 
+static void test_owner(void **state)
+{
+	struct test_state *ts = *state;
+	int                fd;
+	char              *data[] = {VALUE1, VALUE2};
+	kv_owner_t         owner, other;
+	struct kv_key_spec key_spec = base_spec;
+	char              *key;
+	void              *value;
+	kv_vector_t        tmp_vvalue[VVALUE_SINGLE_ALIGNED_CNT];
+	kv_vector_t       *vvalue;
+	sid_kvs_val_fl_t   flags;
+	size_t             size;
+
+	assert_int_equal(_get_owner_id("/type/test", &owner), 0);
+	assert_int_not_equal(owner, OWNER_ID_CORE);
+	_do_set_kv(ts->work_ctx, "key1", owner, SID_KV_FL_RD | SID_KV_FL_AL, data, 1, KV_OP_SET, false);
+	_do_set_kv(ts->work_ctx, "key2", owner, SID_KV_FL_RD, data, ARRAY_LEN(data), KV_OP_SET, true);
+	fd = _do_build_buffers(ts->work_res);
+
+	/* owner IDs are process-local - the same ID refers to another owner on the receiving side */
+	_destroy_owner_tbl();
+	assert_int_equal(_get_owner_id("/type/other", &other), 0);
+	assert_int_equal(other, owner);
+
+	assert_int_equal(_sync_main_kv_store(ts->main_res, ts->main_ctx->common, NULL, fd), 0);
+	assert_int_equal(kv_store_num_entries(ts->main_ctx->common->kvs_res), 2);
+
+	key_spec.core = "key1";
+	assert_non_null(key = _compose_key(NULL, &key_spec));
+	assert_non_null(value = sid_kvs_va_get(ts->main_ctx->common->kvs_res, .key = key, .size = &size, .flags = &flags));
+	_destroy_key(NULL, key);
+	assert_false(flags & SID_KVS_VAL_FL_VECTOR);
+	vvalue = _get_vvalue(flags, value, size, tmp_vvalue, VVALUE_CNT(tmp_vvalue));
+	assert_string_equal(_get_owner_str(VVALUE_OWNER(vvalue)), "/type/test");
+	assert_int_equal((uintptr_t) vvalue[VVALUE_IDX_DATA_ALIGNED].iov_base % SVALUE_DATA_ALIGNMENT, 0);
+	assert_string_equal(vvalue[VVALUE_IDX_DATA_ALIGNED].iov_base, VALUE1);
+
+	key_spec.core = "key2";
+	assert_non_null(key = _compose_key(NULL, &key_spec));
+	assert_non_null(value = sid_kvs_va_get(ts->main_ctx->common->kvs_res, .key = key, .size = &size, .flags = &flags));
+	_destroy_key(NULL, key);
+	assert_true(flags & SID_KVS_VAL_FL_VECTOR);
+	assert_string_equal(_get_owner_str(VVALUE_OWNER(value)), "/type/test");
+	_check_kv(ts->main_ctx, "key2", data, ARRAY_LEN(data), true);
+
+	_destroy_owner_tbl();
+}
+
 int setup(void **state)
 {
 	struct test_state *ts = malloc(sizeof(struct test_state));
@@ -705,6 +765,7 @@ int main(void)
 		setup_test(test_unset_broken),  setup_test(test_change_broken),    setup_test(test_subtract_broken),
 		setup_test(test_add_broken),    setup_test(test_multi_1),          setup_test(test_multi_broken_1),
 		setup_test(test_multi_2),       setup_test(test_multi_broken_2),   setup_test(test_multi_broken_3),
+		setup_test(test_owner),
 	};
 	return cmocka_run_group_tests(tests, NULL, NULL);
 }
@@ -8,6 +8,7 @@
 #include "../src/iface/ifc.c"
 #include "base/buf.h"
 #include "iface/ifc.h"
+#include "internal/fmt.h"
 
 #include <setjmp.h>
 #include <stdarg.h>
@@ -503,6 +504,107 @@ static void test_sid_ifc_req_export_no_data(void **state)
 	__check_sid_ifc_req(&req, NULL, 0, 0, NULL, 0);
 }
 
+#define DBDUMP_FILTER_DATA                                                                                                 \
+	SID_IFC_DBDUMP_KEY_NS "=D\0" SID_IFC_DBDUMP_KEY_MOD "=/type/dm\0" SID_IFC_DBDUMP_KEY_DEV "=8:0\0" SID_IFC_DBDUMP_KEY_FLAGS "=4"
+
+static void test_add_dbdump_filter(void **state)
+{
+	struct sid_buf            *buf;
+	char                      *data;
+	size_t                     size;
+	struct sid_ifc_dbdump_data filter = {.ns = "D", .mod = "/type/dm", .dev = "8:0", .flags = 4};
+
+	buf = sid_buf_create(&SID_BUF_SPEC(.mode = SID_BUF_MODE_SIZE_PREFIX), &SID_BUF_INIT(.alloc_step = 1), NULL);
+	assert_non_null(buf);
+	assert_int_equal(_add_dbdump_filter_to_buf(buf, &filter), 0);
+	assert_int_equal(sid_buf_get_data(buf, (const void **) &data, &size), 0);
+	assert_int_equal(size, sizeof(DBDUMP_FILTER_DATA));
+	assert_memory_equal(data, DBDUMP_FILTER_DATA, size);
+	sid_buf_destroy(buf);
+}
+
+static void test_sid_ifc_req_export_filter(void **state)
+{
+	struct sid_ifc_req req = {.cmd         = SID_IFC_CMD_DBDUMP,
+	                          .data.dbdump = {.ns = "D", .mod = "/type/dm", .dev = "8:0", .flags = 4}};
+
+	will_return(__wrap_sid_comms_unix_recv, sizeof(unsigned char));
+	will_return(__wrap_read, sizeof(RESULT_DATA) + SID_BUF_SIZE_PREFIX_LEN);
+	will_return(__wrap_mmap, sizeof(RESULT_DATA));
+	will_return(__wrap_mmap, RESULT_DATA);
+	will_return(__wrap_munmap, sizeof(RESULT_DATA));
+	__check_sid_ifc_req(&req, DBDUMP_FILTER_DATA, sizeof(DBDUMP_FILTER_DATA), 0, RESULT_DATA, sizeof(RESULT_DATA));
+}
+
+#define WATCH_FILTER_DATA SID_IFC_WATCH_KEY_NS "=dev\0" SID_IFC_WATCH_KEY_PREFIX "=::D:"
+
+static void test_add_watch_filter(void **state)
+{
+	struct sid_buf           *buf;
+	char                     *data;
+	size_t                    size;
+	struct sid_ifc_watch_data filter = {.ns = "dev", .prefix = "::D:"};
+
+	buf = sid_buf_create(&SID_BUF_SPEC(.mode = SID_BUF_MODE_SIZE_PREFIX), &SID_BUF_INIT(.alloc_step = 1), NULL);
+	assert_non_null(buf);
+	assert_int_equal(_add_watch_filter_to_buf(buf, &filter), 0);
+	assert_int_equal(sid_buf_get_data(buf, (const void **) &data, &size), 0);
+	assert_int_equal(size, sizeof(WATCH_FILTER_DATA));
+	assert_memory_equal(data, WATCH_FILTER_DATA, size);
+	sid_buf_destroy(buf);
+}
+
+static void __write_watch_msg(int fd, const char *data, size_t data_size)
+{
+	struct sid_ifc_msg_header hdr      = {.status = 0, .prot = SID_IFC_PROTOCOL, .cmd = SID_IFC_CMD_REPLY};
+	SID_BUF_SIZE_PREFIX_TYPE  msg_size = SID_BUF_SIZE_PREFIX_LEN + sizeof(hdr) + data_size;
+
+	assert_int_equal(write(fd, &msg_size, SID_BUF_SIZE_PREFIX_LEN), SID_BUF_SIZE_PREFIX_LEN);
+	assert_int_equal(write(fd, &hdr, sizeof(hdr)), sizeof(hdr));
+	assert_int_equal(write(fd, data, data_size), data_size);
+}
+
+static void test_sid_ifc_rsl_next(void **state)
+{
+	struct sid_ifc_rsl *rsl;
+	const char         *data;
+	size_t              size;
+	int                 fds[2];
+
+	assert_int_equal(pipe(fds), 0);
+	rsl = calloc(1, sizeof(*rsl));
+	assert_non_null(rsl);
+	rsl->shm = MAP_FAILED;
+	rsl->fd  = -1;
+	rsl->buf = sid_buf_create(&SID_BUF_SPEC(.mode = SID_BUF_MODE_SIZE_PREFIX), &SID_BUF_INIT(.alloc_step = 1), NULL);
+	assert_non_null(rsl->buf);
+	assert_int_equal(sid_ifc_rsl_get_fd(rsl), -ENOTCONN);
+	assert_int_equal(sid_ifc_rsl_next(rsl), -ENOTCONN);
+	rsl->fd = fds[0];
+	assert_int_equal(sid_ifc_rsl_get_fd(rsl), fds[0]);
+
+	/* both messages are in the pipe at once, each must be received separately */
+	__write_watch_msg(fds[1], "first", sizeof("first"));
+	__write_watch_msg(fds[1], "second", sizeof("second"));
+
+	assert_int_equal(sid_ifc_rsl_next(rsl), 0);
+	data = sid_ifc_rsl_get_data(rsl, &size);
+	assert_int_equal(size, sizeof("first"));
+	assert_string_equal(data, "first");
+
+	assert_int_equal(sid_ifc_rsl_next(rsl), 0);
+	data = sid_ifc_rsl_get_data(rsl, &size);
+	assert_int_equal(size, sizeof("second"));
+	assert_string_equal(data, "second");
+
+	/* truncated message */
+	assert_int_equal(write(fds[1], "\xff", 1), 1);
+	close(fds[1]);
+	assert_int_equal(sid_ifc_rsl_next(rsl), -EBADMSG);
+	assert_int_equal(sid_ifc_rsl_next(rsl), -ENODATA);
+	sid_ifc_rsl_free(rsl);
+}
+
 static void test_sid_ifc_req_fail_recv_fd(void **state)
 {
 	struct sid_ifc_req  req = {.cmd = SID_IFC_CMD_DBDUMP};
@@ -549,6 +651,121 @@ static void test_sid_ifc_req_fail_mmap(void **state)
 	assert_null(rsl);
 }
 
+static void __check_cbor_item(const char **data, size_t *size, sid_ifc_cbor_type_t type, struct sid_ifc_cbor_item *item)
+{
+	assert_int_equal(sid_ifc_cbor_next(data, size, item), 0);
+	assert_int_equal(item->type, type);
+}
+
+static void __check_cbor_str(const char **data, size_t *size, sid_ifc_cbor_type_t type, const char *str, size_t len)
+{
+	struct sid_ifc_cbor_item item;
+
+	__check_cbor_item(data, size, type, &item);
+	assert_int_equal(item.val.str.len, len);
+	assert_memory_equal(item.val.str.mem, str, len);
+}
+
+static void test_cbor_next(void **state)
+{
+	/* {"A": 100, "BC": -257, "D": true, "E": [h'00']} */
+	static const char        cbor[] = "\xbf\x61"
+	                                  "A\x18\x64\x62"
+	                                  "BC\x39\x01\x00\x61"
+	                                  "D\xf5\x61"
+	                                  "E\x9f\x41\x00\xff\xff";
+	const char              *data   = cbor;
+	size_t                   size   = sizeof(cbor) - 1;
+	struct sid_ifc_cbor_item item;
+
+	__check_cbor_item(&data, &size, SID_IFC_CBOR_MAP, &item);
+	assert_true(item.val.count == SID_IFC_CBOR_COUNT_INDEFINITE);
+	__check_cbor_str(&data, &size, SID_IFC_CBOR_TSTR, "A", 1);
+	__check_cbor_item(&data, &size, SID_IFC_CBOR_UINT, &item);
+	assert_int_equal(item.val.uint, 100);
+	__check_cbor_str(&data, &size, SID_IFC_CBOR_TSTR, "BC", 2);
+	__check_cbor_item(&data, &size, SID_IFC_CBOR_NINT, &item);
+	assert_int_equal(item.val.nint, -257);
+	__check_cbor_str(&data, &size, SID_IFC_CBOR_TSTR, "D", 1);
+	__check_cbor_item(&data, &size, SID_IFC_CBOR_BOOL, &item);
+	assert_true(item.val.boolean);
+	__check_cbor_str(&data, &size, SID_IFC_CBOR_TSTR, "E", 1);
+	__check_cbor_item(&data, &size, SID_IFC_CBOR_ARRAY, &item);
+	assert_true(item.val.count == SID_IFC_CBOR_COUNT_INDEFINITE);
+	__check_cbor_str(&data, &size, SID_IFC_CBOR_BSTR, "\0", 1);
+	__check_cbor_item(&data, &size, SID_IFC_CBOR_BREAK, &item);
+	__check_cbor_item(&data, &size, SID_IFC_CBOR_BREAK, &item);
+	assert_int_equal(size, 0);
+	assert_int_equal(sid_ifc_cbor_next(&data, &size, &item), -ENODATA);
+}
+
+static void test_cbor_next_bad(void **state)
+{
+	struct sid_ifc_cbor_item item;
+	const char              *data;
+	size_t                   size;
+
+#define CHECK_CBOR_NEXT(str, err)                                                                                          \
+	data = str;                                                                                                        \
+	size = sizeof(str) - 1;                                                                                            \
+	assert_int_equal(sid_ifc_cbor_next(&data, &size, &item), err);                                                     \
+	assert_ptr_equal(data, str)
+
+	CHECK_CBOR_NEXT("\x19\x01", -EBADMSG);                 /* truncated argument */
+	CHECK_CBOR_NEXT("\x63" "ab", -EBADMSG);                 /* truncated string */
+	CHECK_CBOR_NEXT("\x1c", -EBADMSG);                      /* reserved additional info */
+	CHECK_CBOR_NEXT("\x3b\x80\0\0\0\0\0\0\0", -ERANGE); /* negative integer out of int64 range */
+	CHECK_CBOR_NEXT("\x7f", -ENOTSUP);                      /* chunked string */
+	CHECK_CBOR_NEXT("\xc0", -ENOTSUP);                      /* tag */
+	CHECK_CBOR_NEXT("\xf6", -ENOTSUP);                      /* null */
+#undef CHECK_CBOR_NEXT
+}
+
+static void test_cbor_fmt(void **state)
+{
+	struct sid_buf          *buf;
+	const char              *data;
+	size_t                   size;
+	struct sid_ifc_cbor_item item;
+
+	buf = sid_buf_create(&SID_BUF_SPEC(), &SID_BUF_INIT(.alloc_step = 1), NULL);
+	assert_non_null(buf);
+	assert_int_equal(fmt_doc_start(FMT_CBOR, buf, 0), 0);
+	assert_int_equal(fmt_fld_uint64(FMT_CBOR, buf, 1, "U", UINT64_MAX, false), 0);
+	assert_int_equal(fmt_fld_int64(FMT_CBOR, buf, 1, "I", INT64_MIN, true), 0);
+	assert_int_equal(fmt_fld_str(FMT_CBOR, buf, 1, "S", "str", true), 0);
+	assert_int_equal(fmt_arr_start(FMT_CBOR, buf, 1, "A", true), 0);
+	assert_int_equal(fmt_arr_fld_uint(FMT_CBOR, buf, 2, 1000, false), 0);
+	assert_int_equal(fmt_arr_fld_bin(FMT_CBOR, buf, 2, "\0\1", 2, true), 0);
+	assert_int_equal(fmt_arr_end(FMT_CBOR, buf, 1), 0);
+	assert_int_equal(fmt_doc_end(FMT_CBOR, buf, 0), 0);
+	assert_int_equal(fmt_null_byte(buf), 0);
+	assert_int_equal(sid_buf_get_data(buf, (const void **) &data, &size), 0);
+
+	/* terminating null byte is not part of CBOR data */
+	assert_int_equal(data[size - 1], '\0');
+	size--;
+
+	__check_cbor_item(&data, &size, SID_IFC_CBOR_MAP, &item);
+	__check_cbor_str(&data, &size, SID_IFC_CBOR_TSTR, "U", 1);
+	__check_cbor_item(&data, &size, SID_IFC_CBOR_UINT, &item);
+	assert_true(item.val.uint == UINT64_MAX);
+	__check_cbor_str(&data, &size, SID_IFC_CBOR_TSTR, "I", 1);
+	__check_cbor_item(&data, &size, SID_IFC_CBOR_NINT, &item);
+	assert_true(item.val.nint == INT64_MIN);
+	__check_cbor_str(&data, &size, SID_IFC_CBOR_TSTR, "S", 1);
+	__check_cbor_str(&data, &size, SID_IFC_CBOR_TSTR, "str", 3);
+	__check_cbor_str(&data, &size, SID_IFC_CBOR_TSTR, "A", 1);
+	__check_cbor_item(&data, &size, SID_IFC_CBOR_ARRAY, &item);
+	__check_cbor_item(&data, &size, SID_IFC_CBOR_UINT, &item);
+	assert_int_equal(item.val.uint, 1000);
+	__check_cbor_str(&data, &size, SID_IFC_CBOR_BSTR, "\0\1", 2);
+	__check_cbor_item(&data, &size, SID_IFC_CBOR_BREAK, &item);
+	__check_cbor_item(&data, &size, SID_IFC_CBOR_BREAK, &item);
+	assert_int_equal(size, 0);
+	sid_buf_destroy(buf);
+}
+
 int main(void)
 {
 	const struct CMUnitTest tests[] = {
@@ -565,6 +782,10 @@ int main(void)
 		cmocka_unit_test(test_sid_ifc_req_export_fail2),  cmocka_unit_test(test_sid_ifc_req_export_no_data),
 		cmocka_unit_test(test_sid_ifc_req_fail_recv_fd),  cmocka_unit_test(test_sid_ifc_req_fail_read_fd1),
 		cmocka_unit_test(test_sid_ifc_req_fail_read_fd2), cmocka_unit_test(test_sid_ifc_req_fail_mmap),
+		cmocka_unit_test(test_add_dbdump_filter),         cmocka_unit_test(test_sid_ifc_req_export_filter),
+		cmocka_unit_test(test_cbor_next),                 cmocka_unit_test(test_cbor_next_bad),
+		cmocka_unit_test(test_cbor_fmt),                  cmocka_unit_test(test_add_watch_filter),
+		cmocka_unit_test(test_sid_ifc_rsl_next),
 	};
 	return cmocka_run_group_tests(tests, NULL, NULL);
 }
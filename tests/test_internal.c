@@ -6,12 +6,16 @@
 
 #include "internal/comp-attrs.h"
 
+#include "internal/fmt.h"
+#include "internal/mem.h"
 #include "internal/util.h"
+#include "internal/vdelta.h"
 
 #include <setjmp.h>
 #include <stdarg.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <cmocka.h>
 
@@ -197,6 +201,199 @@ static void comb_alloc_test1(void **state)
 	do_alloc_test("prefix", "str", "suffix", (char *[]) {"prefix", "str", "suffix", NULL});
 }
 
+static void do_fmt_json_test(const char *value, const char *goal)
+{
+	struct sid_buf *buf;
+	const char     *data;
+	size_t          size;
+
+	buf = sid_buf_create(&SID_BUF_SPEC(), &SID_BUF_INIT(.alloc_step = 1), NULL);
+	assert_non_null(buf);
+	assert_int_equal(fmt_arr_fld_str(FMT_JSON, buf, 0, value, false), 0);
+	assert_int_equal(fmt_null_byte(buf), 0);
+	assert_int_equal(sid_buf_get_data(buf, (const void **) &data, &size), 0);
+	assert_string_equal(data, goal);
+	sid_buf_destroy(buf);
+}
+
+static void fmt_json_escape_test(void **state)
+{
+	do_fmt_json_test("", "\n\"\"");
+	do_fmt_json_test("/dev/sda", "\n\"/dev/sda\"");
+	/* characters needing escape at various positions relative to 8-byte words */
+	do_fmt_json_test("a\"b", "\n\"a\\\"b\"");
+	do_fmt_json_test("01234567\\", "\n\"01234567\\\\\"");
+	do_fmt_json_test("0123456789abcde\n", "\n\"0123456789abcde\\n\"");
+	do_fmt_json_test("\t\r\b\f\x01\x1f", "\n\"\\t\\r\\b\\f\\u0001\\u001f\"");
+	/* bytes above 0x7f are passed through */
+	do_fmt_json_test("\xc5\xa1\xc5\xa1\xc5\xa1\xc5\xa1x", "\n\"\xc5\xa1\xc5\xa1\xc5\xa1\xc5\xa1x\"");
+}
+
+static void fmt_json_int_test(void **state)
+{
+	struct sid_buf *buf;
+	const char     *data;
+	size_t          size;
+
+	buf = sid_buf_create(&SID_BUF_SPEC(), &SID_BUF_INIT(.alloc_step = 1), NULL);
+	assert_non_null(buf);
+	assert_int_equal(fmt_fld_uint64(FMT_ENV, buf, 0, "A", UINT64_MAX, false), 0);
+	assert_int_equal(fmt_fld_int64(FMT_ENV, buf, 0, "B", INT64_MIN, false), 0);
+	assert_int_equal(fmt_fld_uint(FMT_ENV, buf, 0, "C", 0, false), 0);
+	assert_int_equal(fmt_null_byte(buf), 0);
+	assert_int_equal(sid_buf_get_data(buf, (const void **) &data, &size), 0);
+	assert_string_equal(data, "A=18446744073709551615\nB=-9223372036854775808\nC=0\n");
+	sid_buf_destroy(buf);
+}
+
+static struct vdelta_vec *init_vdelta_vec(struct vdelta_vec *vec, struct iovec *mem, char *strv[])
+{
+	for (vec->v = mem, vec->cnt = 0; strv[vec->cnt]; vec->cnt++)
+		mem[vec->cnt] = (struct iovec) {.iov_base = strv[vec->cnt], .iov_len = strlen(strv[vec->cnt]) + 1};
+
+	return vec;
+}
+
+static void check_vdelta_vec(struct vdelta_vec *vec, char *goal[])
+{
+	size_t i;
+
+	for (i = 0; i < vec->cnt && goal[i]; i++)
+		assert_string_equal(vec->v[i].iov_base, goal[i]);
+	assert_int_equal(i, vec->cnt);
+	assert_null(goal[i]);
+}
+
+static void do_vdelta_step_test(vdelta_op_t op, char *goal_plus[], char *goal_minus[], char *goal_final[])
+{
+	struct iovec      mem[18];
+	struct vdelta_vec old, new;
+	struct vdelta_vec plus = {.v = mem + 6}, minus = {.v = mem + 9}, final = {.v = mem + 12};
+
+	vdelta_step(op,
+	            init_vdelta_vec(&old, mem, (char *[]) {"a", "b", "d", NULL}),
+	            init_vdelta_vec(&new, mem + 3, (char *[]) {"b", "c", "e", NULL}),
+	            &plus,
+	            &minus,
+	            &final);
+	check_vdelta_vec(&plus, goal_plus);
+	check_vdelta_vec(&minus, goal_minus);
+	check_vdelta_vec(&final, goal_final);
+}
+
+static void vdelta_step_set_test(void **state)
+{
+	do_vdelta_step_test(VDELTA_OP_SET,
+	                    (char *[]) {"c", "e", NULL},
+	                    (char *[]) {"a", "d", NULL},
+	                    (char *[]) {"b", "c", "e", NULL});
+}
+
+static void vdelta_step_plus_test(void **state)
+{
+	do_vdelta_step_test(VDELTA_OP_PLUS,
+	                    (char *[]) {"c", "e", NULL},
+	                    (char *[]) {NULL},
+	                    (char *[]) {"a", "b", "c", "d", "e", NULL});
+}
+
+static void vdelta_step_minus_test(void **state)
+{
+	do_vdelta_step_test(VDELTA_OP_MINUS, (char *[]) {NULL}, (char *[]) {"b", NULL}, (char *[]) {"a", "d", NULL});
+}
+
+static void vdelta_abs_test(void **state)
+{
+	struct iovec      mem[16];
+	struct vdelta_vec old_plus, old_minus, new_plus, new_minus;
+	struct vdelta_vec abs_plus = {.v = mem + 8}, abs_minus = {.v = mem + 12};
+
+	vdelta_abs(init_vdelta_vec(&old_plus, mem, (char *[]) {"a", "c", NULL}),
+	           init_vdelta_vec(&old_minus, mem + 2, (char *[]) {"b", "e", NULL}),
+	           init_vdelta_vec(&new_plus, mem + 4, (char *[]) {"b", "d", NULL}),
+	           init_vdelta_vec(&new_minus, mem + 6, (char *[]) {"c", "f", NULL}),
+	           &abs_plus,
+	           &abs_minus);
+	check_vdelta_vec(&abs_plus, (char *[]) {"a", "d", NULL});
+	check_vdelta_vec(&abs_minus, (char *[]) {"e", "f", NULL});
+}
+
+static void mem_arena_test(void **state)
+{
+	struct mem_arena     *arena;
+	struct mem_arena_mark mark;
+	char                 *p1, *p2, *p3;
+
+	arena = mem_arena_create(64);
+	assert_non_null(arena);
+
+	p1 = mem_arena_alloc(arena, 16);
+	assert_non_null(p1);
+	memset(p1, 'x', 16);
+
+	mark = mem_arena_get_mark(arena);
+	p2   = mem_arena_alloc(arena, 40);
+	assert_non_null(p2);
+	/* bigger than chunk size */
+	assert_non_null(mem_arena_alloc(arena, 256));
+	mem_arena_release(arena, mark);
+
+	/* memory after the mark is reused, memory before the mark is kept */
+	p3 = mem_arena_alloc(arena, 40);
+	assert_ptr_equal(p2, p3);
+	assert_int_equal(p1[15], 'x');
+
+	mem_arena_destroy(arena);
+}
+
+static void mem_slab_test(void **state)
+{
+	struct mem_slab_cache *cache;
+	struct mem_slab_stats  stats[MEM_SLAB_CACHE_STATS_COUNT];
+	char                  *p[64], *big;
+	unsigned               i;
+
+	cache = mem_slab_cache_create("test");
+	assert_non_null(cache);
+
+	for (i = 0; i < 64; i++) {
+		p[i] = mem_slab_cache_alloc(cache, 24);
+		assert_non_null(p[i]);
+		memset(p[i], i, 24);
+	}
+	/* objects allocated one after another are placed next to each other */
+	assert_ptr_equal(p[1], p[0] + 32);
+
+	big = mem_slab_cache_alloc(cache, 4096);
+	assert_non_null(big);
+	memset(big, 'x', 4096);
+
+	assert_int_equal(mem_slab_cache_get_stats(cache, stats, MEM_SLAB_CACHE_STATS_COUNT), 2);
+	assert_int_equal(stats[0].obj_size, 32);
+	assert_int_equal(stats[0].obj_count, 64);
+	assert_int_equal(stats[1].obj_size, 0);
+	assert_int_equal(stats[1].obj_count, 1);
+
+	/* freed object is reused by next allocation of the same size class */
+	mem_slab_cache_free(cache, p[10], 24);
+	assert_ptr_equal(mem_slab_cache_alloc(cache, 20), p[10]);
+	assert_int_equal(p[11][0], 11);
+
+	for (i = 0; i < 64; i++)
+		mem_slab_cache_free(cache, p[i], 24);
+	mem_slab_cache_free(cache, big, 4096);
+
+	/* empty page is kept as spare */
+	assert_int_equal(mem_slab_cache_get_stats(cache, stats, MEM_SLAB_CACHE_STATS_COUNT), 1);
+	assert_int_equal(stats[0].obj_count, 0);
+	assert_int_equal(stats[0].page_count, 1);
+
+	/* leave some objects allocated, destroy must free them */
+	assert_non_null(mem_slab_cache_alloc(cache, 100));
+	assert_non_null(mem_slab_cache_alloc(cache, 1000));
+	mem_slab_cache_destroy(cache);
+}
+
 int main(void)
 {
 	const struct CMUnitTest tests[] = {
@@ -213,7 +410,11 @@ int main(void)
 		cmocka_unit_test(bad_mem_test_missing2), cmocka_unit_test(bad_mem_test_missing3),
 		cmocka_unit_test(bad_mem_test_missing4), cmocka_unit_test(bad_mem_test_missing5),
 		cmocka_unit_test(bad_mem_test_missing6), cmocka_unit_test(comb_alloc_test0),
-		cmocka_unit_test(comb_alloc_test1),
+		cmocka_unit_test(comb_alloc_test1),      cmocka_unit_test(fmt_json_escape_test),
+		cmocka_unit_test(fmt_json_int_test),     cmocka_unit_test(vdelta_step_set_test),
+		cmocka_unit_test(vdelta_step_plus_test), cmocka_unit_test(vdelta_step_minus_test),
+		cmocka_unit_test(vdelta_abs_test),       cmocka_unit_test(mem_arena_test),
+		cmocka_unit_test(mem_slab_test),
 	};
 	return cmocka_run_group_tests(tests, NULL, NULL);
 }
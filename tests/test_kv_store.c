@@ -28,14 +28,17 @@ static void test_type_F(void **state)
 	size_t                 size          = sizeof(test_iov) / sizeof(test_iov[0]);
 	size_t                 combined_size = sizeof("test") + sizeof("value");
 	size_t                 value_size;
+	struct kv_store        kv_store      = {.value_cache = mem_slab_cache_create("test")};
 	struct kv_store_value *value =
-		_create_kv_store_value(test_iov, size, SID_KVS_VAL_FL_VECTOR, SID_KVS_VAL_OP_MERGE, &value_size);
+		_create_kv_store_value(&kv_store, test_iov, size, SID_KVS_VAL_FL_VECTOR, SID_KVS_VAL_OP_MERGE, &value_size);
 	assert_ptr_not_equal(value, NULL);
 	assert_int_equal(memcmp(value->data, "test\0value", value->size), 0);
 	assert_int_equal(value->size, combined_size);
 	assert_int_equal(value->int_flags, KV_STORE_VALUE_INT_ALLOC);
 	assert_int_equal(value->ext_flags, SID_KVS_VAL_OP_NONE);
-	_destroy_kv_store_value(value);
+	assert_int_equal(_get_kv_store_value_size(value), value_size);
+	_destroy_kv_store_value(&kv_store, value);
+	mem_slab_cache_destroy(kv_store.value_cache);
 }
 
 static void test_type_E(void **state)
@@ -43,8 +46,9 @@ static void test_type_E(void **state)
 	struct iovec          *return_iov, test_iov[] = {{"test", sizeof("test")}, {"value", sizeof("value")}};
 	size_t                 size = sizeof(test_iov) / sizeof(test_iov[0]);
 	size_t                 value_size;
+	struct kv_store        kv_store = {.value_cache = mem_slab_cache_create("test")};
 	struct kv_store_value *value =
-		_create_kv_store_value(test_iov, size, SID_KVS_VAL_FL_VECTOR, SID_KVS_VAL_OP_NONE, &value_size);
+		_create_kv_store_value(&kv_store, test_iov, size, SID_KVS_VAL_FL_VECTOR, SID_KVS_VAL_OP_NONE, &value_size);
 	assert_ptr_not_equal(value, NULL);
 	return_iov = (struct iovec *) value->data;
 
@@ -55,7 +59,9 @@ static void test_type_E(void **state)
 	assert_int_equal(value->size, size);
 	assert_int_equal(value->int_flags, KV_STORE_VALUE_INT_ALLOC);
 	assert_int_equal(value->ext_flags, SID_KVS_VAL_FL_VECTOR);
-	_destroy_kv_store_value(value);
+	assert_int_equal(_get_kv_store_value_size(value), value_size);
+	_destroy_kv_store_value(&kv_store, value);
+	mem_slab_cache_destroy(kv_store.value_cache);
 }
 
 static void test_type_G(void **state)
@@ -63,7 +69,9 @@ static void test_type_G(void **state)
 	struct iovec           test_iov[] = {{"test", sizeof("test")}, {"value", sizeof("value")}};
 	size_t                 size       = sizeof(test_iov) / sizeof(test_iov[0]);
 	size_t                 value_size;
-	struct kv_store_value *value = _create_kv_store_value(test_iov,
+	struct kv_store        kv_store   = {.value_cache = mem_slab_cache_create("test")};
+	struct kv_store_value *value = _create_kv_store_value(&kv_store,
+	                                                      test_iov,
 	                                                      size,
 	                                                      SID_KVS_VAL_FL_REF | SID_KVS_VAL_FL_VECTOR,
 	                                                      SID_KVS_VAL_OP_NONE,
@@ -73,7 +81,9 @@ static void test_type_G(void **state)
 	assert_int_equal(value->size, size);
 	assert_int_equal(value->int_flags, 0);
 	assert_int_equal(value->ext_flags, SID_KVS_VAL_FL_REF | SID_KVS_VAL_FL_VECTOR);
-	_destroy_kv_store_value(value);
+	assert_int_equal(_get_kv_store_value_size(value), value_size);
+	_destroy_kv_store_value(&kv_store, value);
+	mem_slab_cache_destroy(kv_store.value_cache);
 }
 
 static void test_type_H(void **state)
@@ -82,11 +92,13 @@ static void test_type_H(void **state)
 	size_t                 size       = sizeof(test_iov) / sizeof(test_iov[0]);
 	size_t                 value_size;
 	struct iovec           old_iov[size];
+	struct kv_store        kv_store   = {.value_cache = mem_slab_cache_create("test")};
 	struct kv_store_value *value;
 	int                    i;
 
 	memcpy(old_iov, test_iov, sizeof(old_iov));
-	value = _create_kv_store_value(test_iov,
+	value = _create_kv_store_value(&kv_store,
+	                               test_iov,
 	                               size,
 	                               SID_KVS_VAL_FL_REF | SID_KVS_VAL_FL_VECTOR,
 	                               SID_KVS_VAL_OP_MERGE,
@@ -98,7 +110,9 @@ static void test_type_H(void **state)
 		assert_ptr_not_equal(test_iov[i].iov_base, old_iov[i].iov_base);
 	assert_int_equal(value->int_flags, KV_STORE_VALUE_INT_ALLOC);
 	assert_int_equal(value->ext_flags, SID_KVS_VAL_FL_REF | SID_KVS_VAL_FL_VECTOR);
-	_destroy_kv_store_value(value);
+	assert_int_equal(_get_kv_store_value_size(value), value_size);
+	_destroy_kv_store_value(&kv_store, value);
+	mem_slab_cache_destroy(kv_store.value_cache);
 	for (i = 0; i < size; i++) {
 		assert_ptr_equal(test_iov[i].iov_base, NULL);
 		assert_int_equal(test_iov[i].iov_len, 0);
@@ -119,6 +133,7 @@ static void test_kvstore_iterate(void **state)
 	sid_res_t           *kv_store_res = NULL;
 	struct kv_update_arg update_arg;
 	struct kv_unset_nfo  unset_nfo;
+	kv_owner_t           owner;
 	size_t               meta_size = 0;
 
 	kv_store_res                   = sid_res_create(SID_RES_NO_PARENT,
@@ -129,7 +144,8 @@ static void test_kvstore_iterate(void **state)
                                       SID_RES_PRIO_NORMAL,
                                       SID_RES_NO_SERVICE_LINKS);
 
-	_vvalue_header_prep(test_iov, VVALUE_CNT(test_iov), &seqnum, &ucmd_flags, &gennum, (char *) TEST_OWNER);
+	assert_int_equal(_get_owner_id(TEST_OWNER, &owner), 0);
+	_vvalue_header_prep(test_iov, VVALUE_CNT(test_iov), &seqnum, &ucmd_flags, &gennum, &owner);
 	test_iov[VVALUE_IDX_DATA].iov_base = "test";
 	test_iov[VVALUE_IDX_DATA].iov_len  = sizeof("test");
 
@@ -161,7 +177,7 @@ static void test_kvstore_iterate(void **state)
 	assert_int_equal(kv_store_num_entries(kv_store_res), 1);
 	/* TODO: if update_arg is NULL in the following call it causes SEGV */
 	update_arg.ret_code = 0;
-	unset_nfo.owner     = TEST_OWNER;
+	unset_nfo.owner     = owner;
 	unset_nfo.seqnum    = 0;
 	update_arg.custom   = &unset_nfo;
 	assert_int_equal(sid_kvs_va_unset(kv_store_res, .key = TEST_KEY, .fn = _kv_cb_main_unset, .fn_arg = &update_arg), 0);
@@ -280,6 +296,487 @@ static void test_kvstore_merge_op(void **state)
 	sid_res_unref(kv_store_res);
 }
 
+static void test_scan_cache_fingerprint(void **state)
+{
+	char path[] = "/tmp/sid-test-fpr-XXXXXX";
+	char fpr1[SCAN_CACHE_FPR_SIZE], fpr2[SCAN_CACHE_FPR_SIZE];
+	int  fd;
+
+	assert_true((fd = mkstemp(path)) >= 0);
+	unlink(path);
+
+	assert_int_equal(ftruncate(fd, 8 * 1024 * 1024), 0);
+	assert_int_equal(_get_fingerprint(fd, 1, fpr1, sizeof(fpr1)), 0);
+
+	/* change in the middle of the device is not covered */
+	assert_int_equal(pwrite(fd, "x", 1, 4 * 1024 * 1024), 1);
+	assert_int_equal(_get_fingerprint(fd, 1, fpr2, sizeof(fpr2)), 0);
+	assert_string_equal(fpr1, fpr2);
+
+	/* superblock 64 KiB from the start (btrfs) is covered */
+	assert_int_equal(pwrite(fd, "_BHRfS_M", 8, 64 * 1024 + 64), 8);
+	assert_int_equal(_get_fingerprint(fd, 1, fpr2, sizeof(fpr2)), 0);
+	assert_string_not_equal(fpr1, fpr2);
+
+	/* so is the end of the device */
+	assert_int_equal(_get_fingerprint(fd, 1, fpr1, sizeof(fpr1)), 0);
+	assert_int_equal(pwrite(fd, "x", 1, 8 * 1024 * 1024 - 256 * 1024), 1);
+	assert_int_equal(_get_fingerprint(fd, 1, fpr2, sizeof(fpr2)), 0);
+	assert_string_not_equal(fpr1, fpr2);
+
+	/* device smaller than the hashed areas */
+	assert_int_equal(ftruncate(fd, 96 * 1024), 0);
+	assert_int_equal(_get_fingerprint(fd, 1, fpr1, sizeof(fpr1)), 0);
+	assert_int_equal(pwrite(fd, "x", 1, 64 * 1024), 1);
+	assert_int_equal(_get_fingerprint(fd, 1, fpr2, sizeof(fpr2)), 0);
+	assert_string_not_equal(fpr1, fpr2);
+
+	close(fd);
+}
+
+static bool _index_match_yes(const char *key, void *data, size_t data_size, sid_kvs_val_fl_t flags, void *arg)
+{
+	return data_size && *(char *) data == 'y';
+}
+
+static bool _index_part_first_char(const char *key, char *part, size_t part_size, void *arg)
+{
+	return snprintf(part, part_size, "%c:", key[0]) < part_size;
+}
+
+static bool _index_has(sid_res_t *kv_store_res, const char *index_key)
+{
+	return sid_kvs_va_get(kv_store_res, .key = index_key) != NULL;
+}
+
+static size_t _index_count(sid_res_t *kv_store_res, const char *prefix)
+{
+	sid_kvs_iter_t *iter;
+	size_t          count = 0;
+
+	assert_ptr_not_equal(iter = sid_kvs_iter_create_prefix(kv_store_res, prefix), NULL);
+	while (sid_kvs_iter_next(iter, NULL, NULL, NULL))
+		count++;
+	sid_kvs_iter_destroy(iter);
+
+	return count;
+}
+
+static void test_kvstore_index(void **state)
+{
+	sid_res_t      *kv_store_res;
+	sid_kvs_iter_t *iter;
+	const char     *key;
+
+	kv_store_res = sid_res_create(SID_RES_NO_PARENT,
+	                              &sid_res_type_kvs,
+	                              SID_RES_FL_RESTRICT_WALK_UP,
+	                              "testkvstore",
+	                              &main_kv_store_res_params,
+	                              SID_RES_PRIO_NORMAL,
+	                              SID_RES_NO_SERVICE_LINKS);
+
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "a", .value = "yes", .size = sizeof("yes")), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "b", .value = "no", .size = sizeof("no")), 0);
+
+	/* index without build does not see existing records */
+	assert_int_equal(sid_kvs_index_register(kv_store_res,
+	                                        &((struct sid_kvs_index_spec) {.prefix   = "%",
+	                                                                       .match_fn = _index_match_yes,
+	                                                                       .flags    = SID_KVS_IDX_FL_NO_BUILD})),
+	                 0);
+	assert_false(_index_has(kv_store_res, "%a"));
+
+	/* index with build indexes existing matching records */
+	assert_int_equal(sid_kvs_index_register(kv_store_res,
+	                                        &((struct sid_kvs_index_spec) {.prefix   = "@",
+	                                                                       .match_fn = _index_match_yes,
+	                                                                       .part_fn  = _index_part_first_char})),
+	                 0);
+	assert_true(_index_has(kv_store_res, "@a:a"));
+	assert_false(_index_has(kv_store_res, "@b:b"));
+
+	/* set and unset maintain index keys */
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "a", .value = "yes", .size = sizeof("yes")), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "b", .value = "yes", .size = sizeof("yes")), 0);
+	assert_true(_index_has(kv_store_res, "%a"));
+	assert_true(_index_has(kv_store_res, "%b"));
+	assert_int_equal(_index_count(kv_store_res, "%"), 2);
+	assert_int_equal(_index_count(kv_store_res, "@b:"), 1);
+
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "a", .value = "no", .size = sizeof("no")), 0);
+	assert_false(_index_has(kv_store_res, "%a"));
+	assert_false(_index_has(kv_store_res, "@a:a"));
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "%b"), "yes");
+
+	assert_int_equal(sid_kvs_va_unset(kv_store_res, .key = "b"), 0);
+	assert_false(_index_has(kv_store_res, "%b"));
+	assert_false(_index_has(kv_store_res, "@b:b"));
+
+	/* archive keys are indexed too */
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "c", .value = "yes", .size = sizeof("yes")), 0);
+	assert_int_equal(sid_kvs_va_unset(kv_store_res, .key = "c", .archive_key = "~c"), 0);
+	assert_false(_index_has(kv_store_res, "%c"));
+	assert_true(_index_has(kv_store_res, "%~c"));
+
+	/* rollback removes index keys added within the transaction */
+	assert_int_equal(sid_kvs_transaction_begin(kv_store_res), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "d", .value = "yes", .size = sizeof("yes")), 0);
+	assert_true(_index_has(kv_store_res, "%d"));
+	sid_kvs_transaction_end(kv_store_res, true);
+	assert_false(_index_has(kv_store_res, "d"));
+	assert_false(_index_has(kv_store_res, "%d"));
+
+	/* value restored by rollback still gets its index keys removed */
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "e", .value = "yes", .size = sizeof("yes")), 0);
+	assert_int_equal(sid_kvs_transaction_begin(kv_store_res), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "e", .value = "no", .size = sizeof("no"), .archive_key = "~e"), 0);
+	sid_kvs_transaction_end(kv_store_res, true);
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "%e"), "yes");
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "e", .value = "no", .size = sizeof("no")), 0);
+	assert_false(_index_has(kv_store_res, "%e"));
+	assert_int_equal(sid_kvs_va_unset(kv_store_res, .key = "e"), 0);
+
+	/* index key removal is deferred till the end of the transaction and reevaluated */
+	assert_int_equal(sid_kvs_transaction_begin(kv_store_res), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "a", .value = "yes", .size = sizeof("yes")), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "a", .value = "no", .size = sizeof("no")), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "a", .value = "yes", .size = sizeof("yes")), 0);
+	assert_int_equal(sid_kvs_va_unset(kv_store_res, .key = "~c"), 0);
+	assert_true(_index_has(kv_store_res, "%~c"));
+	sid_kvs_transaction_end(kv_store_res, false);
+	assert_true(_index_has(kv_store_res, "%a"));
+	assert_true(_index_has(kv_store_res, "@a:a"));
+	assert_false(_index_has(kv_store_res, "~c"));
+	assert_false(_index_has(kv_store_res, "%~c"));
+
+	/* unset the record through the index key iterator returned */
+	assert_ptr_not_equal(iter = sid_kvs_iter_create_prefix(kv_store_res, "%a"), NULL);
+	assert_ptr_not_equal(sid_kvs_iter_next(iter, NULL, &key, NULL), NULL);
+	sid_kvs_iter_destroy(iter);
+	assert_int_equal(sid_kvs_va_unset(kv_store_res, .key = key + 1), 0);
+	assert_false(_index_has(kv_store_res, "@a:a"));
+	assert_int_equal(kv_store_num_entries(kv_store_res), 0);
+
+	sid_res_unref(kv_store_res);
+}
+
+static void test_kvstore_savepoint(void **state)
+{
+	sid_res_t               *kv_store_res;
+	struct sid_kvs_savepoint sp1, sp2;
+
+	kv_store_res = sid_res_create(SID_RES_NO_PARENT,
+	                              &sid_res_type_kvs,
+	                              SID_RES_FL_RESTRICT_WALK_UP,
+	                              "testkvstore",
+	                              &main_kv_store_res_params,
+	                              SID_RES_PRIO_NORMAL,
+	                              SID_RES_NO_SERVICE_LINKS);
+
+	assert_int_equal(sid_kvs_index_register(kv_store_res,
+	                                        &((struct sid_kvs_index_spec) {.prefix = "%", .match_fn = _index_match_yes})),
+	                 0);
+
+	/* savepoints need a transaction */
+	assert_int_equal(sid_kvs_savepoint(kv_store_res, &sp1), -ENOENT);
+
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "a", .value = "a0", .size = sizeof("a0")), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "b", .value = "b0", .size = sizeof("b0")), 0);
+
+	assert_int_equal(sid_kvs_transaction_begin(kv_store_res), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "a", .value = "a1", .size = sizeof("a1")), 0);
+	assert_int_equal(sid_kvs_savepoint(kv_store_res, &sp1), 0);
+
+	/* changes after the savepoint are undone, including repeated ones, archives and index keys */
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "a", .value = "a2", .size = sizeof("a2")), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "a", .value = "a3", .size = sizeof("a3")), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "c", .value = "yes", .size = sizeof("yes")), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "b", .value = "b1", .size = sizeof("b1"), .archive_key = "~b"),
+	                 0);
+	assert_int_equal(sid_kvs_va_unset(kv_store_res, .key = "a"), 0);
+	assert_true(_index_has(kv_store_res, "%c"));
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "~b"), "b0");
+
+	assert_int_equal(sid_kvs_savepoint(kv_store_res, &sp2), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "d", .value = "d0", .size = sizeof("d0")), 0);
+	assert_int_equal(sid_kvs_rollback_to(kv_store_res, &sp2), 0);
+	assert_null(sid_kvs_va_get(kv_store_res, .key = "d"));
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "b"), "b1");
+
+	assert_int_equal(sid_kvs_rollback_to(kv_store_res, &sp1), 0);
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "a"), "a1");
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "b"), "b0");
+	assert_null(sid_kvs_va_get(kv_store_res, .key = "~b"));
+	assert_null(sid_kvs_va_get(kv_store_res, .key = "c"));
+	assert_false(_index_has(kv_store_res, "%c"));
+
+	/* savepoints taken after the one rolled back to are not valid anymore */
+	assert_int_equal(sid_kvs_rollback_to(kv_store_res, &sp2), -ERANGE);
+
+	/* not even once the transaction gets past them again */
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "f", .value = "f0", .size = sizeof("f0")), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "f", .value = "f1", .size = sizeof("f1")), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "f", .value = "f2", .size = sizeof("f2")), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "g", .value = "g0", .size = sizeof("g0")), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "g", .value = "g1", .size = sizeof("g1"), .archive_key = "~g"),
+	                 0);
+	assert_int_equal(sid_kvs_va_unset(kv_store_res, .key = "f"), 0);
+	assert_int_equal(sid_kvs_va_unset(kv_store_res, .key = "g"), 0);
+	assert_int_equal(sid_kvs_rollback_to(kv_store_res, &sp2), -ERANGE);
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "f"), "f2");
+	assert_int_equal(sid_kvs_rollback_to(kv_store_res, &sp1), 0);
+	assert_null(sid_kvs_va_get(kv_store_res, .key = "f"));
+	assert_null(sid_kvs_va_get(kv_store_res, .key = "g"));
+
+	/* rolling back to the same savepoint again with no changes after it is a no-op */
+	assert_int_equal(sid_kvs_rollback_to(kv_store_res, &sp1), 0);
+	assert_int_equal(sid_kvs_va_unset(kv_store_res, .key = "a"), 0);
+	assert_int_equal(sid_kvs_rollback_to(kv_store_res, &sp1), 0);
+
+	/* the transaction goes on and commits changes made before the savepoint */
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "e", .value = "yes", .size = sizeof("yes")), 0);
+	assert_true(sid_kvs_transaction_active(kv_store_res));
+	sid_kvs_transaction_end(kv_store_res, false);
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "a"), "a1");
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "b"), "b0");
+	assert_true(_index_has(kv_store_res, "%e"));
+
+	/* savepoints from another transaction are not valid */
+	assert_int_equal(sid_kvs_transaction_begin(kv_store_res), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "a", .value = "a2", .size = sizeof("a2")), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "a", .value = "a3", .size = sizeof("a3")), 0);
+	assert_int_equal(sid_kvs_rollback_to(kv_store_res, &sp1), -ERANGE);
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "a"), "a3");
+	sid_kvs_transaction_end(kv_store_res, true);
+
+	/* rolling back the whole transaction restores the oldest value of keys changed several times */
+	assert_int_equal(sid_kvs_transaction_begin(kv_store_res), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "a", .value = "a2", .size = sizeof("a2")), 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "a", .value = "a3", .size = sizeof("a3")), 0);
+	sid_kvs_transaction_end(kv_store_res, true);
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "a"), "a1");
+
+	sid_res_unref(kv_store_res);
+}
+
+static void test_kvstore_set_batch(void **state)
+{
+	sid_res_t              *kv_store_res;
+	struct sid_kvs_set_args args[] = {
+		{.key = "c", .value = "c0", .size = sizeof("c0")},
+		{.key = "a", .value = "yes", .size = sizeof("yes")},
+		{.key = "", .value = "x", .size = sizeof("x")},
+		{.key = "c", .value = "c1", .size = sizeof("c1")},
+		{.key = "b", .value = "b0", .size = sizeof("b0"), .archive_key = "~b"},
+	};
+	int                     results[sizeof(args) / sizeof(args[0])];
+	size_t                  count = sizeof(args) / sizeof(args[0]);
+
+	kv_store_res = sid_res_create(SID_RES_NO_PARENT,
+	                              &sid_res_type_kvs,
+	                              SID_RES_FL_RESTRICT_WALK_UP,
+	                              "testkvstore",
+	                              &main_kv_store_res_params,
+	                              SID_RES_PRIO_NORMAL,
+	                              SID_RES_NO_SERVICE_LINKS);
+
+	assert_int_equal(sid_kvs_index_register(kv_store_res,
+	                                        &((struct sid_kvs_index_spec) {.prefix = "%", .match_fn = _index_match_yes})),
+	                 0);
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "b", .value = "old", .size = sizeof("old")), 0);
+
+	/* failed item does not prevent the others from being set */
+	assert_int_equal(sid_kvs_set_batch(kv_store_res, args, count, results), -EINVAL);
+	assert_int_equal(results[0], 0);
+	assert_int_equal(results[1], 0);
+	assert_int_equal(results[2], -EINVAL);
+	assert_int_equal(results[3], 0);
+	assert_int_equal(results[4], 0);
+	assert_false(sid_kvs_transaction_active(kv_store_res));
+
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "c"), "c1");
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "b"), "b0");
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "~b"), "old");
+	assert_true(_index_has(kv_store_res, "%a"));
+	assert_int_equal(kv_store_num_entries(kv_store_res), 4);
+
+	/* batch within an active transaction is part of that transaction */
+	args[2].key = "d";
+	assert_int_equal(sid_kvs_transaction_begin(kv_store_res), 0);
+	assert_int_equal(sid_kvs_set_batch(kv_store_res, args, count, NULL), 0);
+	assert_true(sid_kvs_transaction_active(kv_store_res));
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "d"), "x");
+	sid_kvs_transaction_end(kv_store_res, true);
+	assert_null(sid_kvs_va_get(kv_store_res, .key = "d"));
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "~b"), "old");
+	assert_int_equal(kv_store_num_entries(kv_store_res), 4);
+
+	sid_res_unref(kv_store_res);
+}
+
+static int _unset_reject_a5(struct sid_kvs_update_spec *spec)
+{
+	return strcmp(spec->key, "a5") != 0;
+}
+
+static void test_kvstore_unset_range(void **state)
+{
+	sid_res_t *kv_store_res;
+	char       key[8];
+	int        i;
+
+	kv_store_res = sid_res_create(SID_RES_NO_PARENT,
+	                              &sid_res_type_kvs,
+	                              SID_RES_FL_RESTRICT_WALK_UP,
+	                              "testkvstore",
+	                              &main_kv_store_res_params,
+	                              SID_RES_PRIO_NORMAL,
+	                              SID_RES_NO_SERVICE_LINKS);
+
+	assert_int_equal(sid_kvs_index_register(kv_store_res,
+	                                        &((struct sid_kvs_index_spec) {.prefix = "%", .match_fn = _index_match_yes})),
+	                 0);
+
+	for (i = 0; i < 10; i++) {
+		snprintf(key, sizeof(key), "a%d", i);
+		assert_int_equal(sid_kvs_va_set(kv_store_res, .key = key, .value = "yes", .size = sizeof("yes")), 0);
+		snprintf(key, sizeof(key), "b%d", i);
+		assert_int_equal(sid_kvs_va_set(kv_store_res, .key = key, .value = "no", .size = sizeof("no")), 0);
+	}
+	assert_int_equal(sid_kvs_va_set(kv_store_res, .key = "c", .value = "no", .size = sizeof("no")), 0);
+	assert_int_equal(_index_count(kv_store_res, "%"), 10);
+
+	/* keys rejected by the callback are kept, index records follow the records */
+	assert_int_equal(sid_kvs_va_unset_prefix(kv_store_res, .prefix = "a", .fn = _unset_reject_a5), 9);
+	assert_null(sid_kvs_va_get(kv_store_res, .key = "a0"));
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "a5"), "yes");
+	assert_true(_index_has(kv_store_res, "%a5"));
+	assert_int_equal(_index_count(kv_store_res, "%"), 1);
+	assert_int_equal(kv_store_num_entries(kv_store_res), 12);
+
+	/* range start does not need to exist */
+	assert_int_equal(sid_kvs_va_unset_range(kv_store_res, .key_start = "b", .key_end = "b1"), 2);
+	assert_null(sid_kvs_va_get(kv_store_res, .key = "b1"));
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "b2"), "no");
+
+	/* unsets within a transaction are rolled back with it */
+	assert_int_equal(sid_kvs_transaction_begin(kv_store_res), 0);
+	assert_int_equal(sid_kvs_va_unset_range(kv_store_res, .key_start = "b2", .key_end = "b4"), 3);
+	sid_kvs_transaction_end(kv_store_res, true);
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "b3"), "no");
+	assert_int_equal(kv_store_num_entries(kv_store_res), 10);
+
+	/* each unset key is archived separately */
+	assert_int_equal(sid_kvs_va_unset_range(kv_store_res, .key_start = "b5", .archive_prefix = "~"), 6);
+	assert_null(sid_kvs_va_get(kv_store_res, .key = "c"));
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "~c"), "no");
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "~b9"), "no");
+	assert_int_equal(kv_store_num_entries(kv_store_res), 10);
+
+	/* index keys are never unset directly */
+	assert_int_equal(sid_kvs_va_unset_prefix(kv_store_res, .prefix = ""), 10);
+	assert_int_equal(kv_store_num_entries(kv_store_res), 0);
+	assert_int_equal(_index_count(kv_store_res, "%"), 0);
+
+	sid_res_unref(kv_store_res);
+}
+
+static void test_kvstore_unset_range_alias(void **state)
+{
+	sid_res_t *kv_store_res;
+	char       key[8];
+	int        i;
+
+	kv_store_res = sid_res_create(SID_RES_NO_PARENT,
+	                              &sid_res_type_kvs,
+	                              SID_RES_FL_RESTRICT_WALK_UP,
+	                              "testkvstore",
+	                              &main_kv_store_res_params,
+	                              SID_RES_PRIO_NORMAL,
+	                              SID_RES_NO_SERVICE_LINKS);
+
+	/* values are freed once, when the last key referencing them is unset */
+	for (i = 1; i <= 3; i += 2) {
+		snprintf(key, sizeof(key), "d%d", i);
+		assert_int_equal(sid_kvs_va_set(kv_store_res,
+		                                .key   = key,
+		                                .value = strdup("yes"),
+		                                .size  = sizeof("yes"),
+		                                .flags = SID_KVS_VAL_FL_REF | SID_KVS_VAL_FL_AUTOFREE),
+		                 0);
+	}
+	assert_int_equal(sid_kvs_add_alias(kv_store_res, "d1", "d2", false), 0);
+	assert_int_equal(sid_kvs_add_alias(kv_store_res, "d3", "e", false), 0);
+	assert_int_equal(sid_kvs_va_unset_range(kv_store_res, .key_start = "d", .key_end = "d9"), 3);
+	assert_null(sid_kvs_va_get(kv_store_res, .key = "d2"));
+	assert_string_equal(sid_kvs_va_get(kv_store_res, .key = "e"), "yes");
+	assert_int_equal(sid_kvs_va_unset_prefix(kv_store_res, .prefix = ""), 1);
+	assert_int_equal(kv_store_num_entries(kv_store_res), 0);
+
+	sid_res_unref(kv_store_res);
+}
+
+static void test_kv_key(void **state)
+{
+	static const char *keys[] = {"::D:dev1:::#RDY",
+	                             "::D:dev1:::#RES",
+	                             "::D:dev1-a:::#RDY",
+	                             "+::D:dev1:::#GMB",
+	                             "::G::::#BOOTID",
+	                             "#sys"};
+	struct kv_key      kv_key1, kv_key2;
+	const char        *str;
+	char              *key;
+	size_t             len;
+	unsigned           i, j;
+	int                r;
+
+	/* composed key is the same as the one composed with format string before */
+	key = _compose_key(NULL,
+	                   &KV_KEY_SPEC(.op = KV_OP_PLUS, .dom = "dom", .ns = SID_KV_NS_DEV, .ns_part = "dev1", .core = "#GMB"));
+	assert_string_equal(key, " +:dom:D:dev1:::#GMB");
+	_destroy_key(NULL, key);
+
+	key = _compose_key_prefix(NULL, &KV_KEY_SPEC(.ns = SID_KV_NS_DEV, .ns_part = "dev1", .core = "#GMB"));
+	assert_string_equal(key, "::D:dev1:::");
+
+	_kv_key_parse(&kv_key1, key);
+	assert_int_equal(kv_key1.last_part, KEY_PART_CORE);
+	assert_ptr_not_equal(str = _kv_key_get_part(&kv_key1, KEY_PART_NS_PART, &len), NULL);
+	assert_int_equal(len, 4);
+	assert_int_equal(strncmp(str, "dev1", len), 0);
+	assert_int_equal(_get_ns_from_kv_key(&kv_key1), SID_KV_NS_DEV);
+	assert_int_equal(_get_op_from_kv_key(&kv_key1), KV_OP_SET);
+	_destroy_key(NULL, key);
+
+	/* parsed keys give the same parts as scanning the key string each time */
+	for (i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+		_kv_key_parse(&kv_key1, keys[i]);
+		assert_int_equal(_get_ns_from_kv_key(&kv_key1), _get_ns_from_key(keys[i]));
+		assert_int_equal(_get_op_from_kv_key(&kv_key1), _get_op_from_key(keys[i]));
+		assert_ptr_equal(_kv_key_get_part(&kv_key1, KEY_PART_CORE, NULL), _get_key_part(keys[i], KEY_PART_CORE, NULL));
+	}
+
+	/* comparing whole keys keeps the order of keys in KV store */
+	for (i = 0; i < sizeof(keys) / sizeof(keys[0]); i++) {
+		_kv_key_parse(&kv_key1, keys[i]);
+
+		for (j = 0; j < sizeof(keys) / sizeof(keys[0]); j++) {
+			_kv_key_parse(&kv_key2, keys[j]);
+			r = _kv_key_cmp(&kv_key1, &kv_key2, KEY_PART_CORE);
+			assert_int_equal((r > 0) - (r < 0), (strcmp(keys[i], keys[j]) > 0) - (strcmp(keys[i], keys[j]) < 0));
+		}
+	}
+
+	/* comparing up to ns_part groups keys of the same device */
+	_kv_key_parse(&kv_key1, keys[0]);
+	_kv_key_parse(&kv_key2, keys[1]);
+	assert_int_equal(_kv_key_cmp(&kv_key1, &kv_key2, KEY_PART_NS_PART), 0);
+	_kv_key_parse(&kv_key2, keys[2]);
+	assert_true(_kv_key_cmp(&kv_key1, &kv_key2, KEY_PART_NS_PART) < 0);
+}
+
 int main(void)
 {
 	cmocka_set_message_output(CM_OUTPUT_STDOUT);
@@ -290,6 +787,13 @@ int main(void)
 		cmocka_unit_test(test_type_H),
 		cmocka_unit_test(test_kvstore_iterate),
 		cmocka_unit_test(test_kvstore_merge_op),
+		cmocka_unit_test(test_scan_cache_fingerprint),
+		cmocka_unit_test(test_kvstore_index),
+		cmocka_unit_test(test_kvstore_savepoint),
+		cmocka_unit_test(test_kvstore_set_batch),
+		cmocka_unit_test(test_kvstore_unset_range),
+		cmocka_unit_test(test_kvstore_unset_range_alias),
+		cmocka_unit_test(test_kv_key),
 	};
 	return cmocka_run_group_tests(tests, NULL, NULL);
 }